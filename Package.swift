@@ -31,7 +31,8 @@ let package = Package(
             name: "CRecast"),
         .testTarget(
             name: "RecastTests",
-            dependencies: ["SwiftNavigation"],
+            dependencies: ["SwiftNavigation", "CRecast"],
+            path: "Tests/DetourTests",
             swiftSettings: [.interoperabilityMode(.Cxx)]),
     ]
 )
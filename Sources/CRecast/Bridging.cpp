@@ -8,75 +8,86 @@
 #include "RecastAssert.h"
 #include "DetourNavMeshBuilder.h"
 #include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
 
+#include <float.h>
+#include <limits.h>
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
-// This runs the pipeline from beginning to end, based on the sample code and
-struct BindingBulkResult *bindingRunBulk(rcConfig *cfg, int flags, const float* verts, int nverts, const int* tris, int ntris)
-{
-    rcHeightfield *hf = nullptr;
-    rcCompactHeightfield *chf = nullptr;
-    rcContourSet *cset = nullptr;
-    rcPolyMesh *poly_mesh = nullptr;
-    rcPolyMeshDetail *detail_mesh = nullptr;
-    rcContext ctx;
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
-    if (false) 
+//
+// The Recast structures used by the pipeline.  A pooled context is kept by each
+// tile worker: the structures are reset by every build and keep the capacity of the
+// largest tile seen so far, so steady-state builds do not go back to the heap.  A
+// context that is not pooled releases the intermediate structures as soon as they
+// are no longer needed, to keep the peak memory of a one-off build down.
+//
+struct BindingBuildContext {
+    rcHeightfield *hf;
+    rcCompactHeightfield *chf;
+    rcContourSet *cset;
+    rcPolyMesh *poly_mesh;
+    rcPolyMeshDetail *detail_mesh;
+    std::vector<unsigned char> tri_areas;
+    bool pooled;
+
+    BindingBuildContext (bool pooled)
+        : hf (nullptr), chf (nullptr), cset (nullptr), poly_mesh (nullptr), detail_mesh (nullptr), pooled (pooled)
     {
-        unlink ("/tmp/imported.obj");
-        FILE *o = fopen ("/tmp/imported.obj", "w");
-        int i = 0;
-        for (i = 0; i < nverts; i++){
-            const float *v = &verts [i*3];
+    }
 
-            fprintf (o, "v %g %g %g\n", v[0], v[1], v[2]);
-        }
-        int top = ntris*3;
-        for (i = 0; i < top; i += 3) {
-            fprintf (o, "f %d %d %d\n", tris [i]+1, tris[i+1]+1, tris [i+2]+1);
-        }
-        fclose (o);
+    ~BindingBuildContext ()
+    {
+        release ();
     }
 
-    // Allocate voxel heightfield where we rasterize our input data to.
-    hf = rcAllocHeightfield ();
-    if (hf == nullptr) {
-        return NULL;
+    // Gives all the memory back, the next build allocates the structures again
+    void release ()
+    {
+        rcFreeHeightField (hf);
+        rcFreeCompactHeightfield (chf);
+        rcFreeContourSet (cset);
+        rcFreePolyMesh (poly_mesh);
+        rcFreePolyMeshDetail (detail_mesh);
+        hf = nullptr;
+        chf = nullptr;
+        cset = nullptr;
+        poly_mesh = nullptr;
+        detail_mesh = nullptr;
+        std::vector<unsigned char> ().swap (tri_areas);
     }
-    struct BindingBulkResult *result = (struct BindingBulkResult *) calloc (1, sizeof (struct BindingBulkResult));
-    result->code = BCODE_ERR_UNKNOWN;
-    
-    // Save some data, in case we want to use it to generate a Detour package.
-    result->max_verts_per_poly = cfg->maxVertsPerPoly;
-    result->cs = cfg->cs;
-    result->ch = cfg->ch;
-    
-    unsigned char *tri_areas;
+
+private:
+    BindingBuildContext (const BindingBuildContext&);
+    BindingBuildContext& operator= (const BindingBuildContext&);
+};
+
+//
+// Runs the Recast pipeline over bc->hf, which has all the geometry rasterized
+// into it, producing bc->poly_mesh and bc->detail_mesh.  The borderSize is passed
+// to the partitioning steps, it is zero for a single mesh, and the tile border for tiles.
+//
+static BCodeStatus
+runPolyMeshPipeline (rcContext *ctx, const rcConfig *cfg, int flags, int borderSize, BindingBuildContext *bc)
+{
+    rcHeightfield *hf = bc->hf;
     int partition;
     
-    if (!rcCreateHeightfield(&ctx, *hf, cfg->width, cfg->height, cfg->bmin, cfg->bmax, cfg->cs, cfg->ch))
-        goto exit1;
-    
-    tri_areas = (unsigned char*) calloc(ntris, sizeof (unsigned char));
-    if (tri_areas == NULL){
-        result->code = BCODE_ERR_MEMORY;
-        goto exit1;
-    }
-    
-    // Find triangles which are walkable based on their slope and rasterize them.
-    // If your input data is multiple meshes, you can transform them here, calculate
-    // the are type for each of the meshes and rasterize them.
-    rcMarkWalkableTriangles(&ctx, cfg->walkableSlopeAngle, verts, nverts, tris, ntris, tri_areas);
-    
-    if (!rcRasterizeTriangles(&ctx, verts, nverts, tris, tri_areas, ntris, *hf, cfg->walkableClimb)){
-        result->code = BCODE_ERR_RASTERIZE;
-        goto exit1;
-    }
-    
     //
     // Step 3. Filter walkable surfaces.
     //
@@ -84,11 +95,11 @@ struct BindingBulkResult *bindingRunBulk(rcConfig *cfg, int flags, const float*
     // remove unwanted overhangs caused by the conservative rasterization
     // as well as filter spans where the character cannot possibly stand.
     if (flags & FILTER_LOW_HANGING_OBSTACLES)
-        rcFilterLowHangingWalkableObstacles(&ctx, cfg->walkableClimb, *hf);
+        rcFilterLowHangingWalkableObstacles(ctx, cfg->walkableClimb, *hf);
     if (flags & FILTER_LEDGE_SPANS)
-        rcFilterLedgeSpans(&ctx, cfg->walkableHeight, cfg->walkableClimb, *hf);
+        rcFilterLedgeSpans(ctx, cfg->walkableHeight, cfg->walkableClimb, *hf);
     if (flags & FILTER_WALKABLE_LOW_HEIGHT_SPANS)
-        rcFilterWalkableLowHeightSpans(&ctx, cfg->walkableHeight, *hf);
+        rcFilterWalkableLowHeightSpans(ctx, cfg->walkableHeight, *hf);
     
     //
     // Step 4. Partition walkable surface to simple regions.
@@ -96,106 +107,208 @@ struct BindingBulkResult *bindingRunBulk(rcConfig *cfg, int flags, const float*
     // Compact the heightfield so that it is faster to handle from now on.
     // This will result more cache coherent data as well as the neighbours
     // between walkable cells will be calculated.
-    chf = rcAllocCompactHeightfield();
-    if (!chf){
-        result->code = BCODE_ERR_MEMORY;
-        goto exit1;
-    }
-    
+    if (!bc->chf)
+        bc->chf = rcAllocCompactHeightfield();
+    if (!bc->chf)
+        return BCODE_ERR_MEMORY;
+    rcCompactHeightfield *chf = bc->chf;
     
-    if (!rcBuildCompactHeightfield(&ctx, cfg->walkableHeight, cfg->walkableClimb, *hf, *chf)){
-        result->code = BCODE_ERR_BUILD_COMPACT_HEIGHTFIELD;
-        goto exit2;
-    }
-    if (hf){
-        rcFreeHeightField (hf);
-        hf = nullptr;
+    if (!rcBuildCompactHeightfield(ctx, cfg->walkableHeight, cfg->walkableClimb, *hf, *chf))
+        return BCODE_ERR_BUILD_COMPACT_HEIGHTFIELD;
+    if (!bc->pooled){
+        rcFreeHeightField (bc->hf);
+        bc->hf = nullptr;
     }
 
     // Erode the walkable area by agent radius.
-    rcErodeWalkableArea(&ctx, cfg->walkableRadius, *chf);
+    rcErodeWalkableArea(ctx, cfg->walkableRadius, *chf);
     
     partition = flags & PARTITION_MASK;
     if (partition == PARTITION_LAYER) {
         // Partition the walkable surface into simple regions without holes.
-        if (!rcBuildLayerRegions(&ctx, *chf, 0, cfg->minRegionArea)){
-            result->code = BCODE_ERR_BUILD_LAYER_REGIONS;
-            goto exit2;
-        }
+        if (!rcBuildLayerRegions(ctx, *chf, borderSize, cfg->minRegionArea))
+            return BCODE_ERR_BUILD_LAYER_REGIONS;
     } else if (partition == PARTITION_MONOTONE) {
         // Partition the walkable surface into simple regions without holes.
         // Monotone partitioning does not need distancefield.
-        if (!rcBuildRegionsMonotone(&ctx, *chf, 0, cfg->minRegionArea, cfg->mergeRegionArea)){
-            result->code = BCODE_ERR_BUILD_REGIONS_MONOTONE;
-            goto exit2;
-        }
+        if (!rcBuildRegionsMonotone(ctx, *chf, borderSize, cfg->minRegionArea, cfg->mergeRegionArea))
+            return BCODE_ERR_BUILD_REGIONS_MONOTONE;
     } else if (partition == PARTITION_WATERSHED) {
         // Prepare for region partitioning, by calculating distance field along the walkable surface.
-        if (!rcBuildDistanceField(&ctx, *chf)) {
-            result->code = BCODE_ERR_BUILD_DISTANCE_FIELD;
-            goto exit2;
-        }
+        if (!rcBuildDistanceField(ctx, *chf))
+            return BCODE_ERR_BUILD_DISTANCE_FIELD;
         // Partition the walkable surface into simple regions without holes.
-        if (!rcBuildRegions(&ctx, *chf, 0, cfg->minRegionArea, cfg->mergeRegionArea)) {
-            result->code = BCODE_ERR_BUILD_REGIONS;
-            goto exit2;
-        }
+        if (!rcBuildRegions(ctx, *chf, borderSize, cfg->minRegionArea, cfg->mergeRegionArea))
+            return BCODE_ERR_BUILD_REGIONS;
     }
     
     //
     // Step 5. Trace and simplify region contours.
     //
-    cset = rcAllocContourSet();
-    if (cset == NULL) {
-        result->code = BCODE_ERR_ALLOC_CONTOUR;
-        goto exit2;
-    }
-    if (!rcBuildContours(&ctx, *chf, cfg->maxSimplificationError, cfg->maxEdgeLen, *cset)){
-        result->code = BCODE_ERR_BUILD_CONTOUR;
-        goto exit3;
-    }
+    if (!bc->cset)
+        bc->cset = rcAllocContourSet();
+    if (!bc->cset)
+        return BCODE_ERR_ALLOC_CONTOUR;
+    if (!rcBuildContours(ctx, *chf, cfg->maxSimplificationError, cfg->maxEdgeLen, *bc->cset))
+        return BCODE_ERR_BUILD_CONTOUR;
     
     //
     // Step 6. Build polygons mesh from contours.
     //
     // Build polygon navmesh from the contours.
-    poly_mesh = rcAllocPolyMesh();
-    if (!poly_mesh) {
-        result->code = BCODE_ERR_ALLOC_POLYMESH;
-        goto exit3;
-    }
-    if (!rcBuildPolyMesh(&ctx, *cset, cfg->maxVertsPerPoly, *poly_mesh)){
-        result->code = BCODE_ERR_BUILD_POLY_MESH;
-        goto exit4;
+    if (!bc->poly_mesh)
+        bc->poly_mesh = rcAllocPolyMesh();
+    if (!bc->poly_mesh)
+        return BCODE_ERR_ALLOC_POLYMESH;
+    if (!rcBuildPolyMesh(ctx, *bc->cset, cfg->maxVertsPerPoly, *bc->poly_mesh))
+        return BCODE_ERR_BUILD_POLY_MESH;
+    if (!bc->pooled){
+        rcFreeContourSet (bc->cset);
+        bc->cset = nullptr;
     }
+    
     //
     // Step 7. Create detail mesh which allows to access approximate height on each polygon.
     //
-    detail_mesh = rcAllocPolyMeshDetail();
-    if (!detail_mesh) {
-        result->code = BCODE_ERR_ALLOC_DETAIL_POLY_MESH;
-        goto exit4;
-    }
-    if (!rcBuildPolyMeshDetail(&ctx, *poly_mesh, *chf, cfg->detailSampleDist, cfg->detailSampleMaxError, *detail_mesh)){
-        result->code = BCODE_ERR_BUILD_DETAIL_POLY_MESH;
-        goto exit5;
-    }
-    rcFreeCompactHeightfield(chf);
-    chf = nullptr;
-    rcFreeContourSet(cset);
-    cset = nullptr;
+    if (!bc->detail_mesh)
+        bc->detail_mesh = rcAllocPolyMeshDetail();
+    if (!bc->detail_mesh)
+        return BCODE_ERR_ALLOC_DETAIL_POLY_MESH;
+    if (!rcBuildPolyMeshDetail(ctx, *bc->poly_mesh, *chf, cfg->detailSampleDist, cfg->detailSampleMaxError, *bc->detail_mesh))
+        return BCODE_ERR_BUILD_DETAIL_POLY_MESH;
+    if (!bc->pooled){
+        rcFreeCompactHeightfield (bc->chf);
+        bc->chf = nullptr;
+    }
     
     // At this point the navigation mesh data is ready, you can access it from poly_mesh.
     // See duDebugDrawPolyMesh or dtCreateNavMeshData as examples how to access the data.
+    return BCODE_OK;
+}
+
+//
+// Rasterizes the triangles into bc->hf, which is reset to the field described by cfg.
+// The area ids are used when given, otherwise the triangles are marked by their slope.
+//
+static BCodeStatus
+rasterizeTriangles (rcContext *ctx, const rcConfig *cfg, const float* verts, int nverts, const int* tris, int ntris,
+                    const unsigned char *areas, BindingBuildContext *bc)
+{
+    // Allocate voxel heightfield where we rasterize our input data to.
+    if (bc->hf == nullptr)
+        bc->hf = rcAllocHeightfield ();
+    if (bc->hf == nullptr)
+        return BCODE_ERR_MEMORY;
+    
+    if (!rcCreateHeightfield(ctx, *bc->hf, cfg->width, cfg->height, cfg->bmin, cfg->bmax, cfg->cs, cfg->ch))
+        return BCODE_ERR_UNKNOWN;
+    
+    if (areas != NULL) {
+        bc->tri_areas.assign (areas, areas + ntris);
+    } else {
+        bc->tri_areas.assign (ntris, 0);
+
+        // Find triangles which are walkable based on their slope and rasterize them.
+        // If your input data is multiple meshes, you can transform them here, calculate
+        // the are type for each of the meshes and rasterize them.
+        rcMarkWalkableTriangles(ctx, cfg->walkableSlopeAngle, verts, nverts, tris, ntris, bc->tri_areas.data ());
+    }
+    
+    if (!rcRasterizeTriangles(ctx, verts, nverts, tris, bc->tri_areas.data (), ntris, *bc->hf, cfg->walkableClimb))
+        return BCODE_ERR_RASTERIZE;
+    return BCODE_OK;
+}
+
+// Hands the meshes of a successful build over to the caller
+static BCodeStatus
+takePolyMeshes (BCodeStatus code, BindingBuildContext *bc, rcPolyMesh **poly_mesh_result, rcPolyMeshDetail **detail_mesh_result)
+{
+    if (code != BCODE_OK)
+        return code;
+    *poly_mesh_result = bc->poly_mesh;
+    *detail_mesh_result = bc->detail_mesh;
+    bc->poly_mesh = nullptr;
+    bc->detail_mesh = nullptr;
+    return BCODE_OK;
+}
+
+//
+// Runs the Recast pipeline over a heightfield with all the geometry rasterized
+// into it, see runPolyMeshPipeline.
+//
+// The heightfield is released.  On success the meshes are stored in poly_mesh_result
+// and detail_mesh_result and must be released by the caller.
+static BCodeStatus
+buildPolyMeshesFromHeightfield (rcContext *ctx, const rcConfig *cfg, int flags, int borderSize, rcHeightfield *hf,
+                                rcPolyMesh **poly_mesh_result, rcPolyMeshDetail **detail_mesh_result)
+{
+    BindingBuildContext bc (false);
+    bc.hf = hf;
+    return takePolyMeshes (runPolyMeshPipeline (ctx, cfg, flags, borderSize, &bc), &bc, poly_mesh_result, detail_mesh_result);
+}
+
+//
+// Runs the Recast pipeline over the triangles rasterized into the field described by
+// cfg, see buildPolyMeshesFromHeightfield.
+//
+static BCodeStatus
+buildPolyMeshes (rcContext *ctx, const rcConfig *cfg, int flags, int borderSize,
+                 const float* verts, int nverts, const int* tris, int ntris,
+                 rcPolyMesh **poly_mesh_result, rcPolyMeshDetail **detail_mesh_result)
+{
+    BindingBuildContext bc (false);
+    BCodeStatus code = rasterizeTriangles (ctx, cfg, verts, nverts, tris, ntris, NULL, &bc);
+    if (code != BCODE_OK)
+        return code;
+    return takePolyMeshes (runPolyMeshPipeline (ctx, cfg, flags, borderSize, &bc), &bc, poly_mesh_result, detail_mesh_result);
+}
+
+// This runs the pipeline from beginning to end, based on the sample code and
+struct BindingBulkResult *bindingRunBulk(rcConfig *cfg, int flags, int maxThreads, const float* verts, int nverts, const int* tris, int ntris)
+{
+    rcContext ctx;
+
+    if (maxThreads <= 0)
+        maxThreads = (int) sysconf (_SC_NPROCESSORS_ONLN);
+    ctx.setMaxThreads (maxThreads);
+
+    if (false) 
+    {
+        unlink ("/tmp/imported.obj");
+        FILE *o = fopen ("/tmp/imported.obj", "w");
+        int i = 0;
+        for (i = 0; i < nverts; i++){
+            const float *v = &verts [i*3];
+
+            fprintf (o, "v %g %g %g\n", v[0], v[1], v[2]);
+        }
+        int top = ntris*3;
+        for (i = 0; i < top; i += 3) {
+            fprintf (o, "f %d %d %d\n", tris [i]+1, tris[i+1]+1, tris [i+2]+1);
+        }
+        fclose (o);
+    }
+
+    struct BindingBulkResult *result = (struct BindingBulkResult *) calloc (1, sizeof (struct BindingBulkResult));
+    if (result == NULL)
+        return NULL;
+    
+    // Save some data, in case we want to use it to generate a Detour package.
+    result->max_verts_per_poly = cfg->maxVertsPerPoly;
+    result->cs = cfg->cs;
+    result->ch = cfg->ch;
     
-    result->code = BCODE_OK;
-    result->poly_mesh = poly_mesh;
-    result->poly_mesh_detail = detail_mesh;
+    result->code = buildPolyMeshes (&ctx, cfg, flags, 0, verts, nverts, tris, ntris, &result->poly_mesh, &result->poly_mesh_detail);
+    if (result->code != BCODE_OK)
+        return result;
+
+    rcPolyMesh *poly_mesh = result->poly_mesh;
     if (poly_mesh->nverts == 0) {
         printf ("poly_mesh returned zero vertices, not good");
     }
 #if false
     {
+        rcPolyMeshDetail *detail_mesh = result->poly_mesh_detail;
         unlink ("/tmp/output.obj");
         FILE *o = fopen ("/tmp/output.obj", "w");
         int i = 0;
@@ -208,23 +321,6 @@ struct BindingBulkResult *bindingRunBulk(rcConfig *cfg, int flags, const float*
     }
 #endif
     return result;
-    
-exit5:
-    if (detail_mesh)
-        rcFreePolyMeshDetail(detail_mesh);
-exit4:
-    if (poly_mesh)
-        rcFreePolyMesh(poly_mesh);
-exit3:
-    if (cset)
-        rcFreeContourSet(cset);
-exit2:
-    if (chf)
-        rcFreeCompactHeightfield(chf);
-exit1:
-    if (hf)
-        rcFreeHeightField (hf);
-    return result;
 }
 
 void
@@ -387,3 +483,2085 @@ freeVertsAndTriangles (BindingVertsAndTriangles *data) {
     }
     free (data);
 }
+
+//
+// Point sample fields
+//
+// Keeps a heightfield that point clouds or depth samples are splatted into, frame
+// after frame, without meshing them first.   Building copies the heightfield, since
+// the filters change the areas of its spans, so the field keeps accumulating.
+//
+
+struct BindingPointField {
+    rcConfig config;
+    rcHeightfield *hf;
+};
+
+BindingPointField *
+bindingCreatePointField (const rcConfig *cfg)
+{
+    rcContext ctx (false);
+    BindingPointField *field = (BindingPointField *) calloc (1, sizeof (BindingPointField));
+    if (field == NULL)
+        return NULL;
+    field->config = *cfg;
+    field->hf = rcAllocHeightfield ();
+    if (field->hf == NULL || !rcCreateHeightfield (&ctx, *field->hf, cfg->width, cfg->height, cfg->bmin, cfg->bmax, cfg->cs, cfg->ch)) {
+        bindingFreePointField (field);
+        return NULL;
+    }
+    return field;
+}
+
+void
+bindingFreePointField (BindingPointField *field)
+{
+    if (field->hf)
+        rcFreeHeightField (field->hf);
+    free (field);
+}
+
+bool
+bindingPointFieldAdd (BindingPointField *field, const float *points, const float *normals, int count, float splatRadius)
+{
+    rcContext ctx (false);
+    const rcConfig &cfg = field->config;
+    return rcRasterizePoints (&ctx, points, normals, count, cfg.walkableSlopeAngle, splatRadius, RC_WALKABLE_AREA,
+                              1, *field->hf, cfg.walkableClimb);
+}
+
+bool
+bindingPointFieldAddSphere (BindingPointField *field, const float *center, float radius)
+{
+    rcContext ctx (false);
+    const rcConfig &cfg = field->config;
+    return rcRasterizeSphere (&ctx, center, radius, cfg.walkableSlopeAngle, RC_WALKABLE_AREA, *field->hf, cfg.walkableClimb);
+}
+
+bool
+bindingPointFieldAddCapsule (BindingPointField *field, const float *start, const float *end, float radius)
+{
+    rcContext ctx (false);
+    const rcConfig &cfg = field->config;
+    return rcRasterizeCapsule (&ctx, start, end, radius, cfg.walkableSlopeAngle, RC_WALKABLE_AREA, *field->hf, cfg.walkableClimb);
+}
+
+bool
+bindingPointFieldAddBox (BindingPointField *field, const float *center, const float *halfExtents, const float *axes)
+{
+    rcContext ctx (false);
+    const rcConfig &cfg = field->config;
+    return rcRasterizeBox (&ctx, center, halfExtents, axes, cfg.walkableSlopeAngle, RC_WALKABLE_AREA, *field->hf, cfg.walkableClimb);
+}
+
+void
+bindingPointFieldClear (BindingPointField *field, const float *bmin, const float *bmax)
+{
+    rcContext ctx (false);
+    if (bmin == NULL || bmax == NULL) {
+        bmin = field->hf->bmin;
+        bmax = field->hf->bmax;
+    }
+    rcClearSpans (&ctx, bmin, bmax, *field->hf);
+}
+
+BindingBulkResult *
+bindingPointFieldBuild (BindingPointField *field, int flags, int maxThreads)
+{
+    rcContext ctx;
+    if (maxThreads <= 0)
+        maxThreads = (int) sysconf (_SC_NPROCESSORS_ONLN);
+    ctx.setMaxThreads (maxThreads);
+
+    const rcConfig *cfg = &field->config;
+    BindingBulkResult *result = (BindingBulkResult *) calloc (1, sizeof (BindingBulkResult));
+    if (result == NULL)
+        return NULL;
+    result->max_verts_per_poly = cfg->maxVertsPerPoly;
+    result->cs = cfg->cs;
+    result->ch = cfg->ch;
+
+    rcHeightfield *hf = rcAllocHeightfield ();
+    if (hf == NULL) {
+        result->code = BCODE_ERR_MEMORY;
+        return result;
+    }
+    if (!rcCreateHeightfield (&ctx, *hf, cfg->width, cfg->height, cfg->bmin, cfg->bmax, cfg->cs, cfg->ch)) {
+        rcFreeHeightField (hf);
+        result->code = BCODE_ERR_UNKNOWN;
+        return result;
+    }
+    const rcHeightfield *src = field->hf;
+    for (int i = 0; i < src->width*src->height; i++) {
+        for (const rcSpan *span = src->spans [i]; span != NULL; span = span->next) {
+            if (!rcAddSpan (&ctx, *hf, i % src->width, i / src->width, span->smin, span->smax, span->area, 0)) {
+                rcFreeHeightField (hf);
+                result->code = BCODE_ERR_MEMORY;
+                return result;
+            }
+        }
+    }
+
+    result->code = buildPolyMeshesFromHeightfield (&ctx, cfg, flags, 0, hf, &result->poly_mesh, &result->poly_mesh_detail);
+    return result;
+}
+
+int
+bindingPointFieldGetSpans (const BindingPointField *field, int x, int z, BindingSpan *spans, int maxSpans)
+{
+    const rcHeightfield *hf = field->hf;
+    if (x < 0 || z < 0 || x >= hf->width || z >= hf->height)
+        return -1;
+    int count = 0;
+    for (const rcSpan *span = hf->spans [x + z*hf->width]; span != NULL; span = span->next) {
+        if (count < maxSpans) {
+            spans [count].smin = span->smin;
+            spans [count].smax = span->smax;
+            spans [count].area = span->area;
+        }
+        count++;
+    }
+    return count;
+}
+
+//
+// Debug mesh extraction
+//
+// Unlike bindingExtractVertsAndTriangles, this works on the tiles of a live
+// dtNavMesh, using the detail triangles so the geometry follows the height of
+// the ground.   The vertex buffer of a tile is its polygon vertices followed by
+// its detail vertices, so no vertex is duplicated.
+//
+// A tile is identified by its salt and data, which change every time a tile is
+// added or removed, so finding the changed tiles is a scan of the tile slots.
+//
+
+struct BindingDebugMeshSlot {
+    unsigned int salt;
+    const dtMeshHeader *header;
+    int vertCapacity, triCapacity;
+};
+
+struct BindingDebugMesh {
+    const dtNavMesh *navMesh;
+    float heightOffset;
+    unsigned int version;
+    // The slot the next update starts scanning from, so that a limited update
+    // resumes where the previous one stopped instead of at the first slot
+    int cursor;
+    std::vector<BindingDebugTileMesh> tiles;
+    std::vector<BindingDebugMeshSlot> slots;
+};
+
+BindingDebugMesh *
+bindingCreateDebugMesh (const dtNavMesh *navMesh, float heightOffset)
+{
+    if (navMesh == NULL)
+        return NULL;
+    BindingDebugMesh *mesh = new (std::nothrow) BindingDebugMesh ();
+    if (mesh == NULL)
+        return NULL;
+    mesh->navMesh = navMesh;
+    mesh->heightOffset = heightOffset;
+    mesh->version = 0;
+    mesh->cursor = 0;
+    const int maxTiles = navMesh->getMaxTiles ();
+    mesh->tiles.resize (maxTiles);
+    mesh->slots.resize (maxTiles);
+    memset (mesh->tiles.data (), 0, sizeof (BindingDebugTileMesh)*maxTiles);
+    memset (mesh->slots.data (), 0, sizeof (BindingDebugMeshSlot)*maxTiles);
+    return mesh;
+}
+
+void
+bindingFreeDebugMesh (BindingDebugMesh *mesh)
+{
+    if (mesh == NULL)
+        return;
+    for (size_t i = 0; i < mesh->tiles.size (); i++) {
+        free (mesh->tiles [i].verts);
+        free (mesh->tiles [i].triangles);
+    }
+    delete mesh;
+}
+
+// Fills the buffers of a slot from its tile, growing them only when needed
+static bool
+extractDebugTile (BindingDebugMesh *mesh, int index, const dtMeshTile *tile)
+{
+    BindingDebugTileMesh &out = mesh->tiles [index];
+    BindingDebugMeshSlot &slot = mesh->slots [index];
+    out.nverts = 0;
+    out.ntris = 0;
+    if (tile == NULL || tile->header == NULL)
+        return true;
+
+    const dtMeshHeader *header = tile->header;
+    int nverts = header->vertCount + header->detailVertCount;
+    int ntris = 0;
+    for (int i = 0; i < header->polyCount; i++) {
+        const dtPoly *poly = &tile->polys [i];
+        if (poly->getType () == DT_POLYTYPE_OFFMESH_CONNECTION)
+            continue;
+        ntris += tile->detailMeshes ? tile->detailMeshes [i].triCount : poly->vertCount - 2;
+    }
+
+    if (nverts > slot.vertCapacity) {
+        float *verts = (float *) realloc (out.verts, sizeof (float)*4*nverts);
+        if (verts == NULL)
+            return false;
+        out.verts = verts;
+        slot.vertCapacity = nverts;
+    }
+    if (ntris > slot.triCapacity) {
+        uint32_t *triangles = (uint32_t *) realloc (out.triangles, sizeof (uint32_t)*3*ntris);
+        if (triangles == NULL)
+            return false;
+        out.triangles = triangles;
+        slot.triCapacity = ntris;
+    }
+
+    float *v = out.verts;
+    for (int i = 0; i < header->vertCount; i++, v += 4) {
+        const float *src = &tile->verts [i*3];
+        v [0] = src [0];
+        v [1] = src [1] + mesh->heightOffset;
+        v [2] = src [2];
+        v [3] = 0;
+    }
+    for (int i = 0; i < header->detailVertCount; i++, v += 4) {
+        const float *src = &tile->detailVerts [i*3];
+        v [0] = src [0];
+        v [1] = src [1] + mesh->heightOffset;
+        v [2] = src [2];
+        v [3] = 0;
+    }
+
+    uint32_t *t = out.triangles;
+    for (int i = 0; i < header->polyCount; i++) {
+        const dtPoly *poly = &tile->polys [i];
+        if (poly->getType () == DT_POLYTYPE_OFFMESH_CONNECTION)
+            continue;
+        if (tile->detailMeshes == NULL) {
+            for (int j = 2; j < poly->vertCount; j++) {
+                *t++ = poly->verts [0];
+                *t++ = poly->verts [j-1];
+                *t++ = poly->verts [j];
+            }
+            continue;
+        }
+        const dtPolyDetail *pd = &tile->detailMeshes [i];
+        for (int j = 0; j < pd->triCount; j++) {
+            const unsigned char *dt = &tile->detailTris [(pd->triBase + j)*4];
+            for (int k = 0; k < 3; k++) {
+                if (dt [k] < poly->vertCount)
+                    *t++ = poly->verts [dt [k]];
+                else
+                    *t++ = header->vertCount + pd->vertBase + (dt [k] - poly->vertCount);
+            }
+        }
+    }
+    out.nverts = nverts;
+    out.ntris = ntris;
+    return true;
+}
+
+int
+bindingDebugMeshUpdate (BindingDebugMesh *mesh, int maxTiles)
+{
+    const dtNavMesh *nav = mesh->navMesh;
+    const unsigned int version = mesh->version + 1;
+    const int nslots = (int) mesh->slots.size ();
+    int count = 0;
+    for (int k = 0; k < nslots; k++) {
+        const int i = (mesh->cursor + k) % nslots;
+        if (maxTiles > 0 && count >= maxTiles) {
+            mesh->cursor = i;
+            break;
+        }
+        const dtMeshTile *tile = nav->getTile (i);
+        BindingDebugMeshSlot &slot = mesh->slots [i];
+        if (tile->header == slot.header && (tile->header == NULL || tile->salt == slot.salt))
+            continue;
+
+        BindingDebugTileMesh &out = mesh->tiles [i];
+        if (!extractDebugTile (mesh, i, tile)) {
+            // Leave the slot to be retried, with empty buffers rather than stale ones.
+            out.ref = 0;
+            out.version = version;
+            slot.header = NULL;
+            count++;
+            continue;
+        }
+        out.ref = tile->header ? nav->getTileRef (tile) : 0;
+        out.version = version;
+        slot.header = tile->header;
+        slot.salt = tile->salt;
+        count++;
+    }
+    if (count > 0)
+        mesh->version = version;
+    return count;
+}
+
+unsigned int
+bindingDebugMeshVersion (const BindingDebugMesh *mesh)
+{
+    return mesh->version;
+}
+
+int
+bindingDebugMeshTileCount (const BindingDebugMesh *mesh)
+{
+    return (int) mesh->tiles.size ();
+}
+
+int
+bindingDebugMeshChangedTiles (const BindingDebugMesh *mesh, unsigned int sinceVersion, int *tiles, int maxTiles)
+{
+    int n = 0;
+    for (int i = 0; i < (int) mesh->tiles.size () && n < maxTiles; i++) {
+        if (mesh->tiles [i].version > sinceVersion)
+            tiles [n++] = i;
+    }
+    return n;
+}
+
+const BindingDebugTileMesh *
+bindingDebugMeshTile (const BindingDebugMesh *mesh, int tile)
+{
+    if (tile < 0 || tile >= (int) mesh->tiles.size ())
+        return NULL;
+    return &mesh->tiles [tile];
+}
+
+//
+// Computes the polygon corridor between two polygons and string-pulls it, so
+// both Detour steps happen in a single call from Swift.   All the output is
+// written into the caller-owned buffers, nothing is allocated here.
+//
+// Returns the status of the straight path query, with the detail bits of the
+// corridor search (for example DT_PARTIAL_RESULT) merged in.
+dtStatus
+bindingFindStraightPathCorridor (const dtNavMeshQuery *query, const dtQueryFilter *filter,
+                                 dtPolyRef startRef, dtPolyRef endRef, const float *startPos, const float *endPos,
+                                 dtPolyRef *corridor, int *corridorCount, int maxCorridor,
+                                 float *straightPath, unsigned char *straightPathFlags, dtPolyRef *straightPathRefs,
+                                 int *straightPathCount, int maxStraightPath, int options)
+{
+    *corridorCount = 0;
+    *straightPathCount = 0;
+    
+    dtStatus status = query->findPath(startRef, endRef, startPos, endPos, filter, corridor, corridorCount, maxCorridor);
+    if (dtStatusFailed(status))
+        return status;
+    if (*corridorCount == 0)
+        return DT_FAILURE;
+    
+    dtStatus straightStatus = query->findStraightPath(startPos, endPos, corridor, *corridorCount,
+                                                      straightPath, straightPathFlags, straightPathRefs,
+                                                      straightPathCount, maxStraightPath, options);
+    if (dtStatusFailed(straightStatus))
+        return straightStatus;
+    return straightStatus | (status & DT_STATUS_DETAIL_MASK);
+}
+
+BindingPathResult *
+bindingAllocPathResult (int maxCorridor, int maxPoints)
+{
+    // The points hold three floats each, refuse sizes whose byte counts would not fit
+    if (maxCorridor <= 0 || maxPoints <= 0 || maxPoints > INT_MAX / 3)
+        return NULL;
+    BindingPathResult *ret = (BindingPathResult *) calloc (1, sizeof (BindingPathResult));
+    if (ret == NULL)
+        return NULL;
+    ret->maxCorridor = maxCorridor;
+    ret->maxPoints = maxPoints;
+    ret->corridor = (dtPolyRef *) calloc (maxCorridor, sizeof (dtPolyRef));
+    ret->points = (float *) calloc ((size_t) maxPoints*3, sizeof (float));
+    ret->flags = (unsigned char *) calloc (maxPoints, sizeof (unsigned char));
+    ret->refs = (dtPolyRef *) calloc (maxPoints, sizeof (dtPolyRef));
+    if (ret->corridor == NULL || ret->points == NULL || ret->flags == NULL || ret->refs == NULL) {
+        bindingFreePathResult(ret);
+        return NULL;
+    }
+    return ret;
+}
+
+void
+bindingFreePathResult (BindingPathResult *result)
+{
+    free (result->corridor);
+    free (result->points);
+    free (result->flags);
+    free (result->refs);
+    free (result);
+}
+
+//
+// Runs the whole path query from two world positions: snaps both positions to
+// the navigation mesh, searches the polygon corridor and string-pulls it.
+//
+// The result must have been allocated with bindingAllocPathResult, and can be
+// reused across calls, so no memory is allocated in the steady state.   On
+// return the snapped polygons and positions are available in the result, even
+// if the path search itself fails.
+dtStatus
+bindingFindPath (const dtNavMeshQuery *query, const dtQueryFilter *filter,
+                 const float *startPos, const float *endPos, const float *halfExtents,
+                 int options, BindingPathResult *result)
+{
+    result->startRef = 0;
+    result->endRef = 0;
+    result->corridorCount = 0;
+    result->count = 0;
+    
+    dtStatus status = query->findNearestPoly(startPos, halfExtents, filter, &result->startRef, result->startPos);
+    if (dtStatusFailed(status))
+        return status;
+    if (result->startRef == 0)
+        return DT_FAILURE | DT_INVALID_PARAM;
+    
+    status = query->findNearestPoly(endPos, halfExtents, filter, &result->endRef, result->endPos);
+    if (dtStatusFailed(status))
+        return status;
+    if (result->endRef == 0)
+        return DT_FAILURE | DT_INVALID_PARAM;
+    
+    return bindingFindStraightPathCorridor(query, filter, result->startRef, result->endRef, result->startPos, result->endPos,
+                                           result->corridor, &result->corridorCount, result->maxCorridor,
+                                           result->points, result->flags, result->refs,
+                                           &result->count, result->maxPoints, options);
+}
+
+//
+// Runtime tile generation
+//
+// The generator owns a tiled dtNavMesh and a pool of worker threads.   The
+// tiles around the interest points are queued nearest first, the workers
+// request their geometry from the provider callback and run the Recast and
+// Detour pipeline, and the finished tiles are only added to (or evicted from)
+// the navigation mesh inside bindingTileGeneratorUpdate, which is the safe point
+// chosen by the caller.
+//
+
+struct BindingTileGeometry {
+    std::vector<float> verts;
+    std::vector<int> tris;
+    // The area ids of the triangles, only kept when every triangle has one
+    std::vector<unsigned char> areas;
+};
+
+bool
+bindingTileGeometryAdd (BindingTileGeometry *geometry, const float *verts, int numVerts, const int *tris, int numTris)
+{
+    if (numVerts < 0 || numTris < 0 || (numVerts > 0 && verts == NULL) || (numTris > 0 && tris == NULL))
+        return false;
+    // The vertices and triangles of a tile are indexed with ints
+    const int base = (int) (geometry->verts.size () / 3);
+    if (numVerts > INT_MAX/3 - base || numTris > INT_MAX/3 - (int) (geometry->tris.size () / 3))
+        return false;
+    for (int i = 0; i < numTris*3; i++) {
+        if (tris [i] < 0 || tris [i] >= numVerts)
+            return false;
+    }
+    geometry->verts.insert (geometry->verts.end (), verts, verts + numVerts*3);
+    geometry->tris.reserve (geometry->tris.size () + numTris*3);
+    for (int i = 0; i < numTris*3; i++)
+        geometry->tris.push_back (base + tris [i]);
+    geometry->areas.clear ();
+    return true;
+}
+
+enum BindingTileState {
+    TILE_PENDING,
+    TILE_LOADED,
+    TILE_EMPTY,
+    // Failed too many times in a row, kept until evicted so it is not built again
+    TILE_FAILED
+};
+
+// The failed builds in a row of a pending tile, and the update it may be queued again at
+struct BindingTileFailure {
+    int count;
+    uint64_t retryUpdate;
+};
+
+static const int DEFAULT_MAX_BUILD_ATTEMPTS = 5;
+
+struct BindingTileRequest {
+    int tx, ty;
+    float distance;
+};
+
+struct BindingTileBuildResult {
+    int tx, ty;
+    unsigned char *data;
+    int dataSize;
+    // The build failed, as opposed to the tile being empty
+    bool failed;
+};
+
+struct BindingTileGenerator {
+    BindingTileGeneratorParams params;
+    BindingTileGeometryProvider provider;
+    void *userData;
+    dtNavMesh *navMesh;
+    float tileWidth;
+
+    // Only touched by the thread calling bindingTileGeneratorUpdate.
+    std::unordered_map<uint64_t, BindingTileState> tiles;
+    std::unordered_map<uint64_t, BindingTileFailure> failures;
+    std::vector<float> points;
+    uint64_t updateCount;
+    int64_t buildsFailed;
+
+    // Shared with the workers, protected by lock.
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping;
+    std::vector<BindingTileRequest> queue;
+    std::vector<uint64_t> building;
+    std::vector<BindingTileBuildResult> results;
+
+    std::vector<std::thread> workers;
+};
+
+static uint64_t
+tileKey (int tx, int ty)
+{
+    return ((uint64_t) (uint32_t) tx << 32) | (uint32_t) ty;
+}
+
+// Distance on the xz-plane from the nearest interest point to the tile
+static float
+tileDistance (const BindingTileGenerator *gen, int tx, int ty)
+{
+    const float *orig = gen->params.config.bmin;
+    const float x0 = orig[0] + tx * gen->tileWidth, x1 = x0 + gen->tileWidth;
+    const float z0 = orig[2] + ty * gen->tileWidth, z1 = z0 + gen->tileWidth;
+    float best = FLT_MAX;
+    for (size_t i = 0; i < gen->points.size (); i += 3) {
+        const float dx = rcMax (rcMax (x0 - gen->points [i], gen->points [i] - x1), 0.0f);
+        const float dz = rcMax (rcMax (z0 - gen->points [i+2], gen->points [i+2] - z1), 0.0f);
+        best = rcMin (best, dx*dx + dz*dz);
+    }
+    return best == FLT_MAX ? FLT_MAX : rcSqrt (best);
+}
+
+// What happened to a tile build, besides the data it produced
+struct BindingTileBuildInfo {
+    // BCODE_OK for the tiles that were built and the empty ones
+    BCodeStatus code;
+    // The memory held by the geometry of the tile
+    size_t geometryBytes;
+};
+
+// Runs the pipeline for a single tile, on a worker thread, returns the Detour tile data or NULL if the tile is empty
+// or failed, info may be NULL.   The Recast structures come from the worker's build context and stay there for the next tile.
+static unsigned char *
+buildTile (const BindingTileGeneratorParams &p, BindingTileGeometryProvider provider, void *userData,
+           rcContext *ctx, BindingBuildContext *bc, int tx, int ty, int *dataSize, BindingTileBuildInfo *info)
+{
+    const float tileWidth = p.config.tileSize * p.config.cs;
+    rcConfig cfg = p.config;
+
+    // The field covers the tile plus the border that lets neighbouring tiles line up
+    cfg.width = cfg.tileSize + cfg.borderSize*2;
+    cfg.height = cfg.tileSize + cfg.borderSize*2;
+    cfg.bmin[0] = p.config.bmin[0] + tx*tileWidth - cfg.borderSize*cfg.cs;
+    cfg.bmin[2] = p.config.bmin[2] + ty*tileWidth - cfg.borderSize*cfg.cs;
+    cfg.bmax[0] = p.config.bmin[0] + (tx+1)*tileWidth + cfg.borderSize*cfg.cs;
+    cfg.bmax[2] = p.config.bmin[2] + (ty+1)*tileWidth + cfg.borderSize*cfg.cs;
+
+    *dataSize = 0;
+    BindingTileBuildInfo unused;
+    if (info == NULL)
+        info = &unused;
+    info->code = BCODE_OK;
+    info->geometryBytes = 0;
+    BindingTileGeometry geometry;
+    BCodeStatus code;
+    // Running out of memory, in the provider or in the pipeline, fails this tile only
+    try {
+        provider (userData, tx, ty, cfg.bmin, cfg.bmax, &geometry);
+        info->geometryBytes = geometry.verts.capacity () * sizeof (float) + geometry.tris.capacity () * sizeof (int);
+        if (geometry.tris.empty ())
+            return NULL;
+
+        const int ntris = (int) geometry.tris.size ()/3;
+        code = rasterizeTriangles (ctx, &cfg, geometry.verts.data (), (int) geometry.verts.size ()/3,
+                                   geometry.tris.data (), ntris,
+                                   (int) geometry.areas.size () == ntris ? geometry.areas.data () : NULL, bc);
+        if (code == BCODE_OK)
+            code = runPolyMeshPipeline (ctx, &cfg, p.flags, cfg.borderSize, bc);
+    } catch (const std::bad_alloc &) {
+        code = BCODE_ERR_MEMORY;
+    }
+    if (code != BCODE_OK) {
+        ctx->log (RC_LOG_ERROR, "buildTile: Tile (%d, %d) failed with code %d.", tx, ty, code);
+        info->code = code;
+        return NULL;
+    }
+
+    rcPolyMesh *poly_mesh = bc->poly_mesh;
+    const rcPolyMeshDetail *poly_mesh_detail = bc->detail_mesh;
+    unsigned char *navData = NULL;
+    if (poly_mesh->npolys > 0 && poly_mesh->nverts < 0xffff && poly_mesh->nvp <= DT_VERTS_PER_POLYGON) {
+        for (int i = 0; i < poly_mesh->npolys; ++i)
+            poly_mesh->flags[i] = 1;
+
+        dtNavMeshCreateParams params;
+        memset(&params, 0, sizeof(params));
+        params.verts = poly_mesh->verts;
+        params.vertCount = poly_mesh->nverts;
+        params.polys = poly_mesh->polys;
+        params.polyAreas = poly_mesh->areas;
+        params.polyFlags = poly_mesh->flags;
+        params.polyCount = poly_mesh->npolys;
+        params.nvp = poly_mesh->nvp;
+        params.detailMeshes = poly_mesh_detail->meshes;
+        params.detailVerts = poly_mesh_detail->verts;
+        params.detailVertsCount = poly_mesh_detail->nverts;
+        params.detailTris = poly_mesh_detail->tris;
+        params.detailTriCount = poly_mesh_detail->ntris;
+        params.walkableHeight = p.agentHeight;
+        params.walkableRadius = p.agentRadius;
+        params.walkableClimb = p.agentMaxClimb;
+        params.tileX = tx;
+        params.tileY = ty;
+        rcVcopy(params.bmin, poly_mesh->bmin);
+        rcVcopy(params.bmax, poly_mesh->bmax);
+        params.cs = cfg.cs;
+        params.ch = cfg.ch;
+        params.buildBvTree = true;
+
+        if (!dtCreateNavMeshData(&params, &navData, dataSize)) {
+            navData = NULL;
+            *dataSize = 0;
+            info->code = BCODE_ERR_UNKNOWN;
+        }
+    }
+    return navData;
+}
+
+static void
+tileWorker (BindingTileGenerator *gen)
+{
+    rcContext ctx (false);
+    BindingBuildContext bc (true);
+    std::unique_lock<std::mutex> guard (gen->lock);
+    for (;;) {
+        gen->wake.wait (guard, [gen] { return gen->stopping || !gen->queue.empty (); });
+        if (gen->stopping)
+            return;
+
+        // The queue is sorted farthest first, so the nearest tile is at the back
+        BindingTileRequest request = gen->queue.back ();
+        gen->queue.pop_back ();
+        const uint64_t key = tileKey (request.tx, request.ty);
+        gen->building.push_back (key);
+        guard.unlock ();
+
+        BindingTileBuildResult result;
+        BindingTileBuildInfo info;
+        result.tx = request.tx;
+        result.ty = request.ty;
+        result.data = buildTile (gen->params, gen->provider, gen->userData, &ctx, &bc, request.tx, request.ty, &result.dataSize, &info);
+        result.failed = info.code != BCODE_OK;
+
+        guard.lock ();
+        gen->building.erase (std::find (gen->building.begin (), gen->building.end (), key));
+        try {
+            gen->results.push_back (result);
+        } catch (const std::bad_alloc &) {
+            // The tile is still pending, and is queued again by the next update
+            dtFree (result.data);
+        }
+    }
+}
+
+BindingTileGenerator *
+bindingCreateTileGenerator (const BindingTileGeneratorParams *params, BindingTileGeometryProvider provider, void *userData)
+{
+    if (params == NULL || provider == NULL || params->config.tileSize <= 0 || params->config.cs <= 0)
+        return NULL;
+    if (params->config.maxVertsPerPoly > DT_VERTS_PER_POLYGON)
+        return NULL;
+
+    BindingTileGenerator *gen = new (std::nothrow) BindingTileGenerator;
+    if (gen == NULL)
+        return NULL;
+    gen->params = *params;
+    gen->provider = provider;
+    gen->userData = userData;
+    gen->tileWidth = params->config.tileSize * params->config.cs;
+    gen->stopping = false;
+    gen->updateCount = 0;
+    gen->buildsFailed = 0;
+    if (gen->params.maxBuildAttempts <= 0)
+        gen->params.maxBuildAttempts = DEFAULT_MAX_BUILD_ATTEMPTS;
+
+    dtNavMeshParams navParams;
+    memset (&navParams, 0, sizeof (navParams));
+    rcVcopy (navParams.orig, params->config.bmin);
+    navParams.tileWidth = gen->tileWidth;
+    navParams.tileHeight = gen->tileWidth;
+    navParams.maxTiles = params->maxTiles;
+    navParams.maxPolys = params->maxPolysPerTile;
+
+    gen->navMesh = dtAllocNavMesh ();
+    if (gen->navMesh == NULL || dtStatusFailed (gen->navMesh->init (&navParams))) {
+        dtFreeNavMesh (gen->navMesh);
+        delete gen;
+        return NULL;
+    }
+
+    int numThreads = params->numThreads;
+    if (numThreads <= 0)
+        numThreads = rcMax ((int) sysconf (_SC_NPROCESSORS_ONLN) - 1, 1);
+    // A thread that can not be started fails the creation, after stopping the ones that were
+    try {
+        gen->workers.reserve (numThreads);
+        for (int i = 0; i < numThreads; i++)
+            gen->workers.emplace_back (tileWorker, gen);
+    } catch (...) {
+        bindingFreeTileGenerator (gen);
+        return NULL;
+    }
+    return gen;
+}
+
+void
+bindingFreeTileGenerator (BindingTileGenerator *generator)
+{
+    {
+        std::lock_guard<std::mutex> guard (generator->lock);
+        generator->stopping = true;
+    }
+    generator->wake.notify_all ();
+    for (size_t i = 0; i < generator->workers.size (); i++)
+        generator->workers [i].join ();
+    for (size_t i = 0; i < generator->results.size (); i++)
+        dtFree (generator->results [i].data);
+    dtFreeNavMesh (generator->navMesh);
+    delete generator;
+}
+
+dtNavMesh *
+bindingTileGeneratorNavMesh (BindingTileGenerator *generator)
+{
+    return generator->navMesh;
+}
+
+void
+bindingTileGeneratorSetInterestPoints (BindingTileGenerator *generator, const float *points, int count)
+{
+    generator->points.assign (points, points + rcMax (count, 0)*3);
+}
+
+int
+bindingTileGeneratorUpdate (BindingTileGenerator *generator, int maxTileChanges)
+{
+    BindingTileGenerator *gen = generator;
+    const float evictRadius = rcMax (gen->params.evictRadius, gen->params.generateRadius);
+    int changes = 0;
+
+    std::vector<BindingTileBuildResult> finished;
+    {
+        std::lock_guard<std::mutex> guard (gen->lock);
+        finished.swap (gen->results);
+    }
+
+    gen->updateCount++;
+
+    // Evict the tiles that are now far from every interest point first, making room for the new ones
+    for (auto it = gen->tiles.begin (); it != gen->tiles.end (); ) {
+        const int tx = (int) (it->first >> 32), ty = (int) (uint32_t) it->first;
+        if (it->second == TILE_PENDING || tileDistance (gen, tx, ty) <= evictRadius) {
+            ++it;
+            continue;
+        }
+        if (it->second == TILE_LOADED) {
+            if (changes >= maxTileChanges) {
+                ++it;
+                continue;
+            }
+            gen->navMesh->removeTile (gen->navMesh->getTileRefAt (tx, ty, 0), NULL, NULL);
+            changes++;
+        }
+        gen->failures.erase (it->first);
+        it = gen->tiles.erase (it);
+    }
+
+    // Add the finished tiles that are still wanted, those beyond the budget wait for the next update
+    size_t next = 0;
+    for (; next < finished.size () && changes < maxTileChanges; next++) {
+        BindingTileBuildResult &r = finished [next];
+        const uint64_t key = tileKey (r.tx, r.ty);
+        auto it = gen->tiles.find (key);
+        if (it == gen->tiles.end () || tileDistance (gen, r.tx, r.ty) > evictRadius) {
+            if (it != gen->tiles.end ()) {
+                gen->failures.erase (key);
+                gen->tiles.erase (it);
+            }
+            dtFree (r.data);
+            continue;
+        }
+        bool failed = r.failed;
+        if (r.data != NULL && dtStatusFailed (gen->navMesh->addTile (r.data, r.dataSize, DT_TILE_FREE_DATA, 0, NULL))) {
+            dtFree (r.data);
+            failed = true;
+        }
+        // A tile that keeps failing, for a full navigation mesh or a geometry its settings can not
+        // handle, waits twice as many updates after every failure, and is given up on after the last
+        if (failed) {
+            gen->buildsFailed++;
+            BindingTileFailure &f = gen->failures [key];
+            f.count++;
+            if (f.count >= gen->params.maxBuildAttempts)
+                it->second = TILE_FAILED;
+            else
+                f.retryUpdate = gen->updateCount + ((uint64_t) 1 << rcMin (f.count, 16));
+            continue;
+        }
+        gen->failures.erase (key);
+        if (r.data == NULL) {
+            it->second = TILE_EMPTY;
+            continue;
+        }
+        it->second = TILE_LOADED;
+        changes++;
+    }
+
+    // Queue the missing tiles around the interest points
+    const float radius = gen->params.generateRadius;
+    const float *orig = gen->params.config.bmin;
+    for (size_t i = 0; i < gen->points.size (); i += 3) {
+        const int tx0 = (int) floorf ((gen->points [i] - radius - orig[0]) / gen->tileWidth);
+        const int tx1 = (int) floorf ((gen->points [i] + radius - orig[0]) / gen->tileWidth);
+        const int ty0 = (int) floorf ((gen->points [i+2] - radius - orig[2]) / gen->tileWidth);
+        const int ty1 = (int) floorf ((gen->points [i+2] + radius - orig[2]) / gen->tileWidth);
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                if (tileDistance (gen, tx, ty) <= radius)
+                    gen->tiles.emplace (tileKey (tx, ty), TILE_PENDING);
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard (gen->lock);
+
+        // Results beyond the budget go back in front of the ones finished meanwhile
+        gen->results.insert (gen->results.begin (), finished.begin () + next, finished.end ());
+
+        gen->queue.clear ();
+        for (auto it = gen->tiles.begin (); it != gen->tiles.end (); ) {
+            if (it->second != TILE_PENDING) {
+                ++it;
+                continue;
+            }
+            auto failure = gen->failures.find (it->first);
+            if (failure != gen->failures.end () && failure->second.retryUpdate > gen->updateCount) {
+                ++it;
+                continue;
+            }
+            if (std::find (gen->building.begin (), gen->building.end (), it->first) != gen->building.end () ||
+                std::find_if (gen->results.begin (), gen->results.end (), [&](const BindingTileBuildResult &r) { return tileKey (r.tx, r.ty) == it->first; }) != gen->results.end ()) {
+                ++it;
+                continue;
+            }
+            BindingTileRequest request;
+            request.tx = (int) (it->first >> 32);
+            request.ty = (int) (uint32_t) it->first;
+            request.distance = tileDistance (gen, request.tx, request.ty);
+
+            // Pending tiles that drifted out of range are dropped before they are built
+            if (request.distance > evictRadius) {
+                if (failure != gen->failures.end ())
+                    gen->failures.erase (failure);
+                it = gen->tiles.erase (it);
+                continue;
+            }
+            gen->queue.push_back (request);
+            ++it;
+        }
+        std::sort (gen->queue.begin (), gen->queue.end (), [](const BindingTileRequest &a, const BindingTileRequest &b) {
+            if (a.distance != b.distance)
+                return a.distance > b.distance;
+            return a.ty != b.ty ? a.ty > b.ty : a.tx > b.tx;
+        });
+    }
+    gen->wake.notify_all ();
+    return changes;
+}
+
+int
+bindingTileGeneratorPendingCount (BindingTileGenerator *generator)
+{
+    int count = 0;
+    for (auto it = generator->tiles.begin (); it != generator->tiles.end (); ++it) {
+        if (it->second == TILE_PENDING)
+            count++;
+    }
+    return count;
+}
+
+void
+bindingTileGeneratorGetStats (BindingTileGenerator *generator, BindingTileGeneratorStats *stats)
+{
+    memset (stats, 0, sizeof (*stats));
+    for (auto it = generator->tiles.begin (); it != generator->tiles.end (); ++it) {
+        if (it->second == TILE_LOADED)
+            stats->loaded++;
+        else if (it->second == TILE_EMPTY)
+            stats->empty++;
+        else if (it->second == TILE_FAILED)
+            stats->failed++;
+        else {
+            stats->pending++;
+            auto failure = generator->failures.find (it->first);
+            if (failure != generator->failures.end () && failure->second.retryUpdate > generator->updateCount)
+                stats->retrying++;
+        }
+    }
+    stats->buildsFailed = generator->buildsFailed;
+}
+
+//
+// Tile meshes
+//
+// rcBuildTriangleTiles bins the triangles once, anchored at the bounds of the
+// mesh, and the configuration handed back puts the generator's tile grid on
+// the same origin, so a tile request maps to a single bin.   Requests that do
+// not line up with the bins gather every bin their box overlaps instead.
+//
+
+struct BindingTileMesh {
+    std::vector<float> verts;
+    std::vector<int> tris;
+    std::vector<unsigned char> areas;
+    rcTriangleTiles tiles;
+};
+
+BindingTileMesh *
+bindingCreateTileMesh (rcConfig *config, int numThreads, const float *verts, int numVerts, const int *tris, int numTris)
+{
+    if (config == NULL || config->tileSize <= 0 || config->cs <= 0)
+        return NULL;
+    if (numVerts <= 0 || numTris < 0 || verts == NULL || (numTris > 0 && tris == NULL))
+        return NULL;
+    for (int i = 0; i < numTris*3; i++) {
+        if (tris [i] < 0 || tris [i] >= numVerts)
+            return NULL;
+    }
+
+    BindingTileMesh *mesh = new (std::nothrow) BindingTileMesh;
+    if (mesh == NULL)
+        return NULL;
+    rcContext ctx;
+    if (numThreads <= 0)
+        numThreads = (int) sysconf (_SC_NPROCESSORS_ONLN);
+    ctx.setMaxThreads (numThreads);
+    try {
+        mesh->verts.assign (verts, verts + numVerts*3);
+        mesh->tris.assign (tris, tris + numTris*3);
+        mesh->areas.assign (numTris, 0);
+    } catch (const std::bad_alloc &) {
+        delete mesh;
+        return NULL;
+    }
+    if (!rcBuildTriangleTiles (&ctx, config->walkableSlopeAngle, mesh->verts.data (), numVerts, mesh->tris.data (), numTris,
+                               config->tileSize * config->cs, config->borderSize * config->cs, mesh->areas.data (), mesh->tiles)) {
+        delete mesh;
+        return NULL;
+    }
+    rcVcopy (config->bmin, mesh->tiles.bmin);
+    rcVcopy (config->bmax, mesh->tiles.bmax);
+    return mesh;
+}
+
+void
+bindingFreeTileMesh (BindingTileMesh *mesh)
+{
+    delete mesh;
+}
+
+void
+bindingTileMeshGeometry (void *userData, int tx, int ty, const float *bmin, const float *bmax, BindingTileGeometry *geometry)
+{
+    const BindingTileMesh *mesh = (const BindingTileMesh *) userData;
+    const rcTriangleTiles &tiles = mesh->tiles;
+
+    // The bins whose cells overlap the box hold every triangle touching it, but
+    // when the box fits in the bordered box of a bin that bin alone is enough.
+    int x0 = (int) floorf ((bmin[0] - tiles.bmin[0]) / tiles.tileSize);
+    int z0 = (int) floorf ((bmin[2] - tiles.bmin[2]) / tiles.tileSize);
+    int x1 = (int) floorf ((bmax[0] - tiles.bmin[0]) / tiles.tileSize);
+    int z1 = (int) floorf ((bmax[2] - tiles.bmin[2]) / tiles.tileSize);
+    if (tx >= 0 && ty >= 0 && tx < tiles.width && ty < tiles.height &&
+        bmin[0] >= tiles.bmin[0] + tx*tiles.tileSize - tiles.tileBorder &&
+        bmin[2] >= tiles.bmin[2] + ty*tiles.tileSize - tiles.tileBorder &&
+        bmax[0] <= tiles.bmin[0] + (tx+1)*tiles.tileSize + tiles.tileBorder &&
+        bmax[2] <= tiles.bmin[2] + (ty+1)*tiles.tileSize + tiles.tileBorder) {
+        x0 = x1 = tx;
+        z0 = z1 = ty;
+    }
+    x0 = rcMax (x0, 0);
+    z0 = rcMax (z0, 0);
+    x1 = rcMin (x1, tiles.width - 1);
+    z1 = rcMin (z1, tiles.height - 1);
+    if (x0 > x1 || z0 > z1)
+        return;
+
+    std::vector<int> found;
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            const int t = x + z*tiles.width;
+            for (int k = tiles.tileStarts [t]; k < tiles.tileStarts [t+1]; k++) {
+                const int *tri = &mesh->tris [tiles.tris [k]*3];
+                float tmin[2] = { FLT_MAX, FLT_MAX }, tmax[2] = { -FLT_MAX, -FLT_MAX };
+                for (int j = 0; j < 3; j++) {
+                    const float *v = &mesh->verts [tri [j]*3];
+                    tmin[0] = rcMin (tmin[0], v[0]); tmax[0] = rcMax (tmax[0], v[0]);
+                    tmin[1] = rcMin (tmin[1], v[2]); tmax[1] = rcMax (tmax[1], v[2]);
+                }
+                if (tmin[0] <= bmax[0] && tmax[0] >= bmin[0] && tmin[1] <= bmax[2] && tmax[1] >= bmin[2])
+                    found.push_back (tiles.tris [k]);
+            }
+        }
+    }
+    // The bins list their triangles in increasing order, so only merged bins repeat any
+    if (x0 != x1 || z0 != z1) {
+        std::sort (found.begin (), found.end ());
+        found.erase (std::unique (found.begin (), found.end ()), found.end ());
+    }
+    if (found.empty ())
+        return;
+
+    // Only the vertices of the found triangles are handed over, renumbered in order
+    std::vector<int> used;
+    used.reserve (found.size ()*3);
+    for (size_t i = 0; i < found.size (); i++)
+        used.insert (used.end (), &mesh->tris [found [i]*3], &mesh->tris [found [i]*3] + 3);
+    std::sort (used.begin (), used.end ());
+    used.erase (std::unique (used.begin (), used.end ()), used.end ());
+
+    // Appending to geometry that has no area ids would leave these without them too
+    const bool keepAreas = geometry->tris.empty () || geometry->areas.size ()*3 == geometry->tris.size ();
+    const int base = (int) (geometry->verts.size () / 3);
+    geometry->verts.reserve (geometry->verts.size () + used.size ()*3);
+    for (size_t i = 0; i < used.size (); i++)
+        geometry->verts.insert (geometry->verts.end (), &mesh->verts [used [i]*3], &mesh->verts [used [i]*3] + 3);
+    geometry->tris.reserve (geometry->tris.size () + found.size ()*3);
+    for (size_t i = 0; i < found.size (); i++) {
+        for (int j = 0; j < 3; j++) {
+            const int v = mesh->tris [found [i]*3 + j];
+            geometry->tris.push_back (base + (int) (std::lower_bound (used.begin (), used.end (), v) - used.begin ()));
+        }
+    }
+    if (keepAreas) {
+        for (size_t i = 0; i < found.size (); i++)
+            geometry->areas.push_back (mesh->areas [found [i]]);
+    } else {
+        geometry->areas.clear ();
+    }
+}
+
+//
+// Tile files and streaming
+//
+// The stream reads the tiles around the interest points, and ahead of them along
+// their velocities, on a pool of I/O threads.   Each thread takes the nearest
+// queued tiles, up to its share of the queue depth, and reads the ones that are
+// next to each other in the file with a single read.   The tiles are checked and
+// handed back in buffers ready for dtNavMesh::addTile with DT_TILE_FREE_DATA, and
+// they are only added to (or evicted from) the navigation mesh inside
+// bindingTileStreamUpdate, like the tiles of the generator.
+//
+
+static const int TILE_FILE_MAGIC = 'N'<<24 | 'T'<<16 | 'I'<<8 | 'F';
+static const int TILE_FILE_VERSION = 1;
+
+struct BindingTileFileHeader {
+    int magic;
+    int version;
+    dtNavMeshParams params;
+    int tileCount;
+};
+
+struct BindingTileFileEntry {
+    int x, y, layer;
+    int dataSize;
+    int64_t offset;
+};
+
+bool
+bindingWriteTileFile (const dtNavMesh *navMesh, const char *path)
+{
+    std::vector<const dtMeshTile *> tiles;
+    for (int i = 0; i < navMesh->getMaxTiles (); i++) {
+        const dtMeshTile *tile = navMesh->getTile (i);
+        if (tile->header != NULL && tile->dataSize > 0)
+            tiles.push_back (tile);
+    }
+    std::sort (tiles.begin (), tiles.end (), [](const dtMeshTile *a, const dtMeshTile *b) {
+        if (a->header->y != b->header->y)
+            return a->header->y < b->header->y;
+        if (a->header->x != b->header->x)
+            return a->header->x < b->header->x;
+        return a->header->layer < b->header->layer;
+    });
+
+    BindingTileFileHeader header;
+    memset (&header, 0, sizeof (header));
+    header.magic = TILE_FILE_MAGIC;
+    header.version = TILE_FILE_VERSION;
+    header.params = *navMesh->getParams ();
+    header.tileCount = (int) tiles.size ();
+
+    std::vector<BindingTileFileEntry> entries (tiles.size ());
+    int64_t offset = sizeof (header) + sizeof (BindingTileFileEntry) * tiles.size ();
+    for (size_t i = 0; i < tiles.size (); i++) {
+        entries [i].x = tiles [i]->header->x;
+        entries [i].y = tiles [i]->header->y;
+        entries [i].layer = tiles [i]->header->layer;
+        entries [i].dataSize = tiles [i]->dataSize;
+        entries [i].offset = offset;
+        offset += tiles [i]->dataSize;
+    }
+
+    FILE *f = fopen (path, "wb");
+    if (f == NULL)
+        return false;
+    bool ok = fwrite (&header, sizeof (header), 1, f) == 1;
+    if (ok && !entries.empty ())
+        ok = fwrite (entries.data (), sizeof (BindingTileFileEntry), entries.size (), f) == entries.size ();
+    for (size_t i = 0; ok && i < tiles.size (); i++)
+        ok = fwrite (tiles [i]->data, tiles [i]->dataSize, 1, f) == 1;
+    if (fclose (f) != 0)
+        ok = false;
+    return ok;
+}
+
+enum BindingStreamTileState {
+    STREAM_UNLOADED,
+    STREAM_PENDING,
+    STREAM_LOADED,
+    // Failed too many times in a row, kept until evicted so it is not read again
+    STREAM_FAILED
+};
+
+static const int DEFAULT_MAX_READ_ATTEMPTS = 5;
+
+struct BindingTileReadRequest {
+    int entry;
+    float distance;
+};
+
+struct BindingTileReadResult {
+    int entry;
+    unsigned char *data;
+};
+
+typedef std::chrono::steady_clock BindingStreamClock;
+
+struct BindingTileStream {
+    BindingTileStreamParams params;
+    int fd;
+    dtNavMesh *navMesh;
+    float tileWidth;
+    std::vector<BindingTileFileEntry> entries;
+    // The entries at each tile location, one per layer
+    std::unordered_map<uint64_t, std::vector<int>> locations;
+
+    // Only touched by the thread calling bindingTileStreamUpdate.
+    std::vector<unsigned char> states;
+    std::vector<BindingTileFailure> failures;
+    uint64_t updateCount;
+    // The interest points, followed by where they are heading [(x, y, z) * 2 * count]
+    std::vector<float> segments;
+
+    // Shared with the workers, protected by lock.
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping;
+    std::vector<BindingTileReadRequest> queue;
+    // Set while an entry is being read or its result waits to be added
+    std::vector<unsigned char> reading;
+    std::vector<BindingTileReadResult> results;
+    int inFlight;
+    int64_t tilesRead, bytesRead;
+    // Only touched by the thread calling bindingTileStreamUpdate.
+    int64_t tilesFailed;
+    int retrying, failed;
+    double busyTime, totalLatency, maxLatency;
+    BindingStreamClock::time_point busyStart;
+
+    std::vector<std::thread> workers;
+};
+
+// Distance on the xz-plane from a point to a rectangle
+static float
+pointRectDistance (const float *p, const float *rmin, const float *rmax)
+{
+    const float dx = rcMax (rcMax (rmin[0] - p[0], p[0] - rmax[0]), 0.0f);
+    const float dz = rcMax (rcMax (rmin[1] - p[2], p[2] - rmax[1]), 0.0f);
+    return rcSqrt (dx*dx + dz*dz);
+}
+
+// Distance on the xz-plane from the segment pq to a rectangle
+static float
+segmentRectDistance (const float *p, const float *q, const float *rmin, const float *rmax)
+{
+    // The distance is zero when the segment crosses the rectangle
+    float tmin = 0, tmax = 1;
+    const float d[2] = { q[0] - p[0], q[2] - p[2] };
+    const float o[2] = { p[0], p[2] };
+    bool crosses = true;
+    for (int i = 0; i < 2 && crosses; i++) {
+        if (fabsf (d[i]) < 1e-6f) {
+            crosses = o[i] >= rmin[i] && o[i] <= rmax[i];
+            continue;
+        }
+        float t0 = (rmin[i] - o[i]) / d[i], t1 = (rmax[i] - o[i]) / d[i];
+        if (t0 > t1)
+            std::swap (t0, t1);
+        tmin = rcMax (tmin, t0);
+        tmax = rcMin (tmax, t1);
+        crosses = tmin <= tmax;
+    }
+    if (crosses)
+        return 0;
+
+    // Otherwise the nearest point is an end of the segment, or a corner of the rectangle
+    float best = rcMin (pointRectDistance (p, rmin, rmax), pointRectDistance (q, rmin, rmax));
+    const float len2 = d[0]*d[0] + d[1]*d[1];
+    if (len2 > 0) {
+        for (int i = 0; i < 4; i++) {
+            const float cx = (i & 1) ? rmax[0] : rmin[0], cz = (i & 2) ? rmax[1] : rmin[1];
+            const float t = rcClamp (((cx - o[0])*d[0] + (cz - o[1])*d[1]) / len2, 0.0f, 1.0f);
+            const float dx = o[0] + d[0]*t - cx, dz = o[1] + d[1]*t - cz;
+            best = rcMin (best, rcSqrt (dx*dx + dz*dz));
+        }
+    }
+    return best;
+}
+
+static void
+streamTileRect (const BindingTileStream *stream, int tx, int ty, float *rmin, float *rmax)
+{
+    const float *orig = stream->navMesh->getParams ()->orig;
+    rmin[0] = orig[0] + tx * stream->tileWidth;
+    rmin[1] = orig[2] + ty * stream->tileWidth;
+    rmax[0] = rmin[0] + stream->tileWidth;
+    rmax[1] = rmin[1] + stream->tileWidth;
+}
+
+// Distance from the nearest interest point, or the path ahead of it, to the tile
+static float
+streamTileDistance (const BindingTileStream *stream, int tx, int ty)
+{
+    float rmin[2], rmax[2];
+    streamTileRect (stream, tx, ty, rmin, rmax);
+    float best = FLT_MAX;
+    for (size_t i = 0; i < stream->segments.size (); i += 6)
+        best = rcMin (best, segmentRectDistance (&stream->segments [i], &stream->segments [i+3], rmin, rmax));
+    return best;
+}
+
+// Distance from the nearest interest point to the tile, the tiles ahead are read after the ones around the points
+static float
+streamTilePriority (const BindingTileStream *stream, int tx, int ty)
+{
+    float rmin[2], rmax[2];
+    streamTileRect (stream, tx, ty, rmin, rmax);
+    float best = FLT_MAX;
+    for (size_t i = 0; i < stream->segments.size (); i += 6)
+        best = rcMin (best, pointRectDistance (&stream->segments [i], rmin, rmax));
+    return best;
+}
+
+static bool
+readFully (int fd, unsigned char *buffer, size_t size, int64_t offset)
+{
+    while (size > 0) {
+        ssize_t n = pread (fd, buffer, size, (off_t) offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buffer += n;
+        size -= (size_t) n;
+        offset += n;
+    }
+    return true;
+}
+
+// Reads a batch of tiles, the tiles that are next to each other in the file are read together
+static void
+readTiles (BindingTileStream *stream, std::vector<BindingTileReadRequest> &batch, std::vector<unsigned char> &buffer, std::vector<BindingTileReadResult> &results)
+{
+    std::sort (batch.begin (), batch.end (), [stream](const BindingTileReadRequest &a, const BindingTileReadRequest &b) {
+        return stream->entries [a.entry].offset < stream->entries [b.entry].offset;
+    });
+    size_t first = 0;
+    while (first < batch.size ()) {
+        const BindingTileFileEntry &start = stream->entries [batch [first].entry];
+        size_t last = first + 1;
+        int64_t end = start.offset + start.dataSize;
+        while (last < batch.size () && stream->entries [batch [last].entry].offset == end) {
+            end += stream->entries [batch [last].entry].dataSize;
+            last++;
+        }
+
+        // Running out of memory fails the tiles of this run, they are requested again later
+        bool ok;
+        try {
+            buffer.resize ((size_t) (end - start.offset));
+            ok = readFully (stream->fd, buffer.data (), buffer.size (), start.offset);
+        } catch (const std::bad_alloc &) {
+            std::vector<unsigned char> ().swap (buffer);
+            ok = false;
+        }
+        for (size_t i = first; i < last; i++) {
+            const BindingTileFileEntry &entry = stream->entries [batch [i].entry];
+            BindingTileReadResult result;
+            result.entry = batch [i].entry;
+            result.data = NULL;
+            const unsigned char *src = ok ? buffer.data () + (entry.offset - start.offset) : NULL;
+            const dtMeshHeader *header = (const dtMeshHeader *) src;
+            if (ok && entry.dataSize >= (int) sizeof (dtMeshHeader) && header->magic == DT_NAVMESH_MAGIC && header->version == DT_NAVMESH_VERSION &&
+                header->x == entry.x && header->y == entry.y && header->layer == entry.layer) {
+                result.data = (unsigned char *) dtAlloc (entry.dataSize, DT_ALLOC_PERM);
+                if (result.data != NULL)
+                    memcpy (result.data, src, entry.dataSize);
+            }
+            results.push_back (result);
+        }
+        first = last;
+    }
+}
+
+static void
+tileStreamWorker (BindingTileStream *stream, int maxBatch)
+{
+    // Sized for the largest batch up front, so handing back results never allocates
+    std::vector<BindingTileReadRequest> batch (maxBatch);
+    std::vector<BindingTileReadResult> results;
+    results.reserve (maxBatch);
+    std::vector<unsigned char> buffer;
+    std::unique_lock<std::mutex> guard (stream->lock);
+    for (;;) {
+        stream->wake.wait (guard, [stream] { return stream->stopping || (!stream->queue.empty () && stream->inFlight < stream->params.queueDepth); });
+        if (stream->stopping)
+            return;
+
+        // The queue is sorted farthest first, so the nearest tiles are at the back
+        const int n = rcMin (rcMin (maxBatch, (int) stream->queue.size ()), stream->params.queueDepth - stream->inFlight);
+        batch.assign (stream->queue.end () - n, stream->queue.end ());
+        stream->queue.resize (stream->queue.size () - n);
+        for (int i = 0; i < n; i++)
+            stream->reading [batch [i].entry] = 1;
+        if (stream->inFlight == 0)
+            stream->busyStart = BindingStreamClock::now ();
+        stream->inFlight += n;
+        guard.unlock ();
+
+        const BindingStreamClock::time_point start = BindingStreamClock::now ();
+        results.clear ();
+        readTiles (stream, batch, buffer, results);
+        const double latency = std::chrono::duration<double> (BindingStreamClock::now () - start).count ();
+
+        guard.lock ();
+        try {
+            stream->results.insert (stream->results.end (), results.begin (), results.end ());
+        } catch (const std::bad_alloc &) {
+            // Drop the tiles, they are still pending and get requested again
+            for (size_t i = 0; i < results.size (); i++) {
+                dtFree (results [i].data);
+                stream->reading [results [i].entry] = 0;
+            }
+        }
+        stream->inFlight -= n;
+        if (stream->inFlight == 0)
+            stream->busyTime += std::chrono::duration<double> (BindingStreamClock::now () - stream->busyStart).count ();
+        for (int i = 0; i < n; i++) {
+            const BindingTileFileEntry &entry = stream->entries [batch [i].entry];
+            stream->bytesRead += entry.dataSize;
+        }
+        stream->tilesRead += n;
+        stream->totalLatency += latency * n;
+        stream->maxLatency = rcMax (stream->maxLatency, latency);
+        // A slot in the queue depth is free again
+        stream->wake.notify_one ();
+    }
+}
+
+// Checks that every tile of the index lies in the data of the file, and that no two overlap
+static bool
+validTileEntries (const std::vector<BindingTileFileEntry> &entries, int64_t dataStart, int64_t fileSize)
+{
+    std::vector<int> order (entries.size ());
+    for (size_t i = 0; i < order.size (); i++)
+        order [i] = (int) i;
+    std::sort (order.begin (), order.end (), [&entries](int a, int b) {
+        return entries [a].offset < entries [b].offset;
+    });
+    int64_t end = dataStart;
+    for (size_t i = 0; i < order.size (); i++) {
+        const BindingTileFileEntry &entry = entries [order [i]];
+        if (entry.dataSize <= 0 || entry.offset < end || entry.offset > fileSize - entry.dataSize)
+            return false;
+        end = entry.offset + entry.dataSize;
+    }
+    return true;
+}
+
+BindingTileStream *
+bindingOpenTileStream (const char *path, const BindingTileStreamParams *params)
+{
+    if (path == NULL || params == NULL || params->loadRadius < 0)
+        return NULL;
+
+    int fd = open (path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    BindingTileFileHeader header;
+    if (fstat (fd, &st) != 0 || !readFully (fd, (unsigned char *) &header, sizeof (header), 0) ||
+        header.magic != TILE_FILE_MAGIC || header.version != TILE_FILE_VERSION || header.tileCount < 0 ||
+        (int64_t) sizeof (header) + (int64_t) sizeof (BindingTileFileEntry) * header.tileCount > (int64_t) st.st_size) {
+        close (fd);
+        return NULL;
+    }
+
+    BindingTileStream *stream = new (std::nothrow) BindingTileStream;
+    if (stream == NULL) {
+        close (fd);
+        return NULL;
+    }
+    stream->params = *params;
+    if (stream->params.queueDepth <= 0)
+        stream->params.queueDepth = 8;
+    if (stream->params.numThreads <= 0)
+        stream->params.numThreads = 2;
+    stream->fd = fd;
+    stream->tileWidth = header.params.tileWidth;
+    stream->stopping = false;
+    if (stream->params.maxReadAttempts <= 0)
+        stream->params.maxReadAttempts = DEFAULT_MAX_READ_ATTEMPTS;
+    stream->inFlight = 0;
+    stream->updateCount = 0;
+    stream->tilesRead = stream->bytesRead = stream->tilesFailed = 0;
+    stream->retrying = stream->failed = 0;
+    stream->busyTime = stream->totalLatency = stream->maxLatency = 0;
+
+    stream->navMesh = NULL;
+    bool ok = false;
+    try {
+        stream->entries.resize (header.tileCount);
+        ok = header.tileCount == 0 || readFully (fd, (unsigned char *) stream->entries.data (), sizeof (BindingTileFileEntry) * header.tileCount, sizeof (header));
+        ok = ok && validTileEntries (stream->entries, sizeof (header) + sizeof (BindingTileFileEntry) * header.tileCount, st.st_size);
+        if (ok) {
+            for (int i = 0; i < header.tileCount; i++)
+                stream->locations [tileKey (stream->entries [i].x, stream->entries [i].y)].push_back (i);
+            stream->states.assign (header.tileCount, STREAM_UNLOADED);
+            stream->failures.assign (header.tileCount, BindingTileFailure ());
+            stream->reading.assign (header.tileCount, 0);
+        }
+    } catch (const std::bad_alloc &) {
+        ok = false;
+    }
+    if (ok) {
+        stream->navMesh = dtAllocNavMesh ();
+        ok = stream->navMesh != NULL && dtStatusSucceed (stream->navMesh->init (&header.params));
+    }
+    if (!ok) {
+        dtFreeNavMesh (stream->navMesh);
+        close (fd);
+        delete stream;
+        return NULL;
+    }
+
+    const int numThreads = stream->params.numThreads;
+    const int maxBatch = rcMax (stream->params.queueDepth / numThreads, 1);
+    // A thread that can not be started fails the open, after stopping the ones that were
+    try {
+        stream->workers.reserve (numThreads);
+        for (int i = 0; i < numThreads; i++)
+            stream->workers.emplace_back (tileStreamWorker, stream, maxBatch);
+    } catch (...) {
+        bindingCloseTileStream (stream);
+        return NULL;
+    }
+    return stream;
+}
+
+void
+bindingCloseTileStream (BindingTileStream *stream)
+{
+    {
+        std::lock_guard<std::mutex> guard (stream->lock);
+        stream->stopping = true;
+    }
+    stream->wake.notify_all ();
+    for (size_t i = 0; i < stream->workers.size (); i++)
+        stream->workers [i].join ();
+    for (size_t i = 0; i < stream->results.size (); i++)
+        dtFree (stream->results [i].data);
+    dtFreeNavMesh (stream->navMesh);
+    close (stream->fd);
+    delete stream;
+}
+
+dtNavMesh *
+bindingTileStreamNavMesh (BindingTileStream *stream)
+{
+    return stream->navMesh;
+}
+
+void
+bindingTileStreamSetInterestPoints (BindingTileStream *stream, const float *points, const float *velocities, int count)
+{
+    const float ahead = rcMax (stream->params.readaheadTime, 0.0f);
+    stream->segments.resize (rcMax (count, 0) * 6);
+    for (int i = 0; i < count; i++) {
+        float *s = &stream->segments [i*6];
+        rcVcopy (s, &points [i*3]);
+        rcVcopy (s+3, &points [i*3]);
+        if (velocities != NULL)
+            rcVmad (s+3, s, &velocities [i*3], ahead);
+    }
+}
+
+// A dtParallelForFunc that splits the work like the Recast build steps, the context is an rcContext
+static void
+contextParallelFor (void *context, const int count, dtParallelForRangeFunc *func, void *userData)
+{
+    ((rcContext *) context)->parallelFor (count, func, userData);
+}
+
+// A tile that keeps failing, for a damaged tile or a full navigation mesh, waits twice as many
+// updates after every failure before it is read again, and is given up on after the last
+static void
+streamTileFailed (BindingTileStream *stream, int entry)
+{
+    BindingTileFailure &f = stream->failures [entry];
+    stream->tilesFailed++;
+    f.count++;
+    if (f.count >= stream->params.maxReadAttempts) {
+        stream->states [entry] = STREAM_FAILED;
+        return;
+    }
+    f.retryUpdate = stream->updateCount + ((uint64_t) 1 << rcMin (f.count, 16));
+    stream->states [entry] = STREAM_UNLOADED;
+}
+
+int
+bindingTileStreamUpdate (BindingTileStream *stream, int maxTileChanges, int maxThreads)
+{
+    const float loadRadius = stream->params.loadRadius;
+    const float evictRadius = rcMax (stream->params.evictRadius, loadRadius);
+    int changes = 0;
+
+    std::vector<BindingTileReadResult> finished;
+    {
+        std::lock_guard<std::mutex> guard (stream->lock);
+        finished.swap (stream->results);
+    }
+    stream->updateCount++;
+
+    // Evict the tiles that are now far from every interest point first, making room for the new ones,
+    // the failed tiles are forgotten as well so they get another round of attempts when wanted again
+    for (size_t i = 0; i < stream->entries.size (); i++) {
+        const BindingTileFileEntry &entry = stream->entries [i];
+        const unsigned char state = stream->states [i];
+        if (state == STREAM_PENDING || (state != STREAM_LOADED && stream->failures [i].count == 0))
+            continue;
+        if (streamTileDistance (stream, entry.x, entry.y) <= evictRadius)
+            continue;
+        if (state == STREAM_LOADED) {
+            if (changes >= maxTileChanges)
+                continue;
+            stream->navMesh->removeTile (stream->navMesh->getTileRefAt (entry.x, entry.y, entry.layer), NULL, NULL);
+            changes++;
+        }
+        stream->states [i] = STREAM_UNLOADED;
+        stream->failures [i] = BindingTileFailure ();
+    }
+
+    // Add the tiles that were read and are still wanted, those beyond the budget wait for the next update
+    std::vector<unsigned char *> data;
+    std::vector<int> dataSizes;
+    std::vector<int> added;
+    size_t next = 0;
+    for (; next < finished.size () && changes < maxTileChanges; next++) {
+        const BindingTileReadResult &r = finished [next];
+        const BindingTileFileEntry &entry = stream->entries [r.entry];
+        if (r.data == NULL) {
+            if (stream->states [r.entry] == STREAM_PENDING)
+                streamTileFailed (stream, r.entry);
+            else
+                stream->tilesFailed++;
+            continue;
+        }
+        if (stream->states [r.entry] != STREAM_PENDING || streamTileDistance (stream, entry.x, entry.y) > evictRadius) {
+            stream->states [r.entry] = STREAM_UNLOADED;
+            dtFree (r.data);
+            continue;
+        }
+        data.push_back (r.data);
+        dataSizes.push_back (entry.dataSize);
+        added.push_back (r.entry);
+        changes++;
+    }
+    if (!data.empty ()) {
+        std::vector<dtTileRef> refs (data.size ());
+        rcContext ctx (false);
+        ctx.setMaxThreads (maxThreads);
+        stream->navMesh->addTiles (data.data (), dataSizes.data (), (int) data.size (), DT_TILE_FREE_DATA, NULL, refs.data (),
+                                   maxThreads > 1 ? contextParallelFor : NULL, &ctx);
+        for (size_t i = 0; i < added.size (); i++) {
+            if (refs [i] == 0) {
+                dtFree (data [i]);
+                streamTileFailed (stream, added [i]);
+                changes--;
+            } else {
+                stream->states [added [i]] = STREAM_LOADED;
+                stream->failures [added [i]] = BindingTileFailure ();
+            }
+        }
+    }
+
+    // Mark the missing tiles around the interest points, and ahead of them
+    const float *orig = stream->navMesh->getParams ()->orig;
+    for (size_t i = 0; i < stream->segments.size (); i += 6) {
+        const float *p = &stream->segments [i], *q = &stream->segments [i+3];
+        const int tx0 = (int) floorf ((rcMin (p[0], q[0]) - loadRadius - orig[0]) / stream->tileWidth);
+        const int tx1 = (int) floorf ((rcMax (p[0], q[0]) + loadRadius - orig[0]) / stream->tileWidth);
+        const int ty0 = (int) floorf ((rcMin (p[2], q[2]) - loadRadius - orig[2]) / stream->tileWidth);
+        const int ty1 = (int) floorf ((rcMax (p[2], q[2]) + loadRadius - orig[2]) / stream->tileWidth);
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                auto it = stream->locations.find (tileKey (tx, ty));
+                if (it == stream->locations.end ())
+                    continue;
+                float rmin[2], rmax[2];
+                streamTileRect (stream, tx, ty, rmin, rmax);
+                if (segmentRectDistance (p, q, rmin, rmax) > loadRadius)
+                    continue;
+                for (size_t j = 0; j < it->second.size (); j++) {
+                    if (stream->states [it->second [j]] == STREAM_UNLOADED)
+                        stream->states [it->second [j]] = STREAM_PENDING;
+                }
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard (stream->lock);
+
+        for (size_t i = 0; i < next; i++)
+            stream->reading [finished [i].entry] = 0;
+        // Results beyond the budget go back in front of the ones read meanwhile
+        stream->results.insert (stream->results.begin (), finished.begin () + next, finished.end ());
+
+        stream->queue.clear ();
+        stream->retrying = stream->failed = 0;
+        for (size_t i = 0; i < stream->entries.size (); i++) {
+            if (stream->states [i] == STREAM_FAILED)
+                stream->failed++;
+            if (stream->states [i] != STREAM_PENDING || stream->reading [i])
+                continue;
+            const BindingTileFileEntry &entry = stream->entries [i];
+
+            // Pending tiles that drifted out of range are dropped before they are read
+            if (streamTileDistance (stream, entry.x, entry.y) > evictRadius) {
+                stream->states [i] = STREAM_UNLOADED;
+                stream->failures [i] = BindingTileFailure ();
+                continue;
+            }
+            if (stream->failures [i].retryUpdate > stream->updateCount) {
+                stream->retrying++;
+                continue;
+            }
+            BindingTileReadRequest request;
+            request.entry = (int) i;
+            request.distance = streamTilePriority (stream, entry.x, entry.y);
+            stream->queue.push_back (request);
+        }
+        std::sort (stream->queue.begin (), stream->queue.end (), [](const BindingTileReadRequest &a, const BindingTileReadRequest &b) {
+            if (a.distance != b.distance)
+                return a.distance > b.distance;
+            return a.entry > b.entry;
+        });
+    }
+    stream->wake.notify_all ();
+    return changes;
+}
+
+int
+bindingTileStreamPendingCount (BindingTileStream *stream)
+{
+    int count = 0;
+    for (size_t i = 0; i < stream->states.size (); i++) {
+        if (stream->states [i] == STREAM_PENDING)
+            count++;
+    }
+    return count;
+}
+
+void
+bindingTileStreamGetStats (BindingTileStream *stream, BindingTileStreamStats *stats)
+{
+    std::lock_guard<std::mutex> guard (stream->lock);
+    stats->queued = (int) stream->queue.size ();
+    stats->inFlight = stream->inFlight;
+    stats->ready = (int) stream->results.size ();
+    stats->tilesRead = stream->tilesRead;
+    stats->bytesRead = stream->bytesRead;
+    stats->tilesFailed = stream->tilesFailed;
+    stats->retrying = stream->retrying;
+    stats->failed = stream->failed;
+    double busy = stream->busyTime;
+    if (stream->inFlight > 0)
+        busy += std::chrono::duration<double> (BindingStreamClock::now () - stream->busyStart).count ();
+    stats->bytesPerSecond = busy > 0 ? stream->bytesRead / busy : 0;
+    stats->meanLatency = stream->tilesRead > 0 ? stream->totalLatency / stream->tilesRead : 0;
+    stats->maxLatency = stream->maxLatency;
+}
+
+//
+// Baking tiles with bounded memory
+//
+// Every worker keeps a pooled build context, and is charged for the memory it holds:
+// the estimate while it builds, the footprint of its context once it is done.   The
+// finished tiles are charged until they are written, which happens in tile order so
+// the file is laid out row by row.   A worker that does not fit the budget gives its
+// context back before waiting, so the waiting workers hold nothing and the builds that
+// are running, which always include the next tile to write, can finish.
+//
+
+struct BindingTileBake {
+    // The settings of the tiles, as used by the generator
+    BindingTileGeneratorParams tileParams;
+    BindingTileGeometryProvider provider;
+    void *userData;
+    int tilesX, tilesY;
+    int fd;
+    int64_t budget;
+    // The scratch memory of a build, which is not kept between tiles
+    int64_t scratch;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    // The next tile to build and the next one to write, in row order
+    int nextTile;
+    int nextWrite;
+    int64_t writeOffset;
+    int64_t estimate;
+    // The memory charged to the workers and to the tiles waiting to be written
+    int64_t committed;
+    int building;
+    bool writeFailed;
+    std::unordered_map<int, BindingTileBuildResult> finished;
+    std::vector<BindingTileFileEntry> entries;
+    BindingTileBakeStats stats;
+};
+
+void
+bindingEstimateTileMemory (const rcConfig *config, int flags, float spansPerCell, BindingTileMemoryEstimate *estimate)
+{
+    if (spansPerCell <= 0)
+        spansPerCell = 2;
+    const int64_t size = config->tileSize + config->borderSize*2;
+    const int64_t cells = size*size;
+    const int64_t spans = (int64_t) ceilf (cells * spansPerCell);
+    const int64_t nvp = rcMax (config->maxVertsPerPoly, 3);
+    const bool watershed = (flags & PARTITION_MASK) == PARTITION_WATERSHED;
+
+    // The columns, and the pools the rasterized spans come from
+    const int64_t pools = (spans + RC_SPANS_PER_POOL - 1) / RC_SPANS_PER_POOL;
+    estimate->heightfield = cells * sizeof (rcSpan *) + pools * sizeof (rcSpanPool);
+
+    // The cells, spans and areas, and the distance field of the watershed partitioning
+    estimate->compactHeightfield = cells * sizeof (rcCompactCell) + spans * (sizeof (rcCompactSpan) + 1);
+    if (watershed)
+        estimate->compactHeightfield += spans * sizeof (unsigned short);
+
+    // The scratch buffers of the partitioning, the watershed one blurs the distance
+    // field and keeps region and distance buffers and level stacks.
+    estimate->regions = spans * (watershed ? 12 : 4);
+
+    // Assume that half of the spans are on a region border, and that simplification
+    // keeps a quarter of those vertices.
+    const int64_t rawVerts = spans / 2;
+    const int64_t verts = rawVerts / 4;
+    estimate->contours = (rawVerts + verts) * 4 * sizeof (int);
+
+    // Every simplified vertex ends up in the mesh, and there are fewer polygons than vertices
+    estimate->polyMesh = verts * 3 * sizeof (unsigned short) + verts * (nvp * 2 * sizeof (unsigned short) + 2 * sizeof (unsigned short) + 1);
+
+    // The polygon vertices, the height samples and about two triangles per vertex
+    int64_t detailVerts = verts;
+    if (config->detailSampleDist > 0) {
+        const float step = rcMax (config->detailSampleDist / config->cs, 1.0f);
+        detailVerts += (int64_t) (cells / (step * step));
+    }
+    estimate->detailMesh = verts * 4 * sizeof (unsigned int) + detailVerts * (3 * sizeof (float) + 2 * 4);
+
+    estimate->total = estimate->heightfield + estimate->compactHeightfield + estimate->regions +
+        estimate->contours + estimate->polyMesh + estimate->detailMesh;
+}
+
+// The memory held by the structures of a build context
+static int64_t
+buildContextFootprint (const BindingBuildContext *bc)
+{
+    int64_t bytes = bc->tri_areas.capacity ();
+    if (bc->hf != nullptr) {
+        bytes += (int64_t) bc->hf->maxCells * sizeof (rcSpan *);
+        for (const rcSpanPool *pool = bc->hf->pools; pool != nullptr; pool = pool->next)
+            bytes += sizeof (rcSpanPool);
+    }
+    if (bc->chf != nullptr) {
+        const rcCompactHeightfield *chf = bc->chf;
+        bytes += (int64_t) chf->maxCells * sizeof (rcCompactCell) + (int64_t) chf->maxSpans * (sizeof (rcCompactSpan) + 1);
+        if (chf->dist != nullptr)
+            bytes += (int64_t) chf->spanCount * sizeof (unsigned short);
+    }
+    if (bc->cset != nullptr) {
+        const rcContourSet *cset = bc->cset;
+        bytes += (int64_t) cset->maxConts * sizeof (rcContour);
+        for (int i = 0; i < cset->maxConts; i++)
+            bytes += (int64_t) (cset->conts [i].maxVerts + cset->conts [i].maxRverts) * 4 * sizeof (int);
+    }
+    if (bc->poly_mesh != nullptr) {
+        const rcPolyMesh *mesh = bc->poly_mesh;
+        bytes += (int64_t) mesh->maxverts * 3 * sizeof (unsigned short);
+        bytes += (int64_t) mesh->maxpolys * (mesh->nvp * 2 * sizeof (unsigned short) + 2 * sizeof (unsigned short) + 1);
+    }
+    if (bc->detail_mesh != nullptr) {
+        const rcPolyMeshDetail *dmesh = bc->detail_mesh;
+        bytes += (int64_t) dmesh->maxmeshes * 4 * sizeof (unsigned int) + (int64_t) dmesh->maxverts * 3 * sizeof (float) + (int64_t) dmesh->maxtris * 4;
+    }
+    return bytes;
+}
+
+static bool
+writeFully (int fd, const unsigned char *buffer, size_t size, int64_t offset)
+{
+    while (size > 0) {
+        ssize_t n = pwrite (fd, buffer, size, (off_t) offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buffer += n;
+        size -= (size_t) n;
+        offset += n;
+    }
+    return true;
+}
+
+struct BindingTileWrite {
+    unsigned char *data;
+    int dataSize;
+    int64_t offset;
+};
+
+static void
+tileBakeWorker (BindingTileBake *bake)
+{
+    rcContext ctx (false);
+    BindingBuildContext bc (true);
+    const int tileCount = bake->tilesX * bake->tilesY;
+    std::vector<BindingTileWrite> writes;
+    // The memory this worker is charged for
+    int64_t charge = 0;
+
+    std::unique_lock<std::mutex> guard (bake->lock);
+    while (bake->nextTile < tileCount && !bake->writeFailed) {
+        const int64_t need = rcMax (bake->estimate, charge);
+        const int64_t others = bake->committed - charge;
+        if (others > 0 && others + need > bake->budget) {
+            if (charge > 0) {
+                guard.unlock ();
+                bc.release ();
+                guard.lock ();
+                bake->committed -= charge;
+                charge = 0;
+                bake->wake.notify_all ();
+            } else {
+                bake->wake.wait (guard);
+            }
+            continue;
+        }
+        bake->committed += need - charge;
+        charge = need;
+        bake->stats.peakMemory = rcMax (bake->stats.peakMemory, bake->committed);
+        bake->building++;
+        bake->stats.maxConcurrentBuilds = rcMax (bake->stats.maxConcurrentBuilds, bake->building);
+        const int tile = bake->nextTile++;
+        guard.unlock ();
+
+        BindingTileBuildResult result;
+        result.tx = tile % bake->tilesX;
+        result.ty = tile / bake->tilesX;
+        BindingTileBuildInfo info;
+        result.data = buildTile (bake->tileParams, bake->provider, bake->userData, &ctx, &bc, result.tx, result.ty, &result.dataSize, &info);
+        const int64_t footprint = buildContextFootprint (&bc);
+        const int64_t used = footprint + (int64_t) info.geometryBytes + bake->scratch;
+
+        guard.lock ();
+        bake->building--;
+        if (info.code != BCODE_OK)
+            bake->stats.tilesFailed++;
+        else if (result.data == NULL)
+            bake->stats.tilesEmpty++;
+        else
+            bake->stats.tilesBuilt++;
+
+        // The build may have needed more than the estimate, later builds are charged that much.
+        // From now on the worker holds its context, and the tile holds its data until it is written.
+        bake->stats.peakMemory = rcMax (bake->stats.peakMemory, bake->committed - charge + used);
+        bake->estimate = rcMax (bake->estimate, used);
+        bake->committed += footprint - charge + result.dataSize;
+        charge = footprint;
+        bake->finished [tile] = result;
+
+        writes.clear ();
+        for (auto it = bake->finished.find (bake->nextWrite); it != bake->finished.end (); it = bake->finished.find (bake->nextWrite)) {
+            const BindingTileBuildResult &ready = it->second;
+            if (ready.data != NULL) {
+                BindingTileFileEntry entry;
+                entry.x = ready.tx;
+                entry.y = ready.ty;
+                entry.layer = 0;
+                entry.dataSize = ready.dataSize;
+                entry.offset = bake->writeOffset;
+                bake->entries.push_back (entry);
+                bake->writeOffset += ready.dataSize;
+
+                BindingTileWrite write;
+                write.data = ready.data;
+                write.dataSize = ready.dataSize;
+                write.offset = entry.offset;
+                writes.push_back (write);
+            }
+            bake->finished.erase (it);
+            bake->nextWrite++;
+        }
+        guard.unlock ();
+
+        bool ok = true;
+        int64_t written = 0;
+        for (size_t i = 0; i < writes.size (); i++) {
+            ok = ok && writeFully (bake->fd, writes [i].data, writes [i].dataSize, writes [i].offset);
+            written += writes [i].dataSize;
+            dtFree (writes [i].data);
+        }
+
+        guard.lock ();
+        bake->committed -= written;
+        bake->stats.bytesWritten += written;
+        if (!ok)
+            bake->writeFailed = true;
+        bake->wake.notify_all ();
+    }
+    guard.unlock ();
+
+    bc.release ();
+    guard.lock ();
+    bake->committed -= charge;
+    bake->wake.notify_all ();
+}
+
+bool
+bindingBakeTiles (const BindingTileBakeParams *params, BindingTileGeometryProvider provider, void *userData,
+                  const char *path, BindingTileBakeStats *stats)
+{
+    if (stats != NULL)
+        memset (stats, 0, sizeof (*stats));
+    if (params == NULL || provider == NULL || path == NULL || params->config.tileSize <= 0 || params->config.cs <= 0)
+        return false;
+    if (params->config.maxVertsPerPoly > DT_VERTS_PER_POLYGON)
+        return false;
+
+    BindingTileBake bake;
+    memset (&bake.tileParams, 0, sizeof (bake.tileParams));
+    bake.tileParams.config = params->config;
+    bake.tileParams.flags = params->flags;
+    bake.tileParams.agentHeight = params->agentHeight;
+    bake.tileParams.agentRadius = params->agentRadius;
+    bake.tileParams.agentMaxClimb = params->agentMaxClimb;
+    bake.tileParams.maxTiles = params->maxTiles;
+    bake.tileParams.maxPolysPerTile = params->maxPolysPerTile;
+    bake.provider = provider;
+    bake.userData = userData;
+
+    const float tileWidth = params->config.tileSize * params->config.cs;
+    bake.tilesX = rcMax ((int) ceilf ((params->config.bmax[0] - params->config.bmin[0]) / tileWidth), 0);
+    bake.tilesY = rcMax ((int) ceilf ((params->config.bmax[2] - params->config.bmin[2]) / tileWidth), 0);
+    const int tileCount = bake.tilesX * bake.tilesY;
+
+    BindingTileMemoryEstimate estimate;
+    bindingEstimateTileMemory (&params->config, params->flags, params->spansPerCell, &estimate);
+    bake.budget = params->memoryBudget > 0 ? params->memoryBudget : INT64_MAX;
+    bake.scratch = estimate.regions;
+    bake.estimate = estimate.total;
+    bake.nextTile = 0;
+    bake.nextWrite = 0;
+    bake.committed = 0;
+    bake.building = 0;
+    bake.writeFailed = false;
+    memset (&bake.stats, 0, sizeof (bake.stats));
+    bake.stats.initialEstimate = estimate.total;
+
+    BindingTileFileHeader header;
+    memset (&header, 0, sizeof (header));
+    header.magic = TILE_FILE_MAGIC;
+    header.version = TILE_FILE_VERSION;
+    rcVcopy (header.params.orig, params->config.bmin);
+    header.params.tileWidth = tileWidth;
+    header.params.tileHeight = tileWidth;
+    header.params.maxTiles = params->maxTiles;
+    header.params.maxPolys = params->maxPolysPerTile;
+
+    bake.fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (bake.fd < 0)
+        return false;
+    // The index has room for every tile, as the empty ones are only known at the end,
+    // the tiles are written after it.
+    bake.writeOffset = sizeof (header) + sizeof (BindingTileFileEntry) * (int64_t) tileCount;
+
+    int numThreads = params->numThreads;
+    if (numThreads <= 0)
+        numThreads = (int) sysconf (_SC_NPROCESSORS_ONLN);
+    numThreads = rcMax (rcMin (numThreads, tileCount), 1);
+    std::vector<std::thread> workers;
+    for (int i = 1; i < numThreads; i++)
+        workers.push_back (std::thread (tileBakeWorker, &bake));
+    tileBakeWorker (&bake);
+    for (size_t i = 0; i < workers.size (); i++)
+        workers [i].join ();
+
+    // The tiles left behind by a failed write
+    for (auto it = bake.finished.begin (); it != bake.finished.end (); ++it)
+        dtFree (it->second.data);
+
+    header.tileCount = (int) bake.entries.size ();
+    bool ok = !bake.writeFailed &&
+        writeFully (bake.fd, (const unsigned char *) &header, sizeof (header), 0) &&
+        (bake.entries.empty () ||
+         writeFully (bake.fd, (const unsigned char *) bake.entries.data (), sizeof (BindingTileFileEntry) * bake.entries.size (), sizeof (header)));
+    if (close (bake.fd) != 0)
+        ok = false;
+
+    bake.stats.finalEstimate = bake.estimate;
+    if (stats != NULL)
+        *stats = bake.stats;
+    return ok;
+}
@@ -0,0 +1,333 @@
+//
+// Copyright (c) 2024 Miguel de Icaza
+//
+// Distributed under the MIT License. See the LICENSE file at the root of
+// the repository for details.
+//
+
+#include "DetourCostOverlay.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include <string.h>
+#include <new>
+
+dtPolyCostOverlay* dtAllocPolyCostOverlay()
+{
+	void* mem = dtAlloc(sizeof(dtPolyCostOverlay), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtPolyCostOverlay;
+}
+
+void dtFreePolyCostOverlay(dtPolyCostOverlay* overlay)
+{
+	if (!overlay) return;
+	overlay->~dtPolyCostOverlay();
+	dtFree(overlay);
+}
+
+/// @class dtPolyCostOverlay
+///
+/// The overlay multiplies the cost of moving across a polygon, on top of the area
+/// cost of the filter, by a value kept in a dense array per tile. Set it on a filter
+/// with dtQueryFilter::setCostOverlay() to have the queries using that filter read it.
+///
+/// Making a large region more expensive, for example because of danger or congestion,
+/// is then a fill of the tile arrays instead of editing the area of every polygon,
+/// and is not limited by the number of area types.
+///
+/// Costs are bound to the tile they were set on. When a tile is removed or rebuilt,
+/// its costs are ignored, and are reset the next time a cost is set on the new tile.
+///
+/// The version counters let callers, like a path cache, find out cheaply whether the
+/// costs they planned with have changed.
+///
+/// The multipliers can not be less than 1.0, the setters refuse them with DT_INVALID_PARAM.
+/// A cheaper polygon would make the A* heuristic of the queries overestimate the
+/// remaining cost, and the searches would no longer find the cheapest path.
+///
+/// @see dtQueryFilter
+
+dtPolyCostOverlay::dtPolyCostOverlay() :
+	m_nav(0),
+	m_tiles(0),
+	m_maxTiles(0),
+	m_version(0)
+{
+}
+
+dtPolyCostOverlay::~dtPolyCostOverlay()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+		dtFree(m_tiles[i].costs);
+	dtFree(m_tiles);
+}
+
+dtStatus dtPolyCostOverlay::init(const dtNavMesh* nav)
+{
+	if (!nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	for (int i = 0; i < m_maxTiles; ++i)
+		dtFree(m_tiles[i].costs);
+	dtFree(m_tiles);
+	m_tiles = 0;
+	m_maxTiles = 0;
+
+	const int maxTiles = nav->getMaxTiles();
+	m_tiles = (dtTileCosts*)dtAlloc(sizeof(dtTileCosts)*maxTiles, DT_ALLOC_PERM);
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(dtTileCosts)*maxTiles);
+	m_maxTiles = maxTiles;
+	m_nav = nav;
+	m_version++;
+
+	return DT_SUCCESS;
+}
+
+dtPolyCostOverlay::dtTileCosts* dtPolyCostOverlay::getTileCosts(const dtMeshTile* tile, const unsigned int salt, const unsigned int it)
+{
+	dtTileCosts& costs = m_tiles[it];
+	const int polyCount = tile->header->polyCount;
+	if (costs.costs && costs.salt == salt && costs.polyCount == polyCount)
+		return &costs;
+
+	if (!costs.costs || costs.polyCount != polyCount)
+	{
+		dtFree(costs.costs);
+		costs.costs = (float*)dtAlloc(sizeof(float)*polyCount, DT_ALLOC_PERM);
+		if (!costs.costs)
+		{
+			costs.polyCount = 0;
+			return 0;
+		}
+	}
+	for (int i = 0; i < polyCount; ++i)
+		costs.costs[i] = 1.0f;
+	costs.salt = salt;
+	costs.polyCount = polyCount;
+	return &costs;
+}
+
+// Also refuses NaN.
+static inline bool isValidCost(const float cost)
+{
+	return cost >= 1.0f;
+}
+
+dtStatus dtPolyCostOverlay::setPolyCost(const dtPolyRef ref, const float cost)
+{
+	return setPolyCosts(&ref, 1, cost);
+}
+
+dtStatus dtPolyCostOverlay::setPolyCosts(const dtPolyRef* refs, const int count, const float cost)
+{
+	if (!m_nav || !refs || count < 0 || !isValidCost(cost))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtStatus status = DT_SUCCESS;
+	m_version++;
+	for (int i = 0; i < count; ++i)
+	{
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		if (dtStatusFailed(m_nav->getTileAndPolyByRef(refs[i], &tile, &poly)))
+		{
+			status |= DT_FAILURE | DT_INVALID_PARAM;
+			continue;
+		}
+		unsigned int salt, it, ip;
+		m_nav->decodePolyId(refs[i], salt, it, ip);
+		dtTileCosts* costs = getTileCosts(tile, salt, it);
+		if (!costs)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		costs->costs[ip] = cost;
+		costs->version = m_version;
+	}
+	return status;
+}
+
+dtStatus dtPolyCostOverlay::setTileCosts(const dtTileRef ref, const int firstPoly, const int count, const float cost)
+{
+	if (!m_nav || !isValidCost(cost))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	const dtMeshTile* tile = m_nav->getTileByRef(ref);
+	if (!tile || !tile->header)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	const int polyCount = tile->header->polyCount;
+	const int last = count < 0 ? polyCount : firstPoly + count;
+	if (firstPoly < 0 || last > polyCount || last < firstPoly)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	unsigned int salt, it, ip;
+	m_nav->decodePolyId((dtPolyRef)ref, salt, it, ip);
+	dtTileCosts* costs = getTileCosts(tile, salt, it);
+	if (!costs)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	for (int i = firstPoly; i < last; ++i)
+		costs->costs[i] = cost;
+	costs->version = ++m_version;
+	return DT_SUCCESS;
+}
+
+// Sets the cost of the polygons of a tile overlapping a box, walking the bounding
+// volume tree of the tile like dtNavMesh::queryPolygonsInTile.
+static int setCostInTile(const dtMeshTile* tile, const float* qmin, const float* qmax, const float cost, float* costs)
+{
+	int n = 0;
+	if (tile->bvTree)
+	{
+		const dtBVNode* node = &tile->bvTree[0];
+		const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
+		const float* tbmin = tile->header->bmin;
+		const float* tbmax = tile->header->bmax;
+		const float qfac = tile->header->bvQuantFactor;
+
+		// Calculate quantized box
+		unsigned short bmin[3], bmax[3];
+		// dtClamp query box to world box.
+		float minx = dtClamp(qmin[0], tbmin[0], tbmax[0]) - tbmin[0];
+		float miny = dtClamp(qmin[1], tbmin[1], tbmax[1]) - tbmin[1];
+		float minz = dtClamp(qmin[2], tbmin[2], tbmax[2]) - tbmin[2];
+		float maxx = dtClamp(qmax[0], tbmin[0], tbmax[0]) - tbmin[0];
+		float maxy = dtClamp(qmax[1], tbmin[1], tbmax[1]) - tbmin[1];
+		float maxz = dtClamp(qmax[2], tbmin[2], tbmax[2]) - tbmin[2];
+		// Quantize
+		bmin[0] = (unsigned short)(qfac * minx) & 0xfffe;
+		bmin[1] = (unsigned short)(qfac * miny) & 0xfffe;
+		bmin[2] = (unsigned short)(qfac * minz) & 0xfffe;
+		bmax[0] = (unsigned short)(qfac * maxx + 1) | 1;
+		bmax[1] = (unsigned short)(qfac * maxy + 1) | 1;
+		bmax[2] = (unsigned short)(qfac * maxz + 1) | 1;
+
+		// Traverse tree
+		while (node < end)
+		{
+			const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
+			const bool isLeafNode = node->i >= 0;
+
+			if (isLeafNode && overlap)
+			{
+				costs[node->i] = cost;
+				n++;
+			}
+
+			if (overlap || isLeafNode)
+				node++;
+			else
+			{
+				const int escapeIndex = -node->i;
+				node += escapeIndex;
+			}
+		}
+	}
+	else
+	{
+		for (int i = 0; i < tile->header->polyCount; ++i)
+		{
+			const dtPoly* poly = &tile->polys[i];
+			// Off-mesh connections are not in the tree either.
+			if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+				continue;
+			float pmin[3], pmax[3];
+			dtVcopy(pmin, &tile->verts[poly->verts[0]*3]);
+			dtVcopy(pmax, pmin);
+			for (int k = 1; k < poly->vertCount; ++k)
+			{
+				const float* v = &tile->verts[poly->verts[k]*3];
+				dtVmin(pmin, v);
+				dtVmax(pmax, v);
+			}
+			if (!dtOverlapBounds(qmin, qmax, pmin, pmax))
+				continue;
+			costs[i] = cost;
+			n++;
+		}
+	}
+	return n;
+}
+
+dtStatus dtPolyCostOverlay::setCostInBounds(const float* bmin, const float* bmax, const float cost, int* polyCount)
+{
+	if (polyCount)
+		*polyCount = 0;
+	if (!m_nav || !bmin || !bmax || !isValidCost(cost))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	int minx, miny, maxx, maxy;
+	m_nav->calcTileLoc(bmin, &minx, &miny);
+	m_nav->calcTileLoc(bmax, &maxx, &maxy);
+
+	m_version++;
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+	int n = 0;
+	for (int y = miny; y <= maxy; ++y)
+	{
+		for (int x = minx; x <= maxx; ++x)
+		{
+			const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				const dtMeshTile* tile = neis[j];
+				if (!dtOverlapBounds(bmin, bmax, tile->header->bmin, tile->header->bmax))
+					continue;
+
+				const dtTileRef ref = m_nav->getTileRef(tile);
+				unsigned int salt, it, ip;
+				m_nav->decodePolyId((dtPolyRef)ref, salt, it, ip);
+				dtTileCosts* costs = getTileCosts(tile, salt, it);
+				if (!costs)
+					return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+				const int count = setCostInTile(tile, bmin, bmax, cost, costs->costs);
+				if (count > 0)
+					costs->version = m_version;
+				n += count;
+			}
+		}
+	}
+
+	if (polyCount)
+		*polyCount = n;
+	return DT_SUCCESS;
+}
+
+void dtPolyCostOverlay::resetTile(const dtTileRef ref)
+{
+	if (!m_nav || !ref)
+		return;
+	unsigned int salt, it, ip;
+	m_nav->decodePolyId((dtPolyRef)ref, salt, it, ip);
+	if ((int)it >= m_maxTiles || !m_tiles[it].costs)
+		return;
+	dtFree(m_tiles[it].costs);
+	m_tiles[it].costs = 0;
+	m_tiles[it].polyCount = 0;
+	m_tiles[it].version = ++m_version;
+}
+
+void dtPolyCostOverlay::clear()
+{
+	m_version++;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (!m_tiles[i].costs)
+			continue;
+		dtFree(m_tiles[i].costs);
+		m_tiles[i].costs = 0;
+		m_tiles[i].polyCount = 0;
+		m_tiles[i].version = m_version;
+	}
+}
+
+unsigned int dtPolyCostOverlay::getTileVersion(const dtTileRef ref) const
+{
+	if (!m_nav || !ref)
+		return 0;
+	unsigned int salt, it, ip;
+	m_nav->decodePolyId((dtPolyRef)ref, salt, it, ip);
+	if ((int)it >= m_maxTiles)
+		return 0;
+	return m_tiles[it].version;
+}
@@ -193,7 +193,8 @@ dtNavMesh::dtNavMesh() :
 	m_tileLutMask(0),
 	m_posLookup(0),
 	m_nextFree(0),
-	m_tiles(0)
+	m_tiles(0),
+	m_tileShare(0)
 {
 #ifndef DT_POLYREF64
 	m_saltBits = 0;
@@ -201,6 +202,7 @@ dtNavMesh::dtNavMesh() :
 	m_polyBits = 0;
 #endif
 	memset(&m_params, 0, sizeof(dtNavMeshParams));
+	memset(&m_replicaAllocator, 0, sizeof(dtReplicaAllocator));
 	m_orig[0] = 0;
 	m_orig[1] = 0;
 	m_orig[2] = 0;
@@ -210,6 +212,8 @@ dtNavMesh::~dtNavMesh()
 {
 	for (int i = 0; i < m_maxTiles; ++i)
 	{
+		if (m_tileShare && m_tileShare[i])
+			releaseSharedTile(&m_tiles[i]);
 		if (m_tiles[i].flags & DT_TILE_FREE_DATA)
 		{
 			dtFree(m_tiles[i].data);
@@ -219,6 +223,7 @@ dtNavMesh::~dtNavMesh()
 	}
 	dtFree(m_posLookup);
 	dtFree(m_tiles);
+	dtFree(m_tileShare);
 }
 		
 dtStatus dtNavMesh::init(const dtNavMeshParams* params)
@@ -287,6 +292,275 @@ dtStatus dtNavMesh::init(unsigned char* data, const int dataSize, const int flag
 	return addTile(data, dataSize, flags, 0, 0);
 }
 
+// How a tile of a shared instance relates to the base mesh.
+enum dtTileShareFlags
+{
+	DT_SHARE_TILE = 0x01,			// The tile data belongs to the base mesh, the polygons are a private copy.
+	DT_SHARE_OWN_LINKS = 0x02,		// The links are a private copy.
+	DT_SHARE_REPLICA = 0x04			// The tile is a private copy of a base tile, polygons included.
+};
+
+// How a tile takes part in a batch of dtNavMesh::addTiles.
+enum dtBatchTileMarks
+{
+	DT_BATCH_TILE_NEW = 1,			// The tile is added by the batch.
+	DT_BATCH_TILE_LINKED = 2		// The tile was already loaded, and gets links to the new tiles.
+};
+
+// The steps of dtNavMesh::addTiles that are handed to the parallel for.
+enum dtBatchLinkSteps
+{
+	DT_BATCH_LINK_INTERNAL,			// The links within each new tile.
+	DT_BATCH_LINK_EXTERNAL			// The links from each tile to its neighbours.
+};
+
+// A step of dtNavMesh::addTiles, handed to the parallel for.
+struct dtBatchLinkJob
+{
+	dtNavMesh* nav;
+	dtMeshTile** tiles;
+	const unsigned char* marks;
+	int step;
+};
+
+/// @par
+///
+/// The instance starts with the same tiles, at the same tile indices and salts, as
+/// the base mesh, so polygon and tile references are valid in both. The vertices,
+/// links, detail meshes, bounding volume trees and off-mesh connections are read
+/// from the base tiles, while the polygons, and with them the flags and area ids,
+/// are copied, so that each instance has its own dynamic state.
+///
+/// Tiles can be added to and removed from the instance as usual. The links of
+/// a shared tile are copied the first time a neighbouring tile is added or removed,
+/// and removing a shared tile only drops the copies, the base data is kept.
+///
+/// Queries, crowds and state management work on the instance like on any other mesh.
+dtStatus dtNavMesh::initShared(const dtNavMesh* base)
+{
+	if (!base || !base->m_tiles)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtStatus status = init(&base->m_params);
+	if (dtStatusFailed(status))
+		return status;
+
+	m_tileShare = (unsigned char*)dtAlloc(sizeof(unsigned char)*m_maxTiles, DT_ALLOC_PERM);
+	if (!m_tileShare)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tileShare, 0, sizeof(unsigned char)*m_maxTiles);
+
+	m_nextFree = 0;
+	for (int i = m_maxTiles-1; i >= 0; --i)
+	{
+		const dtMeshTile* src = &base->m_tiles[i];
+		dtMeshTile* tile = &m_tiles[i];
+		tile->salt = src->salt;
+		if (!src->header)
+		{
+			tile->next = m_nextFree;
+			m_nextFree = tile;
+			continue;
+		}
+
+		tile->polys = (dtPoly*)dtAlloc(sizeof(dtPoly)*src->header->polyCount, DT_ALLOC_PERM);
+		if (!tile->polys)
+		{
+			// The tiles shared so far are released by the destructor.
+			tile->next = 0;
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+		memcpy(tile->polys, src->polys, sizeof(dtPoly)*src->header->polyCount);
+		m_tileShare[i] = DT_SHARE_TILE;
+
+		tile->linksFreeList = src->linksFreeList;
+		tile->header = src->header;
+		tile->verts = src->verts;
+		tile->links = src->links;
+		tile->detailMeshes = src->detailMeshes;
+		tile->detailVerts = src->detailVerts;
+		tile->detailTris = src->detailTris;
+		tile->bvTree = src->bvTree;
+		tile->offMeshCons = src->offMeshCons;
+		tile->data = src->data;
+		tile->dataSize = src->dataSize;
+		tile->flags = 0;
+
+		const int h = computeTileHash(tile->header->x, tile->header->y, m_tileLutMask);
+		tile->next = m_posLookup[h];
+		m_posLookup[h] = tile;
+	}
+
+	return DT_SUCCESS;
+}
+
+/// @par
+///
+/// A replica is the opposite of a shared instance: every tile, with its polygons,
+/// vertices, links, detail meshes, bounding volume trees and off-mesh connections, is
+/// copied into memory that belongs to the replica, so the queries running on it do
+/// not read the memory of the base mesh at all.
+///
+/// On machines with several memory nodes, build one replica per node, with an
+/// @p allocator that places the memory on that node, and have the query threads of
+/// each node use their node's replica, either with a #dtNavMeshQuery initialized on it,
+/// or by moving an existing query there with dtNavMeshQuery::setNavMesh.  The tiles keep
+/// their indices and salts, so polygon and tile references are the same in the base
+/// mesh and in all of its replicas.
+///
+/// The replica starts with the flags and area ids of the base mesh, after that each
+/// copy has its own.  To carry changes over, store a delta of the base mesh with
+/// #storeStateDelta and apply it to each replica with #restoreStateDelta.
+///
+/// The tiles of the replica cannot be added or removed, and the tiles of the base mesh
+/// must not be added or removed while the replica is in use.
+dtStatus dtNavMesh::initReplica(const dtNavMesh* base, const dtReplicaAllocator* allocator)
+{
+	if (!base || !base->m_tiles)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (allocator && (!allocator->alloc || !allocator->free))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtStatus status = init(&base->m_params);
+	if (dtStatusFailed(status))
+		return status;
+
+	m_tileShare = (unsigned char*)dtAlloc(sizeof(unsigned char)*m_maxTiles, DT_ALLOC_PERM);
+	if (!m_tileShare)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tileShare, 0, sizeof(unsigned char)*m_maxTiles);
+	if (allocator)
+		m_replicaAllocator = *allocator;
+
+	m_nextFree = 0;
+	for (int i = m_maxTiles-1; i >= 0; --i)
+	{
+		const dtMeshTile* src = &base->m_tiles[i];
+		dtMeshTile* tile = &m_tiles[i];
+		tile->salt = src->salt;
+		if (!src->header)
+		{
+			tile->next = m_nextFree;
+			m_nextFree = tile;
+			continue;
+		}
+
+		unsigned char* data = allocator ? (unsigned char*)allocator->alloc(allocator->context, src->dataSize) :
+			(unsigned char*)dtAlloc(src->dataSize, DT_ALLOC_PERM);
+		if (!data)
+		{
+			// The tiles replicated so far are released by the destructor.
+			tile->next = 0;
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+		memcpy(data, src->data, src->dataSize);
+		m_tileShare[i] = DT_SHARE_REPLICA;
+
+		const dtMeshHeader* header = src->header;
+		const int headerSize = dtAlign4(sizeof(dtMeshHeader));
+		const int vertsSize = dtAlign4(sizeof(float)*3*header->vertCount);
+		const int polysSize = dtAlign4(sizeof(dtPoly)*header->polyCount);
+		const int linksSize = dtAlign4(sizeof(dtLink)*(header->maxLinkCount));
+		const int detailMeshesSize = dtAlign4(sizeof(dtPolyDetail)*header->detailMeshCount);
+		const int detailVertsSize = dtAlign4(sizeof(float)*3*header->detailVertCount);
+		const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*header->detailTriCount);
+		const int bvtreeSize = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
+		const int offMeshLinksSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
+
+		unsigned char* d = data;
+		tile->header = dtGetThenAdvanceBufferPointer<dtMeshHeader>(d, headerSize);
+		tile->verts = dtGetThenAdvanceBufferPointer<float>(d, vertsSize);
+		tile->polys = dtGetThenAdvanceBufferPointer<dtPoly>(d, polysSize);
+		tile->links = dtGetThenAdvanceBufferPointer<dtLink>(d, linksSize);
+		tile->detailMeshes = dtGetThenAdvanceBufferPointer<dtPolyDetail>(d, detailMeshesSize);
+		tile->detailVerts = dtGetThenAdvanceBufferPointer<float>(d, detailVertsSize);
+		tile->detailTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
+		tile->bvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvtreeSize);
+		tile->offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshLinksSize);
+
+		// The polygons and links of the base may live outside of its tile data.
+		memcpy(tile->polys, src->polys, sizeof(dtPoly)*header->polyCount);
+		memcpy(tile->links, src->links, sizeof(dtLink)*header->maxLinkCount);
+		tile->linksFreeList = src->linksFreeList;
+		tile->data = data;
+		tile->dataSize = src->dataSize;
+		tile->flags = 0;
+
+		const int h = computeTileHash(tile->header->x, tile->header->y, m_tileLutMask);
+		tile->next = m_posLookup[h];
+		m_posLookup[h] = tile;
+	}
+
+	return DT_SUCCESS;
+}
+
+bool dtNavMesh::ownTileLinks(dtMeshTile* tile)
+{
+	const int it = (int)(tile - m_tiles);
+	if (!m_tileShare || !(m_tileShare[it] & DT_SHARE_TILE) || (m_tileShare[it] & DT_SHARE_OWN_LINKS))
+		return true;
+	dtLink* links = (dtLink*)dtAlloc(sizeof(dtLink)*tile->header->maxLinkCount, DT_ALLOC_PERM);
+	if (!links)
+		return false;
+	memcpy(links, tile->links, sizeof(dtLink)*tile->header->maxLinkCount);
+	tile->links = links;
+	m_tileShare[it] |= DT_SHARE_OWN_LINKS;
+	return true;
+}
+
+dtStatus dtNavMesh::ownTileLinksAt(const int x, const int y, const int side)
+{
+	static const int MAX_NEIS = 32;
+	dtMeshTile* neis[MAX_NEIS];
+	const int nneis = side < 0 ? getTilesAt(x, y, neis, MAX_NEIS) : getNeighbourTilesAt(x, y, side, neis, MAX_NEIS);
+	for (int j = 0; j < nneis; ++j)
+	{
+		// The links of a replica tile are a copy of the base, they cannot change.
+		if (m_tileShare[neis[j] - m_tiles] & DT_SHARE_REPLICA)
+			return DT_FAILURE | DT_INVALID_PARAM;
+		if (!ownTileLinks(neis[j]))
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	return DT_SUCCESS;
+}
+
+dtStatus dtNavMesh::ownNeighbourTileLinks(const int x, const int y)
+{
+	if (!m_tileShare)
+		return DT_SUCCESS;
+
+	for (int i = -1; i < 8; ++i)
+	{
+		dtStatus status = ownTileLinksAt(x, y, i);
+		if (dtStatusFailed(status))
+			return status;
+	}
+	return DT_SUCCESS;
+}
+
+void dtNavMesh::releaseSharedTile(dtMeshTile* tile)
+{
+	const int it = (int)(tile - m_tiles);
+	if (m_tileShare[it] & DT_SHARE_REPLICA)
+	{
+		if (m_replicaAllocator.free)
+			m_replicaAllocator.free(m_replicaAllocator.context, tile->data);
+		else
+			dtFree(tile->data);
+	}
+	else
+	{
+		if (m_tileShare[it] & DT_SHARE_OWN_LINKS)
+			dtFree(tile->links);
+		dtFree(tile->polys);
+	}
+	tile->links = 0;
+	tile->polys = 0;
+	tile->data = 0;
+	tile->dataSize = 0;
+	m_tileShare[it] = 0;
+}
+
 /// @par
 ///
 /// @note The parameters are created automatically when the single tile
@@ -907,6 +1181,57 @@ int dtNavMesh::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, co
 /// @see dtCreateNavMeshData, #removeTile
 dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 							dtTileRef lastRef, dtTileRef* result)
+{
+	dtMeshTile* tile = 0;
+	dtStatus status = registerTile(data, dataSize, flags, lastRef, &tile);
+	if (dtStatusFailed(status))
+		return status;
+
+	connectIntLinks(tile);
+
+	// Base off-mesh connections to their starting polygons and connect connections inside the tile.
+	baseOffMeshLinks(tile);
+	connectExtOffMeshLinks(tile, tile, -1);
+
+	// Create connections with neighbour tiles.
+	static const int MAX_NEIS = 32;
+	dtMeshTile* neis[MAX_NEIS];
+	int nneis;
+	
+	// Connect with layers in current tile.
+	nneis = getTilesAt(tile->header->x, tile->header->y, neis, MAX_NEIS);
+	for (int j = 0; j < nneis; ++j)
+	{
+		if (neis[j] == tile)
+			continue;
+	
+		connectExtLinks(tile, neis[j], -1);
+		connectExtLinks(neis[j], tile, -1);
+		connectExtOffMeshLinks(tile, neis[j], -1);
+		connectExtOffMeshLinks(neis[j], tile, -1);
+	}
+	
+	// Connect with neighbour tiles.
+	for (int i = 0; i < 8; ++i)
+	{
+		nneis = getNeighbourTilesAt(tile->header->x, tile->header->y, i, neis, MAX_NEIS);
+		for (int j = 0; j < nneis; ++j)
+		{
+			connectExtLinks(tile, neis[j], i);
+			connectExtLinks(neis[j], tile, dtOppositeTile(i));
+			connectExtOffMeshLinks(tile, neis[j], i);
+			connectExtOffMeshLinks(neis[j], tile, dtOppositeTile(i));
+		}
+	}
+	
+	if (result)
+		*result = getTileRef(tile);
+	
+	return DT_SUCCESS;
+}
+
+dtStatus dtNavMesh::registerTile(unsigned char* data, int dataSize, int flags,
+								 dtTileRef lastRef, dtMeshTile** result)
 {
 	// Make sure the data is in right format.
 	dtMeshHeader* header = (dtMeshHeader*)data;
@@ -925,6 +1250,11 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	// Make sure the location is free.
 	if (getTileAt(header->x, header->y, header->layer))
 		return DT_FAILURE | DT_ALREADY_OCCUPIED;
+
+	// Shared neighbours get their own links before they are connected to the new tile.
+	dtStatus shareStatus = ownNeighbourTileLinks(header->x, header->y);
+	if (dtStatusFailed(shareStatus))
+		return shareStatus;
 		
 	// Allocate a tile.
 	dtMeshTile* tile = 0;
@@ -1011,47 +1341,176 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	tile->dataSize = dataSize;
 	tile->flags = flags;
 
-	connectIntLinks(tile);
+	*result = tile;
+	return DT_SUCCESS;
+}
 
-	// Base off-mesh connections to their starting polygons and connect connections inside the tile.
-	baseOffMeshLinks(tile);
-	connectExtOffMeshLinks(tile, tile, -1);
+/// @par
+///
+/// Adding the tiles one at a time with #addTile connects every tile with its
+/// neighbours as it is added.  This function instead registers all the tiles first,
+/// and then builds the links of all of them at once:
+///
+/// -# The internal links and the off-mesh connections within each new tile.
+/// -# The external links of each new tile, and of the loaded tiles next to them.
+/// -# The off-mesh connections that cross tiles.
+///
+/// The first two steps are handed to @p parallelFor, which may split them among the
+/// caller's threads; Detour does not start threads of its own.  A tile's links are
+/// only ever written by the range that handles that tile, so the ranges do not need
+/// to lock each other out.  The last step writes to two tiles at a time and is done
+/// on the calling thread.
+///
+/// The resulting links do not depend on how the steps were split.
+///
+/// A tile that cannot be added, for example because its data is invalid or its
+/// location is already occupied, is skipped, its result is set to zero and its data
+/// is left to the caller.  The rest of the tiles are still added, and the returned
+/// status has the failure flags of all the skipped tiles.
+///
+/// @see #addTile
+dtStatus dtNavMesh::addTiles(unsigned char** data, const int* dataSizes, const int count, const int flags,
+							 const dtTileRef* lastRefs, dtTileRef* results,
+							 dtParallelForFunc* parallelFor, void* parallelForContext)
+{
+	if (!data || !dataSizes || count < 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (count == 0)
+		return DT_SUCCESS;
 
-	// Create connections with neighbour tiles.
+	// Marks the new tiles, and the loaded tiles whose links change.
+	unsigned char* marks = (unsigned char*)dtAlloc(sizeof(unsigned char)*m_maxTiles, DT_ALLOC_TEMP);
+	dtMeshTile** tiles = (dtMeshTile**)dtAlloc(sizeof(dtMeshTile*)*m_maxTiles, DT_ALLOC_TEMP);
+	if (!marks || !tiles)
+	{
+		dtFree(marks);
+		dtFree(tiles);
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	memset(marks, 0, sizeof(unsigned char)*m_maxTiles);
+
+	// Register the tiles, so each one can find all of its neighbours.
+	dtStatus status = DT_SUCCESS;
+	int nadded = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		dtMeshTile* tile = 0;
+		dtStatus tileStatus = registerTile(data[i], dataSizes[i], flags, lastRefs ? lastRefs[i] : 0, &tile);
+		if (dtStatusFailed(tileStatus))
+		{
+			status |= tileStatus;
+			if (results)
+				results[i] = 0;
+			continue;
+		}
+		marks[tile - m_tiles] = DT_BATCH_TILE_NEW;
+		tiles[nadded++] = tile;
+		if (results)
+			results[i] = getTileRef(tile);
+	}
+
+	// Collect the loaded tiles next to the new ones, they get links to the new tiles.
 	static const int MAX_NEIS = 32;
 	dtMeshTile* neis[MAX_NEIS];
-	int nneis;
-	
-	// Connect with layers in current tile.
-	nneis = getTilesAt(header->x, header->y, neis, MAX_NEIS);
-	for (int j = 0; j < nneis; ++j)
+	int nlinked = nadded;
+	for (int i = 0; i < nadded; ++i)
 	{
-		if (neis[j] == tile)
-			continue;
-	
-		connectExtLinks(tile, neis[j], -1);
-		connectExtLinks(neis[j], tile, -1);
-		connectExtOffMeshLinks(tile, neis[j], -1);
-		connectExtOffMeshLinks(neis[j], tile, -1);
+		const dtMeshTile* tile = tiles[i];
+		for (int side = -1; side < 8; ++side)
+		{
+			const int nneis = side < 0 ? getTilesAt(tile->header->x, tile->header->y, neis, MAX_NEIS) :
+				getNeighbourTilesAt(tile->header->x, tile->header->y, side, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				const int it = (int)(neis[j] - m_tiles);
+				if (marks[it])
+					continue;
+				marks[it] = DT_BATCH_TILE_LINKED;
+				tiles[nlinked++] = neis[j];
+			}
+		}
 	}
-	
-	// Connect with neighbour tiles.
-	for (int i = 0; i < 8; ++i)
+
+	// Links within the new tiles, then between the new tiles and their neighbours.
+	dtBatchLinkJob job;
+	job.nav = this;
+	job.tiles = tiles;
+	job.marks = marks;
+	job.step = DT_BATCH_LINK_INTERNAL;
+	if (parallelFor && nadded > 1)
+		parallelFor(parallelForContext, nadded, linkTilesRange, &job);
+	else
+		linkTiles(tiles, marks, job.step, 0, nadded);
+	job.step = DT_BATCH_LINK_EXTERNAL;
+	if (parallelFor && nlinked > 1)
+		parallelFor(parallelForContext, nlinked, linkTilesRange, &job);
+	else
+		linkTiles(tiles, marks, job.step, 0, nlinked);
+
+	// Off-mesh connections between tiles, each pair of tiles is connected once.
+	for (int i = 0; i < nadded; ++i)
 	{
-		nneis = getNeighbourTilesAt(header->x, header->y, i, neis, MAX_NEIS);
-		for (int j = 0; j < nneis; ++j)
+		dtMeshTile* tile = tiles[i];
+		for (int side = -1; side < 8; ++side)
 		{
-			connectExtLinks(tile, neis[j], i);
-			connectExtLinks(neis[j], tile, dtOppositeTile(i));
-			connectExtOffMeshLinks(tile, neis[j], i);
-			connectExtOffMeshLinks(neis[j], tile, dtOppositeTile(i));
+			const int nneis = side < 0 ? getTilesAt(tile->header->x, tile->header->y, neis, MAX_NEIS) :
+				getNeighbourTilesAt(tile->header->x, tile->header->y, side, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				if (neis[j] == tile)
+					continue;
+				if (marks[neis[j] - m_tiles] == DT_BATCH_TILE_NEW && neis[j] < tile)
+					continue;
+				connectExtOffMeshLinks(tile, neis[j], side);
+				connectExtOffMeshLinks(neis[j], tile, side < 0 ? -1 : dtOppositeTile(side));
+			}
+		}
+	}
+
+	dtFree(marks);
+	dtFree(tiles);
+
+	return status;
+}
+
+void dtNavMesh::linkTilesRange(void* userData, const int begin, const int end)
+{
+	const dtBatchLinkJob* job = (const dtBatchLinkJob*)userData;
+	job->nav->linkTiles(job->tiles, job->marks, job->step, begin, end);
+}
+
+void dtNavMesh::linkTiles(dtMeshTile** tiles, const unsigned char* marks, const int step, const int begin, const int end)
+{
+	static const int MAX_NEIS = 32;
+	dtMeshTile* neis[MAX_NEIS];
+
+	for (int i = begin; i < end; ++i)
+	{
+		dtMeshTile* tile = tiles[i];
+		if (step == DT_BATCH_LINK_INTERNAL)
+		{
+			connectIntLinks(tile);
+			baseOffMeshLinks(tile);
+			connectExtOffMeshLinks(tile, tile, -1);
+			continue;
+		}
+
+		// Only the links of this tile are written, its neighbours link back on their own.
+		const bool isNew = marks[tile - m_tiles] == DT_BATCH_TILE_NEW;
+		for (int side = -1; side < 8; ++side)
+		{
+			const int nneis = side < 0 ? getTilesAt(tile->header->x, tile->header->y, neis, MAX_NEIS) :
+				getNeighbourTilesAt(tile->header->x, tile->header->y, side, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				if (neis[j] == tile)
+					continue;
+				if (!isNew && marks[neis[j] - m_tiles] != DT_BATCH_TILE_NEW)
+					continue;
+				connectExtLinks(tile, neis[j], side);
+			}
 		}
 	}
-	
-	if (result)
-		*result = getTileRef(tile);
-	
-	return DT_SUCCESS;
 }
 
 const dtMeshTile* dtNavMesh::getTileAt(const int x, const int y, const int layer) const
@@ -1248,6 +1707,11 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	dtMeshTile* tile = &m_tiles[tileIndex];
 	if (tile->salt != tileSalt)
 		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Shared neighbours get their own links before they are disconnected from the tile.
+	dtStatus shareStatus = ownNeighbourTileLinks(tile->header->x, tile->header->y);
+	if (dtStatusFailed(shareStatus))
+		return shareStatus;
 	
 	// Remove tile from hash lookup.
 	int h = computeTileHash(tile->header->x,tile->header->y,m_tileLutMask);
@@ -1289,7 +1753,14 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	}
 		
 	// Reset tile.
-	if (tile->flags & DT_TILE_FREE_DATA)
+	if (m_tileShare && m_tileShare[tileIndex])
+	{
+		// The data belongs to the base mesh.
+		releaseSharedTile(tile);
+		if (data) *data = 0;
+		if (dataSize) *dataSize = 0;
+	}
+	else if (tile->flags & DT_TILE_FREE_DATA)
 	{
 		// Owns data
 		dtFree(tile->data);
@@ -1332,6 +1803,237 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	return DT_SUCCESS;
 }
 
+// Where a polygon of a replaced tile was, kept while the tile is swapped.
+struct dtRemapPoly
+{
+	float center[3];
+	float bmin[3];
+	float bmax[3];
+	unsigned char type;
+	float conPos[6];	// The end points of an off-mesh connection, as it was authored.
+	float conRad;		// The radius of an off-mesh connection.
+	bool conBidir;		// True if the off-mesh connection can be traversed both ways.
+};
+
+static void calcRemapPoly(const dtMeshTile* tile, const dtPoly* poly, dtRemapPoly* rp)
+{
+	const float* v = &tile->verts[poly->verts[0]*3];
+	dtVcopy(rp->center, v);
+	dtVcopy(rp->bmin, v);
+	dtVcopy(rp->bmax, v);
+	for (int i = 1; i < poly->vertCount; ++i)
+	{
+		v = &tile->verts[poly->verts[i]*3];
+		dtVadd(rp->center, rp->center, v);
+		dtVmin(rp->bmin, v);
+		dtVmax(rp->bmax, v);
+	}
+	dtVscale(rp->center, rp->center, 1.0f / poly->vertCount);
+	rp->type = poly->getType();
+	if (rp->type == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		const dtOffMeshConnection* con = &tile->offMeshCons[(int)(poly - tile->polys) - tile->header->offMeshBase];
+		memcpy(rp->conPos, con->pos, sizeof(rp->conPos));
+		rp->conRad = con->rad;
+		rp->conBidir = (con->flags & DT_OFFMESH_CON_BIDIR) != 0;
+	}
+	else
+	{
+		memset(rp->conPos, 0, sizeof(rp->conPos));
+		rp->conRad = 0;
+		rp->conBidir = false;
+	}
+}
+
+// Returns how far apart the end points of two off-mesh connections are, or a negative
+// value if they are not the same connection: they must run the same way, and each end
+// must be within the radius of the old connection.
+static float offMeshConDistSqr(const dtRemapPoly& a, const dtRemapPoly& b)
+{
+	if (a.conBidir != b.conBidir)
+		return -1.0f;
+	const float radSqr = dtSqr(a.conRad);
+	float best = -1.0f;
+	const float s0 = dtVdistSqr(&a.conPos[0], &b.conPos[0]);
+	const float e0 = dtVdistSqr(&a.conPos[3], &b.conPos[3]);
+	if (s0 <= radSqr && e0 <= radSqr)
+		best = s0 + e0;
+	if (a.conBidir)
+	{
+		// A two way connection may have been authored from the other end.
+		const float s1 = dtVdistSqr(&a.conPos[0], &b.conPos[3]);
+		const float e1 = dtVdistSqr(&a.conPos[3], &b.conPos[0]);
+		if (s1 <= radSqr && e1 <= radSqr && (best < 0.0f || s1 + e1 < best))
+			best = s1 + e1;
+	}
+	return best;
+}
+
+/// @par
+///
+/// Use this function instead of #removeTile followed by #addTile when a tile is rebuilt,
+/// for example after the geometry under it changed. Every reference into the old tile
+/// becomes invalid, and the mapping tells which polygon of the new tile covers the same
+/// place, so that paths and corridors can be patched with #dtRemapPolyRef instead of
+/// replanned. (See dtCrowd::remapPolyRefs.)
+///
+/// A ground polygon is mapped to the new polygon that contains its center and is within
+/// climb height of it, or else to the nearest new polygon overlapping its bounds. An
+/// off-mesh connection is mapped to the new connection that runs the same way and whose
+/// end points are within its radius of the old ones. Polygons that are no longer there
+/// map to zero. The candidates are found through the bounding volume tree of the new tile.
+///
+/// A mapping only covers one replacement. If the tile is replaced again before every
+/// reference was patched, keep both mappings and pass them to #dtRemapPolyRef in order.
+/// If the mapping can not be computed for lack of memory, the new tile is still in,
+/// every polygon maps to zero and DT_OUT_OF_MEMORY is added to the status.
+///
+/// The new tile must be at the same location and layer as the old one. The new data is
+/// checked before the old tile is removed, so on failure the navigation mesh is left as
+/// it was. The old tile data is freed if the tile owns it (#DT_TILE_FREE_DATA), and is
+/// left to the caller otherwise.
+dtStatus dtNavMesh::replaceTile(dtTileRef ref, unsigned char* data, int dataSize, int flags,
+								dtTileRef* result, dtPolyRefRemap* remap)
+{
+	const dtMeshTile* old = getTileByRef(ref);
+	if (!old || !old->header || !data)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const dtMeshHeader* header = (const dtMeshHeader*)data;
+	if (header->magic != DT_NAVMESH_MAGIC)
+		return DT_FAILURE | DT_WRONG_MAGIC;
+	if (header->version != DT_NAVMESH_VERSION)
+		return DT_FAILURE | DT_WRONG_VERSION;
+	if (header->x != old->header->x || header->y != old->header->y || header->layer != old->header->layer)
+		return DT_FAILURE | DT_INVALID_PARAM;
+#ifndef DT_POLYREF64
+	if (m_polyBits < dtIlog2(dtNextPow2((unsigned int)header->polyCount)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+#endif
+
+	const int oldPolyCount = old->header->polyCount;
+	if (remap && (!remap->newRefs || remap->maxPolys < oldPolyCount))
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+	// Remember where the old polygons were, the tile data may be gone after removing it.
+	dtRemapPoly* oldPolys = 0;
+	if (remap)
+	{
+		oldPolys = (dtRemapPoly*)dtAlloc(sizeof(dtRemapPoly)*dtMax(oldPolyCount, 1), DT_ALLOC_TEMP);
+		if (!oldPolys)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		for (int i = 0; i < oldPolyCount; ++i)
+			calcRemapPoly(old, &old->polys[i], &oldPolys[i]);
+		remap->oldBase = getPolyRefBase(old);
+		remap->polyCount = oldPolyCount;
+	}
+
+	// Everything addTile can reject has been checked above, and removing the tile frees
+	// its location and a tile slot, so once the old tile is gone the new one goes in.
+	dtStatus status = removeTile(ref, 0, 0);
+	if (dtStatusFailed(status))
+	{
+		dtFree(oldPolys);
+		return status;
+	}
+
+	dtTileRef newRef = 0;
+	status = addTile(data, dataSize, flags, 0, &newRef);
+	if (result)
+		*result = newRef;
+	if (!remap)
+		return status;
+	if (dtStatusFailed(status))
+	{
+		memset(remap->newRefs, 0, sizeof(dtPolyRef)*oldPolyCount);
+		dtFree(oldPolys);
+		return status;
+	}
+
+	const dtMeshTile* tile = getTileByRef(newRef);
+	const dtPolyRef base = getPolyRefBase(tile);
+	const float climb = tile->header->walkableClimb;
+	const int newPolyCount = tile->header->polyCount;
+	dtRemapPoly* newPolys = (dtRemapPoly*)dtAlloc(sizeof(dtRemapPoly)*dtMax(newPolyCount, 1), DT_ALLOC_TEMP);
+	dtPolyRef* candidates = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*dtMax(newPolyCount, 1), DT_ALLOC_TEMP);
+	if (!newPolys || !candidates)
+	{
+		// The new tile is in, only the mapping is missing.
+		memset(remap->newRefs, 0, sizeof(dtPolyRef)*oldPolyCount);
+		dtFree(candidates);
+		dtFree(newPolys);
+		dtFree(oldPolys);
+		return status | DT_OUT_OF_MEMORY;
+	}
+	for (int i = 0; i < newPolyCount; ++i)
+		calcRemapPoly(tile, &tile->polys[i], &newPolys[i]);
+
+	for (int i = 0; i < oldPolyCount; ++i)
+	{
+		const dtRemapPoly& op = oldPolys[i];
+		dtPolyRef best = 0;
+		float bestDist = FLT_MAX;
+
+		if (op.type == DT_POLYTYPE_OFFMESH_CONNECTION)
+		{
+			// Off-mesh connections are matched by their end points and direction.
+			for (int j = tile->header->offMeshBase; j < newPolyCount; ++j)
+			{
+				if (newPolys[j].type != DT_POLYTYPE_OFFMESH_CONNECTION)
+					continue;
+				const float d = offMeshConDistSqr(op, newPolys[j]);
+				if (d >= 0.0f && d < bestDist)
+				{
+					best = base | (dtPolyRef)j;
+					bestDist = d;
+				}
+			}
+			remap->newRefs[i] = best;
+			continue;
+		}
+
+		// Only the ground polygons overlapping the old bounds are candidates.
+		float qmin[3], qmax[3];
+		dtVcopy(qmin, op.bmin);
+		dtVcopy(qmax, op.bmax);
+		qmin[1] -= climb;
+		qmax[1] += climb;
+		const int ncandidates = queryPolygonsInTile(tile, qmin, qmax, candidates, newPolyCount);
+		for (int k = 0; k < ncandidates; ++k)
+		{
+			const int j = (int)decodePolyIdPoly(candidates[k]);
+			const dtPoly* poly = &tile->polys[j];
+			const dtRemapPoly& np = newPolys[j];
+			// The tree is quantized, check the exact bounds.
+			if (!dtOverlapBounds(qmin, qmax, np.bmin, np.bmax))
+				continue;
+
+			// Prefer the polygon covering the old center, then the nearest one.
+			float d = dtVdist2DSqr(op.center, np.center);
+			float verts[DT_VERTS_PER_POLYGON*3];
+			for (int v = 0; v < poly->vertCount; ++v)
+				dtVcopy(&verts[v*3], &tile->verts[poly->verts[v]*3]);
+			if (dtPointInPolygon(op.center, verts, poly->vertCount))
+			{
+				const float dy = dtMax(np.bmin[1] - op.center[1], op.center[1] - np.bmax[1]);
+				if (dy <= climb)
+					d = -1.0f + dtMax(dy, 0.0f) / (climb + 1.0f);
+			}
+			if (d < bestDist)
+			{
+				best = candidates[k];
+				bestDist = d;
+			}
+		}
+		remap->newRefs[i] = best;
+	}
+
+	dtFree(candidates);
+	dtFree(newPolys);
+	dtFree(oldPolys);
+	return status;
+}
+
 dtTileRef dtNavMesh::getTileRef(const dtMeshTile* tile) const
 {
 	if (!tile) return 0;
@@ -1449,6 +2151,320 @@ dtStatus dtNavMesh::restoreTileState(dtMeshTile* tile, const unsigned char* data
 	return DT_SUCCESS;
 }
 
+struct dtNavMeshState
+{
+	int magic;								// Magic number, used to identify the data.
+	int version;							// Data version number.
+	int tileCount;							// Number of tiles stored.
+	int polyCount;							// Number of polygons stored, over all tiles.
+};
+
+struct dtNavMeshStateDelta
+{
+	int magic;								// Magic number, used to identify the data.
+	int version;							// Data version number.
+	int changeCount;						// Number of changed polygons stored.
+};
+
+struct dtPolyStateChange
+{
+	dtPolyRef ref;							// The changed polygon.
+	unsigned short flags;					// Flags (see dtPolyFlags).
+	unsigned char area;						// Area ID of the polygon.
+};
+
+// The whole mesh state is laid out as the header, the tile refs, the polygon
+// count of each tile and then the flags and areas of all polygons in tile order.
+struct dtNavMeshStateLayout
+{
+	dtNavMeshState* header;
+	dtTileRef* refs;
+	int* polyCounts;
+	unsigned short* flags;
+	unsigned char* areas;
+};
+
+// Rounds a size up to a multiple of four, in 64 bits so the counts read from a state buffer can not wrap it.
+static long long dtAlign4Size(const long long size)
+{
+	return (size + 3) & ~3ll;
+}
+
+// The size of a state with the given counts, computed in 64 bits. Compare it to the
+// size of the buffer before any offset is derived from the counts.
+static long long dtGetStateLayoutSize(const int tileCount, const int polyCount)
+{
+	return dtAlign4Size(sizeof(dtNavMeshState)) +
+		dtAlign4Size((long long)sizeof(dtTileRef) * tileCount) +
+		dtAlign4Size((long long)sizeof(int) * tileCount) +
+		dtAlign4Size((long long)sizeof(unsigned short) * polyCount) +
+		dtAlign4Size((long long)sizeof(unsigned char) * polyCount);
+}
+
+static void dtGetStateLayout(unsigned char* data, const int tileCount, const int polyCount, dtNavMeshStateLayout& layout)
+{
+	layout.header = dtGetThenAdvanceBufferPointer<dtNavMeshState>(data, dtAlign4(sizeof(dtNavMeshState)));
+	layout.refs = dtGetThenAdvanceBufferPointer<dtTileRef>(data, dtAlign4(sizeof(dtTileRef) * tileCount));
+	layout.polyCounts = dtGetThenAdvanceBufferPointer<int>(data, dtAlign4(sizeof(int) * tileCount));
+	layout.flags = dtGetThenAdvanceBufferPointer<unsigned short>(data, dtAlign4(sizeof(unsigned short) * polyCount));
+	layout.areas = dtGetThenAdvanceBufferPointer<unsigned char>(data, dtAlign4(sizeof(unsigned char) * polyCount));
+}
+
+// Reads the header of a state buffer and checks that the buffer holds all of it.
+// The layout is only used for reading.
+static dtStatus dtReadStateLayout(const unsigned char* data, const int dataSize, dtNavMeshStateLayout& layout)
+{
+	if (!data || dataSize < (int)dtAlign4(sizeof(dtNavMeshState)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	const dtNavMeshState* header = (const dtNavMeshState*)data;
+	if (header->magic != DT_NAVMESH_STATE_MAGIC)
+		return DT_FAILURE | DT_WRONG_MAGIC;
+	if (header->version != DT_NAVMESH_STATE_VERSION)
+		return DT_FAILURE | DT_WRONG_VERSION;
+	// The counts come from the buffer, so they are checked against its size before they are used.
+	if (header->tileCount < 0 || header->polyCount < 0 ||
+		(long long)dataSize < dtGetStateLayoutSize(header->tileCount, header->polyCount))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	dtGetStateLayout(const_cast<unsigned char*>(data), header->tileCount, header->polyCount, layout);
+	return DT_SUCCESS;
+}
+
+// Returns the live tile a stored state belongs to, or null if the tile was removed or rebuilt since.
+static const dtMeshTile* dtGetStateTile(const dtNavMesh& mesh, const dtTileRef ref, const int polyCount)
+{
+	const dtMeshTile* tile = mesh.getTileByRef(ref);
+	if (!tile || tile->header->polyCount != polyCount)
+		return 0;
+	return tile;
+}
+
+// Checks that every tile of a state is still in the mesh, and that their polygons add up
+// to the flags and areas stored, so reading them stays within the buffer.
+static bool dtCheckStateTiles(const dtNavMesh& mesh, const dtNavMeshStateLayout& layout)
+{
+	long long polyCount = 0;
+	for (int i = 0; i < layout.header->tileCount; ++i)
+	{
+		if (!dtGetStateTile(mesh, layout.refs[i], layout.polyCounts[i]))
+			return false;
+		polyCount += layout.polyCounts[i];
+	}
+	return polyCount == layout.header->polyCount;
+}
+
+///  @see #storeState
+int dtNavMesh::getStateSize() const
+{
+	int tileCount = 0;
+	int polyCount = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = &m_tiles[i];
+		if (!tile->header) continue;
+		tileCount++;
+		polyCount += tile->header->polyCount;
+	}
+	return (int)dtGetStateLayoutSize(tileCount, polyCount);
+}
+
+/// @par
+///
+/// The state of all tiles is stored in one buffer, the flags and area ids are
+/// kept in separate arrays so restoring and comparing states is a linear pass.
+/// @note The state data is only valid until any tile reference changes.
+/// @see #getStateSize, #restoreState, #storeStateDelta
+dtStatus dtNavMesh::storeState(unsigned char* data, const int maxDataSize) const
+{
+	int tileCount = 0;
+	int polyCount = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = &m_tiles[i];
+		if (!tile->header) continue;
+		tileCount++;
+		polyCount += tile->header->polyCount;
+	}
+
+	// Make sure there is enough space to store the state.
+	const long long dataSize = dtGetStateLayoutSize(tileCount, polyCount);
+	if ((long long)maxDataSize < dataSize)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+	// Clear the padding, so the stored buffer does not carry stale memory.
+	memset(data, 0, (size_t)dataSize);
+	dtNavMeshStateLayout layout;
+	dtGetStateLayout(data, tileCount, polyCount, layout);
+	layout.header->magic = DT_NAVMESH_STATE_MAGIC;
+	layout.header->version = DT_NAVMESH_STATE_VERSION;
+	layout.header->tileCount = tileCount;
+	layout.header->polyCount = polyCount;
+
+	int n = 0;
+	int p = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = &m_tiles[i];
+		if (!tile->header) continue;
+		layout.refs[n] = getTileRef(tile);
+		layout.polyCounts[n] = tile->header->polyCount;
+		n++;
+		for (int j = 0; j < tile->header->polyCount; ++j, ++p)
+		{
+			layout.flags[p] = tile->polys[j].flags;
+			layout.areas[p] = tile->polys[j].getArea();
+		}
+	}
+
+	return DT_SUCCESS;
+}
+
+/// @par
+///
+/// Every tile in the state must still be in the mesh with the same reference,
+/// otherwise nothing is restored. Tiles added after the state was stored keep
+/// their current state.
+/// @note This function does not impact the tile's #dtTileRef and #dtPolyRef's.
+/// @see #storeState
+dtStatus dtNavMesh::restoreState(const unsigned char* data, const int maxDataSize)
+{
+	dtNavMeshStateLayout layout;
+	dtStatus status = dtReadStateLayout(data, maxDataSize, layout);
+	if (dtStatusFailed(status))
+		return status;
+
+	// Check that the restore is possible before changing anything.
+	if (!dtCheckStateTiles(*this, layout))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const int tileCount = layout.header->tileCount;
+	int p = 0;
+	for (int i = 0; i < tileCount; ++i)
+	{
+		dtMeshTile* tile = &m_tiles[decodePolyIdTile((dtPolyRef)layout.refs[i])];
+		for (int j = 0; j < tile->header->polyCount; ++j, ++p)
+		{
+			tile->polys[j].flags = layout.flags[p];
+			tile->polys[j].setArea(layout.areas[p]);
+		}
+	}
+
+	return DT_SUCCESS;
+}
+
+///  @see #storeStateDelta
+int dtNavMesh::getStateDeltaMaxSize() const
+{
+	int polyCount = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (m_tiles[i].header)
+			polyCount += m_tiles[i].header->polyCount;
+	}
+	return dtAlign4(sizeof(dtNavMeshStateDelta)) + dtAlign4(sizeof(dtPolyStateChange) * polyCount);
+}
+
+/// @par
+///
+/// The delta only holds the polygons whose flags or area differ from @p base, so
+/// it is usually much smaller than a full state. Applying it with #restoreStateDelta
+/// to a mesh in the @p base state brings it to the current state. To chain deltas,
+/// store a new base state after each one.
+///
+/// Every tile in @p base must still be in the mesh with the same reference.
+/// @see #getStateDeltaMaxSize, #storeState, #restoreStateDelta
+dtStatus dtNavMesh::storeStateDelta(const unsigned char* base, const int baseSize,
+									unsigned char* data, const int maxDataSize, int* dataSize) const
+{
+	*dataSize = 0;
+
+	dtNavMeshStateLayout layout;
+	dtStatus status = dtReadStateLayout(base, baseSize, layout);
+	if (dtStatusFailed(status))
+		return status;
+
+	if (!dtCheckStateTiles(*this, layout))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const int headerSize = dtAlign4(sizeof(dtNavMeshStateDelta));
+	if (maxDataSize < headerSize)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+	unsigned char* d = data;
+	dtNavMeshStateDelta* header = dtGetThenAdvanceBufferPointer<dtNavMeshStateDelta>(d, headerSize);
+	dtPolyStateChange* changes = (dtPolyStateChange*)d;
+	const int maxChanges = (maxDataSize - headerSize) / (int)sizeof(dtPolyStateChange);
+
+	int n = 0;
+	int p = 0;
+	for (int i = 0; i < layout.header->tileCount; ++i)
+	{
+		const dtMeshTile* tile = dtGetStateTile(*this, layout.refs[i], layout.polyCounts[i]);
+		const dtPolyRef polyBase = getPolyRefBase(tile);
+		for (int j = 0; j < tile->header->polyCount; ++j, ++p)
+		{
+			const dtPoly* poly = &tile->polys[j];
+			if (poly->flags == layout.flags[p] && poly->getArea() == layout.areas[p])
+				continue;
+			if (n >= maxChanges)
+				return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+			memset(&changes[n], 0, sizeof(dtPolyStateChange));
+			changes[n].ref = polyBase | (dtPolyRef)j;
+			changes[n].flags = poly->flags;
+			changes[n].area = poly->getArea();
+			n++;
+		}
+	}
+
+	header->magic = DT_NAVMESH_DELTA_MAGIC;
+	header->version = DT_NAVMESH_STATE_VERSION;
+	header->changeCount = n;
+	*dataSize = headerSize + dtAlign4(sizeof(dtPolyStateChange) * n);
+
+	return DT_SUCCESS;
+}
+
+/// @par
+///
+/// Every polygon in the delta must still be in the mesh, otherwise nothing is restored.
+/// @note This function does not impact the tile's #dtTileRef and #dtPolyRef's.
+/// @see #storeStateDelta
+dtStatus dtNavMesh::restoreStateDelta(const unsigned char* data, const int dataSize)
+{
+	const int headerSize = dtAlign4(sizeof(dtNavMeshStateDelta));
+	if (!data || dataSize < headerSize)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const dtNavMeshStateDelta* header = dtGetThenAdvanceBufferPointer<const dtNavMeshStateDelta>(data, headerSize);
+	if (header->magic != DT_NAVMESH_DELTA_MAGIC)
+		return DT_FAILURE | DT_WRONG_MAGIC;
+	if (header->version != DT_NAVMESH_STATE_VERSION)
+		return DT_FAILURE | DT_WRONG_VERSION;
+	// The count comes from the buffer, so it is checked against its size before it is used.
+	if (header->changeCount < 0 ||
+		(long long)dataSize < headerSize + (long long)sizeof(dtPolyStateChange) * header->changeCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const dtPolyStateChange* changes = (const dtPolyStateChange*)data;
+
+	// Check that the restore is possible before changing anything.
+	for (int i = 0; i < header->changeCount; ++i)
+	{
+		if (!isValidPolyRef(changes[i].ref))
+			return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	for (int i = 0; i < header->changeCount; ++i)
+	{
+		unsigned int salt, it, ip;
+		decodePolyId(changes[i].ref, salt, it, ip);
+		dtPoly* poly = &m_tiles[it].polys[ip];
+		poly->flags = changes[i].flags;
+		poly->setArea(changes[i].area);
+	}
+
+	return DT_SUCCESS;
+}
+
 /// @par
 ///
 /// Off-mesh connections are stored in the navigation mesh as special 2-vertex 
@@ -19,7 +19,9 @@
 
 #include <float.h>
 #include <string.h>
+#include <stdlib.h>
 #include "DetourNavMeshQuery.h"
+#include "DetourCostOverlay.h"
 #include "DetourNavMesh.h"
 #include "DetourNode.h"
 #include "DetourCommon.h"
@@ -44,6 +46,9 @@
 ///
 /// Setting the include flags to 0 will result in all polygons being excluded.
 ///
+/// If a cost overlay is set, the area cost of a polygon is multiplied by the 
+/// polygon's multiplier in the overlay. (See dtPolyCostOverlay.)
+///
 /// <b>Custom Implementations</b>
 /// 
 /// DT_VIRTUAL_QUERYFILTER must be defined in order to extend this class.
@@ -64,7 +69,8 @@
 
 dtQueryFilter::dtQueryFilter() :
 	m_includeFlags(0xffff),
-	m_excludeFlags(0)
+	m_excludeFlags(0),
+	m_costOverlay(0)
 {
 	for (int i = 0; i < DT_MAX_AREAS; ++i)
 		m_areaCost[i] = 1.0f;
@@ -90,10 +96,11 @@ bool dtQueryFilter::passFilter(const dtPolyRef /*ref*/,
 
 float dtQueryFilter::getCost(const float* pa, const float* pb,
 							 const dtPolyRef /*prevRef*/, const dtMeshTile* /*prevTile*/, const dtPoly* /*prevPoly*/,
-							 const dtPolyRef /*curRef*/, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
+							 const dtPolyRef curRef, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
 							 const dtPolyRef /*nextRef*/, const dtMeshTile* /*nextTile*/, const dtPoly* /*nextPoly*/) const
 {
-	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
+	const float cost = dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
+	return m_costOverlay ? cost * m_costOverlay->getCost(curRef) : cost;
 }
 #else
 inline bool dtQueryFilter::passFilter(const dtPolyRef /*ref*/,
@@ -105,10 +112,11 @@ inline bool dtQueryFilter::passFilter(const dtPolyRef /*ref*/,
 
 inline float dtQueryFilter::getCost(const float* pa, const float* pb,
 									const dtPolyRef /*prevRef*/, const dtMeshTile* /*prevTile*/, const dtPoly* /*prevPoly*/,
-									const dtPolyRef /*curRef*/, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
+									const dtPolyRef curRef, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
 									const dtPolyRef /*nextRef*/, const dtMeshTile* /*nextTile*/, const dtPoly* /*nextPoly*/) const
 {
-	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
+	const float cost = dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
+	return m_costOverlay ? cost * m_costOverlay->getCost(curRef) : cost;
 }
 #endif	
 	
@@ -235,6 +243,24 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 	return DT_SUCCESS;
 }
 
+/// @par
+///
+/// The polygon references found so far stay valid when the new mesh has the same
+/// parameters and tiles, which holds for a mesh and its replicas.  A sliced path
+/// query in progress is abandoned.
+dtStatus dtNavMeshQuery::setNavMesh(const dtNavMesh* nav)
+{
+	if (!nav || !m_nav || !m_nodePool)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (memcmp(nav->getParams(), m_nav->getParams(), sizeof(dtNavMeshParams)) != 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_nav = nav;
+	memset(&m_query, 0, sizeof(dtQueryData));
+	m_query.status = DT_FAILURE;
+	return DT_SUCCESS;
+}
+
 dtStatus dtNavMeshQuery::findRandomPoint(const dtQueryFilter* filter, float (*frand)(),
 										 dtPolyRef* randomRef, float* randomPt) const
 {
@@ -741,6 +767,305 @@ dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfE
 	return DT_SUCCESS;
 }
 
+struct dtNearestPolysItem
+{
+	int tx, ty;
+	int cx, cz;
+	int idx;
+};
+
+static int compareNearestPolysItem(const void* va, const void* vb)
+{
+	const dtNearestPolysItem* a = (const dtNearestPolysItem*)va;
+	const dtNearestPolysItem* b = (const dtNearestPolysItem*)vb;
+	if (a->tx != b->tx) return a->tx < b->tx ? -1 : 1;
+	if (a->ty != b->ty) return a->ty < b->ty ? -1 : 1;
+	if (a->cx != b->cx) return a->cx < b->cx ? -1 : 1;
+	if (a->cz != b->cz) return a->cz < b->cz ? -1 : 1;
+	return a->idx - b->idx;
+}
+
+/// @par
+///
+/// The points are sorted by tile, and then into small cells within the tile
+/// (a few search boxes wide).  All the points in a cell are resolved with a
+/// single bounding volume tree walk over the union of their search boxes.
+/// A tile is only searched for the points whose own search box reaches it,
+/// and a polygon is only tested against the points whose box overlaps it.
+///
+/// The result for each point is the same as calling #findNearestPoly for it.
+///
+dtStatus dtNavMeshQuery::findNearestPolys(const float* centers, const int count, const float* halfExtents,
+										  const dtQueryFilter* filter,
+										  dtPolyRef* nearestRefs, float* nearestPts) const
+{
+	dtAssert(m_nav);
+
+	if (!centers || count < 0 || !halfExtents || !dtVisfinite(halfExtents) || !filter || !nearestRefs)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (count == 0)
+		return DT_SUCCESS;
+
+	dtNearestPolysItem* items = (dtNearestPolysItem*)dtAlloc(sizeof(dtNearestPolysItem)*count, DT_ALLOC_TEMP);
+	int* order = (int*)dtAlloc(sizeof(int)*count, DT_ALLOC_TEMP);
+	float* dist = (float*)dtAlloc(sizeof(float)*count, DT_ALLOC_TEMP);
+	float* pts = (float*)dtAlloc(sizeof(float)*count*3, DT_ALLOC_TEMP);
+	unsigned short* qbounds = (unsigned short*)dtAlloc(sizeof(unsigned short)*count*6, DT_ALLOC_TEMP);
+	int* tileRanges = (int*)dtAlloc(sizeof(int)*count*4, DT_ALLOC_TEMP);
+	int* tileGroup = (int*)dtAlloc(sizeof(int)*count, DT_ALLOC_TEMP);
+	if (!items || !order || !dist || !pts || !qbounds || !tileRanges || !tileGroup)
+	{
+		dtFree(items);
+		dtFree(order);
+		dtFree(dist);
+		dtFree(pts);
+		dtFree(qbounds);
+		dtFree(tileRanges);
+		dtFree(tileGroup);
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	const float cellSize = dtMax(dtMax(halfExtents[0], halfExtents[2]) * 4.0f, 1e-3f);
+	int nitems = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		const float* c = &centers[i*3];
+		nearestRefs[i] = 0;
+		dist[i] = FLT_MAX;
+		if (!dtVisfinite(c))
+			continue;
+		dtNearestPolysItem& it = items[nitems++];
+		m_nav->calcTileLoc(c, &it.tx, &it.ty);
+		it.cx = (int)dtMathFloorf(c[0] / cellSize);
+		it.cz = (int)dtMathFloorf(c[2] / cellSize);
+		it.idx = i;
+	}
+	qsort(items, nitems, sizeof(dtNearestPolysItem), compareNearestPolysItem);
+
+	for (int i = 0; i < nitems; )
+	{
+		// Collect the group of points sharing the same tile and cell, the union
+		// of their search boxes is built from the exact box of each point.
+		int j = i;
+		float qmin[3], qmax[3];
+		dtVsub(qmin, &centers[items[i].idx*3], halfExtents);
+		dtVadd(qmax, &centers[items[i].idx*3], halfExtents);
+		while (j < nitems && items[j].tx == items[i].tx && items[j].ty == items[i].ty &&
+			   items[j].cx == items[i].cx && items[j].cz == items[i].cz)
+		{
+			const float* c = &centers[items[j].idx*3];
+			float pmin[3], pmax[3];
+			dtVsub(pmin, c, halfExtents);
+			dtVadd(pmax, c, halfExtents);
+			dtVmin(qmin, pmin);
+			dtVmax(qmax, pmax);
+			order[j - i] = items[j].idx;
+
+			// The tiles findNearestPoly would visit for this point.
+			int* range = &tileRanges[(j - i)*4];
+			m_nav->calcTileLoc(pmin, &range[0], &range[1]);
+			m_nav->calcTileLoc(pmax, &range[2], &range[3]);
+			j++;
+		}
+		
+		// Same tile traversal as queryPolygons, so every point sees the polygons in the same order.
+		int minx, miny, maxx, maxy;
+		m_nav->calcTileLoc(qmin, &minx, &miny);
+		m_nav->calcTileLoc(qmax, &maxx, &maxy);
+
+		static const int MAX_NEIS = 32;
+		const dtMeshTile* neis[MAX_NEIS];
+		for (int y = miny; y <= maxy; ++y)
+		{
+			for (int x = minx; x <= maxx; ++x)
+			{
+				int ngroup = 0;
+				for (int k = 0; k < j - i; ++k)
+				{
+					const int* range = &tileRanges[k*4];
+					if (x >= range[0] && x <= range[2] && y >= range[1] && y <= range[3])
+						tileGroup[ngroup++] = order[k];
+				}
+				if (!ngroup)
+					continue;
+				const int nneis = m_nav->getTilesAt(x,y,neis,MAX_NEIS);
+				for (int k = 0; k < nneis; ++k)
+					findNearestPolysInTile(neis[k], qmin, qmax, centers, tileGroup, ngroup, halfExtents, filter, qbounds, dist, nearestRefs, pts);
+			}
+		}
+
+		i = j;
+	}
+
+	if (nearestPts)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			if (nearestRefs[i])
+				dtVcopy(&nearestPts[i*3], &pts[i*3]);
+		}
+	}
+
+	dtFree(items);
+	dtFree(order);
+	dtFree(dist);
+	dtFree(pts);
+	dtFree(qbounds);
+	dtFree(tileRanges);
+	dtFree(tileGroup);
+
+	return DT_SUCCESS;
+}
+
+// Updates the nearest polygon of a point, using the same metric as dtFindNearestPolyQuery.
+static void updateNearestPoly(const dtNavMeshQuery* query, const dtMeshTile* tile, const dtPolyRef ref, const float* center,
+							  float* nearestDist, dtPolyRef* nearestRef, float* nearestPt)
+{
+	float closestPtPoly[3];
+	float diff[3];
+	bool posOverPoly = false;
+	float d;
+	query->closestPointOnPoly(ref, center, closestPtPoly, &posOverPoly);
+
+	// If a point is directly over a polygon and closer than
+	// climb height, favor that instead of straight line nearest point.
+	dtVsub(diff, center, closestPtPoly);
+	if (posOverPoly)
+	{
+		d = dtAbs(diff[1]) - tile->header->walkableClimb;
+		d = d > 0 ? d*d : 0;
+	}
+	else
+	{
+		d = dtVlenSqr(diff);
+	}
+
+	if (d < *nearestDist)
+	{
+		dtVcopy(nearestPt, closestPtPoly);
+		*nearestDist = d;
+		*nearestRef = ref;
+	}
+}
+
+// Quantizes a query box to the tile bounding volume tree space, like queryPolygonsInTile.
+static void quantizeQueryBounds(const dtMeshTile* tile, const float* qmin, const float* qmax, unsigned short* bmin, unsigned short* bmax)
+{
+	const float* tbmin = tile->header->bmin;
+	const float* tbmax = tile->header->bmax;
+	const float qfac = tile->header->bvQuantFactor;
+	
+	float minx = dtClamp(qmin[0], tbmin[0], tbmax[0]) - tbmin[0];
+	float miny = dtClamp(qmin[1], tbmin[1], tbmax[1]) - tbmin[1];
+	float minz = dtClamp(qmin[2], tbmin[2], tbmax[2]) - tbmin[2];
+	float maxx = dtClamp(qmax[0], tbmin[0], tbmax[0]) - tbmin[0];
+	float maxy = dtClamp(qmax[1], tbmin[1], tbmax[1]) - tbmin[1];
+	float maxz = dtClamp(qmax[2], tbmin[2], tbmax[2]) - tbmin[2];
+	bmin[0] = (unsigned short)(qfac * minx) & 0xfffe;
+	bmin[1] = (unsigned short)(qfac * miny) & 0xfffe;
+	bmin[2] = (unsigned short)(qfac * minz) & 0xfffe;
+	bmax[0] = (unsigned short)(qfac * maxx + 1) | 1;
+	bmax[1] = (unsigned short)(qfac * maxy + 1) | 1;
+	bmax[2] = (unsigned short)(qfac * maxz + 1) | 1;
+}
+
+/// @par
+///
+/// Walks the tile once with the union of the search boxes of the group, and
+/// only evaluates a polygon for the points whose own search box overlaps it.
+void dtNavMeshQuery::findNearestPolysInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
+											const float* centers, const int* group, const int ngroup, const float* halfExtents,
+											const dtQueryFilter* filter, unsigned short* qbounds,
+											float* nearestDist, dtPolyRef* nearestRefs, float* nearestPts) const
+{
+	dtAssert(m_nav);
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+
+	if (tile->bvTree)
+	{
+		const dtBVNode* node = &tile->bvTree[0];
+		const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
+
+		unsigned short bmin[3], bmax[3];
+		quantizeQueryBounds(tile, qmin, qmax, bmin, bmax);
+		for (int k = 0; k < ngroup; ++k)
+		{
+			float pmin[3], pmax[3];
+			const float* center = &centers[group[k]*3];
+			dtVsub(pmin, center, halfExtents);
+			dtVadd(pmax, center, halfExtents);
+			quantizeQueryBounds(tile, pmin, pmax, &qbounds[k*6], &qbounds[k*6+3]);
+		}
+
+		// Traverse tree
+		while (node < end)
+		{
+			const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
+			const bool isLeafNode = node->i >= 0;
+
+			if (isLeafNode && overlap)
+			{
+				dtPolyRef ref = base | (dtPolyRef)node->i;
+				if (filter->passFilter(ref, tile, &tile->polys[node->i]))
+				{
+					for (int k = 0; k < ngroup; ++k)
+					{
+						if (!dtOverlapQuantBounds(&qbounds[k*6], &qbounds[k*6+3], node->bmin, node->bmax))
+							continue;
+						const int idx = group[k];
+						updateNearestPoly(this, tile, ref, &centers[idx*3], &nearestDist[idx], &nearestRefs[idx], &nearestPts[idx*3]);
+					}
+				}
+			}
+
+			if (overlap || isLeafNode)
+				node++;
+			else
+			{
+				const int escapeIndex = -node->i;
+				node += escapeIndex;
+			}
+		}
+	}
+	else
+	{
+		float bmin[3], bmax[3];
+		for (int i = 0; i < tile->header->polyCount; ++i)
+		{
+			dtPoly* p = &tile->polys[i];
+			// Do not return off-mesh connection polygons.
+			if (p->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+				continue;
+			// Must pass filter
+			const dtPolyRef ref = base | (dtPolyRef)i;
+			if (!filter->passFilter(ref, tile, p))
+				continue;
+			// Calc polygon bounds.
+			const float* v = &tile->verts[p->verts[0]*3];
+			dtVcopy(bmin, v);
+			dtVcopy(bmax, v);
+			for (int j = 1; j < p->vertCount; ++j)
+			{
+				v = &tile->verts[p->verts[j]*3];
+				dtVmin(bmin, v);
+				dtVmax(bmax, v);
+			}
+			if (!dtOverlapBounds(qmin, qmax, bmin, bmax))
+				continue;
+			for (int k = 0; k < ngroup; ++k)
+			{
+				const int idx = group[k];
+				float pmin[3], pmax[3];
+				dtVsub(pmin, &centers[idx*3], halfExtents);
+				dtVadd(pmax, &centers[idx*3], halfExtents);
+				if (!dtOverlapBounds(pmin, pmax, bmin, bmax))
+					continue;
+				updateNearestPoly(this, tile, ref, &centers[idx*3], &nearestDist[idx], &nearestRefs[idx], &nearestPts[idx*3]);
+			}
+		}
+	}
+}
+
 void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 										 const dtQueryFilter* filter, dtPolyQuery* query) const
 {
@@ -185,19 +185,22 @@ static int addNeighbour(const int idx, const float dist,
 
 static int getNeighbours(const float* pos, const float height, const float range,
 						 const dtCrowdAgent* skip, dtCrowdNeighbour* result, const int maxResult,
-						 dtCrowdAgent** agents, const int /*nagents*/, dtProximityGrid* grid)
+						 const dtCrowdAgent* agents, dtProximityGrid* grid, const float maxHeight)
 {
 	int n = 0;
 	
 	static const int MAX_NEIS = 32;
 	unsigned short ids[MAX_NEIS];
-	int nids = grid->queryItems(pos[0]-range, pos[2]-range,
-								pos[0]+range, pos[2]+range,
-								ids, MAX_NEIS);
+	// The agents are registered at their position, so search the heights at which
+	// the tallest agent could still overlap.
+	const float dy = (height+maxHeight)/2;
+	const float bmin[3] = { pos[0]-range, pos[1]-dy, pos[2]-range };
+	const float bmax[3] = { pos[0]+range, pos[1]+dy, pos[2]+range };
+	int nids = grid->queryItems(bmin, bmax, ids, MAX_NEIS);
 	
 	for (int i = 0; i < nids; ++i)
 	{
-		const dtCrowdAgent* ag = agents[ids[i]];
+		const dtCrowdAgent* ag = &agents[ids[i]];
 		
 		if (ag == skip) continue;
 		
@@ -216,6 +219,55 @@ static int getNeighbours(const float* pos, const float height, const float range
 	return n;
 }
 
+// Returns the point of an obstacle closest to a position.
+static void closestObstaclePoint(const dtCrowdObstacle* ob, const float* pos, float* pt)
+{
+	if (ob->type == DT_CROWDOBSTACLE_CAPSULE)
+	{
+		float t;
+		dtDistancePtSegSqr2D(pos, ob->pos, ob->end, t);
+		dtVlerp(pt, ob->pos, ob->end, t);
+	}
+	else
+	{
+		dtVcopy(pt, ob->pos);
+	}
+}
+
+static int getObstacles(const float* pos, const float height, const float range,
+						dtCrowdNeighbour* result, const int maxResult,
+						const dtCrowdObstacle* obstacles, dtProximityGrid* grid,
+						const float maxHeight)
+{
+	int n = 0;
+	
+	static const int MAX_OBSTACLES = 32;
+	unsigned short ids[MAX_OBSTACLES];
+	const float dy = (height+maxHeight)/2;
+	const float bmin[3] = { pos[0]-range, pos[1]-dy, pos[2]-range };
+	const float bmax[3] = { pos[0]+range, pos[1]+dy, pos[2]+range };
+	int nids = grid->queryItems(bmin, bmax, ids, MAX_OBSTACLES);
+	
+	for (int i = 0; i < nids; ++i)
+	{
+		const dtCrowdObstacle* ob = &obstacles[ids[i]];
+		
+		// Check for overlap.
+		float pt[3], diff[3];
+		closestObstaclePoint(ob, pos, pt);
+		dtVsub(diff, pos, pt);
+		if (dtMathFabsf(diff[1]) >= (height+ob->height)/2.0f)
+			continue;
+		diff[1] = 0;
+		const float distSqr = dtVlenSqr(diff);
+		if (distSqr > dtSqr(range + ob->radius))
+			continue;
+		
+		n = addNeighbour(ids[i], distSqr, result, n, maxResult);
+	}
+	return n;
+}
+
 static int addToOptQueue(dtCrowdAgent* newag, dtCrowdAgent** agents, const int nagents, const int maxAgents)
 {
 	// Insert neighbour based on greatest time.
@@ -332,13 +384,24 @@ dtCrowd::dtCrowd() :
 	m_agents(0),
 	m_activeAgents(0),
 	m_agentAnims(0),
+	m_freeAgents(0),
+	m_nfreeAgents(0),
 	m_obstacleQuery(0),
 	m_grid(0),
+	m_obstacles(0),
+	m_maxObstacles(0),
+	m_freeObstacles(0),
+	m_nfreeObstacles(0),
+	m_obstacleCells(0),
+	m_obstacleGrid(0),
 	m_pathResult(0),
 	m_maxPathResult(0),
 	m_maxAgentRadius(0),
 	m_velocitySampleCount(0),
-	m_navquery(0)
+	m_navquery(0),
+	m_ngridAgents(0),
+	m_gridAgentHeight(0),
+	m_gridObstacleHeight(0)
 {
 }
 
@@ -360,12 +423,30 @@ void dtCrowd::purge()
 
 	dtFree(m_agentAnims);
 	m_agentAnims = 0;
+
+	dtFree(m_freeAgents);
+	m_freeAgents = 0;
+	m_nfreeAgents = 0;
 	
 	dtFree(m_pathResult);
 	m_pathResult = 0;
 	
 	dtFreeProximityGrid(m_grid);
 	m_grid = 0;
+	m_ngridAgents = 0;
+	m_gridAgentHeight = 0;
+
+	dtFree(m_obstacles);
+	m_obstacles = 0;
+	m_maxObstacles = 0;
+
+	dtFree(m_freeObstacles);
+	m_freeObstacles = 0;
+	m_nfreeObstacles = 0;
+	m_obstacleCells = 0;
+
+	dtFreeProximityGrid(m_obstacleGrid);
+	m_obstacleGrid = 0;
 
 	dtFreeObstacleAvoidanceQuery(m_obstacleQuery);
 	m_obstacleQuery = 0;
@@ -387,16 +468,18 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 	// Larger than agent radius because it is also used for agent recovery.
 	dtVset(m_agentPlacementHalfExtents, m_maxAgentRadius*2.0f, m_maxAgentRadius*1.5f, m_maxAgentRadius*2.0f);
 	
+	// The grid is also bucketed by height, so that agents on different floors do not
+	// share cells.
 	m_grid = dtAllocProximityGrid();
 	if (!m_grid)
 		return false;
-	if (!m_grid->init(m_maxAgents*4, maxAgentRadius*3))
+	if (!m_grid->init(m_maxAgents*4, maxAgentRadius*3, maxAgentRadius*6))
 		return false;
 	
 	m_obstacleQuery = dtAllocObstacleAvoidanceQuery();
 	if (!m_obstacleQuery)
 		return false;
-	if (!m_obstacleQuery->init(6, 8))
+	if (!m_obstacleQuery->init(DT_CROWDAGENT_MAX_NEIGHBOURS + DT_CROWDAGENT_MAX_OBSTACLES, 8))
 		return false;
 
 	// Init obstacle query params.
@@ -450,6 +533,14 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 		m_agentAnims[i].active = false;
 	}
 
+	// Free slots are kept in a stack, lowest index on top.
+	m_freeAgents = (int*)dtAlloc(sizeof(int)*m_maxAgents, DT_ALLOC_PERM);
+	if (!m_freeAgents)
+		return false;
+	for (int i = 0; i < m_maxAgents; ++i)
+		m_freeAgents[i] = m_maxAgents - 1 - i;
+	m_nfreeAgents = m_maxAgents;
+
 	// The navquery is mostly used for local searches, no need for large node pool.
 	m_navquery = dtAllocNavMeshQuery();
 	if (!m_navquery)
@@ -460,6 +551,157 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 	return true;
 }
 
+/// @par
+///
+/// Dynamic obstacles are moving shapes, like carts, doors or characters driven by
+/// something else than the crowd, that agents using #DT_CROWD_OBSTACLE_AVOIDANCE steer
+/// around like around other agents. They take no agent slot and need no change to the
+/// navigation mesh. Each agent avoids the #DT_CROWDAGENT_MAX_OBSTACLES nearest obstacles
+/// within its collision query range. A capsule is seen by an agent as a circle at the
+/// point of its segment closest to the agent.
+///
+/// Moving an obstacle only updates its entry; the obstacles are registered in their own
+/// proximity grid once per #update.
+///
+/// Each obstacle takes one grid item for every cell its bounds cover, so a long capsule
+/// takes many. The grid has room for 16 cells per obstacle in total, and #addObstacle and
+/// #updateObstacle fail when an obstacle would not fit, rather than leaving it out of the grid.
+bool dtCrowd::initObstacles(const int maxObstacles)
+{
+	if (!m_maxAgents || maxObstacles < 1 || maxObstacles > 0xffff)
+		return false;
+
+	dtFree(m_obstacles);
+	m_obstacles = 0;
+	m_maxObstacles = 0;
+	dtFree(m_freeObstacles);
+	m_freeObstacles = 0;
+	m_nfreeObstacles = 0;
+	m_obstacleCells = 0;
+	dtFreeProximityGrid(m_obstacleGrid);
+
+	m_obstacleGrid = dtAllocProximityGrid();
+	if (!m_obstacleGrid)
+		return false;
+	// Capsules can span several cells. The item indices of the grid are 16 bits.
+	if (!m_obstacleGrid->init(dtMin(maxObstacles*16, 0xffff), m_maxAgentRadius*3, m_maxAgentRadius*6))
+		return false;
+
+	m_obstacles = (dtCrowdObstacle*)dtAlloc(sizeof(dtCrowdObstacle)*maxObstacles, DT_ALLOC_PERM);
+	if (!m_obstacles)
+		return false;
+	memset(m_obstacles, 0, sizeof(dtCrowdObstacle)*maxObstacles);
+
+	// Free slots are kept in a stack, lowest index on top.
+	m_freeObstacles = (int*)dtAlloc(sizeof(int)*maxObstacles, DT_ALLOC_PERM);
+	if (!m_freeObstacles)
+		return false;
+	for (int i = 0; i < maxObstacles; ++i)
+		m_freeObstacles[i] = maxObstacles - 1 - i;
+	m_nfreeObstacles = maxObstacles;
+	m_maxObstacles = maxObstacles;
+
+	return true;
+}
+
+// Sets the position of an obstacle, keeping the axis of a capsule when no end is given.
+static void setObstaclePos(dtCrowdObstacle* ob, const float* pos, const float* end)
+{
+	if (ob->type == DT_CROWDOBSTACLE_CAPSULE && !end)
+	{
+		// Keep the capsule axis.
+		float axis[3];
+		dtVsub(axis, ob->end, ob->pos);
+		dtVadd(ob->end, pos, axis);
+	}
+	else
+	{
+		dtVcopy(ob->end, ob->type == DT_CROWDOBSTACLE_CAPSULE ? end : pos);
+	}
+	dtVcopy(ob->pos, pos);
+}
+
+// The box an obstacle is registered with in the obstacle grid.
+static void calcObstacleBounds(const dtCrowdObstacle* ob, float* bmin, float* bmax)
+{
+	const float r = ob->radius;
+	bmin[0] = dtMin(ob->pos[0], ob->end[0]) - r;
+	bmin[1] = dtMin(ob->pos[1], ob->end[1]);
+	bmin[2] = dtMin(ob->pos[2], ob->end[2]) - r;
+	bmax[0] = dtMax(ob->pos[0], ob->end[0]) + r;
+	bmax[1] = dtMax(ob->pos[1], ob->end[1]);
+	bmax[2] = dtMax(ob->pos[2], ob->end[2]) + r;
+}
+
+static int getObstacleCellCount(const dtProximityGrid* grid, const dtCrowdObstacle* ob)
+{
+	float bmin[3], bmax[3];
+	calcObstacleBounds(ob, bmin, bmax);
+	return grid->getItemCellCount(bmin, bmax);
+}
+
+int dtCrowd::addObstacle(const float* pos, const float* end, const float radius, const float height)
+{
+	// Also refuses NaN.
+	if (!pos || !(radius > 0.0f) || !(height > 0.0f))
+		return -1;
+	if (m_nfreeObstacles == 0)
+		return -1;
+	const int idx = m_freeObstacles[m_nfreeObstacles-1];
+
+	dtCrowdObstacle* ob = &m_obstacles[idx];
+	ob->type = end ? DT_CROWDOBSTACLE_CAPSULE : DT_CROWDOBSTACLE_CIRCLE;
+	ob->radius = radius;
+	ob->height = height;
+	dtVset(ob->vel, 0,0,0);
+	setObstaclePos(ob, pos, end);
+
+	const int cells = getObstacleCellCount(m_obstacleGrid, ob);
+	if (m_obstacleCells + cells > m_obstacleGrid->getPoolSize())
+		return -1;
+	m_obstacleCells += cells;
+	ob->active = true;
+	m_nfreeObstacles--;
+	return idx;
+}
+
+bool dtCrowd::updateObstacle(const int idx, const float* pos, const float* end, const float* vel)
+{
+	if (idx < 0 || idx >= m_maxObstacles || !m_obstacles[idx].active || !pos)
+		return false;
+	dtCrowdObstacle* ob = &m_obstacles[idx];
+
+	dtCrowdObstacle moved = *ob;
+	setObstaclePos(&moved, pos, end);
+	const int cells = getObstacleCellCount(m_obstacleGrid, &moved) - getObstacleCellCount(m_obstacleGrid, ob);
+	if (m_obstacleCells + cells > m_obstacleGrid->getPoolSize())
+		return false;
+	m_obstacleCells += cells;
+
+	dtVcopy(ob->pos, moved.pos);
+	dtVcopy(ob->end, moved.end);
+	if (vel)
+		dtVcopy(ob->vel, vel);
+	return true;
+}
+
+void dtCrowd::removeObstacle(const int idx)
+{
+	if (idx >= 0 && idx < m_maxObstacles && m_obstacles[idx].active && m_nfreeObstacles < m_maxObstacles)
+	{
+		m_obstacleCells -= getObstacleCellCount(m_obstacleGrid, &m_obstacles[idx]);
+		m_obstacles[idx].active = false;
+		m_freeObstacles[m_nfreeObstacles++] = idx;
+	}
+}
+
+const dtCrowdObstacle* dtCrowd::getObstacle(const int idx) const
+{
+	if (idx < 0 || idx >= m_maxObstacles)
+		return 0;
+	return &m_obstacles[idx];
+}
+
 void dtCrowd::setObstacleAvoidanceParams(const int idx, const dtObstacleAvoidanceParams* params)
 {
 	if (idx >= 0 && idx < DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS)
@@ -512,38 +754,60 @@ void dtCrowd::updateAgentParameters(const int idx, const dtCrowdAgentParams* par
 	memcpy(&m_agents[idx].params, params, sizeof(dtCrowdAgentParams));
 }
 
+void dtCrowd::updateAgentParameters(const int* idxs, const int nidxs, const dtCrowdAgentParams* params)
+{
+	for (int i = 0; i < nidxs; ++i)
+	{
+		const int idx = idxs[i];
+		if (idx < 0 || idx >= m_maxAgents)
+			continue;
+		memcpy(&m_agents[idx].params, &params[i], sizeof(dtCrowdAgentParams));
+	}
+}
+
 /// @par
 ///
-/// The agent's position will be constrained to the surface of the navigation mesh.
-int dtCrowd::addAgent(const float* pos, const dtCrowdAgentParams* params)
+/// The configurations are stored in the same order as the indices.  The entries of invalid indices,
+/// or of agents that are not active, are zeroed and flagged in @p valid.
+int dtCrowd::getAgentParameters(const int* idxs, const int nidxs, dtCrowdAgentParams* params, unsigned char* valid) const
 {
-	// Find empty slot.
-	int idx = -1;
-	for (int i = 0; i < m_maxAgents; ++i)
+	int n = 0;
+	for (int i = 0; i < nidxs; ++i)
 	{
-		if (!m_agents[i].active)
+		const int idx = idxs[i];
+		const bool ok = idx >= 0 && idx < m_maxAgents && m_agents[idx].active;
+		if (ok)
+		{
+			memcpy(&params[i], &m_agents[idx].params, sizeof(dtCrowdAgentParams));
+			n++;
+		}
+		else
 		{
-			idx = i;
-			break;
+			memset(&params[i], 0, sizeof(dtCrowdAgentParams));
 		}
+		if (valid)
+			valid[i] = ok ? 1 : 0;
 	}
-	if (idx == -1)
-		return -1;
-	
-	dtCrowdAgent* ag = &m_agents[idx];		
+	return n;
+}
 
-	updateAgentParameters(idx, params);
-	
-	// Find nearest position on navmesh and place the agent there.
-	float nearest[3];
-	dtPolyRef ref = 0;
-	dtVcopy(nearest, pos);
-	dtStatus status = m_navquery->findNearestPoly(pos, m_agentPlacementHalfExtents, &m_filters[ag->params.queryFilterType], &ref, nearest);
-	if (dtStatusFailed(status))
+int dtCrowd::allocAgentSlot()
+{
+	// Pop free slots, skipping any that were re-activated behind our back.
+	while (m_nfreeAgents > 0)
 	{
-		dtVcopy(nearest, pos);
-		ref = 0;
+		const int idx = m_freeAgents[--m_nfreeAgents];
+		if (!m_agents[idx].active)
+			return idx;
 	}
+	return -1;
+}
+
+void dtCrowd::initAgent(const int idx, const dtCrowdAgentParams* params, dtPolyRef ref, const float* nearest)
+{
+	dtCrowdAgent* ag = &m_agents[idx];
+
+	updateAgentParameters(idx, params);
 	
 	ag->corridor.reset(ref, nearest);
 	ag->boundary.reset();
@@ -568,19 +832,130 @@ int dtCrowd::addAgent(const float* pos, const dtCrowdAgentParams* params)
 	ag->targetState = DT_CROWDAGENT_TARGET_NONE;
 	
 	ag->active = true;
+}
+
+/// @par
+///
+/// The agent's position will be constrained to the surface of the navigation mesh.
+int dtCrowd::addAgent(const float* pos, const dtCrowdAgentParams* params)
+{
+	// Find empty slot.
+	const int idx = allocAgentSlot();
+	if (idx == -1)
+		return -1;
+	
+	// Find nearest position on navmesh and place the agent there.
+	float nearest[3];
+	dtPolyRef ref = 0;
+	dtVcopy(nearest, pos);
+	dtStatus status = m_navquery->findNearestPoly(pos, m_agentPlacementHalfExtents, &m_filters[params->queryFilterType], &ref, nearest);
+	if (dtStatusFailed(status))
+	{
+		dtVcopy(nearest, pos);
+		ref = 0;
+	}
+	
+	initAgent(idx, params, ref, nearest);
 
 	return idx;
 }
 
+/// @par
+///
+/// Equivalent to calling #addAgent for each agent, but the positions are snapped
+/// to the navigation mesh in batches (see dtNavMeshQuery::findNearestPolys), one
+/// batch per query filter type in use.
+///
+/// Agents that could not be placed on the navigation mesh are still added, in
+/// the #DT_CROWDAGENT_STATE_INVALID state, like #addAgent does.  Agents only fail
+/// to be added (reported as -1 in @p idxs) when the crowd is full.
+int dtCrowd::addAgents(const float* pos, const dtCrowdAgentParams* params, const int count, int* idxs)
+{
+	if (count <= 0)
+		return 0;
+	
+	dtPolyRef* refs = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*count, DT_ALLOC_TEMP);
+	float* nearest = (float*)dtAlloc(sizeof(float)*count*3, DT_ALLOC_TEMP);
+	float* groupPos = (float*)dtAlloc(sizeof(float)*count*3, DT_ALLOC_TEMP);
+	int* group = (int*)dtAlloc(sizeof(int)*count, DT_ALLOC_TEMP);
+	dtPolyRef* groupRefs = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*count, DT_ALLOC_TEMP);
+	if (!refs || !nearest || !groupPos || !group || !groupRefs)
+	{
+		dtFree(refs);
+		dtFree(nearest);
+		dtFree(groupPos);
+		dtFree(group);
+		dtFree(groupRefs);
+		for (int i = 0; i < count; ++i)
+			idxs[i] = -1;
+		return 0;
+	}
+	
+	// Only the agents that will get a slot need snapping.
+	const int nadd = dtMin(count, m_nfreeAgents);
+	for (int i = 0; i < nadd; ++i)
+	{
+		refs[i] = 0;
+		dtVcopy(&nearest[i*3], &pos[i*3]);
+	}
+	
+	// Snap in batches of agents sharing the same query filter.
+	for (int f = 0; f < DT_CROWD_MAX_QUERY_FILTER_TYPE; ++f)
+	{
+		int ngroup = 0;
+		for (int i = 0; i < nadd; ++i)
+		{
+			if (params[i].queryFilterType != f)
+				continue;
+			group[ngroup] = i;
+			dtVcopy(&groupPos[ngroup*3], &pos[i*3]);
+			ngroup++;
+		}
+		if (!ngroup)
+			continue;
+		
+		dtStatus status = m_navquery->findNearestPolys(groupPos, ngroup, m_agentPlacementHalfExtents, &m_filters[f], groupRefs, groupPos);
+		if (dtStatusFailed(status))
+			continue;
+		for (int j = 0; j < ngroup; ++j)
+		{
+			const int i = group[j];
+			refs[i] = groupRefs[j];
+			if (groupRefs[j])
+				dtVcopy(&nearest[i*3], &groupPos[j*3]);
+		}
+	}
+	
+	int n = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		const int idx = i < nadd ? allocAgentSlot() : -1;
+		idxs[i] = idx;
+		if (idx == -1)
+			continue;
+		initAgent(idx, &params[i], refs[i], &nearest[i*3]);
+		n++;
+	}
+	
+	dtFree(refs);
+	dtFree(nearest);
+	dtFree(groupPos);
+	dtFree(group);
+	dtFree(groupRefs);
+	
+	return n;
+}
+
 /// @par
 ///
 /// The agent is deactivated and will no longer be processed.  Its #dtCrowdAgent object
 /// is not removed from the pool.  It is marked as inactive so that it is available for reuse.
 void dtCrowd::removeAgent(const int idx)
 {
-	if (idx >= 0 && idx < m_maxAgents)
+	if (idx >= 0 && idx < m_maxAgents && m_agents[idx].active && m_nfreeAgents < m_maxAgents)
 	{
 		m_agents[idx].active = false;
+		m_freeAgents[m_nfreeAgents++] = idx;
 	}
 }
 
@@ -633,6 +1008,67 @@ bool dtCrowd::requestMoveTarget(const int idx, dtPolyRef ref, const float* pos)
 	return true;
 }
 
+int dtCrowd::requestMoveTargets(const int* idxs, const int nidxs, dtPolyRef ref, const float* pos)
+{
+	if (!ref)
+		return 0;
+	
+	int n = 0;
+	for (int i = 0; i < nidxs; ++i)
+	{
+		if (requestMoveTarget(idxs[i], ref, pos))
+			n++;
+	}
+	return n;
+}
+
+/// @par
+///
+/// The target is snapped to the navigation mesh once per query filter type used
+/// by the agents, rather than once per agent, so retargeting a large group costs
+/// about the same as retargeting a single agent.
+///
+/// The requests will be processed during the next #update().
+int dtCrowd::requestMoveTargets(const int* idxs, const int nidxs, const float* pos, dtPolyRef* targetRef, float* targetPos)
+{
+	dtPolyRef refs[DT_CROWD_MAX_QUERY_FILTER_TYPE];
+	float nearest[DT_CROWD_MAX_QUERY_FILTER_TYPE][3];
+	unsigned int snapped = 0;
+	
+	if (targetRef)
+		*targetRef = 0;
+	
+	int n = 0;
+	for (int i = 0; i < nidxs; ++i)
+	{
+		const int idx = idxs[i];
+		if (idx < 0 || idx >= m_maxAgents)
+			continue;
+		
+		const int filterType = m_agents[idx].params.queryFilterType;
+		if (filterType >= DT_CROWD_MAX_QUERY_FILTER_TYPE)
+			continue;
+		if (!(snapped & (1u << filterType)))
+		{
+			refs[filterType] = 0;
+			dtVcopy(nearest[filterType], pos);
+			m_navquery->findNearestPoly(pos, m_agentPlacementHalfExtents, &m_filters[filterType], &refs[filterType], nearest[filterType]);
+			snapped |= 1u << filterType;
+			
+			if (targetRef && !*targetRef && refs[filterType])
+			{
+				*targetRef = refs[filterType];
+				if (targetPos)
+					dtVcopy(targetPos, nearest[filterType]);
+			}
+		}
+		
+		if (requestMoveTarget(idx, refs[filterType], nearest[filterType]))
+			n++;
+	}
+	return n;
+}
+
 bool dtCrowd::requestMoveVelocity(const int idx, const float* vel)
 {
 	if (idx < 0 || idx >= m_maxAgents)
@@ -1069,13 +1505,23 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 	updateTopologyOptimization(agents, nagents, dt);
 	
 	// Register agents to proximity grid.
-	m_grid->clear();
-	for (int i = 0; i < nagents; ++i)
+	registerAgents(agents, nagents);
+
+	// Register obstacles to their proximity grid.
+	if (m_obstacleGrid)
 	{
-		dtCrowdAgent* ag = agents[i];
-		const float* p = ag->npos;
-		const float r = ag->params.radius;
-		m_grid->addItem((unsigned short)i, p[0]-r, p[2]-r, p[0]+r, p[2]+r);
+		m_obstacleGrid->clear();
+		m_gridObstacleHeight = 0;
+		for (int i = 0; i < m_maxObstacles; ++i)
+		{
+			const dtCrowdObstacle* ob = &m_obstacles[i];
+			if (!ob->active)
+				continue;
+			float bmin[3], bmax[3];
+			calcObstacleBounds(ob, bmin, bmax);
+			m_gridObstacleHeight = dtMax(m_gridObstacleHeight, ob->height);
+			m_obstacleGrid->addItem((unsigned short)i, bmin, bmax);
+		}
 	}
 	
 	// Get nearby navmesh segments and agents to collide with.
@@ -1097,9 +1543,7 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 		// Query neighbour agents
 		ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
 								  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
-								  agents, nagents, m_grid);
-		for (int j = 0; j < ag->nneis; j++)
-			ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
+								  m_agents, m_grid, m_gridAgentHeight);
 	}
 	
 	// Find next corner to steer to.
@@ -1280,6 +1724,22 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 				m_obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
 			}
 
+			// Add nearby dynamic obstacles.
+			if (m_obstacleGrid)
+			{
+				dtCrowdNeighbour obs[DT_CROWDAGENT_MAX_OBSTACLES];
+				const int nobs = getObstacles(ag->npos, ag->params.height, ag->params.collisionQueryRange,
+											  obs, DT_CROWDAGENT_MAX_OBSTACLES, m_obstacles, m_obstacleGrid,
+											  m_gridObstacleHeight);
+				for (int j = 0; j < nobs; ++j)
+				{
+					const dtCrowdObstacle* ob = &m_obstacles[obs[j].idx];
+					float pt[3];
+					closestObstaclePoint(ob, ag->npos, pt);
+					m_obstacleQuery->addCircle(pt, ob->radius, ob->vel, ob->vel);
+				}
+			}
+
 			// Append neighbour segments as obstacles.
 			for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
 			{
@@ -1452,5 +1912,552 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 		dtVset(ag->vel, 0,0,0);
 		dtVset(ag->dvel, 0,0,0);
 	}
-	
+
+	// Register the final positions for the spatial queries.
+	registerAgents(agents, nagents);
 }
+
+void dtCrowd::registerAgents(dtCrowdAgent** agents, const int nagents)
+{
+	m_grid->clear();
+	m_gridAgentHeight = 0;
+	for (int i = 0; i < nagents; ++i)
+	{
+		dtCrowdAgent* ag = agents[i];
+		const float* p = ag->npos;
+		const float r = ag->params.radius;
+		const float bmin[3] = { p[0]-r, p[1], p[2]-r };
+		const float bmax[3] = { p[0]+r, p[1], p[2]+r };
+		// Items are agent indices, which stay valid after the agent list is reused.
+		m_grid->addItem((unsigned short)getAgentIndex(ag), bmin, bmax);
+		m_gridAgentHeight = dtMax(m_gridAgentHeight, ag->params.height);
+	}
+	m_ngridAgents = nagents;
+}
+
+int dtCrowd::queryGridAgents(const float* bmin, const float* bmax, int* idxs, const int maxIdxs) const
+{
+	if (!m_ngridAgents || maxIdxs <= 0)
+		return 0;
+
+	// The grid holds each agent once, so the candidates fit in the active agent count.
+	unsigned short* ids = (unsigned short*)dtAlloc(sizeof(unsigned short)*m_ngridAgents, DT_ALLOC_TEMP);
+	if (!ids)
+		return 0;
+	const int nids = m_grid->queryItems(bmin, bmax, ids, m_ngridAgents);
+
+	int n = 0;
+	for (int i = 0; i < nids && n < maxIdxs; ++i)
+	{
+		const dtCrowdAgent* ag = &m_agents[ids[i]];
+		if (!ag->active)
+			continue;
+		const float* p = ag->npos;
+		if (p[0] < bmin[0] || p[1] < bmin[1] || p[2] < bmin[2] ||
+			p[0] > bmax[0] || p[1] > bmax[1] || p[2] > bmax[2])
+			continue;
+		idxs[n++] = ids[i];
+	}
+
+	dtFree(ids);
+	return n;
+}
+
+/// @par
+///
+/// The spatial queries use the proximity grid built by #update, and see the agents
+/// at their positions at the end of the last update. Agents added since are not
+/// found until the next update, and removed agents are skipped.
+///
+/// The queries do not modify the crowd, so several threads can run them at the same
+/// time, as long as no other crowd method is called meanwhile.
+int dtCrowd::queryAgentsInRadius(const float* pos, const float radius, int* idxs, const int maxIdxs) const
+{
+	if (!m_ngridAgents || maxIdxs <= 0)
+		return 0;
+
+	// The box corners hold agents outside the sphere, so collect every candidate
+	// before keeping the first maxIdxs inside it.
+	int* found = (int*)dtAlloc(sizeof(int)*m_ngridAgents, DT_ALLOC_TEMP);
+	if (!found)
+		return 0;
+	float bmin[3], bmax[3];
+	dtVset(bmin, pos[0]-radius, pos[1]-radius, pos[2]-radius);
+	dtVset(bmax, pos[0]+radius, pos[1]+radius, pos[2]+radius);
+	const int nfound = queryGridAgents(bmin, bmax, found, m_ngridAgents);
+
+	int n = 0;
+	for (int i = 0; i < nfound && n < maxIdxs; ++i)
+	{
+		if (dtVdistSqr(pos, m_agents[found[i]].npos) <= dtSqr(radius))
+			idxs[n++] = found[i];
+	}
+	dtFree(found);
+	return n;
+}
+
+int dtCrowd::queryAgentsInBounds(const float* bmin, const float* bmax, int* idxs, const int maxIdxs) const
+{
+	return queryGridAgents(bmin, bmax, idxs, maxIdxs);
+}
+
+int dtCrowd::queryNearestAgents(const float* pos, const float maxDist, int* idxs, float* dists, const int k) const
+{
+	if (!m_ngridAgents || k <= 0)
+		return 0;
+
+	int* found = (int*)dtAlloc(sizeof(int)*m_ngridAgents, DT_ALLOC_TEMP);
+	float* distSqr = (float*)dtAlloc(sizeof(float)*k, DT_ALLOC_TEMP);
+	if (!found || !distSqr)
+	{
+		dtFree(found);
+		dtFree(distSqr);
+		return 0;
+	}
+	const int nfound = queryAgentsInRadius(pos, maxDist, found, m_ngridAgents);
+
+	// Keep the k nearest, sorted by distance.
+	int n = 0;
+	for (int i = 0; i < nfound; ++i)
+	{
+		const float d = dtVdistSqr(pos, m_agents[found[i]].npos);
+		if (n == k && d >= distSqr[n-1])
+			continue;
+		int j = n < k ? n++ : n-1;
+		for (; j > 0 && distSqr[j-1] > d; --j)
+		{
+			distSqr[j] = distSqr[j-1];
+			idxs[j] = idxs[j-1];
+		}
+		distSqr[j] = d;
+		idxs[j] = found[i];
+	}
+
+	if (dists)
+	{
+		for (int i = 0; i < n; ++i)
+			dists[i] = dtMathSqrtf(distSqr[i]);
+	}
+	dtFree(found);
+	dtFree(distSqr);
+	return n;
+}
+
+static const int DT_CROWD_STATE_MAGIC = 'D'<<24 | 'C'<<16 | 'R'<<8 | 'S';
+static const int DT_CROWD_STATE_VERSION = 2;
+
+struct dtCrowdStateHeader
+{
+	int magic;
+	int version;
+	int maxAgents;
+	int agentCount;
+	int maxObstacles;
+	int obstacleCount;
+};
+
+// Fixed part of a stored agent, followed by the variable length neighbours,
+// corners, corridor path, local boundary and animation.
+struct dtCrowdAgentState
+{
+	int idx;
+	unsigned char state;
+	unsigned char partial;
+	unsigned char targetState;
+	unsigned char targetReplan;
+	unsigned char animActive;
+	unsigned char nneis;
+	unsigned char ncorners;
+	float topologyOptTime;
+	float desiredSpeed;
+	float npos[3];
+	float dvel[3];
+	float nvel[3];
+	float vel[3];
+	dtCrowdAgentParams params;
+	dtPolyRef targetRef;
+	float targetPos[3];
+	float targetReplanTime;
+	float corridorPos[3];
+	float corridorTarget[3];
+	int npath;
+};
+
+// A stored obstacle. The obstacles follow the agents, in index order.
+struct dtCrowdObstacleState
+{
+	int idx;
+	dtCrowdObstacle obstacle;
+};
+
+static int getAgentStateSize(const dtCrowdAgent* ag, const dtCrowdAgentAnimation* anim)
+{
+	int size = sizeof(dtCrowdAgentState);
+	size += sizeof(dtCrowdNeighbour) * ag->nneis;
+	size += (sizeof(float)*3 + sizeof(unsigned char) + sizeof(dtPolyRef)) * ag->ncorners;
+	size += sizeof(dtPolyRef) * ag->corridor.getPathCount();
+	size += ag->boundary.getStateSize();
+	if (anim->active)
+		size += sizeof(dtCrowdAgentAnimation);
+	return size;
+}
+
+static unsigned char* writeStateBytes(unsigned char* data, const void* src, const int size)
+{
+	memcpy(data, src, size);
+	return data + size;
+}
+
+static const unsigned char* readStateBytes(const unsigned char* data, const unsigned char* end, void* dst, const int size)
+{
+	if (!data || end - data < size)
+		return 0;
+	memcpy(dst, data, size);
+	return data + size;
+}
+
+int dtCrowd::getStateSize() const
+{
+	int size = sizeof(dtCrowdStateHeader);
+	for (int i = 0; i < m_maxAgents; ++i)
+	{
+		if (m_agents[i].active)
+			size += getAgentStateSize(&m_agents[i], &m_agentAnims[i]);
+	}
+	for (int i = 0; i < m_maxObstacles; ++i)
+	{
+		if (m_obstacles[i].active)
+			size += sizeof(dtCrowdObstacleState);
+	}
+	return size;
+}
+
+/// @par
+///
+/// Corridors are stored as polygon references with their position and target, so
+/// restored agents continue along their paths without planning again. Requests still
+/// waiting for the path queue are stored as waiting for the queue and are resubmitted,
+/// throttled like any other request, after a restore.
+///
+/// The dynamic obstacles are stored with their indices, so handles kept by the caller
+/// stay valid after a restore.
+///
+/// The filters, avoidance settings and navigation mesh are not part of the state, and
+/// the polygon references are only valid while the navigation mesh tiles are unchanged.
+/// The agent user data pointers are stored as is.
+bool dtCrowd::storeState(unsigned char* data, const int maxDataSize, int* dataSize) const
+{
+	*dataSize = 0;
+	const int size = getStateSize();
+	if (maxDataSize < size)
+		return false;
+
+	dtCrowdStateHeader header;
+	header.magic = DT_CROWD_STATE_MAGIC;
+	header.version = DT_CROWD_STATE_VERSION;
+	header.maxAgents = m_maxAgents;
+	header.agentCount = 0;
+	for (int i = 0; i < m_maxAgents; ++i)
+	{
+		if (m_agents[i].active)
+			header.agentCount++;
+	}
+	header.maxObstacles = m_maxObstacles;
+	header.obstacleCount = m_maxObstacles - m_nfreeObstacles;
+
+	unsigned char* d = writeStateBytes(data, &header, sizeof(header));
+	for (int i = 0; i < m_maxAgents; ++i)
+	{
+		const dtCrowdAgent* ag = &m_agents[i];
+		const dtCrowdAgentAnimation* anim = &m_agentAnims[i];
+		if (!ag->active)
+			continue;
+
+		dtCrowdAgentState st;
+		memset(&st, 0, sizeof(st));
+		st.idx = i;
+		st.state = ag->state;
+		st.partial = ag->partial ? 1 : 0;
+		st.targetState = ag->targetState;
+		if (st.targetState == DT_CROWDAGENT_TARGET_WAITING_FOR_PATH)
+			st.targetState = DT_CROWDAGENT_TARGET_WAITING_FOR_QUEUE;
+		st.targetReplan = ag->targetReplan ? 1 : 0;
+		st.animActive = anim->active ? 1 : 0;
+		st.nneis = (unsigned char)ag->nneis;
+		st.ncorners = (unsigned char)ag->ncorners;
+		st.topologyOptTime = ag->topologyOptTime;
+		st.desiredSpeed = ag->desiredSpeed;
+		dtVcopy(st.npos, ag->npos);
+		dtVcopy(st.dvel, ag->dvel);
+		dtVcopy(st.nvel, ag->nvel);
+		dtVcopy(st.vel, ag->vel);
+		memcpy(&st.params, &ag->params, sizeof(dtCrowdAgentParams));
+		st.targetRef = ag->targetRef;
+		dtVcopy(st.targetPos, ag->targetPos);
+		st.targetReplanTime = ag->targetReplanTime;
+		dtVcopy(st.corridorPos, ag->corridor.getPos());
+		dtVcopy(st.corridorTarget, ag->corridor.getTarget());
+		st.npath = ag->corridor.getPathCount();
+
+		d = writeStateBytes(d, &st, sizeof(st));
+		d = writeStateBytes(d, ag->neis, sizeof(dtCrowdNeighbour) * ag->nneis);
+		d = writeStateBytes(d, ag->cornerVerts, sizeof(float)*3 * ag->ncorners);
+		d = writeStateBytes(d, ag->cornerFlags, sizeof(unsigned char) * ag->ncorners);
+		d = writeStateBytes(d, ag->cornerPolys, sizeof(dtPolyRef) * ag->ncorners);
+		d = writeStateBytes(d, ag->corridor.getPath(), sizeof(dtPolyRef) * st.npath);
+		d = ag->boundary.storeState(d);
+		if (anim->active)
+			d = writeStateBytes(d, anim, sizeof(dtCrowdAgentAnimation));
+	}
+
+	for (int i = 0; i < m_maxObstacles; ++i)
+	{
+		if (!m_obstacles[i].active)
+			continue;
+		dtCrowdObstacleState st;
+		memset(&st, 0, sizeof(st));
+		st.idx = i;
+		st.obstacle.active = true;
+		st.obstacle.type = m_obstacles[i].type;
+		dtVcopy(st.obstacle.pos, m_obstacles[i].pos);
+		dtVcopy(st.obstacle.end, m_obstacles[i].end);
+		st.obstacle.radius = m_obstacles[i].radius;
+		st.obstacle.height = m_obstacles[i].height;
+		dtVcopy(st.obstacle.vel, m_obstacles[i].vel);
+		d = writeStateBytes(d, &st, sizeof(st));
+	}
+
+	dtAssert(d - data == size);
+	*dataSize = size;
+	return true;
+}
+
+/// @par
+///
+/// The crowd must have been initialized with the same maximum number of agents, and of
+/// obstacles. (See #initObstacles.) Agents and obstacles keep their indices, and in-flight
+/// path queue requests are dropped.
+/// The path queue is rewound too, so updates after restoring the same state run the same way.
+bool dtCrowd::restoreState(const unsigned char* data, const int dataSize)
+{
+	// Validate everything before touching the agents.
+	if (!readState(data, dataSize, false))
+		return false;
+	if (!readState(data, dataSize, true))
+		return false;
+
+	// Make the restored agents visible to the spatial queries.
+	registerAgents(m_activeAgents, getActiveAgents(m_activeAgents, m_maxAgents));
+	return true;
+}
+
+/// @par
+///
+/// Call this after dtNavMesh::replaceTile() instead of letting the next #update find
+/// the invalid references. The corridors are patched in place, so only the agents
+/// whose path actually crosses a polygon that is gone, or is no longer connected,
+/// request a new path. Agents standing on, or heading to, a polygon without counterpart
+/// are left to the usual recovery in #update. In-flight path requests are issued
+/// again, since their results may refer to the old polygons. The landing polygon of
+/// an agent crossing an off-mesh connection is patched as well.
+///
+/// If a tile was replaced more than once since the last call, pass all of its
+/// mappings in order, they are chained. (See #dtRemapPolyRef.)
+int dtCrowd::remapPolyRefs(const dtPolyRefRemap* remaps, const int nremaps)
+{
+	int nreplan = 0;
+	for (int i = 0; i < m_maxAgents; ++i)
+	{
+		dtCrowdAgent* ag = &m_agents[i];
+		if (!ag->active || ag->state == DT_CROWDAGENT_STATE_INVALID)
+			continue;
+
+		dtCrowdAgentAnimation* anim = &m_agentAnims[i];
+		if (anim->active)
+			anim->polyRef = dtRemapPolyRef(remaps, nremaps, anim->polyRef);
+
+		const dtPolyRef firstRef = ag->corridor.getFirstPoly();
+		const bool pathIntact = ag->corridor.remapPolyRefs(remaps, nremaps, m_navquery);
+
+		dtPolyRef targetRef = ag->targetRef;
+		if (ag->targetState != DT_CROWDAGENT_TARGET_NONE && ag->targetState != DT_CROWDAGENT_TARGET_VELOCITY)
+			targetRef = dtRemapPolyRef(remaps, nremaps, ag->targetRef);
+
+		if ((firstRef && !dtRemapPolyRef(remaps, nremaps, firstRef)) || (ag->targetRef && !targetRef))
+		{
+			// The agent or its target is off the new tiles, the update will recover them.
+			nreplan++;
+			continue;
+		}
+		ag->targetRef = targetRef;
+
+		if (ag->targetState == DT_CROWDAGENT_TARGET_WAITING_FOR_QUEUE ||
+			ag->targetState == DT_CROWDAGENT_TARGET_WAITING_FOR_PATH)
+		{
+			// The queued request may return old polygons, issue it again.
+			ag->targetPathqRef = DT_PATHQ_INVALID;
+			ag->targetState = DT_CROWDAGENT_TARGET_REQUESTING;
+		}
+		else if (!pathIntact)
+		{
+			// The path was cut short, replan from its end.
+			if (ag->targetState == DT_CROWDAGENT_TARGET_VALID)
+				requestMoveTargetReplan(i, ag->targetRef, ag->targetPos);
+			nreplan++;
+		}
+	}
+	return nreplan;
+}
+
+bool dtCrowd::readState(const unsigned char* data, const int dataSize, const bool apply)
+{
+	if (!data || dataSize < 0)
+		return false;
+	const unsigned char* end = data + dataSize;
+
+	dtCrowdStateHeader header;
+	const unsigned char* d = readStateBytes(data, end, &header, sizeof(header));
+	if (!d)
+		return false;
+	if (header.magic != DT_CROWD_STATE_MAGIC || header.version != DT_CROWD_STATE_VERSION)
+		return false;
+	if (header.maxAgents != m_maxAgents || header.agentCount < 0 || header.agentCount > m_maxAgents)
+		return false;
+	if (header.maxObstacles != m_maxObstacles || header.obstacleCount < 0 || header.obstacleCount > m_maxObstacles)
+		return false;
+
+	if (apply)
+	{
+		for (int i = 0; i < m_maxAgents; ++i)
+		{
+			m_agents[i].active = false;
+			m_agentAnims[i].active = false;
+		}
+		m_pathq.clear();
+	}
+
+	dtLocalBoundary scratch;
+	int prevIdx = -1;
+	for (int n = 0; n < header.agentCount; ++n)
+	{
+		dtCrowdAgentState st;
+		d = readStateBytes(d, end, &st, sizeof(st));
+		if (!d)
+			return false;
+		// Agents are stored in index order, which also rules out duplicates.
+		if (st.idx <= prevIdx || st.idx >= m_maxAgents)
+			return false;
+		if (st.nneis > DT_CROWDAGENT_MAX_NEIGHBOURS || st.ncorners > DT_CROWDAGENT_MAX_CORNERS)
+			return false;
+		if (st.npath < 1 || st.npath > m_maxPathResult)
+			return false;
+		prevIdx = st.idx;
+
+		dtCrowdAgent* ag = &m_agents[st.idx];
+		dtCrowdAgentAnimation* anim = &m_agentAnims[st.idx];
+		if (!apply)
+		{
+			const int skip = (int)(sizeof(dtCrowdNeighbour) * st.nneis +
+				(sizeof(float)*3 + sizeof(unsigned char) + sizeof(dtPolyRef)) * st.ncorners +
+				sizeof(dtPolyRef) * st.npath);
+			if (end - d < skip)
+				return false;
+			d = scratch.restoreState(d + skip, end);
+			if (!d)
+				return false;
+			if (st.animActive)
+			{
+				if (end - d < (int)sizeof(dtCrowdAgentAnimation))
+					return false;
+				d += sizeof(dtCrowdAgentAnimation);
+			}
+			continue;
+		}
+
+		ag->state = st.state;
+		ag->partial = st.partial != 0;
+		ag->targetState = st.targetState;
+		ag->targetReplan = st.targetReplan != 0;
+		ag->targetPathqRef = DT_PATHQ_INVALID;
+		ag->nneis = st.nneis;
+		ag->ncorners = st.ncorners;
+		ag->topologyOptTime = st.topologyOptTime;
+		ag->desiredSpeed = st.desiredSpeed;
+		dtVcopy(ag->npos, st.npos);
+		dtVset(ag->disp, 0, 0, 0);
+		dtVcopy(ag->dvel, st.dvel);
+		dtVcopy(ag->nvel, st.nvel);
+		dtVcopy(ag->vel, st.vel);
+		memcpy(&ag->params, &st.params, sizeof(dtCrowdAgentParams));
+		ag->targetRef = st.targetRef;
+		dtVcopy(ag->targetPos, st.targetPos);
+		ag->targetReplanTime = st.targetReplanTime;
+
+		d = readStateBytes(d, end, ag->neis, sizeof(dtCrowdNeighbour) * st.nneis);
+		d = readStateBytes(d, end, ag->cornerVerts, sizeof(float)*3 * st.ncorners);
+		d = readStateBytes(d, end, ag->cornerFlags, sizeof(unsigned char) * st.ncorners);
+		d = readStateBytes(d, end, ag->cornerPolys, sizeof(dtPolyRef) * st.ncorners);
+		d = readStateBytes(d, end, m_pathResult, sizeof(dtPolyRef) * st.npath);
+		ag->corridor.reset(m_pathResult[0], st.corridorPos);
+		ag->corridor.setCorridor(st.corridorTarget, m_pathResult, st.npath);
+		d = ag->boundary.restoreState(d, end);
+		if (st.animActive)
+			d = readStateBytes(d, end, anim, sizeof(dtCrowdAgentAnimation));
+		ag->active = true;
+	}
+
+	if (apply)
+	{
+		for (int i = 0; i < m_maxObstacles; ++i)
+			m_obstacles[i].active = false;
+	}
+	int cells = 0;
+	prevIdx = -1;
+	for (int n = 0; n < header.obstacleCount; ++n)
+	{
+		dtCrowdObstacleState st;
+		d = readStateBytes(d, end, &st, sizeof(st));
+		if (!d)
+			return false;
+		const dtCrowdObstacle& ob = st.obstacle;
+		if (st.idx <= prevIdx || st.idx >= m_maxObstacles)
+			return false;
+		if (ob.type != DT_CROWDOBSTACLE_CIRCLE && ob.type != DT_CROWDOBSTACLE_CAPSULE)
+			return false;
+		if (!(ob.radius > 0.0f) || !(ob.height > 0.0f))
+			return false;
+		prevIdx = st.idx;
+		// The obstacles must fit the grid, like in addObstacle.
+		cells += getObstacleCellCount(m_obstacleGrid, &ob);
+		if (cells > m_obstacleGrid->getPoolSize())
+			return false;
+		if (apply)
+		{
+			m_obstacles[st.idx] = ob;
+			m_obstacles[st.idx].active = true;
+		}
+	}
+
+	if (apply)
+	{
+		// Rebuild the free obstacle slots, lowest index on top.
+		m_nfreeObstacles = 0;
+		for (int i = m_maxObstacles - 1; i >= 0; --i)
+		{
+			if (!m_obstacles[i].active)
+				m_freeObstacles[m_nfreeObstacles++] = i;
+		}
+		m_obstacleCells = cells;
+
+		// Rebuild the free slots, lowest index on top.
+		m_nfreeAgents = 0;
+		for (int i = m_maxAgents - 1; i >= 0; --i)
+		{
+			if (!m_agents[i].active)
+				m_freeAgents[m_nfreeAgents++] = i;
+		}
+	}
+
+	return true;
+}
+
@@ -135,3 +135,42 @@ bool dtLocalBoundary::isValid(dtNavMeshQuery* navquery, const dtQueryFilter* fil
 	return true;
 }
 
+int dtLocalBoundary::getStateSize() const
+{
+	return (int)(sizeof(m_center) + sizeof(int) + sizeof(Segment)*m_nsegs + sizeof(int) + sizeof(dtPolyRef)*m_npolys);
+}
+
+/// Writes the boundary to @p data, which must hold #getStateSize bytes, and
+/// returns the position after it.
+unsigned char* dtLocalBoundary::storeState(unsigned char* data) const
+{
+	memcpy(data, m_center, sizeof(m_center)); data += sizeof(m_center);
+	memcpy(data, &m_nsegs, sizeof(int)); data += sizeof(int);
+	memcpy(data, m_segs, sizeof(Segment)*m_nsegs); data += sizeof(Segment)*m_nsegs;
+	memcpy(data, &m_npolys, sizeof(int)); data += sizeof(int);
+	memcpy(data, m_polys, sizeof(dtPolyRef)*m_npolys); data += sizeof(dtPolyRef)*m_npolys;
+	return data;
+}
+
+/// Reads a boundary written by #storeState, and returns the position after it,
+/// or null if the data does not hold a valid boundary before @p end.
+const unsigned char* dtLocalBoundary::restoreState(const unsigned char* data, const unsigned char* end)
+{
+	int nsegs, npolys;
+	if (end - data < (int)(sizeof(m_center) + sizeof(int)))
+		return 0;
+	memcpy(&nsegs, data + sizeof(m_center), sizeof(int));
+	if (nsegs < 0 || nsegs > MAX_LOCAL_SEGS || end - data < (int)(sizeof(m_center) + sizeof(int)*2 + sizeof(Segment)*nsegs))
+		return 0;
+	memcpy(&npolys, data + sizeof(m_center) + sizeof(int) + sizeof(Segment)*nsegs, sizeof(int));
+	if (npolys < 0 || npolys > MAX_LOCAL_POLYS ||
+		end - data < (int)(sizeof(m_center) + sizeof(int)*2 + sizeof(Segment)*nsegs + sizeof(dtPolyRef)*npolys))
+		return 0;
+
+	memcpy(m_center, data, sizeof(m_center)); data += sizeof(m_center) + sizeof(int);
+	m_nsegs = nsegs;
+	memcpy(m_segs, data, sizeof(Segment)*nsegs); data += sizeof(Segment)*nsegs + sizeof(int);
+	m_npolys = npolys;
+	memcpy(m_polys, data, sizeof(dtPolyRef)*npolys); data += sizeof(dtPolyRef)*npolys;
+	return data;
+}
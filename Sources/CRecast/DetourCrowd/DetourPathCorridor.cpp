@@ -579,6 +579,132 @@ bool dtPathCorridor::trimInvalidPath(dtPolyRef safeRef, const float* safePos,
 	return true;
 }
 
+static bool isConnected(const dtNavMesh* nav, const dtPolyRef from, const dtPolyRef to)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	if (dtStatusFailed(nav->getTileAndPolyByRef(from, &tile, &poly)))
+		return false;
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		if (tile->links[i].ref == to)
+			return true;
+	}
+	return false;
+}
+
+// Returns the neighbour of a polygon that contains a position, or zero if there is none.
+static dtPolyRef findNeighbourAt(const dtNavMesh* nav, dtNavMeshQuery* navquery, const dtPolyRef ref, const float* pos)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	if (dtStatusFailed(nav->getTileAndPolyByRef(ref, &tile, &poly)))
+		return 0;
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		const dtPolyRef nei = tile->links[i].ref;
+		float h;
+		if (nei && dtStatusSucceed(navquery->getPolyHeight(nei, pos, &h)))
+			return nei;
+	}
+	return 0;
+}
+
+// Returns a polygon connecting two polygons, or zero if there is none.
+static dtPolyRef findBridge(const dtNavMesh* nav, const dtPolyRef from, const dtPolyRef to)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	if (dtStatusFailed(nav->getTileAndPolyByRef(from, &tile, &poly)))
+		return 0;
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		const dtPolyRef nei = tile->links[i].ref;
+		if (nei && isConnected(nav, nei, to))
+			return nei;
+	}
+	return 0;
+}
+
+/// @par
+///
+/// Each polygon of the path is replaced by its counterpart in the new tiles. Polygons that
+/// map to the same new polygon are merged, and when two remapped polygons are no longer
+/// neighbours, a polygon connecting both is inserted if there is one. Likewise, the path
+/// is extended when the position is on a neighbour of the new first polygon. The path is cut at
+/// the first polygon without counterpart or connection. The target is then clamped to
+/// the last polygon, like in #trimInvalidPath, and the caller should replan.
+bool dtPathCorridor::remapPolyRefs(const dtPolyRefRemap* remaps, const int nremaps, dtNavMeshQuery* navquery)
+{
+	dtAssert(navquery);
+	dtAssert(m_path);
+
+	if (!m_npath)
+		return true;
+	if (!dtRemapPolyRef(remaps, nremaps, m_path[0]))
+		return false;
+
+	// Polygons may be inserted, so rebuild the path from a copy.
+	dtPolyRef* path = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*m_npath, DT_ALLOC_TEMP);
+	if (!path)
+		return false;
+	memcpy(path, m_path, sizeof(dtPolyRef)*m_npath);
+
+	const dtNavMesh* nav = navquery->getAttachedNavMesh();
+	bool prevRemapped = false;
+	int n = 0;
+	int i = 0;
+
+	// The position may be on another part of the old first polygon.
+	const dtPolyRef first = dtRemapPolyRef(remaps, nremaps, path[0]);
+	float h;
+	if (first != path[0] && dtStatusFailed(navquery->getPolyHeight(first, m_pos, &h)))
+	{
+		const dtPolyRef start = findNeighbourAt(nav, navquery, first, m_pos);
+		if (start)
+		{
+			m_path[n++] = start;
+			prevRemapped = true;
+		}
+	}
+
+	for (; i < m_npath; ++i)
+	{
+		const dtPolyRef ref = dtRemapPolyRef(remaps, nremaps, path[i]);
+		if (!ref)
+			break;
+		const bool remapped = ref != path[i];
+		if (n > 0 && ref == m_path[n-1])
+		{
+			prevRemapped = true;
+			continue;
+		}
+		if (n > 0 && (remapped || prevRemapped) && !isConnected(nav, m_path[n-1], ref))
+		{
+			const dtPolyRef bridge = findBridge(nav, m_path[n-1], ref);
+			if (!bridge || n+1 >= m_maxPath)
+				break;
+			m_path[n++] = bridge;
+		}
+		if (n >= m_maxPath)
+			break;
+		m_path[n++] = ref;
+		prevRemapped = remapped;
+	}
+	const bool complete = i == m_npath;
+	m_npath = n;
+	dtFree(path);
+	if (complete)
+		return true;
+
+	// Clamp target pos to last poly
+	float tgt[3];
+	dtVcopy(tgt, m_target);
+	navquery->closestPointOnPolyBoundary(m_path[m_npath-1], tgt, m_target);
+
+	return false;
+}
+
 /// @par
 ///
 /// The path can be invalidated if there are structural changes to the underlying navigation mesh, or the state of 
@@ -74,6 +74,17 @@ bool dtPathQueue::init(const int maxPathSize, const int maxSearchNodeCount, dtNa
 	return true;
 }
 
+void dtPathQueue::clear()
+{
+	for (int i = 0; i < MAX_QUEUE; ++i)
+	{
+		m_queue[i].ref = DT_PATHQ_INVALID;
+		m_queue[i].status = 0;
+	}
+	m_queueHead = 0;
+	m_nextHandle = 1;
+}
+
 void dtPathQueue::update(const int maxIters)
 {
 	static const int MAX_KEEP_ALIVE = 2; // in update ticks.
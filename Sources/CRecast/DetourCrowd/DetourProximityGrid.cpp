@@ -40,15 +40,17 @@ void dtFreeProximityGrid(dtProximityGrid* ptr)
 }
 
 
-inline int hashPos2(int x, int y, int n)
+inline int hashPos3(int x, int y, int z, int n)
 {
-	return ((x*73856093) ^ (y*19349663)) & (n-1);
+	return ((x*73856093) ^ (y*19349663) ^ (z*83492791)) & (n-1);
 }
 
 
 dtProximityGrid::dtProximityGrid() :
 	m_cellSize(0),
 	m_invCellSize(0),
+	m_cellHeight(0),
+	m_invCellHeight(0),
 	m_pool(0),
 	m_poolHead(0),
 	m_poolSize(0),
@@ -63,13 +65,23 @@ dtProximityGrid::~dtProximityGrid()
 	dtFree(m_pool);
 }
 
-bool dtProximityGrid::init(const int poolSize, const float cellSize)
+/// @par
+///
+/// With a cell height, the items added and queried with a box are also bucketed
+/// by height, so that items on different floors of a building do not share cells.
+/// The cells are indexed by (x, z, y) of the world, and the items added with the
+/// two-dimensional methods all go to the bottom layer of cells, so use one kind of
+/// method per grid.
+bool dtProximityGrid::init(const int poolSize, const float cellSize, const float cellHeight)
 {
 	dtAssert(poolSize > 0);
 	dtAssert(cellSize > 0.0f);
+	dtAssert(cellHeight >= 0.0f);
 	
 	m_cellSize = cellSize;
 	m_invCellSize = 1.0f / m_cellSize;
+	m_cellHeight = cellHeight;
+	m_invCellHeight = cellHeight > 0.0f ? 1.0f / cellHeight : 0.0f;
 	
 	// Allocate hashs buckets
 	m_bucketsSize = dtNextPow2(poolSize);
@@ -97,6 +109,8 @@ void dtProximityGrid::clear()
 	m_bounds[1] = 0xffff;
 	m_bounds[2] = -0xffff;
 	m_bounds[3] = -0xffff;
+	m_heightBounds[0] = 0xffff;
+	m_heightBounds[1] = -0xffff;
 }
 
 void dtProximityGrid::addItem(const unsigned short id,
@@ -107,27 +121,62 @@ void dtProximityGrid::addItem(const unsigned short id,
 	const int iminy = (int)dtMathFloorf(miny * m_invCellSize);
 	const int imaxx = (int)dtMathFloorf(maxx * m_invCellSize);
 	const int imaxy = (int)dtMathFloorf(maxy * m_invCellSize);
-	
+	addItem(id, iminx, iminy, 0, imaxx, imaxy, 0);
+}
+
+void dtProximityGrid::addItem(const unsigned short id, const float* bmin, const float* bmax)
+{
+	const int iminx = (int)dtMathFloorf(bmin[0] * m_invCellSize);
+	const int iminy = (int)dtMathFloorf(bmin[2] * m_invCellSize);
+	const int iminz = (int)dtMathFloorf(bmin[1] * m_invCellHeight);
+	const int imaxx = (int)dtMathFloorf(bmax[0] * m_invCellSize);
+	const int imaxy = (int)dtMathFloorf(bmax[2] * m_invCellSize);
+	const int imaxz = (int)dtMathFloorf(bmax[1] * m_invCellHeight);
+	addItem(id, iminx, iminy, iminz, imaxx, imaxy, imaxz);
+}
+
+int dtProximityGrid::getItemCellCount(const float* bmin, const float* bmax) const
+{
+	const int nx = (int)dtMathFloorf(bmax[0] * m_invCellSize) - (int)dtMathFloorf(bmin[0] * m_invCellSize) + 1;
+	const int ny = (int)dtMathFloorf(bmax[2] * m_invCellSize) - (int)dtMathFloorf(bmin[2] * m_invCellSize) + 1;
+	const int nz = (int)dtMathFloorf(bmax[1] * m_invCellHeight) - (int)dtMathFloorf(bmin[1] * m_invCellHeight) + 1;
+	// In floats, since the product of a huge box overflows; anything past the pool is the same.
+	const float n = (float)nx * (float)ny * (float)nz;
+	return n > (float)m_poolSize ? m_poolSize + 1 : (int)n;
+}
+
+void dtProximityGrid::addItem(const unsigned short id, const int iminx, const int iminy, const int iminz,
+							  const int imaxx, const int imaxy, const int imaxz)
+{
 	m_bounds[0] = dtMin(m_bounds[0], iminx);
 	m_bounds[1] = dtMin(m_bounds[1], iminy);
 	m_bounds[2] = dtMax(m_bounds[2], imaxx);
 	m_bounds[3] = dtMax(m_bounds[3], imaxy);
+	m_heightBounds[0] = dtMin(m_heightBounds[0], iminz);
+	m_heightBounds[1] = dtMax(m_heightBounds[1], imaxz);
 	
-	for (int y = iminy; y <= imaxy; ++y)
+	for (int z = iminz; z <= imaxz; ++z)
 	{
-		for (int x = iminx; x <= imaxx; ++x)
+		for (int y = iminy; y <= imaxy; ++y)
 		{
-			if (m_poolHead < m_poolSize)
+			for (int x = iminx; x <= imaxx; ++x)
 			{
-				const int h = hashPos2(x, y, m_bucketsSize);
-				const unsigned short idx = (unsigned short)m_poolHead;
-				m_poolHead++;
-				Item& item = m_pool[idx];
-				item.x = (short)x;
-				item.y = (short)y;
-				item.id = id;
-				item.next = m_buckets[h];
-				m_buckets[h] = idx;
+				if (m_poolHead < m_poolSize)
+				{
+					const int h = hashPos3(x, y, z, m_bucketsSize);
+					const unsigned short idx = (unsigned short)m_poolHead;
+					m_poolHead++;
+					Item& item = m_pool[idx];
+					item.x = (short)x;
+					item.y = (short)y;
+					item.z = (short)z;
+					item.minx = (short)iminx;
+					item.miny = (short)iminy;
+					item.minz = (short)iminz;
+					item.id = id;
+					item.next = m_buckets[h];
+					m_buckets[h] = idx;
+				}
 			}
 		}
 	}
@@ -141,34 +190,53 @@ int dtProximityGrid::queryItems(const float minx, const float miny,
 	const int iminy = (int)dtMathFloorf(miny * m_invCellSize);
 	const int imaxx = (int)dtMathFloorf(maxx * m_invCellSize);
 	const int imaxy = (int)dtMathFloorf(maxy * m_invCellSize);
-	
+	return queryItems(iminx, iminy, 0, imaxx, imaxy, 0, ids, maxIds);
+}
+
+int dtProximityGrid::queryItems(const float* bmin, const float* bmax,
+								unsigned short* ids, const int maxIds) const
+{
+	const int iminx = (int)dtMathFloorf(bmin[0] * m_invCellSize);
+	const int iminy = (int)dtMathFloorf(bmin[2] * m_invCellSize);
+	const int iminz = (int)dtMathFloorf(bmin[1] * m_invCellHeight);
+	const int imaxx = (int)dtMathFloorf(bmax[0] * m_invCellSize);
+	const int imaxy = (int)dtMathFloorf(bmax[2] * m_invCellSize);
+	const int imaxz = (int)dtMathFloorf(bmax[1] * m_invCellHeight);
+	return queryItems(iminx, iminy, iminz, imaxx, imaxy, imaxz, ids, maxIds);
+}
+
+int dtProximityGrid::queryItems(const int iminx, const int iminy, const int iminz,
+								const int imaxx, const int imaxy, const int imaxz,
+								unsigned short* ids, const int maxIds) const
+{
 	int n = 0;
 	
-	for (int y = iminy; y <= imaxy; ++y)
+	// Skip the layers of cells above and below all the items.
+	const int minz = dtMax(iminz, m_heightBounds[0]);
+	const int maxz = dtMin(imaxz, m_heightBounds[1]);
+	
+	for (int z = minz; z <= maxz; ++z)
 	{
-		for (int x = iminx; x <= imaxx; ++x)
+		for (int y = iminy; y <= imaxy; ++y)
 		{
-			const int h = hashPos2(x, y, m_bucketsSize);
-			unsigned short idx = m_buckets[h];
-			while (idx != 0xffff)
+			for (int x = iminx; x <= imaxx; ++x)
 			{
-				Item& item = m_pool[idx];
-				if ((int)item.x == x && (int)item.y == y)
+				const int h = hashPos3(x, y, z, m_bucketsSize);
+				unsigned short idx = m_buckets[h];
+				while (idx != 0xffff)
 				{
-					// Check if the id exists already.
-					const unsigned short* end = ids + n;
-					unsigned short* i = ids;
-					while (i != end && *i != item.id)
-						++i;
-					// Item not found, add it.
-					if (i == end)
+					Item& item = m_pool[idx];
+					// Report the item only in the first of its cells within the query.
+					if ((int)item.x == x && (int)item.y == y && (int)item.z == z &&
+						x == dtMax((int)item.minx, iminx) && y == dtMax((int)item.miny, iminy) &&
+						z == dtMax((int)item.minz, minz))
 					{
 						if (n >= maxIds)
 							return n;
 						ids[n++] = item.id;
 					}
+					idx = item.next;
 				}
-				idx = item.next;
 			}
 		}
 	}
@@ -180,14 +248,30 @@ int dtProximityGrid::getItemCountAt(const int x, const int y) const
 {
 	int n = 0;
 	
-	const int h = hashPos2(x, y, m_bucketsSize);
-	unsigned short idx = m_buckets[h];
-	while (idx != 0xffff)
+	// Count the items of every height the grid holds, one bucket per height.
+	// Items spread over more heights than there are items are cheaper to scan.
+	if (m_heightBounds[1] - m_heightBounds[0] >= m_poolHead)
 	{
-		Item& item = m_pool[idx];
-		if ((int)item.x == x && (int)item.y == y)
-			n++;
-		idx = item.next;
+		for (int i = 0; i < m_poolHead; ++i)
+		{
+			const Item& item = m_pool[i];
+			if ((int)item.x == x && (int)item.y == y)
+				n++;
+		}
+		return n;
+	}
+	
+	for (int z = m_heightBounds[0]; z <= m_heightBounds[1]; ++z)
+	{
+		const int h = hashPos3(x, y, z, m_bucketsSize);
+		unsigned short idx = m_buckets[h];
+		while (idx != 0xffff)
+		{
+			const Item& item = m_pool[idx];
+			if ((int)item.x == x && (int)item.y == y && (int)item.z == z)
+				n++;
+			idx = item.next;
+		}
 	}
 	
 	return n;
@@ -20,10 +20,12 @@
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
 
+#include <float.h>
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <thread>
 
 namespace
 {
@@ -78,6 +80,54 @@ void rcContext::log(const rcLogCategory category, const char* format, ...)
 	doLog(category, msg, len);
 }
 
+void rcContext::parallelFor(const int count, rcParallelForFunc func, void* userData)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	const int nranges = rcMin(m_maxThreads, count);
+	if (nranges <= 1)
+	{
+		func(userData, 0, count);
+		return;
+	}
+	doParallelFor(count, nranges, func, userData);
+}
+
+void rcContext::doParallelFor(const int count, const int nranges, rcParallelForFunc func, void* userData)
+{
+	static const int MAX_THREADS = 64;
+	const int n = rcMin(nranges, MAX_THREADS);
+
+	// The calling thread takes the first range, the rest get a thread each.
+	// If a thread cannot be started, the calling thread also runs the ranges
+	// that did not get one, so the job always completes.
+	std::thread threads[MAX_THREADS];
+	int started = 1;
+	try
+	{
+		for (; started < n; ++started)
+		{
+			const int begin = (int)((long long)count * started / n);
+			const int end = (int)((long long)count * (started + 1) / n);
+			threads[started] = std::thread(func, userData, begin, end);
+		}
+	}
+	catch (...)
+	{
+	}
+	func(userData, 0, (int)((long long)count / n));
+	for (int i = started; i < n; ++i)
+	{
+		func(userData, (int)((long long)count * i / n), (int)((long long)count * (i + 1) / n));
+	}
+	for (int i = 1; i < started; ++i)
+	{
+		threads[i].join();
+	}
+}
+
 void rcContext::doResetLog()
 {
 	// Defined out of line to fix the weak v-tables warning
@@ -103,6 +153,7 @@ rcHeightfield::rcHeightfield()
 , spans()
 , pools()
 , freelist()
+, maxCells()
 {
 }
 
@@ -146,6 +197,8 @@ rcCompactHeightfield::rcCompactHeightfield()
 , spans()
 , dist()
 , areas()
+, maxCells()
+, maxSpans()
 {
 }
 
@@ -184,6 +237,33 @@ rcHeightfieldLayerSet::~rcHeightfieldLayerSet()
 	rcFree(layers);
 }
 
+rcTriangleTiles* rcAllocTriangleTiles()
+{
+	return rcNew<rcTriangleTiles>(RC_ALLOC_PERM);
+}
+
+void rcFreeTriangleTiles(rcTriangleTiles* triangleTiles)
+{
+	rcDelete(triangleTiles);
+}
+
+rcTriangleTiles::rcTriangleTiles()
+: bmin()
+, bmax()
+, tileSize()
+, tileBorder()
+, width()
+, height()
+, tileStarts()
+, tris()
+{
+}
+
+rcTriangleTiles::~rcTriangleTiles()
+{
+	rcFree(tileStarts);
+	rcFree(tris);
+}
 
 rcContourSet* rcAllocContourSet()
 {
@@ -206,12 +286,13 @@ rcContourSet::rcContourSet()
 , height()
 , borderSize()
 , maxError()
+, maxConts()
 {
 }
 
 rcContourSet::~rcContourSet()
 {
-	for (int i = 0; i < nconts; ++i)
+	for (int i = 0; i < maxConts; ++i)
 	{
 		rcFree(conts[i].verts);
 		rcFree(conts[i].rverts);
@@ -238,6 +319,7 @@ rcPolyMesh::rcPolyMesh()
 , nverts()
 , npolys()
 , maxpolys()
+, maxverts()
 , nvp()
 , bmin()
 , bmax()
@@ -281,6 +363,9 @@ rcPolyMeshDetail::rcPolyMeshDetail()
 , nmeshes()
 , nverts()
 , ntris()
+, maxmeshes()
+, maxverts()
+, maxtris()
 {
 }
 
@@ -315,12 +400,32 @@ bool rcCreateHeightfield(rcContext* context, rcHeightfield& heightfield, int siz
 	rcVcopy(heightfield.bmax, maxBounds);
 	heightfield.cs = cellSize;
 	heightfield.ch = cellHeight;
-	heightfield.spans = (rcSpan**)rcAlloc(sizeof(rcSpan*) * heightfield.width * heightfield.height, RC_ALLOC_PERM);
-	if (!heightfield.spans)
+
+	// A heightfield that was already used keeps its columns and span pools.
+	const int cellCount = heightfield.width * heightfield.height;
+	if (cellCount > heightfield.maxCells || !heightfield.spans)
 	{
-		return false;
+		rcFree(heightfield.spans);
+		heightfield.maxCells = 0;
+		heightfield.spans = (rcSpan**)rcAlloc(sizeof(rcSpan*) * rcMax(cellCount, 1), RC_ALLOC_PERM);
+		if (!heightfield.spans)
+		{
+			return false;
+		}
+		heightfield.maxCells = rcMax(cellCount, 1);
+	}
+	memset(heightfield.spans, 0, sizeof(rcSpan*) * cellCount);
+
+	// Return all the spans of the pools to the free list.
+	heightfield.freelist = NULL;
+	for (rcSpanPool* pool = heightfield.pools; pool; pool = pool->next)
+	{
+		for (int i = RC_SPANS_PER_POOL - 1; i >= 0; --i)
+		{
+			pool->items[i].next = heightfield.freelist;
+			heightfield.freelist = &pool->items[i];
+		}
 	}
-	memset(heightfield.spans, 0, sizeof(rcSpan*) * heightfield.width * heightfield.height);
 	return true;
 }
 
@@ -381,6 +486,264 @@ void rcClearUnwalkableTriangles(rcContext* context, const float walkableSlopeAng
 	}
 }
 
+namespace
+{
+// Triangles are classified and bounded in blocks of this size, gathered into
+// structure-of-arrays form so the math below compiles to vector code.
+const int TRIANGLE_BLOCK_SIZE = 64;
+
+// Triangles handled by a single parallel job.
+const int TRIANGLES_PER_CHUNK = 16384;
+
+struct TriangleTilesJob
+{
+	const float* verts;
+	int numVerts;
+	const int* tris;
+	int numTris;
+	int nchunks;
+	float walkableThr;
+	unsigned char* triAreaIDs;
+	rcTriangleTiles* tiles;
+	float* chunkBounds;		// Vertex bounds of each chunk. [(min, max) * nchunks]
+	int* triTiles;			// Tile range covered by each triangle. [(tx0, ty0, tx1, ty1) * numTris]
+	int* chunkCounts;		// Triangle count per chunk and tile, later the write offsets. [nchunks * ntiles]
+};
+
+void chunkRange(const int n, const int nchunks, const int chunk, int& begin, int& end)
+{
+	begin = (int)((long long)n * chunk / nchunks);
+	end = (int)((long long)n * (chunk + 1) / nchunks);
+}
+
+void boundVertexChunks(void* userData, const int begin, const int end)
+{
+	TriangleTilesJob& job = *(TriangleTilesJob*)userData;
+	for (int c = begin; c < end; ++c)
+	{
+		int v0, v1;
+		chunkRange(job.numVerts, job.nchunks, c, v0, v1);
+		float* bmin = &job.chunkBounds[c * 6];
+		float* bmax = &job.chunkBounds[c * 6 + 3];
+		if (v0 == v1)
+		{
+			bmin[0] = bmin[1] = bmin[2] = FLT_MAX;
+			bmax[0] = bmax[1] = bmax[2] = -FLT_MAX;
+			continue;
+		}
+		rcVcopy(bmin, &job.verts[v0 * 3]);
+		rcVcopy(bmax, &job.verts[v0 * 3]);
+		for (int i = v0 + 1; i < v1; ++i)
+		{
+			const float* v = &job.verts[i * 3];
+			rcVmin(bmin, v);
+			rcVmax(bmax, v);
+		}
+	}
+}
+
+void classifyTriangleChunks(void* userData, const int begin, const int end)
+{
+	TriangleTilesJob& job = *(TriangleTilesJob*)userData;
+	const rcTriangleTiles& tiles = *job.tiles;
+	const int ntiles = tiles.width * tiles.height;
+	const float border = tiles.tileBorder;
+	const float invTileSize = 1.0f / tiles.tileSize;
+	const float maxTx = (float)(tiles.width - 1);
+	const float maxTy = (float)(tiles.height - 1);
+
+	float ax[TRIANGLE_BLOCK_SIZE], ay[TRIANGLE_BLOCK_SIZE], az[TRIANGLE_BLOCK_SIZE];
+	float bx[TRIANGLE_BLOCK_SIZE], by[TRIANGLE_BLOCK_SIZE], bz[TRIANGLE_BLOCK_SIZE];
+	float cx[TRIANGLE_BLOCK_SIZE], cy[TRIANGLE_BLOCK_SIZE], cz[TRIANGLE_BLOCK_SIZE];
+	unsigned char walkable[TRIANGLE_BLOCK_SIZE];
+	float minx[TRIANGLE_BLOCK_SIZE], maxx[TRIANGLE_BLOCK_SIZE];
+	float minz[TRIANGLE_BLOCK_SIZE], maxz[TRIANGLE_BLOCK_SIZE];
+
+	for (int c = begin; c < end; ++c)
+	{
+		int t0, t1;
+		chunkRange(job.numTris, job.nchunks, c, t0, t1);
+		int* counts = &job.chunkCounts[c * ntiles];
+
+		for (int base = t0; base < t1; base += TRIANGLE_BLOCK_SIZE)
+		{
+			const int n = rcMin(TRIANGLE_BLOCK_SIZE, t1 - base);
+
+			// Gather.
+			for (int k = 0; k < n; ++k)
+			{
+				const int* tri = &job.tris[(base + k) * 3];
+				const float* va = &job.verts[tri[0] * 3];
+				const float* vb = &job.verts[tri[1] * 3];
+				const float* vc = &job.verts[tri[2] * 3];
+				ax[k] = va[0]; ay[k] = va[1]; az[k] = va[2];
+				bx[k] = vb[0]; by[k] = vb[1]; bz[k] = vb[2];
+				cx[k] = vc[0]; cy[k] = vc[1]; cz[k] = vc[2];
+			}
+
+			// Same arithmetic as calcTriNormal(), so the classification matches rcMarkWalkableTriangles().
+			for (int k = 0; k < n; ++k)
+			{
+				const float e0x = bx[k] - ax[k], e0y = by[k] - ay[k], e0z = bz[k] - az[k];
+				const float e1x = cx[k] - ax[k], e1y = cy[k] - ay[k], e1z = cz[k] - az[k];
+				const float nx = e0y * e1z - e0z * e1y;
+				const float ny = e0z * e1x - e0x * e1z;
+				const float nz = e0x * e1y - e0y * e1x;
+				const float d = 1.0f / rcSqrt(nx * nx + ny * ny + nz * nz);
+				walkable[k] = (ny * d > job.walkableThr) ? 1 : 0;
+				minx[k] = rcMin(ax[k], rcMin(bx[k], cx[k]));
+				maxx[k] = rcMax(ax[k], rcMax(bx[k], cx[k]));
+				minz[k] = rcMin(az[k], rcMin(bz[k], cz[k]));
+				maxz[k] = rcMax(az[k], rcMax(bz[k], cz[k]));
+			}
+
+			// Scatter results and count the triangles per tile.
+			for (int k = 0; k < n; ++k)
+			{
+				const int i = base + k;
+				if (walkable[k])
+					job.triAreaIDs[i] = RC_WALKABLE_AREA;
+
+				// The tiles whose bordered bounds touch the triangle bounds.
+				int* r = &job.triTiles[i * 4];
+				r[0] = (int)rcClamp(ceilf((minx[k] - tiles.bmin[0] - border) * invTileSize) - 1.0f, 0.0f, maxTx);
+				r[1] = (int)rcClamp(ceilf((minz[k] - tiles.bmin[2] - border) * invTileSize) - 1.0f, 0.0f, maxTy);
+				r[2] = (int)rcClamp(floorf((maxx[k] - tiles.bmin[0] + border) * invTileSize), 0.0f, maxTx);
+				r[3] = (int)rcClamp(floorf((maxz[k] - tiles.bmin[2] + border) * invTileSize), 0.0f, maxTy);
+				for (int ty = r[1]; ty <= r[3]; ++ty)
+					for (int tx = r[0]; tx <= r[2]; ++tx)
+						counts[tx + ty * tiles.width]++;
+			}
+		}
+	}
+}
+
+void binTriangleChunks(void* userData, const int begin, const int end)
+{
+	TriangleTilesJob& job = *(TriangleTilesJob*)userData;
+	const rcTriangleTiles& tiles = *job.tiles;
+	const int ntiles = tiles.width * tiles.height;
+
+	for (int c = begin; c < end; ++c)
+	{
+		int t0, t1;
+		chunkRange(job.numTris, job.nchunks, c, t0, t1);
+		int* offsets = &job.chunkCounts[c * ntiles];
+		for (int i = t0; i < t1; ++i)
+		{
+			const int* r = &job.triTiles[i * 4];
+			for (int ty = r[1]; ty <= r[3]; ++ty)
+				for (int tx = r[0]; tx <= r[2]; ++tx)
+					tiles.tris[offsets[tx + ty * tiles.width]++] = i;
+		}
+	}
+}
+} // anonymous namespace
+
+bool rcBuildTriangleTiles(rcContext* context, const float walkableSlopeAngle,
+                          const float* verts, const int numVerts,
+                          const int* tris, const int numTris,
+                          const float tileSize, const float tileBorder,
+                          unsigned char* triAreaIDs, rcTriangleTiles& triangleTiles)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_BUILD_TRIANGLE_TILES);
+
+	rcAssert(triangleTiles.tileStarts == 0 && triangleTiles.tris == 0);
+	if (tileSize <= 0.0f || numVerts <= 0)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTriangleTiles: Invalid tile size (%f) or vertex count (%d).", tileSize, numVerts);
+		return false;
+	}
+
+	TriangleTilesJob job;
+	job.verts = verts;
+	job.numVerts = numVerts;
+	job.tris = tris;
+	job.numTris = numTris;
+	job.walkableThr = cosf(walkableSlopeAngle / 180.0f * RC_PI);
+	job.triAreaIDs = triAreaIDs;
+	job.tiles = &triangleTiles;
+	job.nchunks = rcClamp((rcMax(numVerts, numTris) + TRIANGLES_PER_CHUNK - 1) / TRIANGLES_PER_CHUNK, 1, context->getMaxThreads());
+
+	// Vertex bounds anchor the tile grid, so they are needed before any triangle can be binned.
+	rcScopedDelete<float> chunkBounds((float*)rcAlloc(sizeof(float) * 6 * job.nchunks, RC_ALLOC_TEMP));
+	if (!chunkBounds)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTriangleTiles: Out of memory 'chunkBounds' (%d).", job.nchunks);
+		return false;
+	}
+	job.chunkBounds = chunkBounds;
+	context->parallelFor(job.nchunks, boundVertexChunks, &job);
+
+	rcVcopy(triangleTiles.bmin, &chunkBounds[0]);
+	rcVcopy(triangleTiles.bmax, &chunkBounds[3]);
+	for (int c = 1; c < job.nchunks; ++c)
+	{
+		rcVmin(triangleTiles.bmin, &chunkBounds[c * 6]);
+		rcVmax(triangleTiles.bmax, &chunkBounds[c * 6 + 3]);
+	}
+
+	triangleTiles.tileSize = tileSize;
+	triangleTiles.tileBorder = tileBorder;
+	triangleTiles.width = rcMax(1, (int)ceilf((triangleTiles.bmax[0] - triangleTiles.bmin[0]) / tileSize));
+	triangleTiles.height = rcMax(1, (int)ceilf((triangleTiles.bmax[2] - triangleTiles.bmin[2]) / tileSize));
+	const int ntiles = triangleTiles.width * triangleTiles.height;
+
+	triangleTiles.tileStarts = (int*)rcAlloc(sizeof(int) * (ntiles + 1), RC_ALLOC_PERM);
+	if (!triangleTiles.tileStarts)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTriangleTiles: Out of memory 'tileStarts' (%d).", ntiles + 1);
+		return false;
+	}
+
+	rcScopedDelete<int> triTiles((int*)rcAlloc(sizeof(int) * 4 * rcMax(numTris, 1), RC_ALLOC_TEMP));
+	if (!triTiles)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTriangleTiles: Out of memory 'triTiles' (%d).", numTris);
+		return false;
+	}
+	job.triTiles = triTiles;
+
+	rcScopedDelete<int> chunkCounts((int*)rcAlloc(sizeof(int) * job.nchunks * ntiles, RC_ALLOC_TEMP));
+	if (!chunkCounts)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTriangleTiles: Out of memory 'chunkCounts' (%d).", job.nchunks * ntiles);
+		return false;
+	}
+	memset(chunkCounts, 0, sizeof(int) * job.nchunks * ntiles);
+	job.chunkCounts = chunkCounts;
+
+	// The single pass over the triangles.
+	context->parallelFor(job.nchunks, classifyTriangleChunks, &job);
+
+	// Turn the counts into write offsets, keeping the chunks of a tile in triangle order.
+	int total = 0;
+	for (int t = 0; t < ntiles; ++t)
+	{
+		triangleTiles.tileStarts[t] = total;
+		for (int c = 0; c < job.nchunks; ++c)
+		{
+			const int n = chunkCounts[c * ntiles + t];
+			chunkCounts[c * ntiles + t] = total;
+			total += n;
+		}
+	}
+	triangleTiles.tileStarts[ntiles] = total;
+
+	triangleTiles.tris = (int*)rcAlloc(sizeof(int) * rcMax(total, 1), RC_ALLOC_PERM);
+	if (!triangleTiles.tris)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTriangleTiles: Out of memory 'tris' (%d).", total);
+		return false;
+	}
+
+	context->parallelFor(job.nchunks, binTriangleChunks, &job);
+
+	return true;
+}
+
 int rcGetHeightFieldSpanCount(rcContext* context, const rcHeightfield& heightfield)
 {
 	rcIgnoreUnused(context);
@@ -423,26 +786,46 @@ bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, con
 	compactHeightfield.bmax[1] += walkableHeight * heightfield.ch;
 	compactHeightfield.cs = heightfield.cs;
 	compactHeightfield.ch = heightfield.ch;
-	compactHeightfield.cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell) * xSize * zSize, RC_ALLOC_PERM);
-	if (!compactHeightfield.cells)
+	compactHeightfield.maxDistance = 0;
+
+	// A compact heightfield that was already used keeps its arrays when they are large enough.
+	// The distance field belongs to the previous build.
+	rcFree(compactHeightfield.dist);
+	compactHeightfield.dist = NULL;
+	if (xSize * zSize > compactHeightfield.maxCells || !compactHeightfield.cells)
 	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.cells' (%d)", xSize * zSize);
-		return false;
+		rcFree(compactHeightfield.cells);
+		compactHeightfield.maxCells = 0;
+		compactHeightfield.cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell) * rcMax(xSize * zSize, 1), RC_ALLOC_PERM);
+		if (!compactHeightfield.cells)
+		{
+			context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.cells' (%d)", xSize * zSize);
+			return false;
+		}
+		compactHeightfield.maxCells = rcMax(xSize * zSize, 1);
 	}
 	memset(compactHeightfield.cells, 0, sizeof(rcCompactCell) * xSize * zSize);
-	compactHeightfield.spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan) * spanCount, RC_ALLOC_PERM);
-	if (!compactHeightfield.spans)
+	if (spanCount > compactHeightfield.maxSpans || !compactHeightfield.spans || !compactHeightfield.areas)
 	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.spans' (%d)", spanCount);
-		return false;
+		rcFree(compactHeightfield.spans);
+		rcFree(compactHeightfield.areas);
+		compactHeightfield.areas = NULL;
+		compactHeightfield.maxSpans = 0;
+		compactHeightfield.spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan) * rcMax(spanCount, 1), RC_ALLOC_PERM);
+		if (!compactHeightfield.spans)
+		{
+			context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.spans' (%d)", spanCount);
+			return false;
+		}
+		compactHeightfield.areas = (unsigned char*)rcAlloc(sizeof(unsigned char) * rcMax(spanCount, 1), RC_ALLOC_PERM);
+		if (!compactHeightfield.areas)
+		{
+			context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.areas' (%d)", spanCount);
+			return false;
+		}
+		compactHeightfield.maxSpans = rcMax(spanCount, 1);
 	}
 	memset(compactHeightfield.spans, 0, sizeof(rcCompactSpan) * spanCount);
-	compactHeightfield.areas = (unsigned char*)rcAlloc(sizeof(unsigned char) * spanCount, RC_ALLOC_PERM);
-	if (!compactHeightfield.areas)
-	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.areas' (%d)", spanCount);
-		return false;
-	}
 	memset(compactHeightfield.areas, RC_NULL_AREA, sizeof(unsigned char) * spanCount);
 
 	const int MAX_HEIGHT = 0xffff;
@@ -602,6 +602,32 @@ static void removeDegenerateSegments(rcIntArray& simplified)
 }
 
 
+/// Grows the contour array of the set, keeping the vertex arrays of all the allocated contours.
+static bool growContours(rcContourSet& cset, const int maxContours)
+{
+	rcContour* conts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
+	if (!conts)
+		return false;
+	memset(conts, 0, sizeof(rcContour)*maxContours);
+	if (cset.conts)
+		memcpy(conts, cset.conts, sizeof(rcContour)*cset.maxConts);
+	rcFree(cset.conts);
+	cset.conts = conts;
+	cset.maxConts = maxContours;
+	return true;
+}
+
+/// Makes room for a number of vertices, reusing the array when it is large enough.
+static bool reserveContourVerts(int*& verts, int& maxVerts, const int nverts)
+{
+	if (nverts <= maxVerts && verts)
+		return true;
+	rcFree(verts);
+	verts = (int*)rcAlloc(sizeof(int)*nverts*4, RC_ALLOC_PERM);
+	maxVerts = verts ? nverts : 0;
+	return verts != 0;
+}
+
 static bool mergeContours(rcContour& ca, rcContour& cb, int ia, int ib)
 {
 	const int maxVerts = ca.nverts + cb.nverts + 2;
@@ -638,10 +664,12 @@ static bool mergeContours(rcContour& ca, rcContour& cb, int ia, int ib)
 	rcFree(ca.verts);
 	ca.verts = verts;
 	ca.nverts = nv;
+	ca.maxVerts = maxVerts;
 	
 	rcFree(cb.verts);
 	cb.verts = 0;
 	cb.nverts = 0;
+	cb.maxVerts = 0;
 	
 	return true;
 }
@@ -850,10 +878,14 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 	cset.borderSize = chf.borderSize;
 	cset.maxError = maxError;
 	
+	// A contour set that was already used keeps its contours and their vertex arrays.
 	int maxContours = rcMax((int)chf.maxRegions, 8);
-	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
-	if (!cset.conts)
-		return false;
+	if (maxContours > cset.maxConts || !cset.conts)
+	{
+		if (!growContours(cset, maxContours))
+			return false;
+	}
+	maxContours = cset.maxConts;
 	cset.nconts = 0;
 	
 	rcScopedDelete<unsigned char> flags((unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP));
@@ -943,16 +975,11 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 						// This happens when a region has holes.
 						const int oldMax = maxContours;
 						maxContours *= 2;
-						rcContour* newConts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
-						for (int j = 0; j < cset.nconts; ++j)
+						if (!growContours(cset, maxContours))
 						{
-							newConts[j] = cset.conts[j];
-							// Reset source pointers to prevent data deletion.
-							cset.conts[j].verts = 0;
-							cset.conts[j].rverts = 0;
+							ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'conts' (%d).", maxContours);
+							return false;
 						}
-						rcFree(cset.conts);
-						cset.conts = newConts;
 						
 						ctx->log(RC_LOG_WARNING, "rcBuildContours: Expanding max contours from %d to %d.", oldMax, maxContours);
 					}
@@ -960,8 +987,7 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 					rcContour* cont = &cset.conts[cset.nconts++];
 					
 					cont->nverts = simplified.size()/4;
-					cont->verts = (int*)rcAlloc(sizeof(int)*cont->nverts*4, RC_ALLOC_PERM);
-					if (!cont->verts)
+					if (!reserveContourVerts(cont->verts, cont->maxVerts, cont->nverts))
 					{
 						ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'verts' (%d).", cont->nverts);
 						return false;
@@ -979,8 +1005,7 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 					}
 					
 					cont->nrverts = verts.size()/4;
-					cont->rverts = (int*)rcAlloc(sizeof(int)*cont->nrverts*4, RC_ALLOC_PERM);
-					if (!cont->rverts)
+					if (!reserveContourVerts(cont->rverts, cont->maxRverts, cont->nrverts))
 					{
 						ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'rverts' (%d).", cont->nrverts);
 						return false;
@@ -44,11 +44,17 @@
 static const int RC_MAX_LAYERS = RC_MAX_LAYERS_DEF;
 static const int RC_MAX_NEIS = RC_MAX_NEIS_DEF;
 
+// Region ids are bytes, so a set of them fits in 256 bits.
+static const int RC_REGION_SET_WORDS = 256/32;
+
 struct rcLayerRegion
 {
 	unsigned char layers[RC_MAX_LAYERS];
 	unsigned char neis[RC_MAX_NEIS];
+	unsigned int layerSet[RC_REGION_SET_WORDS];	// Bit set of the ids in 'layers'
+	unsigned int neiSet[RC_REGION_SET_WORDS];	// Bit set of the ids in 'neis'
 	unsigned short ymin, ymax;
+	unsigned short xmin, xmax, zmin, zmax;	// Cell bounds of the region.
 	unsigned char layerId;		// Layer ID
 	unsigned char nlayers;		// Layer count
 	unsigned char nneis;		// Neighbour count
@@ -56,20 +62,24 @@ struct rcLayerRegion
 };
 
 
-static bool contains(const unsigned char* a, const unsigned char an, const unsigned char v)
+static bool contains(const unsigned int* set, const unsigned char v)
+{
+	return (set[v >> 5] & (1u << (v & 31))) != 0;
+}
+
+static bool overlaps(const unsigned int* a, const unsigned int* b)
 {
-	const int n = (int)an;
-	for (int i = 0; i < n; ++i)
+	for (int i = 0; i < RC_REGION_SET_WORDS; ++i)
 	{
-		if (a[i] == v)
+		if (a[i] & b[i])
 			return true;
 	}
 	return false;
 }
 
-static bool addUnique(unsigned char* a, unsigned char& an, int anMax, unsigned char v)
+static bool addUnique(unsigned char* a, unsigned char& an, unsigned int* set, int anMax, unsigned char v)
 {
-	if (contains(a, an, v))
+	if (contains(set, v))
 		return true;
 
 	if ((int)an >= anMax)
@@ -77,6 +87,7 @@ static bool addUnique(unsigned char* a, unsigned char& an, int anMax, unsigned c
 
 	a[an] = v;
 	an++;
+	set[v >> 5] |= 1u << (v & 31);
 	return true;
 }
 
@@ -96,6 +107,119 @@ struct rcLayerSweepSpan
 	unsigned char nei;	// neighbour id
 };
 
+// Shared state of storeLayers().
+struct rcLayerStore
+{
+	const rcCompactHeightfield* chf;
+	const unsigned char* srcReg;
+	const rcLayerRegion* regs;
+	int borderSize;
+	const int (*cmin)[2];	// Cell bounds of each layer.
+	const int (*cmax)[2];
+	rcHeightfieldLayerSet* lset;
+};
+
+// Copies the height, area and connection data of the layers [begin, end) from the compact heightfield.
+static void storeLayers(void* userData, const int begin, const int end)
+{
+	const rcLayerStore& store = *(const rcLayerStore*)userData;
+	const rcCompactHeightfield& chf = *store.chf;
+	const unsigned char* srcReg = store.srcReg;
+	const rcLayerRegion* regs = store.regs;
+	const int w = chf.width;
+	const int borderSize = store.borderSize;
+	
+	for (int i = begin; i < end; ++i)
+	{
+		const unsigned char curId = (unsigned char)i;
+		rcHeightfieldLayer* layer = &store.lset->layers[i];
+		const int lw = layer->width;
+		const int lh = layer->height;
+		const int hmin = layer->hmin;
+
+		// Update usable data region.
+		layer->minx = layer->width;
+		layer->maxx = 0;
+		layer->miny = layer->height;
+		layer->maxy = 0;
+		
+		// Copy height and area from compact heightfield. 
+		const int x0 = rcMax(store.cmin[i][0] - borderSize, 0);
+		const int x1 = rcMin(store.cmax[i][0] - borderSize, lw-1);
+		const int y0 = rcMax(store.cmin[i][1] - borderSize, 0);
+		const int y1 = rcMin(store.cmax[i][1] - borderSize, lh-1);
+		for (int y = y0; y <= y1; ++y)
+		{
+			for (int x = x0; x <= x1; ++x)
+			{
+				const int cx = borderSize+x;
+				const int cy = borderSize+y;
+				const rcCompactCell& c = chf.cells[cx+cy*w];
+				for (int j = (int)c.index, nj = (int)(c.index+c.count); j < nj; ++j)
+				{
+					const rcCompactSpan& s = chf.spans[j];
+					// Skip unassigned regions.
+					if (srcReg[j] == 0xff)
+						continue;
+					// Skip of does nto belong to current layer.
+					unsigned char lid = regs[srcReg[j]].layerId;
+					if (lid != curId)
+						continue;
+					
+					// Update data bounds.
+					layer->minx = rcMin(layer->minx, x);
+					layer->maxx = rcMax(layer->maxx, x);
+					layer->miny = rcMin(layer->miny, y);
+					layer->maxy = rcMax(layer->maxy, y);
+					
+					// Store height and area type.
+					const int idx = x+y*lw;
+					layer->heights[idx] = (unsigned char)(s.y - hmin);
+					layer->areas[idx] = chf.areas[j];
+					
+					// Check connection.
+					unsigned char portal = 0;
+					unsigned char con = 0;
+					for (int dir = 0; dir < 4; ++dir)
+					{
+						if (rcGetCon(s, dir) != RC_NOT_CONNECTED)
+						{
+							const int ax = cx + rcGetDirOffsetX(dir);
+							const int ay = cy + rcGetDirOffsetY(dir);
+							const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
+							unsigned char alid = srcReg[ai] != 0xff ? regs[srcReg[ai]].layerId : 0xff;
+							// Portal mask
+							if (chf.areas[ai] != RC_NULL_AREA && lid != alid)
+							{
+								portal |= (unsigned char)(1<<dir);
+								// Update height so that it matches on both sides of the portal.
+								const rcCompactSpan& as = chf.spans[ai];
+								if (as.y > hmin)
+									layer->heights[idx] = rcMax(layer->heights[idx], (unsigned char)(as.y - hmin));
+							}
+							// Valid connection mask
+							if (chf.areas[ai] != RC_NULL_AREA && lid == alid)
+							{
+								const int nx = ax - borderSize;
+								const int ny = ay - borderSize;
+								if (nx >= 0 && ny >= 0 && nx < lw && ny < lh)
+									con |= (unsigned char)(1<<dir);
+							}
+						}
+					}
+					
+					layer->cons[idx] = (portal << 4) | con;
+				}
+			}
+		}
+		
+		if (layer->minx > layer->maxx)
+			layer->minx = layer->maxx = 0;
+		if (layer->miny > layer->maxy)
+			layer->miny = layer->maxy = 0;
+	}
+}
+
 /// @par
 /// 
 /// See the #rcConfig documentation for more information on the configuration parameters.
@@ -244,6 +368,8 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 		regs[i].layerId = 0xff;
 		regs[i].ymin = 0xffff;
 		regs[i].ymax = 0;
+		regs[i].xmin = regs[i].zmin = 0xffff;
+		regs[i].xmax = regs[i].zmax = 0;
 	}
 	
 	// Find region neighbours and overlapping regions.
@@ -264,6 +390,10 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 				
 				regs[ri].ymin = rcMin(regs[ri].ymin, s.y);
 				regs[ri].ymax = rcMax(regs[ri].ymax, s.y);
+				regs[ri].xmin = rcMin(regs[ri].xmin, (unsigned short)x);
+				regs[ri].xmax = rcMax(regs[ri].xmax, (unsigned short)x);
+				regs[ri].zmin = rcMin(regs[ri].zmin, (unsigned short)y);
+				regs[ri].zmax = rcMax(regs[ri].zmax, (unsigned short)y);
 				
 				// Collect all region layers.
 				if (nlregs < RC_MAX_LAYERS)
@@ -283,7 +413,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 							// Don't check return value -- if we cannot add the neighbor
 							// it will just cause a few more regions to be created, which
 							// is fine.
-							addUnique(regs[ri].neis, regs[ri].nneis, RC_MAX_NEIS, rai);
+							addUnique(regs[ri].neis, regs[ri].nneis, regs[ri].neiSet, RC_MAX_NEIS, rai);
 						}
 					}
 				}
@@ -300,8 +430,8 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 						rcLayerRegion& ri = regs[lregs[i]];
 						rcLayerRegion& rj = regs[lregs[j]];
 
-						if (!addUnique(ri.layers, ri.nlayers, RC_MAX_LAYERS, lregs[j]) ||
-							!addUnique(rj.layers, rj.nlayers, RC_MAX_LAYERS, lregs[i]))
+						if (!addUnique(ri.layers, ri.nlayers, ri.layerSet, RC_MAX_LAYERS, lregs[j]) ||
+							!addUnique(rj.layers, rj.nlayers, rj.layerSet, RC_MAX_LAYERS, lregs[i]))
 						{
 							ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: layer overflow (too many overlapping walkable platforms). Try increasing RC_MAX_LAYERS.");
 							return false;
@@ -316,8 +446,10 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 	// Create 2D layers from regions.
 	unsigned char layerId = 0;
 	
+	// The search queue holds at most MAX_STACK pending regions. Every region is queued
+	// at most once, so the queue is consumed from the front without shifting.
 	static const int MAX_STACK = 64;
-	unsigned char stack[MAX_STACK];
+	unsigned char stack[256];
 	int nstack = 0;
 	
 	for (int i = 0; i < nregs; ++i)
@@ -334,13 +466,10 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 		nstack = 0;
 		stack[nstack++] = (unsigned char)i;
 		
-		while (nstack)
+		for (int head = 0; head < nstack; ++head)
 		{
 			// Pop front
-			rcLayerRegion& reg = regs[stack[0]];
-			nstack--;
-			for (int j = 0; j < nstack; ++j)
-				stack[j] = stack[j+1];
+			rcLayerRegion& reg = regs[stack[head]];
 			
 			const int nneis = (int)reg.nneis;
 			for (int j = 0; j < nneis; ++j)
@@ -351,7 +480,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 				if (regn.layerId != 0xff)
 					continue;
 				// Skip if the neighbour is overlapping root region.
-				if (contains(root.layers, root.nlayers, nei))
+				if (contains(root.layerSet, nei))
 					continue;
 				// Skip if the height range would become too large.
 				const int ymin = rcMin(root.ymin, regn.ymin);
@@ -359,7 +488,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 				if ((ymax - ymin) >= 255)
 					 continue;
 
-				if (nstack < MAX_STACK)
+				if (nstack-head-1 < MAX_STACK)
 				{
 					// Deepen
 					stack[nstack++] = (unsigned char)nei;
@@ -369,7 +498,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 					// Merge current layers to root.
 					for (int k = 0; k < regn.nlayers; ++k)
 					{
-						if (!addUnique(root.layers, root.nlayers, RC_MAX_LAYERS, regn.layers[k]))
+						if (!addUnique(root.layers, root.nlayers, root.layerSet, RC_MAX_LAYERS, regn.layers[k]))
 						{
 							ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: layer overflow (too many overlapping walkable platforms). Try increasing RC_MAX_LAYERS.");
 							return false;
@@ -384,6 +513,12 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 		layerId++;
 	}
 	
+	// The regions belonging to each layer.
+	unsigned int layerRegs[256][RC_REGION_SET_WORDS];
+	memset(layerRegs, 0, sizeof(layerRegs));
+	for (int i = 0; i < nregs; ++i)
+		layerRegs[regs[i].layerId][i >> 5] |= 1u << (i & 31);
+	
 	// Merge non-overlapping regions that are close in height.
 	const unsigned short mergeHeight = (unsigned short)walkableHeight * 4;
 	
@@ -413,23 +548,10 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 				if ((ymax - ymin) >= 255)
 				  continue;
 						  
-				// Make sure that there is no overlap when merging 'ri' and 'rj'.
-				bool overlap = false;
-				// Iterate over all regions which have the same layerId as 'rj'
-				for (int k = 0; k < nregs; ++k)
-				{
-					if (regs[k].layerId != rj.layerId)
-						continue;
-					// Check if region 'k' is overlapping region 'ri'
-					// Index to 'regs' is the same as region id.
-					if (contains(ri.layers,ri.nlayers, (unsigned char)k))
-					{
-						overlap = true;
-						break;
-					}
-				}
-				// Cannot merge of regions overlap.
-				if (overlap)
+				// Make sure that there is no overlap when merging 'ri' and 'rj',
+				// none of the regions with the same layerId as 'rj' may overlap 'ri'.
+				// Index to 'regs' is the same as region id.
+				if (overlaps(layerRegs[rj.layerId], ri.layerSet))
 					continue;
 				
 				// Can merge i and j.
@@ -445,15 +567,16 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 			for (int j = 0; j < nregs; ++j)
 			{
 				rcLayerRegion& rj = regs[j];
-				if (rj.layerId == oldId)
+				if (contains(layerRegs[oldId], (unsigned char)j))
 				{
 					rj.base = 0;
 					// Remap layerIds.
 					rj.layerId = newId;
+					layerRegs[newId][j >> 5] |= 1u << (j & 31);
 					// Add overlaid layers from 'rj' to 'ri'.
 					for (int k = 0; k < rj.nlayers; ++k)
 					{
-						if (!addUnique(ri.layers, ri.nlayers, RC_MAX_LAYERS, rj.layers[k]))
+						if (!addUnique(ri.layers, ri.nlayers, ri.layerSet, RC_MAX_LAYERS, rj.layers[k]))
 						{
 							ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: layer overflow (too many overlapping walkable platforms). Try increasing RC_MAX_LAYERS.");
 							return false;
@@ -465,6 +588,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 					ri.ymax = rcMax(ri.ymax, rj.ymax);
 				}
 			}
+			memset(layerRegs[oldId], 0, sizeof(layerRegs[oldId]));
 		}
 	}
 	
@@ -517,11 +641,32 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 	memset(lset.layers, 0, sizeof(rcHeightfieldLayer)*lset.nlayers);
 
 	
-	// Store layers.
+	// Find the height and cell bounds of each layer.
+	int hmin[256], hmax[256];
+	int cmin[256][2], cmax[256][2];
+	for (int i = 0; i < lset.nlayers; ++i)
+	{
+		hmin[i] = hmax[i] = 0;
+		cmin[i][0] = cmin[i][1] = 0xffff;
+		cmax[i][0] = cmax[i][1] = -1;
+	}
+	for (int j = 0; j < nregs; ++j)
+	{
+		const rcLayerRegion& reg = regs[j];
+		if (reg.base)
+		{
+			hmin[reg.layerId] = (int)reg.ymin;
+			hmax[reg.layerId] = (int)reg.ymax;
+		}
+		cmin[reg.layerId][0] = rcMin(cmin[reg.layerId][0], (int)reg.xmin);
+		cmin[reg.layerId][1] = rcMin(cmin[reg.layerId][1], (int)reg.zmin);
+		cmax[reg.layerId][0] = rcMax(cmax[reg.layerId][0], (int)reg.xmax);
+		cmax[reg.layerId][1] = rcMax(cmax[reg.layerId][1], (int)reg.zmax);
+	}
+	
+	// Allocate layers.
 	for (int i = 0; i < lset.nlayers; ++i)
 	{
-		unsigned char curId = (unsigned char)i;
-
 		rcHeightfieldLayer* layer = &lset.layers[i];
 
 		const int gridSize = sizeof(unsigned char)*lw*lh;
@@ -550,17 +695,6 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 		}
 		memset(layer->cons, 0, gridSize);
 		
-		// Find layer height bounds.
-		int hmin = 0, hmax = 0;
-		for (int j = 0; j < nregs; ++j)
-		{
-			if (regs[j].base && regs[j].layerId == curId)
-			{
-				hmin = (int)regs[j].ymin;
-				hmax = (int)regs[j].ymax;
-			}
-		}
-
 		layer->width = lw;
 		layer->height = lh;
 		layer->cs = chf.cs;
@@ -569,88 +703,23 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 		// Adjust the bbox to fit the heightfield.
 		rcVcopy(layer->bmin, bmin);
 		rcVcopy(layer->bmax, bmax);
-		layer->bmin[1] = bmin[1] + hmin*chf.ch;
-		layer->bmax[1] = bmin[1] + hmax*chf.ch;
-		layer->hmin = hmin;
-		layer->hmax = hmax;
-
-		// Update usable data region.
-		layer->minx = layer->width;
-		layer->maxx = 0;
-		layer->miny = layer->height;
-		layer->maxy = 0;
-		
-		// Copy height and area from compact heightfield. 
-		for (int y = 0; y < lh; ++y)
-		{
-			for (int x = 0; x < lw; ++x)
-			{
-				const int cx = borderSize+x;
-				const int cy = borderSize+y;
-				const rcCompactCell& c = chf.cells[cx+cy*w];
-				for (int j = (int)c.index, nj = (int)(c.index+c.count); j < nj; ++j)
-				{
-					const rcCompactSpan& s = chf.spans[j];
-					// Skip unassigned regions.
-					if (srcReg[j] == 0xff)
-						continue;
-					// Skip of does nto belong to current layer.
-					unsigned char lid = regs[srcReg[j]].layerId;
-					if (lid != curId)
-						continue;
-					
-					// Update data bounds.
-					layer->minx = rcMin(layer->minx, x);
-					layer->maxx = rcMax(layer->maxx, x);
-					layer->miny = rcMin(layer->miny, y);
-					layer->maxy = rcMax(layer->maxy, y);
-					
-					// Store height and area type.
-					const int idx = x+y*lw;
-					layer->heights[idx] = (unsigned char)(s.y - hmin);
-					layer->areas[idx] = chf.areas[j];
-					
-					// Check connection.
-					unsigned char portal = 0;
-					unsigned char con = 0;
-					for (int dir = 0; dir < 4; ++dir)
-					{
-						if (rcGetCon(s, dir) != RC_NOT_CONNECTED)
-						{
-							const int ax = cx + rcGetDirOffsetX(dir);
-							const int ay = cy + rcGetDirOffsetY(dir);
-							const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
-							unsigned char alid = srcReg[ai] != 0xff ? regs[srcReg[ai]].layerId : 0xff;
-							// Portal mask
-							if (chf.areas[ai] != RC_NULL_AREA && lid != alid)
-							{
-								portal |= (unsigned char)(1<<dir);
-								// Update height so that it matches on both sides of the portal.
-								const rcCompactSpan& as = chf.spans[ai];
-								if (as.y > hmin)
-									layer->heights[idx] = rcMax(layer->heights[idx], (unsigned char)(as.y - hmin));
-							}
-							// Valid connection mask
-							if (chf.areas[ai] != RC_NULL_AREA && lid == alid)
-							{
-								const int nx = ax - borderSize;
-								const int ny = ay - borderSize;
-								if (nx >= 0 && ny >= 0 && nx < lw && ny < lh)
-									con |= (unsigned char)(1<<dir);
-							}
-						}
-					}
-					
-					layer->cons[idx] = (portal << 4) | con;
-				}
-			}
-		}
-		
-		if (layer->minx > layer->maxx)
-			layer->minx = layer->maxx = 0;
-		if (layer->miny > layer->maxy)
-			layer->miny = layer->maxy = 0;
+		layer->bmin[1] = bmin[1] + hmin[i]*chf.ch;
+		layer->bmax[1] = bmin[1] + hmax[i]*chf.ch;
+		layer->hmin = hmin[i];
+		layer->hmax = hmax[i];
 	}
 	
+	// Store layers. The layers are independent of each other once the region
+	// graph is settled, and each one only needs to visit the cells its regions cover.
+	rcLayerStore store;
+	store.chf = &chf;
+	store.srcReg = srcReg;
+	store.regs = regs;
+	store.borderSize = borderSize;
+	store.cmin = cmin;
+	store.cmax = cmax;
+	store.lset = &lset;
+	ctx->parallelFor(lset.nlayers, storeLayers, &store);
+	
 	return true;
 }
@@ -560,16 +560,115 @@ static void pushBack(int v, int* arr, int& an)
 	an++;
 }
 
-static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short rem)
+/// Maps each vertex to the polygons that use it, so that removing a vertex only
+/// visits its own polygons.  Kept up to date as polygons are removed, moved and added.
+struct rcVertPolyIndex
+{
+	int* first;				///< The first entry of each vertex. [Size: maxVerts]
+	int* next;				///< The next entry of the same vertex. [Size: maxEntries]
+	int* poly;				///< The polygon of each entry. [Size: maxEntries]
+	int freeList;			///< The first unused entry.
+};
+
+static void addPolyToIndex(rcVertPolyIndex& index, const unsigned short* p, const int nvp, const int poly)
+{
+	const int nv = countPolyVerts(p, nvp);
+	for (int j = 0; j < nv; ++j)
+	{
+		const int e = index.freeList;
+		rcAssert(e != -1);
+		index.freeList = index.next[e];
+		index.poly[e] = poly;
+		index.next[e] = index.first[p[j]];
+		index.first[p[j]] = e;
+	}
+}
+
+static void removePolyFromIndex(rcVertPolyIndex& index, const unsigned short* p, const int nvp, const int poly)
+{
+	const int nv = countPolyVerts(p, nvp);
+	for (int j = 0; j < nv; ++j)
+	{
+		for (int* link = &index.first[p[j]]; *link != -1; link = &index.next[*link])
+		{
+			const int e = *link;
+			if (index.poly[e] == poly)
+			{
+				*link = index.next[e];
+				index.next[e] = index.freeList;
+				index.freeList = e;
+				break;
+			}
+		}
+	}
+}
+
+static void movePolyInIndex(rcVertPolyIndex& index, const unsigned short* p, const int nvp, const int from, const int to)
+{
+	const int nv = countPolyVerts(p, nvp);
+	for (int j = 0; j < nv; ++j)
+	{
+		for (int e = index.first[p[j]]; e != -1; e = index.next[e])
+		{
+			if (index.poly[e] == from)
+			{
+				index.poly[e] = to;
+				break;
+			}
+		}
+	}
+}
+
+/// Stores the polygons using a vertex in ascending order, and returns their count.
+static int getVertexPolys(const rcVertPolyIndex& index, const unsigned short vert, int* polys, const int maxPolys)
+{
+	int n = 0;
+	for (int e = index.first[vert]; e != -1; e = index.next[e])
+	{
+		const int poly = index.poly[e];
+		// Insertion sort, skipping polygons that use the vertex more than once.
+		int k = n;
+		while (k > 0 && polys[k-1] > poly)
+			k--;
+		if (k > 0 && polys[k-1] == poly)
+			continue;
+		if (n >= maxPolys)
+			break;
+		for (int m = n; m > k; --m)
+			polys[m] = polys[m-1];
+		polys[k] = poly;
+		n++;
+	}
+	return n;
+}
+
+static int countVertexPolys(const rcVertPolyIndex& index, const unsigned short vert)
+{
+	int n = 0;
+	for (int e = index.first[vert]; e != -1; e = index.next[e])
+		n++;
+	return n;
+}
+
+static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const rcVertPolyIndex& index, const unsigned short rem)
 {
 	const int nvp = mesh.nvp;
 	
+	const int maxPolys = countVertexPolys(index, rem);
+	rcScopedDelete<int> touched((int*)rcAlloc(sizeof(int)*rcMax(maxPolys, 1), RC_ALLOC_TEMP));
+	if (!touched)
+	{
+		ctx->log(RC_LOG_WARNING, "canRemoveVertex: Out of memory 'touched' (%d).", maxPolys);
+		return false;
+	}
+	const int ntouched = getVertexPolys(index, rem, touched, maxPolys);
+	
 	// Count number of polygons to remove.
 	int numTouchedVerts = 0;
 	int numRemainingEdges = 0;
-	for (int i = 0; i < mesh.npolys; ++i)
+	for (int i = 0; i < ntouched; ++i)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
+		unsigned short* p = &mesh.polys[touched[i]*nvp*2];
 		const int nv = countPolyVerts(p, nvp);
 		int numRemoved = 0;
 		int numVerts = 0;
@@ -605,9 +704,9 @@ static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned sho
 		return false;
 	}
 		
-	for (int i = 0; i < mesh.npolys; ++i)
+	for (int i = 0; i < ntouched; ++i)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
+		unsigned short* p = &mesh.polys[touched[i]*nvp*2];
 		const int nv = countPolyVerts(p, nvp);
 
 		// Collect edges which touches the removed vertex.
@@ -660,15 +759,29 @@ static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned sho
 	return true;
 }
 
-static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short rem, const int maxTris)
+/// Removes a vertex and re-triangulates the hole left by its polygons.
+///
+/// The vertex is left in mesh.verts, unused, so that the indices of the other
+/// vertices do not change.  The caller compacts the vertices once all the
+/// vertices have been removed.
+static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, rcVertPolyIndex& index, const unsigned short rem, const int maxTris)
 {
 	const int nvp = mesh.nvp;
 
+	const int maxPolys = countVertexPolys(index, rem);
+	rcScopedDelete<int> touched((int*)rcAlloc(sizeof(int)*rcMax(maxPolys, 1), RC_ALLOC_TEMP));
+	if (!touched)
+	{
+		ctx->log(RC_LOG_WARNING, "removeVertex: Out of memory 'touched' (%d).", maxPolys);
+		return false;
+	}
+	int ntouched = getVertexPolys(index, rem, touched, maxPolys);
+
 	// Count number of polygons to remove.
 	int numRemovedVerts = 0;
-	for (int i = 0; i < mesh.npolys; ++i)
+	for (int i = 0; i < ntouched; ++i)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
+		unsigned short* p = &mesh.polys[touched[i]*nvp*2];
 		const int nv = countPolyVerts(p, nvp);
 		for (int j = 0; j < nv; ++j)
 		{
@@ -709,61 +822,50 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 		return false;
 	}
 	
-	for (int i = 0; i < mesh.npolys; ++i)
+	// Remove the polygons in the order a scan over all the polygons would, each one
+	// replaced by the last polygon, so the resulting mesh does not depend on the index.
+	while (ntouched > 0)
 	{
+		const int i = touched[0];
+		for (int k = 1; k < ntouched; ++k)
+			touched[k-1] = touched[k];
+		ntouched--;
+		
 		unsigned short* p = &mesh.polys[i*nvp*2];
 		const int nv = countPolyVerts(p, nvp);
-		bool hasRem = false;
-		for (int j = 0; j < nv; ++j)
-			if (p[j] == rem) hasRem = true;
-		if (hasRem)
+		// Collect edges which does not touch the removed vertex.
+		for (int j = 0, k = nv-1; j < nv; k = j++)
 		{
-			// Collect edges which does not touch the removed vertex.
-			for (int j = 0, k = nv-1; j < nv; k = j++)
+			if (p[j] != rem && p[k] != rem)
 			{
-				if (p[j] != rem && p[k] != rem)
-				{
-					int* e = &edges[nedges*4];
-					e[0] = p[k];
-					e[1] = p[j];
-					e[2] = mesh.regs[i];
-					e[3] = mesh.areas[i];
-					nedges++;
-				}
+				int* e = &edges[nedges*4];
+				e[0] = p[k];
+				e[1] = p[j];
+				e[2] = mesh.regs[i];
+				e[3] = mesh.areas[i];
+				nedges++;
 			}
-			// Remove the polygon.
-			unsigned short* p2 = &mesh.polys[(mesh.npolys-1)*nvp*2];
-			if (p != p2)
-				memcpy(p,p2,sizeof(unsigned short)*nvp);
-			memset(p+nvp,0xff,sizeof(unsigned short)*nvp);
-			mesh.regs[i] = mesh.regs[mesh.npolys-1];
-			mesh.areas[i] = mesh.areas[mesh.npolys-1];
-			mesh.npolys--;
-			--i;
 		}
-	}
-	
-	// Remove vertex.
-	for (int i = (int)rem; i < mesh.nverts - 1; ++i)
-	{
-		mesh.verts[i*3+0] = mesh.verts[(i+1)*3+0];
-		mesh.verts[i*3+1] = mesh.verts[(i+1)*3+1];
-		mesh.verts[i*3+2] = mesh.verts[(i+1)*3+2];
-	}
-	mesh.nverts--;
-
-	// Adjust indices to match the removed vertex layout.
-	for (int i = 0; i < mesh.npolys; ++i)
-	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
-		const int nv = countPolyVerts(p, nvp);
-		for (int j = 0; j < nv; ++j)
-			if (p[j] > rem) p[j]--;
-	}
-	for (int i = 0; i < nedges; ++i)
-	{
-		if (edges[i*4+0] > rem) edges[i*4+0]--;
-		if (edges[i*4+1] > rem) edges[i*4+1]--;
+		// Remove the polygon.
+		removePolyFromIndex(index, p, nvp, i);
+		const int last = mesh.npolys-1;
+		unsigned short* p2 = &mesh.polys[last*nvp*2];
+		if (p != p2)
+		{
+			memcpy(p,p2,sizeof(unsigned short)*nvp);
+			movePolyInIndex(index, p, nvp, last, i);
+			// If the moved polygon uses the vertex too, it is removed next, from its new place.
+			if (ntouched > 0 && touched[ntouched-1] == last)
+			{
+				for (int k = ntouched-1; k > 0; --k)
+					touched[k] = touched[k-1];
+				touched[0] = i;
+			}
+		}
+		memset(p+nvp,0xff,sizeof(unsigned short)*nvp);
+		mesh.regs[i] = mesh.regs[last];
+		mesh.areas[i] = mesh.areas[last];
+		mesh.npolys--;
 	}
 
 	if (nedges == 0)
@@ -967,6 +1069,7 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 		memset(p,0xff,sizeof(unsigned short)*nvp*2);
 		for (int j = 0; j < nvp; ++j)
 			p[j] = polys[i*nvp+j];
+		addPolyToIndex(index, p, nvp, mesh.npolys);
 		mesh.regs[mesh.npolys] = pregs[i];
 		mesh.areas[mesh.npolys] = pareas[i];
 		mesh.npolys++;
@@ -1025,40 +1128,65 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 	}
 	memset(vflags, 0, maxVertices);
 	
-	mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertices*3, RC_ALLOC_PERM);
-	if (!mesh.verts)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.verts' (%d).", maxVertices);
-		return false;
-	}
-	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris*nvp*2, RC_ALLOC_PERM);
-	if (!mesh.polys)
+	// A mesh that was already used keeps its arrays when they are large enough.
+	if (maxVertices > mesh.maxverts || !mesh.verts)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.polys' (%d).", maxTris*nvp*2);
-		return false;
-	}
-	mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris, RC_ALLOC_PERM);
-	if (!mesh.regs)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.regs' (%d).", maxTris);
-		return false;
-	}
-	mesh.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxTris, RC_ALLOC_PERM);
-	if (!mesh.areas)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.areas' (%d).", maxTris);
-		return false;
+		rcFree(mesh.verts);
+		mesh.maxverts = 0;
+		mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertices*3, RC_ALLOC_PERM);
+		if (!mesh.verts)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.verts' (%d).", maxVertices);
+			return false;
+		}
+		mesh.maxverts = maxVertices;
+	}
+	if (maxTris > mesh.maxpolys || nvp != mesh.nvp || !mesh.polys || !mesh.regs || !mesh.areas || !mesh.flags)
+	{
+		rcFree(mesh.polys);
+		rcFree(mesh.regs);
+		rcFree(mesh.areas);
+		rcFree(mesh.flags);
+		mesh.regs = 0;
+		mesh.areas = 0;
+		mesh.flags = 0;
+		mesh.maxpolys = 0;
+		mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris*nvp*2, RC_ALLOC_PERM);
+		if (!mesh.polys)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.polys' (%d).", maxTris*nvp*2);
+			return false;
+		}
+		mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris, RC_ALLOC_PERM);
+		if (!mesh.regs)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.regs' (%d).", maxTris);
+			return false;
+		}
+		mesh.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxTris, RC_ALLOC_PERM);
+		if (!mesh.areas)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.areas' (%d).", maxTris);
+			return false;
+		}
+		// The flags are filled in by the user.
+		mesh.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris, RC_ALLOC_PERM);
+		if (!mesh.flags)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.flags' (%d).", maxTris);
+			return false;
+		}
+		mesh.maxpolys = maxTris;
 	}
 	
 	mesh.nverts = 0;
 	mesh.npolys = 0;
 	mesh.nvp = nvp;
-	mesh.maxpolys = maxTris;
 	
 	memset(mesh.verts, 0, sizeof(unsigned short)*maxVertices*3);
-	memset(mesh.polys, 0xff, sizeof(unsigned short)*maxTris*nvp*2);
-	memset(mesh.regs, 0, sizeof(unsigned short)*maxTris);
-	memset(mesh.areas, 0, sizeof(unsigned char)*maxTris);
+	memset(mesh.polys, 0xff, sizeof(unsigned short)*mesh.maxpolys*nvp*2);
+	memset(mesh.regs, 0, sizeof(unsigned short)*mesh.maxpolys);
+	memset(mesh.areas, 0, sizeof(unsigned char)*mesh.maxpolys);
 	
 	rcScopedDelete<int> nextVert((int*)rcAlloc(sizeof(int)*maxVertices, RC_ALLOC_TEMP));
 	if (!nextVert)
@@ -1224,25 +1352,77 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 	
 	
 	// Remove edge vertices.
-	for (int i = 0; i < mesh.nverts; ++i)
-	{
-		if (vflags[i])
+	bool hasEdgeVerts = false;
+	for (int i = 0; i < mesh.nverts && !hasEdgeVerts; ++i)
+		hasEdgeVerts = vflags[i] != 0;
+	if (hasEdgeVerts)
+	{
+		// Index the polygons of each vertex, so removing a vertex does not scan the whole mesh.
+		const int maxEntries = maxTris*nvp;
+		rcScopedDelete<int> indexFirst((int*)rcAlloc(sizeof(int)*mesh.nverts, RC_ALLOC_TEMP));
+		rcScopedDelete<int> indexNext((int*)rcAlloc(sizeof(int)*maxEntries, RC_ALLOC_TEMP));
+		rcScopedDelete<int> indexPoly((int*)rcAlloc(sizeof(int)*maxEntries, RC_ALLOC_TEMP));
+		if (!indexFirst || !indexNext || !indexPoly)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'index' (%d).", maxEntries);
+			return false;
+		}
+		rcVertPolyIndex index;
+		index.first = indexFirst;
+		index.next = indexNext;
+		index.poly = indexPoly;
+		for (int i = 0; i < mesh.nverts; ++i)
+			index.first[i] = -1;
+		for (int i = 0; i < maxEntries; ++i)
+			index.next[i] = i+1 < maxEntries ? i+1 : -1;
+		index.freeList = 0;
+		for (int i = 0; i < mesh.npolys; ++i)
+			addPolyToIndex(index, &mesh.polys[i*nvp*2], nvp, i);
+		
+		// The removed vertices keep their place until all of them are removed.
+		for (int i = 0; i < mesh.nverts; ++i)
 		{
-			if (!canRemoveVertex(ctx, mesh, (unsigned short)i))
+			if (!vflags[i])
+				continue;
+			vflags[i] = 0;
+			if (!canRemoveVertex(ctx, mesh, index, (unsigned short)i))
 				continue;
-			if (!removeVertex(ctx, mesh, (unsigned short)i, maxTris))
+			if (!removeVertex(ctx, mesh, index, (unsigned short)i, maxTris))
 			{
 				// Failed to remove vertex
 				ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Failed to remove edge vertex %d.", i);
 				return false;
 			}
-			// Remove vertex
-			// Note: mesh.nverts is already decremented inside removeVertex()!
-			// Fixup vertex flags
-			for (int j = i; j < mesh.nverts; ++j)
-				vflags[j] = vflags[j+1];
-			--i;
+			vflags[i] = 1;
 		}
+		
+		// Compact the vertices, and remap the polygons to the new vertex indices.
+		int* remap = indexFirst;
+		int nverts = 0;
+		for (int i = 0; i < mesh.nverts; ++i)
+		{
+			if (vflags[i])
+			{
+				remap[i] = -1;
+				continue;
+			}
+			remap[i] = nverts;
+			if (nverts != i)
+			{
+				mesh.verts[nverts*3+0] = mesh.verts[i*3+0];
+				mesh.verts[nverts*3+1] = mesh.verts[i*3+1];
+				mesh.verts[nverts*3+2] = mesh.verts[i*3+2];
+			}
+			nverts++;
+		}
+		for (int i = 0; i < mesh.npolys; ++i)
+		{
+			unsigned short* p = &mesh.polys[i*nvp*2];
+			const int nv = countPolyVerts(p, nvp);
+			for (int j = 0; j < nv; ++j)
+				p[j] = (unsigned short)remap[p[j]];
+		}
+		mesh.nverts = nverts;
 	}
 	
 	// Calculate adjacency.
@@ -1283,13 +1463,7 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		}
 	}
 
-	// Just allocate the mesh flags array. The user is resposible to fill it.
-	mesh.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*mesh.npolys, RC_ALLOC_PERM);
-	if (!mesh.flags)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.flags' (%d).", mesh.npolys);
-		return false;
-	}
+	// Just clear the mesh flags array. The user is resposible to fill it.
 	memset(mesh.flags, 0, sizeof(unsigned short) * mesh.npolys);
 	
 	if (mesh.nverts > 0xffff)
@@ -1339,6 +1513,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.verts' (%d).", maxVerts*3);
 		return false;
 	}
+	mesh.maxverts = maxVerts;
 
 	mesh.npolys = 0;
 	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys*2*mesh.nvp, RC_ALLOC_PERM);
@@ -1497,6 +1672,7 @@ bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst)
 	dst.nverts = src.nverts;
 	dst.npolys = src.npolys;
 	dst.maxpolys = src.npolys;
+	dst.maxverts = src.nverts;
 	dst.nvp = src.nvp;
 	rcVcopy(dst.bmin, src.bmin);
 	rcVcopy(dst.bmax, src.bmax);
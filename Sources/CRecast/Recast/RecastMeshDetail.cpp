@@ -1175,6 +1175,11 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 	
 	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESHDETAIL);
 	
+	// A reused mesh must not keep the previous build's contents.
+	dmesh.nmeshes = 0;
+	dmesh.nverts = 0;
+	dmesh.ntris = 0;
+	
 	if (mesh.nverts == 0 || mesh.npolys == 0)
 		return true;
 	
@@ -1245,33 +1250,51 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		return false;
 	}
 	
-	dmesh.nmeshes = mesh.npolys;
-	dmesh.nverts = 0;
-	dmesh.ntris = 0;
-	dmesh.meshes = (unsigned int*)rcAlloc(sizeof(unsigned int)*dmesh.nmeshes*4, RC_ALLOC_PERM);
-	if (!dmesh.meshes)
+	// Arrays left over from a previous build are kept when they are large enough.
+	if (mesh.npolys > dmesh.maxmeshes || !dmesh.meshes)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.meshes' (%d).", dmesh.nmeshes*4);
-		return false;
+		rcFree(dmesh.meshes);
+		dmesh.maxmeshes = 0;
+		dmesh.meshes = (unsigned int*)rcAlloc(sizeof(unsigned int)*mesh.npolys*4, RC_ALLOC_PERM);
+		if (!dmesh.meshes)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.meshes' (%d).", mesh.npolys*4);
+			return false;
+		}
+		dmesh.maxmeshes = mesh.npolys;
 	}
+	dmesh.nmeshes = mesh.npolys;
 	
 	int vcap = nPolyVerts+nPolyVerts/2;
 	int tcap = vcap*2;
 	
-	dmesh.nverts = 0;
-	dmesh.verts = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_PERM);
-	if (!dmesh.verts)
+	if (vcap > dmesh.maxverts || !dmesh.verts)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", vcap*3);
-		return false;
+		rcFree(dmesh.verts);
+		dmesh.maxverts = 0;
+		dmesh.verts = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_PERM);
+		if (!dmesh.verts)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", vcap*3);
+			return false;
+		}
+		dmesh.maxverts = vcap;
 	}
-	dmesh.ntris = 0;
-	dmesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*tcap*4, RC_ALLOC_PERM);
-	if (!dmesh.tris)
+	vcap = dmesh.maxverts;
+	
+	if (tcap > dmesh.maxtris || !dmesh.tris)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.tris' (%d).", tcap*4);
-		return false;
+		rcFree(dmesh.tris);
+		dmesh.maxtris = 0;
+		dmesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*tcap*4, RC_ALLOC_PERM);
+		if (!dmesh.tris)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.tris' (%d).", tcap*4);
+			return false;
+		}
+		dmesh.maxtris = tcap;
 	}
+	tcap = dmesh.maxtris;
 	
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
@@ -1346,6 +1369,7 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 				memcpy(newv, dmesh.verts, sizeof(float)*3*dmesh.nverts);
 			rcFree(dmesh.verts);
 			dmesh.verts = newv;
+			dmesh.maxverts = vcap;
 		}
 		for (int j = 0; j < nverts; ++j)
 		{
@@ -1370,6 +1394,7 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 				memcpy(newt, dmesh.tris, sizeof(unsigned char)*4*dmesh.ntris);
 			rcFree(dmesh.tris);
 			dmesh.tris = newt;
+			dmesh.maxtris = tcap;
 		}
 		for (int j = 0; j < ntris; ++j)
 		{
@@ -1427,6 +1452,9 @@ bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", maxVerts*3);
 		return false;
 	}
+	mesh.maxmeshes = maxMeshes;
+	mesh.maxverts = maxVerts;
+	mesh.maxtris = maxTris;
 	
 	// Merge datas.
 	for (int i = 0; i < nmeshes; ++i)
@@ -16,7 +16,9 @@
 // 3. This notice may not be removed or altered from any source distribution.
 //
 
+#include <float.h>
 #include <math.h>
+#include <stdlib.h>
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
@@ -553,3 +555,675 @@ bool rcRasterizeTriangles(rcContext* context,
 
 	return true;
 }
+
+/// Returns the world space height interval of a primitive along the vertical line through (x, z).
+///
+/// @param[in]	shape	The primitive
+/// @param[in]	x		The x coordinate of the line
+/// @param[in]	z		The z coordinate of the line
+/// @param[out]	ymin	The bottom of the interval
+/// @param[out]	ymax	The top of the interval
+/// @param[out]	topNormalY	The y component of the unit normal of the primitive surface at the top of the interval
+/// @returns true if the line intersects the primitive.
+typedef bool (*rcColumnIntervalFunc)(const void* shape, const float x, const float z, float& ymin, float& ymax, float& topNormalY);
+
+/// Adds the span covering a world space height interval to a column of the heightfield.
+///
+/// The interval is clamped to the heightfield bounding box and snapped to the height grid
+/// the same way as the spans of rasterized triangles.
+static bool addColumnSpan(rcHeightfield& heightfield, const int x, const int z,
+                          float spanMin, float spanMax,
+                          const unsigned char areaID, const float inverseCellHeight, const int flagMergeThreshold)
+{
+	const float by = heightfield.bmax[1] - heightfield.bmin[1];
+	spanMin -= heightfield.bmin[1];
+	spanMax -= heightfield.bmin[1];
+
+	// Skip the span if it's completely outside the heightfield bounding box
+	if (spanMax < 0.0f || spanMin > by)
+	{
+		return true;
+	}
+	spanMin = rcMax(spanMin, 0.0f);
+	spanMax = rcMin(spanMax, by);
+
+	unsigned short spanMinCellIndex = (unsigned short)rcClamp((int)floorf(spanMin * inverseCellHeight), 0, RC_SPAN_MAX_HEIGHT);
+	unsigned short spanMaxCellIndex = (unsigned short)rcClamp((int)ceilf(spanMax * inverseCellHeight), (int)spanMinCellIndex + 1, RC_SPAN_MAX_HEIGHT);
+
+	return addSpan(heightfield, x, z, spanMinCellIndex, spanMaxCellIndex, areaID, flagMergeThreshold);
+}
+
+/// Adds a span to every column whose center is within the footprint of a primitive.
+///
+/// Like rcMarkWalkableTriangles does for triangles, the spans whose top surface is steeper
+/// than the walkable slope get #RC_NULL_AREA.
+///
+/// @param[in,out]	heightfield			The heightfield
+/// @param[in]		shapeMin			The min extents of the bounding box of the primitive
+/// @param[in]		shapeMax			The max extents of the bounding box of the primitive
+/// @param[in]		interval			Returns the height interval of the primitive at a column center
+/// @param[in]		shape				The primitive passed to @p interval
+/// @param[in]		walkableThr			The cosine of the walkable slope angle
+/// @param[in]		areaID				The area ID to assign to the walkable spans
+/// @param[in]		flagMergeThreshold	The threshold in which area flags will be merged
+/// @returns true if the operation completes successfully.  false if there was an error adding spans to the heightfield.
+static bool rasterizeColumns(rcHeightfield& heightfield, const float* shapeMin, const float* shapeMax,
+                             rcColumnIntervalFunc interval, const void* shape,
+                             const float walkableThr, const unsigned char areaID, const int flagMergeThreshold)
+{
+	if (!overlapBounds(shapeMin, shapeMax, heightfield.bmin, heightfield.bmax))
+	{
+		return true;
+	}
+
+	const float cellSize = heightfield.cs;
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+
+	// The columns whose center is inside the bounds.
+	const int x0 = rcMax((int)ceilf((shapeMin[0] - heightfield.bmin[0]) * inverseCellSize - 0.5f), 0);
+	const int x1 = rcMin((int)floorf((shapeMax[0] - heightfield.bmin[0]) * inverseCellSize - 0.5f), heightfield.width - 1);
+	const int z0 = rcMax((int)ceilf((shapeMin[2] - heightfield.bmin[2]) * inverseCellSize - 0.5f), 0);
+	const int z1 = rcMin((int)floorf((shapeMax[2] - heightfield.bmin[2]) * inverseCellSize - 0.5f), heightfield.height - 1);
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		const float cz = heightfield.bmin[2] + ((float)z + 0.5f) * cellSize;
+		for (int x = x0; x <= x1; ++x)
+		{
+			const float cx = heightfield.bmin[0] + ((float)x + 0.5f) * cellSize;
+			float ymin, ymax, topNormalY;
+			if (!interval(shape, cx, cz, ymin, ymax, topNormalY))
+			{
+				continue;
+			}
+			const unsigned char area = topNormalY > walkableThr ? areaID : RC_NULL_AREA;
+			if (!addColumnSpan(heightfield, x, z, ymin, ymax, area, inverseCellHeight, flagMergeThreshold))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+struct rcConvexShape
+{
+	const float* planes;
+	int numPlanes;
+	float ymin, ymax;
+};
+
+static bool convexInterval(const void* shape, const float x, const float z, float& ymin, float& ymax, float& topNormalY)
+{
+	const rcConvexShape* convex = (const rcConvexShape*)shape;
+	ymin = convex->ymin;
+	ymax = convex->ymax;
+	// Capped by the bounds until a plane is lower.
+	topNormalY = 1.0f;
+	for (int i = 0; i < convex->numPlanes; ++i)
+	{
+		const float* plane = &convex->planes[i * 4];
+		const float s = plane[0] * x + plane[2] * z + plane[3];
+		if (rcAbs(plane[1]) < 1e-6f)
+		{
+			// A vertical plane, the column is either all inside or all outside.
+			if (s > 0.0f)
+			{
+				return false;
+			}
+			continue;
+		}
+		const float y = -s / plane[1];
+		if (plane[1] > 0.0f)
+		{
+			if (y < ymax)
+			{
+				ymax = y;
+				topNormalY = plane[1] / rcSqrt(rcSqr(plane[0]) + rcSqr(plane[1]) + rcSqr(plane[2]));
+			}
+		}
+		else
+		{
+			ymin = rcMax(ymin, y);
+		}
+	}
+	return ymin <= ymax;
+}
+
+static bool rasterizeConvex(rcHeightfield& heightfield, const float* planes, const int numPlanes,
+                            const float* shapeMin, const float* shapeMax, const float walkableSlopeAngle,
+                            const unsigned char areaID, const int flagMergeThreshold)
+{
+	rcConvexShape convex;
+	convex.planes = planes;
+	convex.numPlanes = numPlanes;
+	convex.ymin = shapeMin[1];
+	convex.ymax = shapeMax[1];
+	const float walkableThr = cosf(walkableSlopeAngle / 180.0f * RC_PI);
+	return rasterizeColumns(heightfield, shapeMin, shapeMax, convexInterval, &convex, walkableThr, areaID, flagMergeThreshold);
+}
+
+bool rcRasterizeConvex(rcContext* context, const float* planes, const int numPlanes,
+                       const float* shapeMin, const float* shapeMax, const float walkableSlopeAngle,
+                       const unsigned char areaID, rcHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_PRIMITIVES);
+
+	if (!rasterizeConvex(heightfield, planes, numPlanes, shapeMin, shapeMax, walkableSlopeAngle, areaID, flagMergeThreshold))
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeConvex: Out of memory.");
+		return false;
+	}
+
+	return true;
+}
+
+bool rcRasterizeBox(rcContext* context, const float* center, const float* halfExtents, const float* axes,
+                    const float walkableSlopeAngle, const unsigned char areaID, rcHeightfield& heightfield,
+                    const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_PRIMITIVES);
+
+	static const float worldAxes[9] = { 1, 0, 0,  0, 1, 0,  0, 0, 1 };
+	if (axes == NULL)
+	{
+		axes = worldAxes;
+	}
+
+	// A pair of opposite planes per axis, and the bounds of the corners.
+	float planes[6 * 4];
+	float boxMin[3];
+	float boxMax[3];
+	rcVcopy(boxMin, center);
+	rcVcopy(boxMax, center);
+	for (int i = 0; i < 3; ++i)
+	{
+		const float* axis = &axes[i * 3];
+		const float d = rcVdot(axis, center);
+		float* front = &planes[i * 8];
+		float* back = &planes[i * 8 + 4];
+		rcVcopy(front, axis);
+		front[3] = -(d + halfExtents[i]);
+		back[0] = -axis[0];
+		back[1] = -axis[1];
+		back[2] = -axis[2];
+		back[3] = d - halfExtents[i];
+		for (int k = 0; k < 3; ++k)
+		{
+			const float e = rcAbs(axis[k]) * halfExtents[i];
+			boxMin[k] -= e;
+			boxMax[k] += e;
+		}
+	}
+
+	if (!rasterizeConvex(heightfield, planes, 6, boxMin, boxMax, walkableSlopeAngle, areaID, flagMergeThreshold))
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeBox: Out of memory.");
+		return false;
+	}
+
+	return true;
+}
+
+struct rcSphereShape
+{
+	const float* center;
+	float radius;
+};
+
+static bool sphereInterval(const void* shape, const float x, const float z, float& ymin, float& ymax, float& topNormalY)
+{
+	const rcSphereShape* sphere = (const rcSphereShape*)shape;
+	const float distSqr = rcSqr(x - sphere->center[0]) + rcSqr(z - sphere->center[2]);
+	const float radiusSqr = rcSqr(sphere->radius);
+	if (distSqr > radiusSqr)
+	{
+		return false;
+	}
+	const float h = rcSqrt(radiusSqr - distSqr);
+	ymin = sphere->center[1] - h;
+	ymax = sphere->center[1] + h;
+	topNormalY = sphere->radius > 0.0f ? h / sphere->radius : 1.0f;
+	return true;
+}
+
+bool rcRasterizeSphere(rcContext* context, const float* center, const float radius, const float walkableSlopeAngle,
+                       const unsigned char areaID, rcHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_PRIMITIVES);
+
+	rcSphereShape sphere;
+	sphere.center = center;
+	sphere.radius = radius;
+	const float sphereMin[3] = { center[0] - radius, center[1] - radius, center[2] - radius };
+	const float sphereMax[3] = { center[0] + radius, center[1] + radius, center[2] + radius };
+	const float walkableThr = cosf(walkableSlopeAngle / 180.0f * RC_PI);
+	if (!rasterizeColumns(heightfield, sphereMin, sphereMax, sphereInterval, &sphere, walkableThr, areaID, flagMergeThreshold))
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeSphere: Out of memory.");
+		return false;
+	}
+
+	return true;
+}
+
+struct rcCylinderShape
+{
+	const float* position;
+	float radius;
+	float height;
+};
+
+static bool cylinderInterval(const void* shape, const float x, const float z, float& ymin, float& ymax, float& topNormalY)
+{
+	const rcCylinderShape* cylinder = (const rcCylinderShape*)shape;
+	const float distSqr = rcSqr(x - cylinder->position[0]) + rcSqr(z - cylinder->position[2]);
+	if (distSqr > rcSqr(cylinder->radius))
+	{
+		return false;
+	}
+	ymin = cylinder->position[1];
+	ymax = cylinder->position[1] + cylinder->height;
+	topNormalY = 1.0f;
+	return true;
+}
+
+bool rcRasterizeCylinder(rcContext* context, const float* position, const float radius, const float height,
+                         const unsigned char areaID, rcHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_PRIMITIVES);
+
+	rcCylinderShape cylinder;
+	cylinder.position = position;
+	cylinder.radius = radius;
+	cylinder.height = height;
+	const float cylinderMin[3] = { position[0] - radius, position[1], position[2] - radius };
+	const float cylinderMax[3] = { position[0] + radius, position[1] + height, position[2] + radius };
+	// The top of the cylinder is flat, so all of it is walkable.
+	if (!rasterizeColumns(heightfield, cylinderMin, cylinderMax, cylinderInterval, &cylinder, -1.0f, areaID, flagMergeThreshold))
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeCylinder: Out of memory.");
+		return false;
+	}
+
+	return true;
+}
+
+struct rcCapsuleShape
+{
+	const float* start;
+	const float* end;
+	float radius;
+};
+
+static bool capsuleInterval(const void* shape, const float x, const float z, float& ymin, float& ymax, float& topNormalY)
+{
+	const rcCapsuleShape* capsule = (const rcCapsuleShape*)shape;
+	const float* a = capsule->start;
+	const float* b = capsule->end;
+	const float radiusSqr = rcSqr(capsule->radius);
+
+	// The capsule is convex, so the line crosses it in a single interval, which is
+	// the union of where it crosses the end spheres and the cylinder between them.
+	ymin = FLT_MAX;
+	ymax = -FLT_MAX;
+	rcSphereShape sphere;
+	sphere.radius = capsule->radius;
+	float sphereMin, sphereMax, sphereNormalY;
+	sphere.center = a;
+	if (sphereInterval(&sphere, x, z, sphereMin, sphereMax, sphereNormalY))
+	{
+		ymin = rcMin(ymin, sphereMin);
+		ymax = rcMax(ymax, sphereMax);
+	}
+	sphere.center = b;
+	if (sphereInterval(&sphere, x, z, sphereMin, sphereMax, sphereNormalY))
+	{
+		ymin = rcMin(ymin, sphereMin);
+		ymax = rcMax(ymax, sphereMax);
+	}
+
+	// With u the height above a, the squared distance of the line from the axis is
+	// quadratic in u, and the position along the axis t = (k + u*dy) / |d|^2 is linear.
+	float d[3];
+	rcVsub(d, b, a);
+	const float lenSqr = rcVdot(d, d);
+	if (lenSqr > 1e-6f)
+	{
+		const float ex = x - a[0];
+		const float ez = z - a[2];
+		const float k = ex * d[0] + ez * d[2];
+		const float qa = lenSqr - rcSqr(d[1]);
+		const float qb = -2.0f * k * d[1];
+		const float qc = lenSqr * (ex * ex + ez * ez) - k * k - radiusSqr * lenSqr;
+
+		float umin = -FLT_MAX;
+		float umax = FLT_MAX;
+		bool inside = true;
+		if (qa <= 1e-6f * lenSqr)
+		{
+			// A vertical axis, the distance does not depend on the height.
+			inside = qc <= 0.0f;
+		}
+		else
+		{
+			const float disc = qb * qb - 4.0f * qa * qc;
+			if (disc < 0.0f)
+			{
+				inside = false;
+			}
+			else
+			{
+				const float s = rcSqrt(disc);
+				umin = (-qb - s) / (2.0f * qa);
+				umax = (-qb + s) / (2.0f * qa);
+			}
+		}
+
+		if (inside)
+		{
+			if (rcAbs(d[1]) > 1e-6f)
+			{
+				const float u0 = -k / d[1];
+				const float u1 = (lenSqr - k) / d[1];
+				umin = rcMax(umin, rcMin(u0, u1));
+				umax = rcMin(umax, rcMax(u0, u1));
+			}
+			else if (k < 0.0f || k > lenSqr)
+			{
+				inside = false;
+			}
+		}
+
+		if (inside && umin <= umax)
+		{
+			ymin = rcMin(ymin, a[1] + umin);
+			ymax = rcMax(ymax, a[1] + umax);
+		}
+	}
+
+	if (ymin > ymax)
+	{
+		return false;
+	}
+
+	// The surface of the capsule is at the radius from the axis, so the normal at the top
+	// points from the closest point of the axis.
+	float t = 0.0f;
+	if (lenSqr > 1e-6f)
+	{
+		const float e[3] = { x - a[0], ymax - a[1], z - a[2] };
+		t = rcClamp(rcVdot(e, d) / lenSqr, 0.0f, 1.0f);
+	}
+	const float axisY = a[1] + d[1] * t;
+	topNormalY = capsule->radius > 0.0f ? rcClamp((ymax - axisY) / capsule->radius, -1.0f, 1.0f) : 1.0f;
+	return true;
+}
+
+bool rcRasterizeCapsule(rcContext* context, const float* start, const float* end, const float radius,
+                        const float walkableSlopeAngle, const unsigned char areaID, rcHeightfield& heightfield,
+                        const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_PRIMITIVES);
+
+	rcCapsuleShape capsule;
+	capsule.start = start;
+	capsule.end = end;
+	capsule.radius = radius;
+	float capsuleMin[3];
+	float capsuleMax[3];
+	rcVcopy(capsuleMin, start);
+	rcVmin(capsuleMin, end);
+	rcVcopy(capsuleMax, start);
+	rcVmax(capsuleMax, end);
+	for (int i = 0; i < 3; ++i)
+	{
+		capsuleMin[i] -= radius;
+		capsuleMax[i] += radius;
+	}
+	const float walkableThr = cosf(walkableSlopeAngle / 180.0f * RC_PI);
+	if (!rasterizeColumns(heightfield, capsuleMin, capsuleMax, capsuleInterval, &capsule, walkableThr, areaID, flagMergeThreshold))
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeCapsule: Out of memory.");
+		return false;
+	}
+
+	return true;
+}
+
+/// A point sample snapped to a heightfield cell.
+struct rcPointSample
+{
+	int column;				///< The index of the column, x + z * width.
+	unsigned short height;	///< The height of the cell. [Units: vx]
+	unsigned char area;		///< The area of the point.
+};
+
+static int comparePointSamples(const void* va, const void* vb)
+{
+	const rcPointSample* a = (const rcPointSample*)va;
+	const rcPointSample* b = (const rcPointSample*)vb;
+	if (a->column != b->column)
+	{
+		return a->column < b->column ? -1 : 1;
+	}
+	if (a->height != b->height)
+	{
+		return a->height < b->height ? -1 : 1;
+	}
+	return (int)a->area - (int)b->area;
+}
+
+/// Snaps a point, and its splat, to the cells it touches.
+///
+/// @param[in]		heightfield		The heightfield
+/// @param[in]		point			The point. [(x, y, z)]
+/// @param[in]		normal			The unit normal of the surface at the point, or null. [(x, y, z)] [opt]
+/// @param[in]		walkableThr		The cosine of the walkable slope angle
+/// @param[in]		areaID			The area of the point when it is walkable
+/// @param[in]		radiusSqr		The squared splat radius
+/// @param[in]		reach			The number of columns the splat covers on each side of the point
+/// @param[out]		samples			Receives the samples of the point, or null to only count them. [opt]
+/// @returns The number of samples of the point.
+static int splatPoint(const rcHeightfield& heightfield, const float* point, const float* normal,
+                      const float walkableThr, const unsigned char areaID, const float radiusSqr, const int reach,
+                      rcPointSample* samples)
+{
+	const int w = heightfield.width;
+	const int h = heightfield.height;
+	const float cellSize = heightfield.cs;
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+	const float by = heightfield.bmax[1] - heightfield.bmin[1];
+
+	const bool walkable = normal == NULL || normal[1] > walkableThr;
+	const unsigned char area = walkable ? areaID : RC_NULL_AREA;
+
+	const int px = (int)floorf((point[0] - heightfield.bmin[0]) * inverseCellSize);
+	const int pz = (int)floorf((point[2] - heightfield.bmin[2]) * inverseCellSize);
+	int numSamples = 0;
+	for (int z = rcMax(pz - reach, 0); z <= rcMin(pz + reach, h - 1); ++z)
+	{
+		for (int x = rcMax(px - reach, 0); x <= rcMin(px + reach, w - 1); ++x)
+		{
+			float y = point[1];
+			if (x != px || z != pz)
+			{
+				const float dx = heightfield.bmin[0] + ((float)x + 0.5f) * cellSize - point[0];
+				const float dz = heightfield.bmin[2] + ((float)z + 0.5f) * cellSize - point[2];
+				if (dx * dx + dz * dz > radiusSqr)
+				{
+					continue;
+				}
+				// Follow the plane of walkable points, so that sloped ground stays continuous.
+				if (normal != NULL && walkable)
+				{
+					y -= (normal[0] * dx + normal[2] * dz) / normal[1];
+				}
+			}
+
+			y -= heightfield.bmin[1];
+			if (y < 0.0f || y > by)
+			{
+				continue;
+			}
+
+			if (samples != NULL)
+			{
+				rcPointSample& sample = samples[numSamples];
+				sample.column = x + z * w;
+				sample.height = (unsigned short)rcClamp((int)floorf(y * inverseCellHeight), 0, RC_SPAN_MAX_HEIGHT - 1);
+				sample.area = area;
+			}
+			numSamples++;
+		}
+	}
+	return numSamples;
+}
+
+bool rcRasterizePoints(rcContext* context, const float* points, const float* normals, const int numPoints,
+                       const float walkableSlopeAngle, const float splatRadius, const unsigned char areaID,
+                       const int maxGap, rcHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_POINTS);
+
+	if (numPoints <= 0)
+	{
+		return true;
+	}
+
+	const int w = heightfield.width;
+	const float walkableThr = cosf(walkableSlopeAngle / 180.0f * RC_PI);
+	const float radiusSqr = rcSqr(splatRadius);
+	// A splat never needs to reach past the heightfield.
+	const float maxReach = (float)rcMax(heightfield.width, heightfield.height);
+	const int reach = splatRadius > 0.0f ? (int)ceilf(rcMin(splatRadius * (1.0f / heightfield.cs), maxReach)) : 0;
+
+	// Size the samples from the cells the splats actually cover, rather than from the square
+	// around each point, which is mostly empty for the points near the edges or outside.
+	const size_t maxSamples = (size_t)RC_SIZE_MAX / sizeof(rcPointSample);
+	size_t numSamples = 0;
+	for (int i = 0; i < numPoints; ++i)
+	{
+		numSamples += (size_t)splatPoint(heightfield, &points[i * 3], normals ? &normals[i * 3] : NULL,
+		                                 walkableThr, areaID, radiusSqr, reach, NULL);
+		if (numSamples > maxSamples)
+		{
+			context->log(RC_LOG_ERROR, "rcRasterizePoints: Too many samples, split the points.");
+			return false;
+		}
+	}
+	if (numSamples == 0)
+	{
+		return true;
+	}
+
+	rcScopedDelete<rcPointSample> samples((rcPointSample*)rcAlloc(sizeof(rcPointSample) * numSamples, RC_ALLOC_TEMP));
+	if (!samples)
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizePoints: Out of memory 'samples' (%llu).", (unsigned long long)numSamples);
+		return false;
+	}
+
+	size_t sampleIndex = 0;
+	for (int i = 0; i < numPoints; ++i)
+	{
+		sampleIndex += (size_t)splatPoint(heightfield, &points[i * 3], normals ? &normals[i * 3] : NULL,
+		                                  walkableThr, areaID, radiusSqr, reach, &samples[sampleIndex]);
+	}
+	rcAssert(sampleIndex == numSamples);
+
+	qsort(samples, numSamples, sizeof(rcPointSample), comparePointSamples);
+
+	// Accumulate the samples of each column into spans, closing the gaps of up to maxGap cells,
+	// and give each span the area of its highest sample.
+	size_t i = 0;
+	while (i < numSamples)
+	{
+		const int column = samples[i].column;
+		const int spanMin = samples[i].height;
+		int spanMax = samples[i].height;
+		unsigned char area = samples[i].area;
+		for (++i; i < numSamples; ++i)
+		{
+			const rcPointSample& sample = samples[i];
+			if (sample.column != column || (int)sample.height > spanMax + 1 + maxGap)
+			{
+				break;
+			}
+			if ((int)sample.height > spanMax)
+			{
+				spanMax = sample.height;
+				area = sample.area;
+			}
+			else
+			{
+				area = rcMax(area, sample.area);
+			}
+		}
+
+		if (!addSpan(heightfield, column % w, column / w, (unsigned short)spanMin, (unsigned short)(spanMax + 1), area, flagMergeThreshold))
+		{
+			context->log(RC_LOG_ERROR, "rcRasterizePoints: Out of memory.");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void rcClearSpans(rcContext* context, const float* boxMinBounds, const float* boxMaxBounds, rcHeightfield& heightfield)
+{
+	rcAssert(context != NULL);
+
+	if (!overlapBounds(boxMinBounds, boxMaxBounds, heightfield.bmin, heightfield.bmax))
+	{
+		return;
+	}
+
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+
+	// The columns whose center is inside the box.
+	const int x0 = rcMax((int)ceilf((boxMinBounds[0] - heightfield.bmin[0]) * inverseCellSize - 0.5f), 0);
+	const int x1 = rcMin((int)floorf((boxMaxBounds[0] - heightfield.bmin[0]) * inverseCellSize - 0.5f), heightfield.width - 1);
+	const int z0 = rcMax((int)ceilf((boxMinBounds[2] - heightfield.bmin[2]) * inverseCellSize - 0.5f), 0);
+	const int z1 = rcMin((int)floorf((boxMaxBounds[2] - heightfield.bmin[2]) * inverseCellSize - 0.5f), heightfield.height - 1);
+	const int minY = (int)floorf((boxMinBounds[1] - heightfield.bmin[1]) * inverseCellHeight);
+	const int maxY = (int)ceilf((boxMaxBounds[1] - heightfield.bmin[1]) * inverseCellHeight);
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			rcSpan** link = &heightfield.spans[x + z * heightfield.width];
+			while (*link != NULL)
+			{
+				rcSpan* span = *link;
+				if ((int)span->smax >= minY && (int)span->smin <= maxY)
+				{
+					*link = span->next;
+					freeSpan(heightfield, span);
+				}
+				else
+				{
+					link = &span->next;
+				}
+			}
+		}
+	}
+}
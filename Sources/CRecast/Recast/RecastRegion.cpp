@@ -562,8 +562,9 @@ static void removeAdjacentNeighbours(rcRegion& reg)
 	}
 }
 
-static void replaceNeighbour(rcRegion& reg, unsigned short oldId, unsigned short newId)
+static bool replaceNeighbour(rcRegion& reg, unsigned short oldId, unsigned short newId)
 {
+	bool floorChanged = false;
 	bool neiChanged = false;
 	for (int i = 0; i < reg.connections.size(); ++i)
 	{
@@ -576,10 +577,26 @@ static void replaceNeighbour(rcRegion& reg, unsigned short oldId, unsigned short
 	for (int i = 0; i < reg.floors.size(); ++i)
 	{
 		if (reg.floors[i] == oldId)
+		{
 			reg.floors[i] = newId;
+			floorChanged = true;
+		}
 	}
 	if (neiChanged)
 		removeAdjacentNeighbours(reg);
+	return neiChanged || floorChanged;
+}
+
+// Records that region @p ri refers to each of the region ids in @p ids.
+static void addRegionReferrer(rcTempVector<rcIntArray>& referrers, const rcIntArray& ids, int ri)
+{
+	const int nreg = (int)referrers.size();
+	for (int i = 0; i < ids.size(); ++i)
+	{
+		const int id = ids[i];
+		if (id > 0 && id < nreg)
+			referrers[id].push(ri);
+	}
 }
 
 static bool canMergeWithRegion(const rcRegion& rega, const rcRegion& regb)
@@ -604,7 +621,8 @@ static bool canMergeWithRegion(const rcRegion& rega, const rcRegion& regb)
 
 static void addUniqueFloorRegion(rcRegion& reg, int n)
 {
-	for (int i = 0; i < reg.floors.size(); ++i)
+	// Scan from the back, neighbouring cells usually repeat the most recent floors.
+	for (int i = reg.floors.size()-1; i >= 0; --i)
 		if (reg.floors[i] == n)
 			return;
 	reg.floors.push(n);
@@ -785,6 +803,37 @@ static void walkContour(int x, int y, int i, int dir,
 }
 
 
+// Renumbers the live regions so that their ids are consecutive, in the order the ids are
+// first seen. Region ids always refer to a region at the same or a later index, so a single
+// pass with a lookup table gives the same numbering as relabeling every id one at a time.
+static bool compressRegionIds(rcContext* ctx, rcTempVector<rcRegion>& regions, unsigned short& maxRegionId)
+{
+	const int nreg = (int)regions.size();
+	rcTempVector<unsigned short> newIds;
+	if (!newIds.reserve(nreg))
+	{
+		ctx->log(RC_LOG_ERROR, "compressRegionIds: Out of memory 'newIds' (%d).", nreg);
+		return false;
+	}
+	newIds.resize(nreg, 0);
+	
+	unsigned short regIdGen = 0;
+	for (int i = 0; i < nreg; ++i)
+	{
+		rcRegion& reg = regions[i];
+		reg.remap = false;
+		if (reg.id == 0) continue;				// Skip nil regions.
+		if (reg.id & RC_BORDER_REG) continue;	// Skip external regions.
+		rcAssert(reg.id < nreg);
+		if (newIds[reg.id] == 0)
+			newIds[reg.id] = ++regIdGen;
+		reg.id = newIds[reg.id];
+	}
+	maxRegionId = regIdGen;
+	
+	return true;
+}
+
 static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRegionSize,
 								  unsigned short& maxRegionId,
 								  rcCompactHeightfield& chf,
@@ -924,6 +973,28 @@ static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRe
 		}
 	}
 	
+	// For each region id, the regions that carry it as their id, and the regions that may
+	// refer to it in their connections or floors. Merging only has to fix up those instead
+	// of every region.
+	rcTempVector<rcIntArray> members;
+	rcTempVector<rcIntArray> referrers;
+	if (!members.reserve(nreg) || !referrers.reserve(nreg))
+	{
+		ctx->log(RC_LOG_ERROR, "mergeAndFilterRegions: Out of memory 'referrers' (%d).", nreg);
+		return false;
+	}
+	members.resize(nreg);
+	referrers.resize(nreg);
+	for (int i = 0; i < nreg; ++i)
+	{
+		const rcRegion& reg = regions[i];
+		if (reg.id == 0 || (reg.id & RC_BORDER_REG))
+			continue;
+		members[reg.id].push(i);
+		addRegionReferrer(referrers, reg.connections, i);
+		addRegionReferrer(referrers, reg.floors, i);
+	}
+
 	// Merge too small regions to neighbour regions.
 	int mergeCount = 0 ;
 	do
@@ -967,21 +1038,37 @@ static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRe
 				unsigned short oldId = reg.id;
 				rcRegion& target = regions[mergeId];
 				
+				// The target takes over the neighbours and floors of the current region.
+				addRegionReferrer(referrers, reg.connections, mergeId);
+				addRegionReferrer(referrers, reg.floors, mergeId);
+				
 				// Merge neighbours.
 				if (mergeRegions(target, reg))
 				{
-					// Fixup regions pointing to current region.
-					for (int j = 0; j < nreg; ++j)
+					// Fixup regions pointing to current region. Each fixup only touches
+					// its own region, so visiting a region twice is harmless.
+					for (int pass = 0; pass < 2; ++pass)
 					{
-						if (regions[j].id == 0 || (regions[j].id & RC_BORDER_REG)) continue;
-						// If another region was already merged into current region
-						// change the nid of the previous region too.
-						if (regions[j].id == oldId)
-							regions[j].id = mergeId;
-						// Replace the current region with the new one if the
-						// current regions is neighbour.
-						replaceNeighbour(regions[j], oldId, mergeId);
+						const rcIntArray& fixup = pass == 0 ? members[oldId] : referrers[oldId];
+						for (int k = 0; k < fixup.size(); ++k)
+						{
+							const int j = fixup[k];
+							if (regions[j].id == 0 || (regions[j].id & RC_BORDER_REG)) continue;
+							// If another region was already merged into current region
+							// change the nid of the previous region too.
+							if (regions[j].id == oldId)
+							{
+								regions[j].id = mergeId;
+								members[mergeId].push(j);
+							}
+							// Replace the current region with the new one if the
+							// current regions is neighbour.
+							if (replaceNeighbour(regions[j], oldId, mergeId))
+								referrers[mergeId].push(j);
+						}
 					}
+					members[oldId].clear();
+					referrers[oldId].clear();
 					mergeCount++;
 				}
 			}
@@ -990,31 +1077,8 @@ static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRe
 	while (mergeCount > 0);
 	
 	// Compress region Ids.
-	for (int i = 0; i < nreg; ++i)
-	{
-		regions[i].remap = false;
-		if (regions[i].id == 0) continue;       // Skip nil regions.
-		if (regions[i].id & RC_BORDER_REG) continue;    // Skip external regions.
-		regions[i].remap = true;
-	}
-	
-	unsigned short regIdGen = 0;
-	for (int i = 0; i < nreg; ++i)
-	{
-		if (!regions[i].remap)
-			continue;
-		unsigned short oldId = regions[i].id;
-		unsigned short newId = ++regIdGen;
-		for (int j = i; j < nreg; ++j)
-		{
-			if (regions[j].id == oldId)
-			{
-				regions[j].id = newId;
-				regions[j].remap = false;
-			}
-		}
-	}
-	maxRegionId = regIdGen;
+	if (!compressRegionIds(ctx, regions, maxRegionId))
+		return false;
 	
 	// Remap regions.
 	for (int i = 0; i < chf.spanCount; ++i)
@@ -1034,7 +1098,7 @@ static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRe
 
 static void addUniqueConnection(rcRegion& reg, int n)
 {
-	for (int i = 0; i < reg.connections.size(); ++i)
+	for (int i = reg.connections.size()-1; i >= 0; --i)
 		if (reg.connections[i] == n)
 			return;
 	reg.connections.push(n);
@@ -1126,6 +1190,16 @@ static bool mergeAndFilterLayerRegions(rcContext* ctx, int minRegionArea,
 	for (int i = 0; i < nreg; ++i)
 		regions[i].id = 0;
 
+	// Marks the regions in the floors of the root currently being grown,
+	// so the overlap tests below do not need to scan the root's floors.
+	rcTempVector<int> floorRoot;
+	if (!floorRoot.reserve(nreg))
+	{
+		ctx->log(RC_LOG_ERROR, "mergeAndFilterLayerRegions: Out of memory 'floorRoot' (%d).", nreg);
+		return false;
+	}
+	floorRoot.resize(nreg, 0);
+
 	// Merge montone regions to create non-overlapping areas.
 	rcIntArray stack(32);
 	for (int i = 1; i < nreg; ++i)
@@ -1137,17 +1211,16 @@ static bool mergeAndFilterLayerRegions(rcContext* ctx, int minRegionArea,
 		
 		// Start search.
 		root.id = layerId;
+		for (int k = 0; k < root.floors.size(); ++k)
+			floorRoot[root.floors[k]] = i;
 
 		stack.clear();
 		stack.push(i);
 		
-		while (stack.size() > 0)
+		for (int head = 0; head < stack.size(); ++head)
 		{
 			// Pop front
-			rcRegion& reg = regions[stack[0]];
-			for (int j = 0; j < stack.size()-1; ++j)
-				stack[j] = stack[j+1];
-			stack.resize(stack.size()-1);
+			rcRegion& reg = regions[stack[head]];
 			
 			const int ncons = (int)reg.connections.size();
 			for (int j = 0; j < ncons; ++j)
@@ -1158,16 +1231,7 @@ static bool mergeAndFilterLayerRegions(rcContext* ctx, int minRegionArea,
 				if (regn.id != 0)
 					continue;
 				// Skip if the neighbour is overlapping root region.
-				bool overlap = false;
-				for (int k = 0; k < root.floors.size(); k++)
-				{
-					if (root.floors[k] == nei)
-					{
-						overlap = true;
-						break;
-					}
-				}
-				if (overlap)
+				if (floorRoot[nei] == i)
 					continue;
 					
 				// Deepen
@@ -1177,7 +1241,14 @@ static bool mergeAndFilterLayerRegions(rcContext* ctx, int minRegionArea,
 				regn.id = layerId;
 				// Merge current layers to root.
 				for (int k = 0; k < regn.floors.size(); ++k)
-					addUniqueFloorRegion(root, regn.floors[k]);
+				{
+					const int floor = regn.floors[k];
+					if (floorRoot[floor] != i)
+					{
+						floorRoot[floor] = i;
+						root.floors.push(floor);
+					}
+				}
 				root.ymin = rcMin(root.ymin, regn.ymin);
 				root.ymax = rcMax(root.ymax, regn.ymax);
 				root.spanCount += regn.spanCount;
@@ -1190,43 +1261,27 @@ static bool mergeAndFilterLayerRegions(rcContext* ctx, int minRegionArea,
 	}
 	
 	// Remove small regions
-	for (int i = 0; i < nreg; ++i)
+	rcTempVector<unsigned char> removeLayer;
+	if (!removeLayer.reserve(layerId))
 	{
-		if (regions[i].spanCount > 0 && regions[i].spanCount < minRegionArea && !regions[i].connectsToBorder)
-		{
-			unsigned short reg = regions[i].id;
-			for (int j = 0; j < nreg; ++j)
-				if (regions[j].id == reg)
-					regions[j].id = 0;
-		}
+		ctx->log(RC_LOG_ERROR, "mergeAndFilterLayerRegions: Out of memory 'removeLayer' (%d).", (int)layerId);
+		return false;
 	}
-	
-	// Compress region Ids.
+	removeLayer.resize(layerId, 0);
 	for (int i = 0; i < nreg; ++i)
 	{
-		regions[i].remap = false;
-		if (regions[i].id == 0) continue;				// Skip nil regions.
-		if (regions[i].id & RC_BORDER_REG) continue;    // Skip external regions.
-		regions[i].remap = true;
+		if (regions[i].spanCount > 0 && regions[i].spanCount < minRegionArea && !regions[i].connectsToBorder)
+			removeLayer[regions[i].id] = 1;
 	}
-	
-	unsigned short regIdGen = 0;
 	for (int i = 0; i < nreg; ++i)
 	{
-		if (!regions[i].remap)
-			continue;
-		unsigned short oldId = regions[i].id;
-		unsigned short newId = ++regIdGen;
-		for (int j = i; j < nreg; ++j)
-		{
-			if (regions[j].id == oldId)
-			{
-				regions[j].id = newId;
-				regions[j].remap = false;
-			}
-		}
+		if (removeLayer[regions[i].id])
+			regions[i].id = 0;
 	}
-	maxRegionId = regIdGen;
+	
+	// Compress region Ids.
+	if (!compressRegionIds(ctx, regions, maxRegionId))
+		return false;
 	
 	// Remap regions.
 	for (int i = 0; i < chf.spanCount; ++i)
@@ -1320,86 +1375,40 @@ static void paintRectRegion(int minx, int maxx, int miny, int maxy, unsigned sho
 }
 
 
-static const unsigned short RC_NULL_NEI = 0xffff;
-
-struct rcSweepSpan
+// A run of connected spans in one row of the monotone sweep.
+struct rcSweepRun
 {
-	unsigned short rid;	// row id
+	int nei;			// index of the run in the previous row this one continues, or one of RC_SWEEP_*
+	int ns;				// number of samples connected to nei
+	int prev;			// number of samples in the next row connected to this run
 	unsigned short id;	// region id
-	unsigned short ns;	// number samples
-	unsigned short nei;	// neighbour id
 };
 
-/// @par
-/// 
-/// Non-null regions will consist of connected, non-overlapping walkable spans that form a single contour.
-/// Contours will form simple polygons.
-/// 
-/// If multiple regions form an area that is smaller than @p minRegionArea, then all spans will be
-/// re-assigned to the zero (null) region.
-/// 
-/// Partitioning can result in smaller than necessary regions. @p mergeRegionArea helps 
-/// reduce unnecessarily small regions.
-/// 
-/// See the #rcConfig documentation for more information on the configuration parameters.
-/// 
-/// The region data will be available via the rcCompactHeightfield::maxRegions
-/// and rcCompactSpan::reg fields.
-/// 
-/// @warning The distance field must be created using #rcBuildDistanceField before attempting to build regions.
-/// 
-/// @see rcCompactHeightfield, rcCompactSpan, rcBuildDistanceField, rcBuildRegionsMonotone, rcConfig
-bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
-							const int borderSize, const int minRegionArea, const int mergeRegionArea)
-{
-	rcAssert(ctx);
-	
-	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
-	
-	const int w = chf.width;
-	const int h = chf.height;
-	unsigned short id = 1;
-	
-	rcScopedDelete<unsigned short> srcReg((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP));
-	if (!srcReg)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildRegionsMonotone: Out of memory 'src' (%d).", chf.spanCount);
-		return false;
-	}
-	memset(srcReg,0,sizeof(unsigned short)*chf.spanCount);
+static const int RC_SWEEP_NO_NEI = -1;
+static const int RC_SWEEP_NULL_NEI = -2;
 
-	const int nsweeps = rcMax(chf.width,chf.height);
-	rcScopedDelete<rcSweepSpan> sweeps((rcSweepSpan*)rcAlloc(sizeof(rcSweepSpan)*nsweeps, RC_ALLOC_TEMP));
-	if (!sweeps)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildRegionsMonotone: Out of memory 'sweeps' (%d).", nsweeps);
-		return false;
-	}
-	
-	
-	// Mark border regions.
-	if (borderSize > 0)
-	{
-		// Make sure border will not overflow.
-		const int bw = rcMin(w, borderSize);
-		const int bh = rcMin(h, borderSize);
-		// Paint regions
-		paintRectRegion(0, bw, 0, h, id|RC_BORDER_REG, chf, srcReg); id++;
-		paintRectRegion(w-bw, w, 0, h, id|RC_BORDER_REG, chf, srcReg); id++;
-		paintRectRegion(0, w, 0, bh, id|RC_BORDER_REG, chf, srcReg); id++;
-		paintRectRegion(0, w, h-bh, h, id|RC_BORDER_REG, chf, srcReg); id++;
-	}
+// Shared state of the row passes of sweepMonotoneRegions().
+struct rcSweepRows
+{
+	const rcCompactHeightfield* chf;
+	unsigned short* srcReg;
+	int borderSize;
+	int* rowRuns;		// number of runs per row, then the index of the first run of each row
+	rcSweepRun* runs;
+};
 
-	chf.borderSize = borderSize;
+// Labels the spans of each row with a row-local run id using the -x connections only.
+static void sweepRowRuns(void* userData, const int begin, const int end)
+{
+	rcSweepRows& sweep = *(rcSweepRows*)userData;
+	const rcCompactHeightfield& chf = *sweep.chf;
+	unsigned short* srcReg = sweep.srcReg;
+	const int w = chf.width;
+	const int borderSize = sweep.borderSize;
 	
-	rcIntArray prev(256);
-
-	// Sweep one line at a time.
-	for (int y = borderSize; y < h-borderSize; ++y)
+	for (int row = begin; row < end; ++row)
 	{
-		// Collect spans from this row.
-		prev.resize(id+1);
-		memset(&prev[0],0,sizeof(int)*id);
+		const int y = borderSize + row;
 		unsigned short rid = 1;
 		
 		for (int x = borderSize; x < w-borderSize; ++x)
@@ -1423,13 +1432,52 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 				}
 				
 				if (!previd)
-				{
 					previd = rid++;
-					sweeps[previd].rid = previd;
-					sweeps[previd].ns = 0;
-					sweeps[previd].nei = 0;
-				}
+				
+				srcReg[i] = previd;
+			}
+		}
+		
+		sweep.rowRuns[row] = rid-1;
+	}
+}
 
+// Links each run to the run it continues in the previous row using the -y connections.
+// Only the task owning row y touches the 'prev' counters of row y-1.
+static void sweepRowLinks(void* userData, const int begin, const int end)
+{
+	rcSweepRows& sweep = *(rcSweepRows*)userData;
+	const rcCompactHeightfield& chf = *sweep.chf;
+	const unsigned short* srcReg = sweep.srcReg;
+	const int w = chf.width;
+	const int borderSize = sweep.borderSize;
+	
+	for (int row = begin; row < end; ++row)
+	{
+		const int y = borderSize + row;
+		rcSweepRun* cur = &sweep.runs[sweep.rowRuns[row]];
+		const int nruns = sweep.rowRuns[row+1] - sweep.rowRuns[row];
+		for (int i = 0; i < nruns; ++i)
+		{
+			cur[i].nei = RC_SWEEP_NO_NEI;
+			cur[i].ns = 0;
+		}
+		
+		// The row below the first one is either border or outside of the field.
+		if (row == 0)
+			continue;
+		const int prevStart = sweep.rowRuns[row-1];
+		
+		for (int x = borderSize; x < w-borderSize; ++x)
+		{
+			const rcCompactCell& c = chf.cells[x+y*w];
+			
+			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			{
+				if (!srcReg[i]) continue;
+				const rcCompactSpan& s = chf.spans[i];
+				rcSweepRun& run = cur[srcReg[i]-1];
+				
 				// -y
 				if (rcGetCon(s,3) != RC_NOT_CONNECTED)
 				{
@@ -1438,51 +1486,172 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 3);
 					if (srcReg[ai] && (srcReg[ai] & RC_BORDER_REG) == 0 && chf.areas[i] == chf.areas[ai])
 					{
-						unsigned short nr = srcReg[ai];
-						if (!sweeps[previd].nei || sweeps[previd].nei == nr)
+						const int nr = prevStart + srcReg[ai]-1;
+						if (run.nei == RC_SWEEP_NO_NEI || run.nei == nr)
 						{
-							sweeps[previd].nei = nr;
-							sweeps[previd].ns++;
-							prev[nr]++;
+							run.nei = nr;
+							run.ns++;
+							sweep.runs[nr].prev++;
 						}
 						else
 						{
-							sweeps[previd].nei = RC_NULL_NEI;
+							run.nei = RC_SWEEP_NULL_NEI;
 						}
 					}
 				}
-
-				srcReg[i] = previd;
-			}
-		}
-		
-		// Create unique ID.
-		for (int i = 1; i < rid; ++i)
-		{
-			if (sweeps[i].nei != RC_NULL_NEI && sweeps[i].nei != 0 &&
-				prev[sweeps[i].nei] == (int)sweeps[i].ns)
-			{
-				sweeps[i].id = sweeps[i].nei;
-			}
-			else
-			{
-				sweeps[i].id = id++;
 			}
 		}
+	}
+}
+
+// Replaces the row-local run ids with the final region ids.
+static void sweepRowRemap(void* userData, const int begin, const int end)
+{
+	rcSweepRows& sweep = *(rcSweepRows*)userData;
+	const rcCompactHeightfield& chf = *sweep.chf;
+	unsigned short* srcReg = sweep.srcReg;
+	const int w = chf.width;
+	const int borderSize = sweep.borderSize;
+	
+	for (int row = begin; row < end; ++row)
+	{
+		const int y = borderSize + row;
+		const rcSweepRun* cur = &sweep.runs[sweep.rowRuns[row]];
 		
-		// Remap IDs
 		for (int x = borderSize; x < w-borderSize; ++x)
 		{
 			const rcCompactCell& c = chf.cells[x+y*w];
 			
 			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 			{
-				if (srcReg[i] > 0 && srcReg[i] < rid)
-					srcReg[i] = sweeps[srcReg[i]].id;
+				if (srcReg[i] > 0)
+					srcReg[i] = cur[srcReg[i]-1].id;
 			}
 		}
 	}
+}
 
+// Partitions the non-border part of the field into monotone regions.
+//
+// The classic sweep walks one row at a time, which serializes the whole pass on the
+// previous row's region ids. Here the rows are split into runs and linked to the previous
+// row independently, so those passes run through rcContext::parallelFor, and only the
+// cheap per-run id assignment stays serial. A run inherits the id of the run below it
+// exactly when the serial sweep would, so the resulting regions are identical.
+static bool sweepMonotoneRegions(rcContext* ctx, const char* name, rcCompactHeightfield& chf,
+								 const int borderSize, unsigned short* srcReg, unsigned short& id)
+{
+	const int nrows = chf.height - borderSize*2;
+	if (nrows <= 0)
+		return true;
+	
+	rcScopedDelete<int> rowRuns((int*)rcAlloc(sizeof(int)*(nrows+1), RC_ALLOC_TEMP));
+	if (!rowRuns)
+	{
+		ctx->log(RC_LOG_ERROR, "%s: Out of memory 'rowRuns' (%d).", name, nrows+1);
+		return false;
+	}
+	
+	rcSweepRows sweep;
+	sweep.chf = &chf;
+	sweep.srcReg = srcReg;
+	sweep.borderSize = borderSize;
+	sweep.rowRuns = rowRuns;
+	sweep.runs = 0;
+	
+	ctx->parallelFor(nrows, sweepRowRuns, &sweep);
+	
+	// Turn the run counts into the index of the first run of each row.
+	int nruns = 0;
+	for (int row = 0; row < nrows; ++row)
+	{
+		const int n = rowRuns[row];
+		rowRuns[row] = nruns;
+		nruns += n;
+	}
+	rowRuns[nrows] = nruns;
+	
+	rcScopedDelete<rcSweepRun> runs((rcSweepRun*)rcAlloc(sizeof(rcSweepRun)*rcMax(nruns, 1), RC_ALLOC_TEMP));
+	if (!runs)
+	{
+		ctx->log(RC_LOG_ERROR, "%s: Out of memory 'runs' (%d).", name, nruns);
+		return false;
+	}
+	memset(runs, 0, sizeof(rcSweepRun)*rcMax(nruns, 1));
+	sweep.runs = runs;
+	
+	ctx->parallelFor(nrows, sweepRowLinks, &sweep);
+	
+	// Create unique IDs, in the same order as the serial sweep.
+	for (int i = 0; i < nruns; ++i)
+	{
+		rcSweepRun& run = runs[i];
+		if (run.nei >= 0 && runs[run.nei].prev == run.ns)
+			run.id = runs[run.nei].id;
+		else
+			run.id = id++;
+	}
+	
+	ctx->parallelFor(nrows, sweepRowRemap, &sweep);
+	
+	return true;
+}
+
+/// @par
+/// 
+/// Non-null regions will consist of connected, non-overlapping walkable spans that form a single contour.
+/// Contours will form simple polygons.
+/// 
+/// If multiple regions form an area that is smaller than @p minRegionArea, then all spans will be
+/// re-assigned to the zero (null) region.
+/// 
+/// Partitioning can result in smaller than necessary regions. @p mergeRegionArea helps 
+/// reduce unnecessarily small regions.
+/// 
+/// See the #rcConfig documentation for more information on the configuration parameters.
+/// 
+/// The region data will be available via the rcCompactHeightfield::maxRegions
+/// and rcCompactSpan::reg fields.
+/// 
+/// @warning The distance field must be created using #rcBuildDistanceField before attempting to build regions.
+/// 
+/// @see rcCompactHeightfield, rcCompactSpan, rcBuildDistanceField, rcBuildRegionsMonotone, rcConfig
+bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
+							const int borderSize, const int minRegionArea, const int mergeRegionArea)
+{
+	rcAssert(ctx);
+	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
+	
+	const int w = chf.width;
+	const int h = chf.height;
+	unsigned short id = 1;
+	
+	rcScopedDelete<unsigned short> srcReg((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP));
+	if (!srcReg)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegionsMonotone: Out of memory 'src' (%d).", chf.spanCount);
+		return false;
+	}
+	memset(srcReg,0,sizeof(unsigned short)*chf.spanCount);
+
+	// Mark border regions.
+	if (borderSize > 0)
+	{
+		// Make sure border will not overflow.
+		const int bw = rcMin(w, borderSize);
+		const int bh = rcMin(h, borderSize);
+		// Paint regions
+		paintRectRegion(0, bw, 0, h, id|RC_BORDER_REG, chf, srcReg); id++;
+		paintRectRegion(w-bw, w, 0, h, id|RC_BORDER_REG, chf, srcReg); id++;
+		paintRectRegion(0, w, 0, bh, id|RC_BORDER_REG, chf, srcReg); id++;
+		paintRectRegion(0, w, h-bh, h, id|RC_BORDER_REG, chf, srcReg); id++;
+	}
+
+	chf.borderSize = borderSize;
+	
+	if (!sweepMonotoneRegions(ctx, "rcBuildRegionsMonotone", chf, borderSize, srcReg, id))
+		return false;
 
 	{
 		rcScopedTimer timerFilter(ctx, RC_TIMER_BUILD_REGIONS_FILTER);
@@ -1677,15 +1846,6 @@ bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
 	}
 	memset(srcReg,0,sizeof(unsigned short)*chf.spanCount);
 	
-	const int nsweeps = rcMax(chf.width,chf.height);
-	rcScopedDelete<rcSweepSpan> sweeps((rcSweepSpan*)rcAlloc(sizeof(rcSweepSpan)*nsweeps, RC_ALLOC_TEMP));
-	if (!sweeps)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildLayerRegions: Out of memory 'sweeps' (%d).", nsweeps);
-		return false;
-	}
-	
-	
 	// Mark border regions.
 	if (borderSize > 0)
 	{
@@ -1701,98 +1861,9 @@ bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
 
 	chf.borderSize = borderSize;
 	
-	rcIntArray prev(256);
-	
-	// Sweep one line at a time.
-	for (int y = borderSize; y < h-borderSize; ++y)
-	{
-		// Collect spans from this row.
-		prev.resize(id+1);
-		memset(&prev[0],0,sizeof(int)*id);
-		unsigned short rid = 1;
-		
-		for (int x = borderSize; x < w-borderSize; ++x)
-		{
-			const rcCompactCell& c = chf.cells[x+y*w];
-			
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
-			{
-				const rcCompactSpan& s = chf.spans[i];
-				if (chf.areas[i] == RC_NULL_AREA) continue;
-				
-				// -x
-				unsigned short previd = 0;
-				if (rcGetCon(s, 0) != RC_NOT_CONNECTED)
-				{
-					const int ax = x + rcGetDirOffsetX(0);
-					const int ay = y + rcGetDirOffsetY(0);
-					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 0);
-					if ((srcReg[ai] & RC_BORDER_REG) == 0 && chf.areas[i] == chf.areas[ai])
-						previd = srcReg[ai];
-				}
-				
-				if (!previd)
-				{
-					previd = rid++;
-					sweeps[previd].rid = previd;
-					sweeps[previd].ns = 0;
-					sweeps[previd].nei = 0;
-				}
-				
-				// -y
-				if (rcGetCon(s,3) != RC_NOT_CONNECTED)
-				{
-					const int ax = x + rcGetDirOffsetX(3);
-					const int ay = y + rcGetDirOffsetY(3);
-					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 3);
-					if (srcReg[ai] && (srcReg[ai] & RC_BORDER_REG) == 0 && chf.areas[i] == chf.areas[ai])
-					{
-						unsigned short nr = srcReg[ai];
-						if (!sweeps[previd].nei || sweeps[previd].nei == nr)
-						{
-							sweeps[previd].nei = nr;
-							sweeps[previd].ns++;
-							prev[nr]++;
-						}
-						else
-						{
-							sweeps[previd].nei = RC_NULL_NEI;
-						}
-					}
-				}
-				
-				srcReg[i] = previd;
-			}
-		}
-		
-		// Create unique ID.
-		for (int i = 1; i < rid; ++i)
-		{
-			if (sweeps[i].nei != RC_NULL_NEI && sweeps[i].nei != 0 &&
-				prev[sweeps[i].nei] == (int)sweeps[i].ns)
-			{
-				sweeps[i].id = sweeps[i].nei;
-			}
-			else
-			{
-				sweeps[i].id = id++;
-			}
-		}
-		
-		// Remap IDs
-		for (int x = borderSize; x < w-borderSize; ++x)
-		{
-			const rcCompactCell& c = chf.cells[x+y*w];
-			
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
-			{
-				if (srcReg[i] > 0 && srcReg[i] < rid)
-					srcReg[i] = sweeps[srcReg[i]].id;
-			}
-		}
-	}
-	
-	
+	if (!sweepMonotoneRegions(ctx, "rcBuildLayerRegions", chf, borderSize, srcReg, id))
+		return false;
+
 	{
 		rcScopedTimer timerFilter(ctx, RC_TIMER_BUILD_REGIONS_FILTER);
 
@@ -3,6 +3,8 @@
 #define BRIDGING_H 1
 #include <stdint.h>
 #include "Recast.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
 
 typedef enum  {
     BCODE_OK = 0,
@@ -50,7 +52,8 @@ enum {
     PARTITION_LAYER = 0
 };
 
-struct BindingBulkResult *bindingRunBulk(rcConfig *config, int flags, const float* verts, int numVerts, const int* tris, int numTris);
+// maxThreads caps the number of threads the partitioning steps may use, zero uses one per processor
+struct BindingBulkResult *bindingRunBulk(rcConfig *config, int flags, int maxThreads, const float* verts, int numVerts, const int* tris, int numTris);
 void bindingRelease (BindingBulkResult *data);
 BDetourStatus bindingGenerateDetour (BindingBulkResult *data, float agentHeight, float agentRadius, float agentMaxclimb, void **result, int *result_size);
 
@@ -64,5 +67,270 @@ struct BindingVertsAndTriangles {
 struct BindingVertsAndTriangles *bindingExtractVertsAndTriangles (const BindingBulkResult *bbr);
 void freeVertsAndTriangles (BindingVertsAndTriangles *data);
 
+// Builds navigation meshes from point clouds or depth samples, splatted straight into
+// a heightfield without meshing them.   The field uses the bounds, grid size and walkable
+// settings of the configuration, and can be fed one frame at a time.
+struct BindingPointField;
+BindingPointField *bindingCreatePointField (const rcConfig *cfg);
+void bindingFreePointField (BindingPointField *field);
+// The points and normals are [(x, y, z) * count] in world units, the normals are optional and
+// mark the steep points as not walkable.   Each point covers the cells within splatRadius.
+bool bindingPointFieldAdd (BindingPointField *field, const float *points, const float *normals, int count, float splatRadius);
+// Adds known shapes to the field, rasterized from their analytic surface instead of samples.
+// As with the points, the parts steeper than the walkable slope are not walkable.   The axes
+// of the box are three unit vectors, or NULL for an axis aligned box.
+bool bindingPointFieldAddSphere (BindingPointField *field, const float *center, float radius);
+bool bindingPointFieldAddCapsule (BindingPointField *field, const float *start, const float *end, float radius);
+bool bindingPointFieldAddBox (BindingPointField *field, const float *center, const float *halfExtents, const float *axes);
+// Removes the samples inside the box, to replace the parts seen again, NULL clears everything
+void bindingPointFieldClear (BindingPointField *field, const float *bmin, const float *bmax);
+// Runs the rest of the pipeline over the samples added so far, with the FILTER_ and PARTITION_ flags.
+// The result is released with bindingRelease, and can be passed to bindingGenerateDetour.
+struct BindingBulkResult *bindingPointFieldBuild (BindingPointField *field, int flags, int maxThreads);
+
+// A span of a column of the field, from the bottom to the top in cells of ch
+struct BindingSpan {
+    int smin;
+    int smax;
+    int area;
+};
+// Copies up to maxSpans spans of the column at x, z into spans, from the bottom up, and
+// returns the number of spans in the column, or -1 when the column is outside the field.
+int bindingPointFieldGetSpans (const BindingPointField *field, int x, int z, BindingSpan *spans, int maxSpans);
+
+// Debug geometry of the tiles of a dtNavMesh, for drawing the navigation mesh
+// over the world.   Each tile slot of the navigation mesh has its own buffers,
+// which are only extracted again when the tile in the slot changes.
+struct BindingDebugTileMesh {
+    // The tile the buffers were extracted from, zero when the slot is empty
+    dtTileRef ref;
+    // The extractor version at which the buffers last changed
+    unsigned int version;
+    int nverts;
+    int ntris;
+    // In SIMD3<Float> format, with one padding float at the end, [(x, y, z, pad) * nverts]
+    float *verts;
+    // Indices into verts, [(a, b, c) * ntris]
+    uint32_t *triangles;
+};
+
+struct BindingDebugMesh;
+// The heightOffset lifts the vertices above the navigation mesh.   [Units: wu]
+BindingDebugMesh *bindingCreateDebugMesh (const dtNavMesh *navMesh, float heightOffset);
+void bindingFreeDebugMesh (BindingDebugMesh *mesh);
+// Extracts the tiles added, replaced or removed since the last update, at most
+// maxTiles of them when it is positive, the rest are left for the next update,
+// which resumes the scan after the last slot extracted.
+// Call it where the navigation mesh is not being changed.   Returns the number of
+// tiles extracted, and increments the version when it is not zero.
+int bindingDebugMeshUpdate (BindingDebugMesh *mesh, int maxTiles);
+unsigned int bindingDebugMeshVersion (const BindingDebugMesh *mesh);
+// The number of tile slots, the maximum number of tiles of the navigation mesh
+int bindingDebugMeshTileCount (const BindingDebugMesh *mesh);
+// Stores the slots whose buffers changed after sinceVersion, returns their count
+int bindingDebugMeshChangedTiles (const BindingDebugMesh *mesh, unsigned int sinceVersion, int *tiles, int maxTiles);
+const BindingDebugTileMesh *bindingDebugMeshTile (const BindingDebugMesh *mesh, int tile);
+
+dtStatus bindingFindStraightPathCorridor (const dtNavMeshQuery *query, const dtQueryFilter *filter,
+                                          dtPolyRef startRef, dtPolyRef endRef, const float *startPos, const float *endPos,
+                                          dtPolyRef *corridor, int *corridorCount, int maxCorridor,
+                                          float *straightPath, unsigned char *straightPathFlags, dtPolyRef *straightPathRefs,
+                                          int *straightPathCount, int maxStraightPath, int options);
+
+// Preallocated result of bindingFindPath, the corridor is used as scratch space
+// for the polygon search, and the straight path arrays hold the final result.
+struct BindingPathResult {
+    dtPolyRef startRef, endRef;
+    float startPos[3], endPos[3];
+
+    int maxCorridor;
+    int corridorCount;
+    dtPolyRef *corridor;
+
+    int maxPoints;
+    int count;
+    float *points;
+    unsigned char *flags;
+    dtPolyRef *refs;
+};
+
+struct BindingPathResult *bindingAllocPathResult (int maxCorridor, int maxPoints);
+void bindingFreePathResult (BindingPathResult *result);
+dtStatus bindingFindPath (const dtNavMeshQuery *query, const dtQueryFilter *filter,
+                          const float *startPos, const float *endPos, const float *halfExtents,
+                          int options, BindingPathResult *result);
+
+// Runtime tile generation, for worlds that can not be baked ahead of time.
+//
+// The provider is called on the worker threads with the bounds of a tile,
+// including its border, and appends the geometry that overlaps it with
+// bindingTileGeometryAdd.   It may be called for several tiles at once.
+struct BindingTileGeometry;
+typedef void (*BindingTileGeometryProvider) (void *userData, int tx, int ty, const float *bmin, const float *bmax, BindingTileGeometry *geometry);
+bool bindingTileGeometryAdd (BindingTileGeometry *geometry, const float *verts, int numVerts, const int *tris, int numTris);
+
+struct BindingTileGeneratorParams {
+    // The Recast settings of every tile.   The x and z of bmin are the origin of the
+    // tile grid, the y of bmin and bmax bound the height of the world.   The tileSize
+    // and borderSize are in voxels, width, height and the x and z of bmax are ignored.
+    rcConfig config;
+    // The FILTER_ and PARTITION_ flags
+    int flags;
+    float agentHeight, agentRadius, agentMaxClimb;
+    // The capacity of the navigation mesh
+    int maxTiles, maxPolysPerTile;
+    // Tiles closer than generateRadius to an interest point are built, and the ones
+    // farther than evictRadius from all of them are removed.   [Units: wu]
+    float generateRadius, evictRadius;
+    // The number of worker threads, zero uses one less than the number of processors
+    int numThreads;
+    // The builds of a tile that may fail in a row before it is marked failed, zero uses 5.
+    // Each failure doubles the number of updates the tile waits before it is built again.
+    int maxBuildAttempts;
+};
+
+struct BindingTileGeneratorStats {
+    // Tiles in the navigation mesh, built without polygons, and queued or being built
+    int loaded, empty, pending;
+    // Pending tiles waiting out the backoff after a failed build
+    int retrying;
+    // Tiles that failed maxBuildAttempts times, they are not built again until they are evicted
+    int failed;
+    // Every build that failed or that the navigation mesh refused, including the retries
+    int64_t buildsFailed;
+};
+
+struct BindingTileGenerator;
+BindingTileGenerator *bindingCreateTileGenerator (const BindingTileGeneratorParams *params, BindingTileGeometryProvider provider, void *userData);
+void bindingFreeTileGenerator (BindingTileGenerator *generator);
+dtNavMesh *bindingTileGeneratorNavMesh (BindingTileGenerator *generator);
+// The points are in world units, [(x, y, z) * count]
+void bindingTileGeneratorSetInterestPoints (BindingTileGenerator *generator, const float *points, int count);
+// Adds the finished tiles to the navigation mesh, evicts the far ones and queues new
+// work.   This is the only call that changes the navigation mesh, call it where no
+// queries or crowd updates are running.   Returns the number of tiles added or removed.
+int bindingTileGeneratorUpdate (BindingTileGenerator *generator, int maxTileChanges);
+// The number of tiles queued or being built
+int bindingTileGeneratorPendingCount (BindingTileGenerator *generator);
+void bindingTileGeneratorGetStats (BindingTileGenerator *generator, BindingTileGeneratorStats *stats);
+
+// A static triangle mesh binned once into the tiles of a tile grid, to feed the
+// generator or the baker without scanning the whole mesh for every tile.   The
+// x and z of config->bmin are set to the bounds of the mesh, and the y of bmin
+// and bmax to its height, use that configuration for the tile grid so each tile
+// only rasterizes the triangles binned into it.   The mesh is copied.
+struct BindingTileMesh;
+BindingTileMesh *bindingCreateTileMesh (rcConfig *config, int numThreads, const float *verts, int numVerts, const int *tris, int numTris);
+void bindingFreeTileMesh (BindingTileMesh *mesh);
+// A BindingTileGeometryProvider, the userData is the BindingTileMesh
+void bindingTileMeshGeometry (void *userData, int tx, int ty, const float *bmin, const float *bmax, BindingTileGeometry *geometry);
+
+
+// Tile files and streaming them from disk.
+//
+// A tile file holds the parameters and the tiles of a tiled navigation mesh,
+// with an index so each tile can be read on its own.   The tiles are stored
+// row by row, so the tiles that are close in the world are close in the file.
+bool bindingWriteTileFile (const dtNavMesh *navMesh, const char *path);
+
+struct BindingTileStreamParams {
+    // Tiles closer than loadRadius to an interest point, or to where it is heading,
+    // are read, the ones farther than evictRadius from all of them are removed.   [Units: wu]
+    float loadRadius, evictRadius;
+    // How far ahead, along the velocity of each interest point, tiles are read.   [Units: s]
+    float readaheadTime;
+    // The maximum number of tiles being read at once, zero uses 8
+    int queueDepth;
+    // The number of I/O threads, zero uses 2
+    int numThreads;
+    // The reads of a tile that may fail in a row before it is marked failed, zero uses 5.
+    // Each failure doubles the number of updates the tile waits before it is read again.
+    int maxReadAttempts;
+};
+
+struct BindingTileStreamStats {
+    // Tiles waiting to be read, being read, and read but not added yet
+    int queued, inFlight, ready;
+    int64_t tilesRead, bytesRead;
+    // The reads that failed, or whose tile could not be added, including the retries
+    int64_t tilesFailed;
+    // Tiles waiting out the backoff after a failed read, and the ones that failed maxReadAttempts
+    // times, which are not read again until they are evicted
+    int retrying, failed;
+    // The read throughput, over the time at least one read was in flight
+    double bytesPerSecond;
+    // The time from the start of the read of a tile to its data being ready.   [Units: s]
+    double meanLatency, maxLatency;
+};
+
+struct BindingTileStream;
+// Opens a tile file, and creates a navigation mesh with its parameters, without any tile
+BindingTileStream *bindingOpenTileStream (const char *path, const BindingTileStreamParams *params);
+void bindingCloseTileStream (BindingTileStream *stream);
+dtNavMesh *bindingTileStreamNavMesh (BindingTileStream *stream);
+// The points and the velocities are in world units, [(x, y, z) * count], the velocities are optional
+void bindingTileStreamSetInterestPoints (BindingTileStream *stream, const float *points, const float *velocities, int count);
+// Adds the tiles that were read to the navigation mesh, evicts the far ones and queues
+// new reads.   This is the only call that changes the navigation mesh, call it where no
+// queries or crowd updates are running.   The tiles are linked on the calling thread when
+// maxThreads is 1 or less, otherwise up to maxThreads threads are started for the batch,
+// which only pays off for large batches.   Returns the number of tiles added or removed.
+int bindingTileStreamUpdate (BindingTileStream *stream, int maxTileChanges, int maxThreads);
+// The number of tiles queued, being read or waiting to be added
+int bindingTileStreamPendingCount (BindingTileStream *stream);
+void bindingTileStreamGetStats (BindingTileStream *stream, BindingTileStreamStats *stats);
+
+// Baking tiled worlds into a tile file with bounded memory.
+//
+// The tiles are built row by row by a pool of workers, and written to the file as
+// soon as they, and the tiles before them, are done.   A build only starts when the
+// memory estimated for it, together with the builds in progress and the tiles waiting
+// to be written, fits the budget, so the memory used does not grow with the size of
+// the world.   The estimate starts from the configuration and is raised to the largest
+// build seen so far.
+struct BindingTileMemoryEstimate {
+    // The bytes held by each stage of the pipeline for one tile
+    int64_t heightfield, compactHeightfield, regions, contours, polyMesh, detailMesh;
+    // The bytes held by a worker building the tile, the stages are kept between tiles
+    int64_t total;
+};
+// The spansPerCell is the expected number of spans in each column of the heightfield
+void bindingEstimateTileMemory (const rcConfig *config, int flags, float spansPerCell, BindingTileMemoryEstimate *estimate);
+
+struct BindingTileBakeParams {
+    // The Recast settings of every tile.   The x and z of bmin and bmax are the area
+    // that is baked, the y bound the height of the world.   The tileSize and borderSize
+    // are in voxels, width and height are ignored.
+    rcConfig config;
+    // The FILTER_ and PARTITION_ flags
+    int flags;
+    float agentHeight, agentRadius, agentMaxClimb;
+    // The capacity of the navigation mesh the file is streamed into
+    int maxTiles, maxPolysPerTile;
+    // The memory the builds and the tiles waiting to be written may use, zero has no limit.   [Units: bytes]
+    int64_t memoryBudget;
+    // The expected number of spans per heightfield column, zero uses 2
+    float spansPerCell;
+    // The number of threads building tiles, the calling thread included, zero uses one per processor
+    int numThreads;
+};
+
+struct BindingTileBakeStats {
+    int tilesBuilt, tilesEmpty, tilesFailed;
+    int64_t bytesWritten;
+    // The memory expected for a build, from the configuration and after the builds
+    int64_t initialEstimate, finalEstimate;
+    // The most memory held by builds and unwritten tiles at once
+    int64_t peakMemory;
+    // The most builds running at once
+    int maxConcurrentBuilds;
+};
+
+// Builds every tile of the area with the geometry from the provider, and writes them
+// to a tile file that can be opened with bindingOpenTileStream.   The tiles that fail
+// are left out and counted in the stats, which may be NULL.   Returns false if the
+// file can not be written.
+bool bindingBakeTiles (const BindingTileBakeParams *params, BindingTileGeometryProvider provider, void *userData,
+                       const char *path, BindingTileBakeStats *stats);
 
 #endif
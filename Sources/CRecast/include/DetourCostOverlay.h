@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2024 Miguel de Icaza
+//
+// Distributed under the MIT License. See the LICENSE file at the root of
+// the repository for details.
+//
+
+#ifndef DETOURCOSTOVERLAY_H
+#define DETOURCOSTOVERLAY_H
+
+#include "DetourNavMesh.h"
+#include "DetourAssert.h"
+
+/// Per polygon traversal cost multipliers, stored densely per tile.
+/// @ingroup detour
+class dtPolyCostOverlay
+{
+public:
+	dtPolyCostOverlay();
+	~dtPolyCostOverlay();
+
+	/// Initializes the overlay for a navigation mesh.
+	///  @param[in]	nav		The navigation mesh the polygon references belong to.
+	/// @return The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav);
+
+	/// Returns the cost multiplier of a polygon. (1.0 if no cost was set.)
+	///  @param[in]	ref		The reference id of the polygon.
+	inline float getCost(const dtPolyRef ref) const
+	{
+		if (!m_nav)
+			return 1.0f;
+		unsigned int salt, it, ip;
+		m_nav->decodePolyId(ref, salt, it, ip);
+		if ((int)it >= m_maxTiles)
+			return 1.0f;
+		const dtTileCosts& tile = m_tiles[it];
+		if (!tile.costs || tile.salt != salt || (int)ip >= tile.polyCount)
+			return 1.0f;
+		dtAssert(tile.costs[ip] >= 1.0f);
+		return tile.costs[ip];
+	}
+
+	/// Sets the cost multiplier of a polygon.
+	///  @param[in]	ref		The reference id of the polygon.
+	///  @param[in]	cost	The cost multiplier. [Limit: >= 1.0]
+	/// @return The status flags for the operation. (DT_INVALID_PARAM if @p cost is below 1.0.)
+	dtStatus setPolyCost(const dtPolyRef ref, const float cost);
+
+	/// Sets the same cost multiplier for a list of polygons.
+	///  @param[in]	refs	The reference ids of the polygons. [(polyRef) * @p count]
+	///  @param[in]	count	The number of polygons.
+	///  @param[in]	cost	The cost multiplier. [Limit: >= 1.0]
+	/// @return The status flags for the operation.
+	dtStatus setPolyCosts(const dtPolyRef* refs, const int count, const float cost);
+
+	/// Sets the cost multiplier for a range of polygons within a tile.
+	///  @param[in]	ref			The reference id of the tile.
+	///  @param[in]	firstPoly	The index of the first polygon in the tile.
+	///  @param[in]	count		The number of polygons, or -1 for the rest of the tile.
+	///  @param[in]	cost		The cost multiplier. [Limit: >= 1.0]
+	/// @return The status flags for the operation.
+	dtStatus setTileCosts(const dtTileRef ref, const int firstPoly, const int count, const float cost);
+
+	/// Sets the cost multiplier for the polygons overlapping an axis aligned box.
+	///  @param[in]	bmin		The minimum bounds of the box. [(x, y, z)]
+	///  @param[in]	bmax		The maximum bounds of the box. [(x, y, z)]
+	///  @param[in]	cost		The cost multiplier. [Limit: >= 1.0]
+	///  @param[out]	polyCount	The number of polygons changed. [opt]
+	/// @return The status flags for the operation.
+	dtStatus setCostInBounds(const float* bmin, const float* bmax, const float cost, int* polyCount = 0);
+
+	/// Removes the cost multipliers of a tile.
+	///  @param[in]	ref		The reference id of the tile.
+	void resetTile(const dtTileRef ref);
+
+	/// Removes all cost multipliers.
+	void clear();
+
+	/// Returns a counter that changes every time a cost multiplier is changed.
+	inline unsigned int getVersion() const { return m_version; }
+
+	/// Returns the value of #getVersion at the last change to the costs of a tile.
+	///  @param[in]	ref		The reference id of the tile.
+	unsigned int getTileVersion(const dtTileRef ref) const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtPolyCostOverlay(const dtPolyCostOverlay&);
+	dtPolyCostOverlay& operator=(const dtPolyCostOverlay&);
+
+	struct dtTileCosts
+	{
+		unsigned int salt;			///< The salt of the tile the costs belong to.
+		unsigned int version;		///< The overlay version of the last change.
+		int polyCount;				///< The number of polygons in the tile.
+		float* costs;				///< The cost multipliers. [Size: polyCount]
+	};
+
+	/// Returns the costs of a tile, allocating or resetting them if the tile has changed.
+	dtTileCosts* getTileCosts(const dtMeshTile* tile, const unsigned int salt, const unsigned int it);
+
+	const dtNavMesh* m_nav;
+	dtTileCosts* m_tiles;
+	int m_maxTiles;
+	unsigned int m_version;
+} SWIFT_UNSAFE_REFERENCE;
+
+dtPolyCostOverlay* dtAllocPolyCostOverlay();
+void dtFreePolyCostOverlay(dtPolyCostOverlay* overlay);
+
+#endif // DETOURCOSTOVERLAY_H
@@ -32,6 +32,12 @@
 /// @ingroup crowd
 static const int DT_CROWDAGENT_MAX_NEIGHBOURS = 6;
 
+/// The maximum number of dynamic obstacles that a crowd agent can take into account
+/// for steering decisions.
+/// @ingroup crowd
+/// @see dtCrowd::addObstacle()
+static const int DT_CROWDAGENT_MAX_OBSTACLES = 4;
+
 /// The maximum number of corners a crowd agent will look ahead in the path.
 /// This value is used for sizing the crowd agent corner buffers.
 /// Due to the behavior of the crowd manager, the actual number of useful
@@ -180,6 +186,27 @@ struct dtCrowdAgentAnimation
 	float t, tmax;
 };
 
+/// The shape of a crowd obstacle.
+/// @ingroup crowd
+enum CrowdObstacleType
+{
+	DT_CROWDOBSTACLE_CIRCLE = 0,	///< A vertical cylinder.
+	DT_CROWDOBSTACLE_CAPSULE		///< A vertical cylinder swept along a segment.
+};
+
+/// A moving obstacle avoided by the agents, which is not an agent itself. (E.g. a cart or a door.)
+/// @ingroup crowd
+struct dtCrowdObstacle
+{
+	bool active;		///< True if the obstacle is in use.
+	unsigned char type;	///< The shape of the obstacle. (See: #CrowdObstacleType)
+	float pos[3];		///< The position of the circle, or the start of the capsule. [(x, y, z)]
+	float end[3];		///< The end of the capsule. (Same as #pos for circles.) [(x, y, z)]
+	float radius;		///< The radius of the obstacle. [Limit: > 0]
+	float height;		///< The height of the obstacle. [Limit: > 0]
+	float vel[3];		///< The velocity of the obstacle. [(x, y, z)]
+};
+
 /// Crowd agent update flags.
 /// @ingroup crowd
 /// @see dtCrowdAgentParams::updateFlags
@@ -207,6 +234,8 @@ class dtCrowd
 	dtCrowdAgent* m_agents;
 	dtCrowdAgent** m_activeAgents;
 	dtCrowdAgentAnimation* m_agentAnims;
+	int* m_freeAgents;
+	int m_nfreeAgents;
 	
 	dtPathQueue m_pathq;
 
@@ -214,6 +243,13 @@ class dtCrowd
 	dtObstacleAvoidanceQuery* m_obstacleQuery;
 	
 	dtProximityGrid* m_grid;
+
+	dtCrowdObstacle* m_obstacles;
+	int m_maxObstacles;
+	int* m_freeObstacles;			///< The free obstacle slots, used as a stack. [Size: #m_maxObstacles]
+	int m_nfreeObstacles;
+	int m_obstacleCells;			///< The obstacle grid cells taken by the active obstacles.
+	dtProximityGrid* m_obstacleGrid;
 	
 	dtPolyRef* m_pathResult;
 	int m_maxPathResult;
@@ -228,6 +264,10 @@ class dtCrowd
 
 	dtNavMeshQuery* m_navquery;
 
+	int m_ngridAgents;
+	float m_gridAgentHeight;		///< The height of the tallest agent in the proximity grid.
+	float m_gridObstacleHeight;		///< The height of the tallest obstacle in the obstacle grid.
+
 	void updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt);
 	void updateMoveRequest(const float dt);
 	void checkPathValidity(dtCrowdAgent** agents, const int nagents, const float dt);
@@ -236,7 +276,15 @@ class dtCrowd
 
 	bool requestMoveTargetReplan(const int idx, dtPolyRef ref, const float* pos);
 
+	int allocAgentSlot();
+	void initAgent(const int idx, const dtCrowdAgentParams* params, dtPolyRef ref, const float* nearest);
+
 	void purge();
+
+	void registerAgents(dtCrowdAgent** agents, const int nagents);
+	int queryGridAgents(const float* bmin, const float* bmax, int* idxs, const int maxIdxs) const;
+
+	bool readState(const unsigned char* data, const int dataSize, const bool apply);
 	
 public:
 	dtCrowd();
@@ -249,6 +297,40 @@ public:
 	/// @return True if the initialization succeeded.
 	bool init(const int maxAgents, const float maxAgentRadius, dtNavMesh* nav);
 	
+	/// Allocates the registry of dynamic obstacles. Must be called after #init.
+	///  @param[in]		maxObstacles	The maximum number of obstacles the crowd can manage. [Limit: >= 1]
+	/// @return True if the initialization succeeded.
+	bool initObstacles(const int maxObstacles);
+
+	/// Adds a dynamic obstacle that the agents avoid.
+	///  @param[in]		pos		The position of the obstacle, or the start of a capsule. [(x, y, z)]
+	///  @param[in]		end		The end of a capsule, or null for a circle. [(x, y, z)] [opt]
+	///  @param[in]		radius	The radius of the obstacle. [Limit: > 0]
+	///  @param[in]		height	The height of the obstacle. [Limit: > 0]
+	/// @return The index of the obstacle, or -1 if it could not be added or the size is not valid.
+	int addObstacle(const float* pos, const float* end, const float radius, const float height);
+
+	/// Moves a dynamic obstacle.
+	///  @param[in]		idx		The obstacle index. [Limits: 0 <= value < #getObstacleCount()]
+	///  @param[in]		pos		The new position, or start of the capsule. [(x, y, z)]
+	///  @param[in]		end		The new end of the capsule. [(x, y, z)] [opt]
+	///  @param[in]		vel		The velocity of the obstacle. [(x, y, z)] [opt]
+	/// @return True if the obstacle was moved, false if it is not active or would not fit the obstacle grid.
+	bool updateObstacle(const int idx, const float* pos, const float* end, const float* vel);
+
+	/// Removes a dynamic obstacle.
+	///  @param[in]		idx		The obstacle index. [Limits: 0 <= value < #getObstacleCount()]
+	void removeObstacle(const int idx);
+
+	/// Gets the specified obstacle from the pool.
+	///	 @param[in]		idx		The obstacle index. [Limits: 0 <= value < #getObstacleCount()]
+	/// @return The requested obstacle, or null if the index is out of range.
+	const dtCrowdObstacle* getObstacle(const int idx) const;
+
+	/// The maximum number of obstacles that can be managed by the object.
+	/// @return The maximum number of obstacles.
+	inline int getObstacleCount() const { return m_maxObstacles; }
+
 	/// Sets the shared avoidance configuration for the specified index.
 	///  @param[in]		idx		The index. [Limits: 0 <= value < #DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS]
 	///  @param[in]		params	The new configuration.
@@ -280,11 +362,33 @@ public:
 	/// @return The index of the agent in the agent pool. Or -1 if the agent could not be added.
 	int addAgent(const float* pos, const dtCrowdAgentParams* params);
 
+	/// Adds several agents to the crowd at once.
+	///  @param[in]		pos		The requested positions of the agents. [(x, y, z) * @p count]
+	///  @param[in]		params	The configuration of each agent. [(params) * @p count]
+	///  @param[in]		count	The number of agents to add.
+	///  @param[out]	idxs	The index of each agent in the agent pool, or -1 if that agent could not be added. [(index) * @p count]
+	/// @return The number of agents that were added.
+	int addAgents(const float* pos, const dtCrowdAgentParams* params, const int count, int* idxs);
+
 	/// Updates the specified agent's configuration.
 	///  @param[in]		idx		The agent index. [Limits: 0 <= value < #getAgentCount()]
 	///  @param[in]		params	The new agent configuration.
 	void updateAgentParameters(const int idx, const dtCrowdAgentParams* params);
 
+	/// Updates the configuration of several agents at once.
+	///  @param[in]		idxs	The agent indices. [(index) * @p nidxs]
+	///  @param[in]		nidxs	The number of agents to update.
+	///  @param[in]		params	The new agent configurations, one per agent. [(params) * @p nidxs]
+	void updateAgentParameters(const int* idxs, const int nidxs, const dtCrowdAgentParams* params);
+
+	/// Retrieves the configuration of several agents at once.
+	///  @param[in]		idxs	The agent indices. [(index) * @p nidxs]
+	///  @param[in]		nidxs	The number of agents to retrieve.
+	///  @param[out]	params	The agent configurations, one per agent. [(params) * @p nidxs]
+	///  @param[out]	valid	Optional, set to 1 for the agents that were retrieved and 0 for the rest. [(flag) * @p nidxs]
+	/// @return The number of configurations retrieved.
+	int getAgentParameters(const int* idxs, const int nidxs, dtCrowdAgentParams* params, unsigned char* valid = 0) const;
+
 	/// Removes the agent from the crowd.
 	///  @param[in]		idx		The agent index. [Limits: 0 <= value < #getAgentCount()]
 	void removeAgent(const int idx);
@@ -296,6 +400,23 @@ public:
 	/// @return True if the request was successfully submitted.
 	bool requestMoveTarget(const int idx, dtPolyRef ref, const float* pos);
 
+	/// Submits the same move request for several agents.
+	///  @param[in]		idxs	The agent indices. [(index) * @p nidxs]
+	///  @param[in]		nidxs	The number of agents.
+	///  @param[in]		ref		The position's polygon reference.
+	///  @param[in]		pos		The position within the polygon. [(x, y, z)]
+	/// @return The number of requests that were successfully submitted.
+	int requestMoveTargets(const int* idxs, const int nidxs, dtPolyRef ref, const float* pos);
+
+	/// Submits a move request towards a shared position for several agents.
+	///  @param[in]		idxs		The agent indices. [(index) * @p nidxs]
+	///  @param[in]		nidxs		The number of agents.
+	///  @param[in]		pos			The target position, it is snapped to the navigation mesh. [(x, y, z)]
+	///  @param[out]	targetRef	The polygon the target was snapped to. [opt]
+	///  @param[out]	targetPos	The snapped target position. [opt] [(x, y, z)]
+	/// @return The number of requests that were successfully submitted.
+	int requestMoveTargets(const int* idxs, const int nidxs, const float* pos, dtPolyRef* targetRef = 0, float* targetPos = 0);
+
 	/// Submits a new move request for the specified agent.
 	///  @param[in]		idx		The agent index. [Limits: 0 <= value < #getAgentCount()]
 	///  @param[in]		vel		The movement velocity. [(x, y, z)]
@@ -317,6 +438,56 @@ public:
 	///  @param[in]		dt		The time, in seconds, to update the simulation. [Limit: > 0]
 	///  @param[out]	debug	A debug object to load with debug information. [Opt]
 	void update(const float dt, dtCrowdAgentDebugInfo* debug);
+
+	/// Finds the agents within a distance of a position.
+	///  @param[in]		pos			The center of the search sphere. [(x, y, z)]
+	///  @param[in]		radius		The radius of the search sphere.
+	///  @param[out]	idxs		The indices of the agents found. [(index) * @p maxIdxs]
+	///  @param[in]		maxIdxs		The size of the index array.
+	/// @return The number of agents returned in @p idxs.
+	int queryAgentsInRadius(const float* pos, const float radius, int* idxs, const int maxIdxs) const;
+
+	/// Finds the agents whose position is within an axis aligned box.
+	///  @param[in]		bmin		The minimum bounds of the box. [(x, y, z)]
+	///  @param[in]		bmax		The maximum bounds of the box. [(x, y, z)]
+	///  @param[out]	idxs		The indices of the agents found. [(index) * @p maxIdxs]
+	///  @param[in]		maxIdxs		The size of the index array.
+	/// @return The number of agents returned in @p idxs.
+	int queryAgentsInBounds(const float* bmin, const float* bmax, int* idxs, const int maxIdxs) const;
+
+	/// Finds the agents nearest to a position, sorted by distance.
+	///  @param[in]		pos			The search position. [(x, y, z)]
+	///  @param[in]		maxDist		The maximum distance of the agents.
+	///  @param[out]	idxs		The indices of the agents found. [(index) * @p k]
+	///  @param[out]	dists		The distance of each agent found. [(distance) * @p k] [opt]
+	///  @param[in]		k			The maximum number of agents to find.
+	/// @return The number of agents returned in @p idxs.
+	int queryNearestAgents(const float* pos, const float maxDist, int* idxs, float* dists, const int k) const;
+
+	/// Gets the size of the buffer required by #storeState to store the current agents and obstacles.
+	/// @return The size of the buffer required to store the state.
+	int getStateSize() const;
+
+	/// Stores the active agents, with their corridors, boundaries and animations, and the
+	/// active obstacles in a compact buffer.
+	///  @param[out]	data			The buffer to store the state in.
+	///  @param[in]		maxDataSize		The size of the data buffer. [Limit: >= #getStateSize]
+	///  @param[out]	dataSize		The number of bytes written to @p data.
+	/// @return True if the state fit in the buffer.
+	bool storeState(unsigned char* data, const int maxDataSize, int* dataSize) const;
+
+	/// Replaces all agents and obstacles with the ones stored by #storeState.
+	///  @param[in]		data			The state. (Obtained from #storeState.)
+	///  @param[in]		dataSize		The size of the state.
+	/// @return True if the state was restored, on failure the crowd is left unchanged.
+	bool restoreState(const unsigned char* data, const int dataSize);
+
+	/// Patches the agent paths and targets after tiles of the navigation mesh were replaced.
+	///  @param[in]		remaps			The mappings of every tile replaced since the last call, oldest first.
+	///									(See: dtNavMesh::replaceTile, dtRemapPolyRef) [Size: @p nremaps]
+	///  @param[in]		nremaps			The number of mappings.
+	/// @return The number of agents whose path could not be fully patched and will be replanned.
+	int remapPolyRefs(const dtPolyRefRemap* remaps, const int nremaps);
 	
 	/// Gets the filter used by the crowd.
 	/// @return The filter used by the crowd.
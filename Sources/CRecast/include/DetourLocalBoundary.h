@@ -57,6 +57,10 @@ public:
 	inline int getSegmentCount() const { return m_nsegs; }
 	inline const float* getSegment(int i) const { return m_segs[i].s; }
 
+	int getStateSize() const;
+	unsigned char* storeState(unsigned char* data) const;
+	const unsigned char* restoreState(const unsigned char* data, const unsigned char* end);
+
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	dtLocalBoundary(const dtLocalBoundary&);
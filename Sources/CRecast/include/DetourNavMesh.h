@@ -79,6 +79,9 @@ static const int DT_NAVMESH_STATE_MAGIC = 'D'<<24 | 'N'<<16 | 'M'<<8 | 'S';
 /// A version number used to detect compatibility of navigation tile states.
 static const int DT_NAVMESH_STATE_VERSION = 1;
 
+/// A magic number used to detect the compatibility of navigation mesh state deltas.
+static const int DT_NAVMESH_DELTA_MAGIC = 'D'<<24 | 'N'<<16 | 'M'<<8 | 'D';
+
 /// @}
 
 /// A flag that indicates that an entity links to an external entity.
@@ -334,6 +337,80 @@ struct dtNavMeshParams
 	int maxPolys;					///< The maximum number of polygons each tile can contain. This and maxTiles are used to calculate how many bits are needed to identify tiles and polygons uniquely.
 };
 
+/// Maps the polygon references of a replaced tile to the polygons of the tile that replaced it.
+/// @see dtNavMesh::replaceTile, dtRemapPolyRef
+/// @ingroup detour
+struct dtPolyRefRemap
+{
+	dtPolyRef oldBase;				///< The polygon reference base of the replaced tile.
+	int polyCount;					///< The number of polygons in the replaced tile.
+	int maxPolys;					///< The size of the newRefs array.
+	dtPolyRef* newRefs;				///< The new reference of each replaced polygon, or zero if it has none. [Size: maxPolys]
+};
+
+/// Returns the new reference of a polygon after one or more tiles were replaced.
+///
+/// The mappings are applied in order, so a tile replaced several times is followed through
+/// all of its replacements, as long as every mapping since the reference was obtained is
+/// passed, oldest first. A mapping only covers the replacement that produced it: the
+/// references it returns are stale once their tile is replaced again.
+///  @param[in]	remaps		The mappings of the replaced tiles, in the order the tiles were replaced. [Size: @p nremaps]
+///  @param[in]	nremaps		The number of mappings.
+///  @param[in]	ref			The polygon reference.
+/// @return The new reference, zero if the polygon has no counterpart in the new tile,
+/// or @p ref if its tile was not replaced.
+inline dtPolyRef dtRemapPolyRef(const dtPolyRefRemap* remaps, const int nremaps, const dtPolyRef ref)
+{
+	dtPolyRef result = ref;
+	for (int i = 0; i < nremaps; ++i)
+	{
+		if (result >= remaps[i].oldBase && result - remaps[i].oldBase < (dtPolyRef)remaps[i].polyCount)
+		{
+			result = remaps[i].newRefs[result - remaps[i].oldBase];
+			if (!result)
+				return 0;
+		}
+	}
+	return result;
+}
+
+/// A function that processes the items [@p begin, @p end) of a job started by a #dtParallelForFunc.
+///  @param[in]		userData	The user data passed to the #dtParallelForFunc.
+///  @param[in]		begin		The first item to process.
+///  @param[in]		end			One past the last item to process.
+typedef void (dtParallelForRangeFunc)(void* userData, const int begin, const int end);
+
+/// Runs @p func over the items [0, @p count), split into contiguous ranges that may run
+/// concurrently, and returns once all of them have been processed.
+///  @param[in]		context		The context passed along with the function.
+///  @param[in]		count		The number of items to process.
+///  @param[in]		func		The function called for each range.
+///  @param[in]		userData	Passed unchanged to @p func.
+/// @see dtNavMesh::addTiles
+typedef void (dtParallelForFunc)(void* context, const int count, dtParallelForRangeFunc* func, void* userData);
+
+/// Allocates the tile data of a replica.
+///  @param[in]		context		The context of the allocator, for example a memory node.
+///  @param[in]		size		The size, in bytes, of the memory to allocate.
+/// @return A pointer to the allocated memory, or null if the allocation failed.
+/// @see dtReplicaAllocator
+typedef void* (dtReplicaAllocFunc)(void* context, size_t size);
+
+/// Frees memory allocated with a #dtReplicaAllocFunc.
+///  @param[in]		context		The context of the allocator.
+///  @param[in]		ptr			The memory to free.
+/// @see dtReplicaAllocator
+typedef void (dtReplicaFreeFunc)(void* context, void* ptr);
+
+/// Places the tile data of a replica. (See: dtNavMesh::initReplica)
+/// @ingroup detour
+struct dtReplicaAllocator
+{
+	dtReplicaAllocFunc* alloc;		///< Allocates the data of each tile.
+	dtReplicaFreeFunc* free;		///< Frees the memory returned by alloc.
+	void* context;					///< Passed unchanged to alloc and free.
+};
+
 /// A navigation mesh based on tiles of convex polygons.
 /// @ingroup detour
 class dtNavMesh
@@ -357,6 +434,20 @@ public:
 	/// @return The status flags for the operation.
 	///  @see dtCreateNavMeshData
 	dtStatus init(unsigned char* data, const int dataSize, const int flags);
+
+	/// Initializes the navigation mesh as an instance sharing the tiles of another mesh.
+	///  @param[in]	base		The mesh to share. It must outlive this mesh, and its tiles
+	///							must not be added, removed or modified while it is shared.
+	/// @return The status flags for the operation.
+	dtStatus initShared(const dtNavMesh* base);
+
+	/// Initializes the navigation mesh as a replica of another mesh, with its own copy
+	/// of all the tile data, polygons included.
+	///  @param[in]	base		The mesh to replicate. Its tiles must not be added or removed
+	///							while it is replicated.
+	///  @param[in]	allocator	Allocates the tile data, null uses #dtAlloc. [opt] [Default: null]
+	/// @return The status flags for the operation.
+	dtStatus initReplica(const dtNavMesh* base, const dtReplicaAllocator* allocator = 0);
 	
 	/// The navigation mesh initialization params.
 	const dtNavMeshParams* getParams() const;
@@ -369,6 +460,21 @@ public:
 	///  @param[out]	result		The tile reference. (If the tile was succesfully added.) [opt]
 	/// @return The status flags for the operation.
 	dtStatus addTile(unsigned char* data, int dataSize, int flags, dtTileRef lastRef, dtTileRef* result);
+
+	/// Adds a batch of tiles to the navigation mesh, building all their links at once.
+	///  @param[in]		data		Data for the new tile meshes. (See: #dtCreateNavMeshData) [Size: @p count]
+	///  @param[in]		dataSizes	Data sizes of the new tile meshes. [Size: @p count]
+	///  @param[in]		count		The number of tiles.
+	///  @param[in]		flags		Tile flags for all the tiles. (See: #dtTileFlags)
+	///  @param[in]		lastRefs	The desired references for the tiles. (When reloading tiles.) [opt] [Size: @p count]
+	///  @param[out]	results		The tile references, zero for the tiles that could not be added. [opt] [Size: @p count]
+	///  @param[in]		parallelFor	Runs the linking steps on the caller's threads, null links on the calling
+	///								thread. [opt] [Default: null]
+	///  @param[in]		parallelForContext	Passed unchanged to @p parallelFor. [opt] [Default: null]
+	/// @return The status flags for the operation.
+	dtStatus addTiles(unsigned char** data, const int* dataSizes, const int count, const int flags,
+					  const dtTileRef* lastRefs, dtTileRef* results,
+					  dtParallelForFunc* parallelFor = 0, void* parallelForContext = 0);
 	
 	/// Removes the specified tile from the navigation mesh.
 	///  @param[in]		ref			The reference of the tile to remove.
@@ -377,6 +483,19 @@ public:
 	/// @return The status flags for the operation.
 	dtStatus removeTile(dtTileRef ref, unsigned char** data, int* dataSize);
 
+	/// Replaces a tile with a new build of the same location, and maps the old polygon
+	/// references to the new polygons by their position.
+	///  @param[in]		ref			The reference of the tile to replace.
+	///  @param[in]		data		Data for the new tile mesh. (See: #dtCreateNavMeshData)
+	///  @param[in]		dataSize	Data size of the new tile mesh.
+	///  @param[in]		flags		Tile flags. (See: #dtTileFlags)
+	///  @param[out]	result		The reference of the new tile. [opt]
+	///  @param[in,out]	remap		The mapping of the old polygon references. The newRefs and
+	///								maxPolys members must be set by the caller. [opt]
+	/// @return The status flags for the operation.
+	dtStatus replaceTile(dtTileRef ref, unsigned char* data, int dataSize, int flags,
+						 dtTileRef* result, dtPolyRefRemap* remap);
+
 	/// @}
 
 	/// @{
@@ -515,6 +634,42 @@ public:
 	///  @param[in]	maxDataSize		The size of the state within the data buffer.
 	/// @return The status flags for the operation.
 	dtStatus restoreTileState(dtMeshTile* tile, const unsigned char* data, const int maxDataSize);
+
+	/// Gets the size of the buffer required by #storeState to store the state of all tiles.
+	/// @return The size of the buffer required to store the state.
+	int getStateSize() const;
+
+	/// Stores the non-structural state of every tile in a single buffer. (Flags, area ids, etc.)
+	///  @param[out]	data			The buffer to store the state in.
+	///  @param[in]		maxDataSize		The size of the data buffer. [Limit: >= #getStateSize]
+	/// @return The status flags for the operation.
+	dtStatus storeState(unsigned char* data, const int maxDataSize) const;
+
+	/// Restores the state of every tile stored by #storeState.
+	///  @param[in]	data			The state. (Obtained from #storeState.)
+	///  @param[in]	maxDataSize		The size of the state within the data buffer.
+	/// @return The status flags for the operation.
+	dtStatus restoreState(const unsigned char* data, const int maxDataSize);
+
+	/// Gets the size of the largest delta #storeStateDelta can produce for the current tiles.
+	/// @return The size of the buffer that fits any delta.
+	int getStateDeltaMaxSize() const;
+
+	/// Stores the state of the polygons whose flags or area changed since the snapshot @p base was stored.
+	///  @param[in]		base			The snapshot to compare against. (Obtained from #storeState.)
+	///  @param[in]		baseSize		The size of the snapshot.
+	///  @param[out]	data			The buffer to store the delta in.
+	///  @param[in]		maxDataSize		The size of the data buffer.
+	///  @param[out]	dataSize		The number of bytes written to @p data.
+	/// @return The status flags for the operation.
+	dtStatus storeStateDelta(const unsigned char* base, const int baseSize,
+							 unsigned char* data, const int maxDataSize, int* dataSize) const;
+
+	/// Applies a delta stored by #storeStateDelta.
+	///  @param[in]	data			The delta. (Obtained from #storeStateDelta.)
+	///  @param[in]	dataSize		The size of the delta.
+	/// @return The status flags for the operation.
+	dtStatus restoreStateDelta(const unsigned char* data, const int dataSize);
 	
 	/// @}
 
@@ -639,9 +794,25 @@ private:
 	void connectExtLinks(dtMeshTile* tile, dtMeshTile* target, int side);
 	/// Builds external polygon links for a tile.
 	void connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int side);
+
+	/// Allocates a tile for the data and sets it up, without linking it to anything.
+	dtStatus registerTile(unsigned char* data, int dataSize, int flags, dtTileRef lastRef, dtMeshTile** result);
+	/// Runs a step of #addTiles over a range of the list of tiles.
+	void linkTiles(dtMeshTile** tiles, const unsigned char* marks, const int step, const int begin, const int end);
+	/// The #dtParallelForRangeFunc of a step of #addTiles.
+	static void linkTilesRange(void* userData, const int begin, const int end);
 	
 	/// Removes external links at specified side.
 	void unconnectLinks(dtMeshTile* tile, dtMeshTile* target);
+
+	/// Gives a shared tile its own copy of the links, so they can be changed.
+	bool ownTileLinks(dtMeshTile* tile);
+	/// Gives the shared tiles at a location, or at one of its sides, their own links.
+	dtStatus ownTileLinksAt(const int x, const int y, const int side);
+	/// Gives the shared tiles around a location their own links.
+	dtStatus ownNeighbourTileLinks(const int x, const int y);
+	/// Frees the copies a shared tile owns.
+	void releaseSharedTile(dtMeshTile* tile);
 	
 
 	// TODO: These methods are duplicates from dtNavMeshQuery, but are needed for off-mesh connection finding.
@@ -667,6 +838,8 @@ private:
 	dtMeshTile** m_posLookup;			///< Tile hash lookup.
 	dtMeshTile* m_nextFree;				///< Freelist of tiles.
 	dtMeshTile* m_tiles;				///< List of tiles.
+	unsigned char* m_tileShare;			///< How each tile is shared with the base mesh. (Null unless shared or replicated.)
+	dtReplicaAllocator m_replicaAllocator;	///< Allocates the tile data of a replica. (Null functions use dtAlloc.)
 		
 #ifndef DT_POLYREF64
 	unsigned int m_saltBits;			///< Number of salt bits in the tile ID.
@@ -30,6 +30,8 @@
 
 //#define DT_VIRTUAL_QUERYFILTER 1
 
+class dtPolyCostOverlay;
+
 /// Defines polygon filtering and traversal costs for navigation mesh query operations.
 /// @ingroup detour
 class dtQueryFilter
@@ -37,6 +39,7 @@ class dtQueryFilter
 	float m_areaCost[DT_MAX_AREAS];		///< Cost per area type. (Used by default implementation.)
 	unsigned short m_includeFlags;		///< Flags for polygons that can be visited. (Used by default implementation.)
 	unsigned short m_excludeFlags;		///< Flags for polygons that should not be visited. (Used by default implementation.)
+	const dtPolyCostOverlay* m_costOverlay;	///< Per polygon cost multipliers. [opt] (Used by default implementation.)
 	
 public:
 	dtQueryFilter();
@@ -115,6 +118,13 @@ public:
 	/// @param[in]		flags		The new flags.
 	inline void setExcludeFlags(const unsigned short flags) { m_excludeFlags = flags; }	
 
+	/// Returns the per polygon cost multipliers used by the filter. [opt]
+	inline const dtPolyCostOverlay* getCostOverlay() const { return m_costOverlay; }
+
+	/// Sets the per polygon cost multipliers used by the filter.
+	/// @param[in]		overlay		The cost multipliers, or null to use only the area costs.
+	inline void setCostOverlay(const dtPolyCostOverlay* overlay) { m_costOverlay = overlay; }
+
 	///@}
 
 } SWIFT_UNSAFE_REFERENCE;
@@ -176,6 +186,12 @@ public:
 	///  @param[in]		maxNodes	Maximum number of search nodes. [Limits: 0 < value <= 65535]
 	/// @returns The status flags for the query.
 	dtStatus init(const dtNavMesh* nav, const int maxNodes);
+
+	/// Moves the query to another mesh with the same tiles, such as a replica of its mesh,
+	/// keeping its search nodes. (See: dtNavMesh::initReplica)
+	///  @param[in]		nav			The mesh to use for all further queries.
+	/// @returns The status flags for the query.
+	dtStatus setNavMesh(const dtNavMesh* nav);
 	
 	/// @name Standard Pathfinding Functions
 	/// @{
@@ -342,6 +358,20 @@ public:
 							 const dtQueryFilter* filter,
 							 dtPolyRef* nearestRef, float* nearestPt, bool* isOverPoly) const;
 	
+	/// Finds the polygons nearest to several points at once.
+	/// Nearby points share a single walk of the tile bounding volume trees, which is
+	/// considerably cheaper than calling #findNearestPoly for each point.
+	///  @param[in]		centers		The centers of the search boxes. [(x, y, z) * @p count]
+	///  @param[in]		count		The number of points.
+	///  @param[in]		halfExtents	The search distance along each axis, shared by all points. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	nearestRefs	The reference id of the nearest polygon for each point, zero if no polygon is found. [(polyRef) * @p count]
+	///  @param[out]	nearestPts	The nearest point on the polygon for each point, unchanged if no polygon is found. [opt] [(x, y, z) * @p count]
+	/// @returns The status flags for the query.
+	dtStatus findNearestPolys(const float* centers, const int count, const float* halfExtents,
+							  const dtQueryFilter* filter,
+							  dtPolyRef* nearestRefs, float* nearestPts) const;
+	
 	/// Finds polygons that overlap the search box.
 	///  @param[in]		center		The center of the search box. [(x, y, z)]
 	///  @param[in]		halfExtents		The search distance along each axis. [(x, y, z)]
@@ -534,6 +564,12 @@ private:
 	void queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 							 const dtQueryFilter* filter, dtPolyQuery* query) const;
 
+	/// Finds the nearest polygons within a tile for a group of points, see findNearestPolys.
+	void findNearestPolysInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
+								const float* centers, const int* group, const int ngroup, const float* halfExtents,
+								const dtQueryFilter* filter, unsigned short* qbounds,
+								float* nearestDist, dtPolyRef* nearestRefs, float* nearestPts) const;
+
 	/// Returns portal points between two polygons.
 	dtStatus getPortalPoints(dtPolyRef from, dtPolyRef to, float* left, float* right,
 							 unsigned char& fromType, unsigned char& toType) const;
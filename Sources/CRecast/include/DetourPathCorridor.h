@@ -80,6 +80,14 @@ public:
 
 	bool trimInvalidPath(dtPolyRef safeRef, const float* safePos,
 						 dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+
+	/// Patches the corridor path after tiles were replaced.
+	///  @param[in]		remaps		The mappings of the replaced tiles. [Size: @p nremaps]
+	///  @param[in]		nremaps		The number of mappings.
+	///  @param[in]		navquery	The query object used to build the corridor.
+	/// @return True if the whole path could be patched, false if it was cut short or
+	/// the first polygon has no counterpart. (In which case the path is left as is.)
+	bool remapPolyRefs(const dtPolyRefRemap* remaps, const int nremaps, dtNavMeshQuery* navquery);
 	
 	/// Checks the current corridor path to see if its polygon references remain valid. 
 	///  @param[in]		maxLookAhead	The number of polygons from the beginning of the corridor to search.
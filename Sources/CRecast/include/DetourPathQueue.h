@@ -59,6 +59,9 @@ public:
 	bool init(const int maxPathSize, const int maxSearchNodeCount, dtNavMesh* nav);
 	
 	void update(const int maxIters);
+
+	/// Drops all requests, queued or in progress, and rewinds the request handles.
+	void clear();
 	
 	dtPathQueueRef request(dtPolyRef startRef, dtPolyRef endRef,
 						   const float* startPos, const float* endPos, 
@@ -23,11 +23,14 @@ class dtProximityGrid
 {
 	float m_cellSize;
 	float m_invCellSize;
+	float m_cellHeight;
+	float m_invCellHeight;
 	
 	struct Item
 	{
 		unsigned short id;
-		short x,y;
+		short x,y,z;
+		short minx,miny,minz;	// The first cell covered by the item.
 		unsigned short next;
 	};
 	Item* m_pool;
@@ -38,32 +41,56 @@ class dtProximityGrid
 	int m_bucketsSize;
 	
 	int m_bounds[4];
+	int m_heightBounds[2];
 	
 public:
 	dtProximityGrid();
 	~dtProximityGrid();
 	
-	bool init(const int poolSize, const float cellSize);
+	/// Initializes the grid.
+	///  @param[in]		poolSize	The maximum number of item cells.
+	///  @param[in]		cellSize	The width and depth of the cells.
+	///  @param[in]		cellHeight	The height of the cells, or zero to ignore the height. [Default: 0]
+	bool init(const int poolSize, const float cellSize, const float cellHeight = 0.0f);
 	
 	void clear();
 	
 	void addItem(const unsigned short id,
 				 const float minx, const float miny,
 				 const float maxx, const float maxy);
+
+	/// Adds an item covering a box, bucketed by height when the grid has a cell height.
+	void addItem(const unsigned short id, const float* bmin, const float* bmax);
+
+	/// Returns the number of item cells an item covering the box takes from the pool,
+	/// or more than the pool size if it can never fit.
+	int getItemCellCount(const float* bmin, const float* bmax) const;
 	
 	int queryItems(const float minx, const float miny,
 				   const float maxx, const float maxy,
 				   unsigned short* ids, const int maxIds) const;
+
+	/// Returns the items in the cells overlapping a box, each item once.
+	int queryItems(const float* bmin, const float* bmax,
+				   unsigned short* ids, const int maxIds) const;
 	
 	int getItemCountAt(const int x, const int y) const;
 	
 	inline const int* getBounds() const { return m_bounds; }
 	inline float getCellSize() const { return m_cellSize; }
+	inline float getCellHeight() const { return m_cellHeight; }
+	inline int getPoolSize() const { return m_poolSize; }
 
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	dtProximityGrid(const dtProximityGrid&);
 	dtProximityGrid& operator=(const dtProximityGrid&);
+
+	void addItem(const unsigned short id, const int iminx, const int iminy, const int iminz,
+				 const int imaxx, const int imaxy, const int imaxz);
+	int queryItems(const int iminx, const int iminy, const int iminz,
+				   const int imaxx, const int imaxy, const int imaxz,
+				   unsigned short* ids, const int maxIds) const;
 };
 
 dtProximityGrid* dtAllocProximityGrid();
@@ -95,10 +95,22 @@ enum rcTimerLabel
 	RC_TIMER_BUILD_POLYMESHDETAIL,
 	/// The time to merge polygon mesh details. (See: #rcMergePolyMeshDetails)
 	RC_TIMER_MERGE_POLYMESHDETAIL,
+	/// The time to classify and bin the input triangles. (See: #rcBuildTriangleTiles)
+	RC_TIMER_BUILD_TRIANGLE_TILES,
+	/// The time to rasterize analytic primitives. (See: #rcRasterizeBox, #rcRasterizeConvex)
+	RC_TIMER_RASTERIZE_PRIMITIVES,
+	/// The time to rasterize point samples. (See: #rcRasterizePoints)
+	RC_TIMER_RASTERIZE_POINTS,
 	/// The maximum number of timers.  (Used for iterating timers.)
 	RC_MAX_TIMERS
 };
 
+/// A function that processes the items [@p begin, @p end) of a job started with rcContext::parallelFor.
+///  @param[in]		userData	The user data passed to rcContext::parallelFor.
+///  @param[in]		begin		The first item to process.
+///  @param[in]		end			One past the last item to process.
+typedef void (*rcParallelForFunc)(void* userData, const int begin, const int end);
+
 /// Provides an interface for optional logging and performance tracking of the Recast 
 /// build process.
 /// 
@@ -111,13 +123,17 @@ enum rcTimerLabel
 /// If no logging or timers are required, just pass an instance of this 
 /// class through the Recast build process.
 /// 
+/// The context also decides how much parallelism the build steps may use.
+/// By default everything runs on the calling thread; see #setMaxThreads
+/// and #doParallelFor.
+/// 
 /// @ingroup recast
 class rcContext
 {
 public:
 	/// Constructor.
 	///  @param[in]		state	TRUE if the logging and performance timers should be enabled.  [Default: true]
-	inline rcContext(bool state = true) : m_logEnabled(state), m_timerEnabled(state) {}
+	inline rcContext(bool state = true) : m_logEnabled(state), m_timerEnabled(state), m_maxThreads(1) {}
 	virtual ~rcContext() {}
 
 	/// Enables or disables logging.
@@ -159,6 +175,23 @@ public:
 	/// @return The accumulated time of the timer, or -1 if timers are disabled or the timer has never been started.
 	inline int getAccumulatedTime(const rcTimerLabel label) const { return m_timerEnabled ? doGetAccumulatedTime(label) : -1; }
 
+	/// Sets the maximum number of threads the build steps may use.
+	///  @param[in]		maxThreads	The thread count. Values below 1 are clamped to 1, which runs
+	///  							everything on the calling thread. [Default: 1]
+	inline void setMaxThreads(int maxThreads) { m_maxThreads = maxThreads < 1 ? 1 : maxThreads; }
+
+	/// Returns the maximum number of threads the build steps may use.
+	inline int getMaxThreads() const { return m_maxThreads; }
+
+	/// Runs @p func over the items [0, @p count), split into at most #getMaxThreads contiguous ranges,
+	/// and returns once all of them have been processed.
+	///
+	/// The ranges may run concurrently, so @p func must only write to data owned by its range.
+	///  @param[in]		count		The number of items to process.
+	///  @param[in]		func		The function called for each range.
+	///  @param[in]		userData	Passed unchanged to @p func.
+	void parallelFor(const int count, rcParallelForFunc func, void* userData);
+
 protected:
 	/// Clears all log entries.
 	virtual void doResetLog();
@@ -184,12 +217,24 @@ protected:
 	/// @param[in]		label	The category of the timer.
 	/// @return The accumulated time of the timer, or -1 if timers are disabled or the timer has never been started.
 	virtual int doGetAccumulatedTime(const rcTimerLabel label) const { rcIgnoreUnused(label); return -1; }
+
+	/// Runs @p func over the items [0, @p count) split into @p nranges contiguous ranges.
+	/// The default implementation starts a thread per range, running the ranges of any thread that
+	/// fails to start on the calling thread; override it to use a job system instead.
+	///  @param[in]		count		The number of items to process.
+	///  @param[in]		nranges		The number of ranges to split the items into. [Limit: 2 <= value <= @p count]
+	///  @param[in]		func		The function called for each range.
+	///  @param[in]		userData	Passed unchanged to @p func.
+	virtual void doParallelFor(const int count, const int nranges, rcParallelForFunc func, void* userData);
 	
 	/// True if logging is enabled.
 	bool m_logEnabled;
 
 	/// True if the performance timers are enabled.
 	bool m_timerEnabled;
+
+	/// The maximum number of threads the build steps may use.
+	int m_maxThreads;
 };
 
 /// A helper to first start a timer and then stop it when this helper goes out of scope.
@@ -324,6 +369,7 @@ struct rcHeightfield
 	rcSpan** spans;		///< Heightfield of spans (width*height).
 	rcSpanPool* pools;	///< Linked list of span pools.
 	rcSpan* freelist;	///< The next free span.
+	int maxCells;		///< The number of allocated columns in #spans.
 
 private:
 	// Explicitly-disabled copy constructor and copy assignment operator.
@@ -370,6 +416,8 @@ struct rcCompactHeightfield
 	rcCompactSpan* spans;		///< Array of spans. [Size: #spanCount]
 	unsigned short* dist;		///< Array containing border distance data. [Size: #spanCount]
 	unsigned char* areas;		///< Array containing area id data. [Size: #spanCount]
+	int maxCells;				///< The number of allocated cells.
+	int maxSpans;				///< The number of allocated entries in #spans and #areas.
 	
 private:
 	// Explicitly-disabled copy constructor and copy assignment operator.
@@ -415,6 +463,29 @@ private:
 	rcHeightfieldLayerSet& operator=(const rcHeightfieldLayerSet&);
 };
 
+/// Represents the triangles of an input mesh binned into a grid of square tiles on the xz-plane.
+/// @ingroup recast
+/// @see rcAllocTriangleTiles, rcFreeTriangleTiles, rcBuildTriangleTiles
+struct rcTriangleTiles
+{
+	rcTriangleTiles();
+	~rcTriangleTiles();
+
+	float bmin[3];		///< The minimum bounds of the input vertices. [(x, y, z)] [Units: wu]
+	float bmax[3];		///< The maximum bounds of the input vertices. [(x, y, z)] [Units: wu]
+	float tileSize;		///< The width and depth of a tile. Tile (0, 0) starts at #bmin. [Units: wu]
+	float tileBorder;	///< How far past its edges a tile collects triangles. [Units: wu]
+	int width;			///< The number of tiles along the x-axis.
+	int height;			///< The number of tiles along the z-axis.
+	int* tileStarts;	///< The triangles of tile (tx, ty) are #tris[tileStarts[tx+ty*width] .. tileStarts[tx+ty*width+1]). [Size: width*height + 1]
+	int* tris;			///< The triangle indices of all tiles, in increasing order within a tile. [Size: tileStarts[width*height]]
+
+private:
+	// Explicitly-disabled copy constructor and copy assignment operator.
+	rcTriangleTiles(const rcTriangleTiles&);
+	rcTriangleTiles& operator=(const rcTriangleTiles&);
+};
+
 /// Represents a simple, non-overlapping contour in field space.
 struct rcContour
 {
@@ -424,6 +495,8 @@ struct rcContour
 	int nrverts;		///< The number of vertices in the raw contour. 
 	unsigned short reg;	///< The region id of the contour.
 	unsigned char area;	///< The area id of the contour.
+	int maxVerts;		///< The number of allocated vertices in #verts.
+	int maxRverts;		///< The number of allocated vertices in #rverts.
 };
 
 /// Represents a group of related contours.
@@ -443,6 +516,7 @@ struct rcContourSet
 	int height;			///< The height of the set. (Along the z-axis in cell units.) 
 	int borderSize;		///< The AABB border size used to generate the source data from which the contours were derived.
 	float maxError;		///< The max edge error that this contour set was simplified with.
+	int maxConts;		///< The number of allocated contours. (The ones past #nconts keep their vertex arrays.)
 	
 private:
 	// Explicitly-disabled copy constructor and copy assignment operator.
@@ -465,6 +539,7 @@ struct rcPolyMesh
 	int nverts;				///< The number of vertices.
 	int npolys;				///< The number of polygons.
 	int maxpolys;			///< The number of allocated polygons.
+	int maxverts;			///< The number of allocated vertices.
 	int nvp;				///< The maximum number of vertices per polygon.
 	float bmin[3];			///< The minimum bounds in world space. [(x, y, z)]
 	float bmax[3];			///< The maximum bounds in world space. [(x, y, z)]
@@ -492,6 +567,9 @@ struct rcPolyMeshDetail
 	int nmeshes;			///< The number of sub-meshes defined by #meshes.
 	int nverts;				///< The number of vertices in #verts.
 	int ntris;				///< The number of triangles in #tris.
+	int maxmeshes;			///< The number of allocated sub-meshes.
+	int maxverts;			///< The number of allocated vertices.
+	int maxtris;			///< The number of allocated triangles.
 	
 private:
 	// Explicitly-disabled copy constructor and copy assignment operator.
@@ -540,6 +618,18 @@ rcHeightfieldLayerSet* rcAllocHeightfieldLayerSet();
 /// @see rcAllocHeightfieldLayerSet
 void rcFreeHeightfieldLayerSet(rcHeightfieldLayerSet* layerSet);
 
+/// Allocates a triangle tile set using the Recast allocator.
+/// @return A triangle tile set that is ready for initialization, or null on failure.
+/// @ingroup recast
+/// @see rcBuildTriangleTiles, rcFreeTriangleTiles
+rcTriangleTiles* rcAllocTriangleTiles();
+
+/// Frees the specified triangle tile set using the Recast allocator.
+/// @param[in]		triangleTiles	A triangle tile set allocated using #rcAllocTriangleTiles
+/// @ingroup recast
+/// @see rcAllocTriangleTiles
+void rcFreeTriangleTiles(rcTriangleTiles* triangleTiles);
+
 /// Allocates a contour set object using the Recast allocator.
 /// @return A contour set that is ready for initialization, or null on failure.
 /// @ingroup recast
@@ -893,6 +983,36 @@ void rcMarkWalkableTriangles(rcContext* context, float walkableSlopeAngle, const
 void rcClearUnwalkableTriangles(rcContext* context, float walkableSlopeAngle, const float* verts, int numVerts,
 								const int* tris, int numTris, unsigned char* triAreaIDs); 
 
+/// Prepares an input mesh for a tiled build: marks the walkable triangles, calculates the
+/// bounds of the vertices, and bins the triangles into the tiles they overlap.
+///
+/// This replaces separate calls to #rcCalcBounds and #rcMarkWalkableTriangles followed by
+/// a binning pass. The triangles are visited once, in blocks laid out so the normal and
+/// bounds math vectorizes, and the work is spread over rcContext::parallelFor.
+/// The result does not depend on the number of threads.
+///
+/// Like #rcMarkWalkableTriangles, only the area ids of walkable triangles are altered.
+///
+/// @see rcTriangleTiles, rcMarkWalkableTriangles
+///
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		walkableSlopeAngle	The maximum slope that is considered walkable.
+/// 									[Limits: 0 <= value < 90] [Units: Degrees]
+/// @param[in]		verts				The vertices. [(x, y, z) * @p nv]
+/// @param[in]		numVerts			The number of vertices.
+/// @param[in]		tris				The triangle vertex indices. [(vertA, vertB, vertC) * @p nt]
+/// @param[in]		numTris				The number of triangles.
+/// @param[in]		tileSize			The width and depth of a tile. [Limit: > 0] [Units: wu]
+/// @param[in]		tileBorder			How far past its edges a tile collects triangles,
+///										usually the border size of the tile. [Limit: >= 0] [Units: wu]
+/// @param[out]		triAreaIDs			The triangle area ids. [Length: >= @p nt]
+/// @param[out]		triangleTiles		The resulting tiles. (Must be pre-allocated.)
+/// @returns True if the operation completed successfully.
+bool rcBuildTriangleTiles(rcContext* context, float walkableSlopeAngle, const float* verts, int numVerts,
+						  const int* tris, int numTris, float tileSize, float tileBorder,
+						  unsigned char* triAreaIDs, rcTriangleTiles& triangleTiles);
+
 /// Adds a span to the specified heightfield.
 /// 
 /// The span addition can be set to favor flags. If the span is merged to
@@ -999,6 +1119,146 @@ bool rcRasterizeTriangles(rcContext* context,
                           const float verts[], const unsigned char triAreaIDs[], int numTris,
                           rcHeightfield& heightfield, int flagMergeThreshold = 1);
 
+/// Rasterizes a convex volume, given by its planes, into the specified heightfield.
+///
+/// The primitive rasterizers compute the span of each column from the height interval of the
+/// primitive along the vertical line through the column center, without tessellating it into
+/// triangles.  Spans are only added to the columns whose center is inside the footprint of the
+/// primitive, so primitives thinner than a cell may be missed.
+///
+/// Like rcMarkWalkableTriangles does for triangles, the spans where the top surface of the
+/// primitive is steeper than @p walkableSlopeAngle get #RC_NULL_AREA instead of @p areaID.
+///
+/// A point is inside the volume when <tt>nx*x + ny*y + nz*z + d <= 0</tt> for every plane.
+///
+/// @see rcHeightfield, rcRasterizeBox
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		planes				The planes of the volume. [(nx, ny, nz, d) * @p numPlanes]
+/// @param[in]		numPlanes			The number of planes.
+/// @param[in]		shapeMin			The minimum bounds of the volume. [(x, y, z)]
+/// @param[in]		shapeMax			The maximum bounds of the volume. [(x, y, z)]
+/// @param[in]		walkableSlopeAngle	The maximum slope that is considered walkable. [Limits: 0 <= value < 90] [Units: Degrees]
+/// @param[in]		areaID				The area id of the walkable surface of the volume. [Limit: <= #RC_WALKABLE_AREA]
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeConvex(rcContext* context, const float* planes, int numPlanes,
+                       const float* shapeMin, const float* shapeMax, float walkableSlopeAngle,
+                       unsigned char areaID, rcHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Rasterizes an oriented box into the specified heightfield.
+///
+/// @see rcHeightfield, rcRasterizeConvex
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		center				The center of the box. [(x, y, z)]
+/// @param[in]		halfExtents			The half size of the box along each of its axes.
+/// @param[in]		axes				The unit axes of the box, or null for an axis aligned box. [(x, y, z) * 3] [opt]
+/// @param[in]		walkableSlopeAngle	The maximum slope that is considered walkable. [Limits: 0 <= value < 90] [Units: Degrees]
+/// @param[in]		areaID				The area id of the walkable surface of the box. [Limit: <= #RC_WALKABLE_AREA]
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeBox(rcContext* context, const float* center, const float* halfExtents, const float* axes,
+                    float walkableSlopeAngle, unsigned char areaID, rcHeightfield& heightfield,
+                    int flagMergeThreshold = 1);
+
+/// Rasterizes a sphere into the specified heightfield.
+///
+/// @see rcHeightfield, rcRasterizeConvex
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		center				The center of the sphere. [(x, y, z)]
+/// @param[in]		radius				The radius of the sphere.
+/// @param[in]		walkableSlopeAngle	The maximum slope that is considered walkable. [Limits: 0 <= value < 90] [Units: Degrees]
+/// @param[in]		areaID				The area id of the walkable surface of the sphere. [Limit: <= #RC_WALKABLE_AREA]
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeSphere(rcContext* context, const float* center, float radius, float walkableSlopeAngle,
+                       unsigned char areaID, rcHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Rasterizes a vertical cylinder into the specified heightfield.
+///
+/// The top of the cylinder is flat, so all of its spans get @p areaID.
+///
+/// @see rcHeightfield, rcRasterizeConvex
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		position			The center of the base of the cylinder. [(x, y, z)]
+/// @param[in]		radius				The radius of the cylinder.
+/// @param[in]		height				The height of the cylinder.
+/// @param[in]		areaID				The area id of the cylinder. [Limit: <= #RC_WALKABLE_AREA]
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeCylinder(rcContext* context, const float* position, float radius, float height,
+                         unsigned char areaID, rcHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Rasterizes a capsule into the specified heightfield.
+///
+/// @see rcHeightfield, rcRasterizeConvex
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		start				The center of one end of the capsule. [(x, y, z)]
+/// @param[in]		end					The center of the other end of the capsule. [(x, y, z)]
+/// @param[in]		radius				The radius of the capsule.
+/// @param[in]		walkableSlopeAngle	The maximum slope that is considered walkable. [Limits: 0 <= value < 90] [Units: Degrees]
+/// @param[in]		areaID				The area id of the walkable surface of the capsule. [Limit: <= #RC_WALKABLE_AREA]
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeCapsule(rcContext* context, const float* start, const float* end, float radius,
+                        float walkableSlopeAngle, unsigned char areaID, rcHeightfield& heightfield,
+                        int flagMergeThreshold = 1);
+
+/// Rasterizes surface point samples, such as a point cloud or unprojected depth samples, into
+/// the specified heightfield.
+///
+/// Each point is splatted to the columns within @p splatRadius of it.  The samples of each column
+/// are accumulated into spans covering their minimum and maximum height, and the spans are then
+/// merged into the heightfield, so a heightfield can be fed incrementally, one frame at a time.
+///
+/// With normals, the points on slopes steeper than @p walkableSlopeAngle are not walkable, and
+/// the splats of the walkable points follow their tangent plane.
+///
+/// @see rcHeightfield, rcClearSpans
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		points				The points. [(x, y, z) * @p numPoints]
+/// @param[in]		normals				The unit normals of the surface at the points. [(x, y, z) * @p numPoints] [opt]
+/// @param[in]		numPoints			The number of points.
+/// @param[in]		walkableSlopeAngle	The maximum slope that is considered walkable. [Limits: 0 <= value < 90] [Units: Degrees]
+/// @param[in]		splatRadius			The radius of the surface covered by a point, zero covers the column of the point. [Units: wu]
+/// @param[in]		areaID				The area id of the walkable points. [Limit: <= #RC_WALKABLE_AREA]
+/// @param[in]		maxGap				The largest vertical gap between the samples of a column that is closed. [Limit: >= 0] [Units: vx]
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizePoints(rcContext* context, const float* points, const float* normals, int numPoints,
+                       float walkableSlopeAngle, float splatRadius, unsigned char areaID,
+                       int maxGap, rcHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Removes the spans that overlap a box from the specified heightfield.
+///
+/// Used to replace the part of a heightfield seen again in a new frame of point samples.
+/// Only the columns whose center is inside the box are cleared.
+///
+/// @see rcHeightfield, rcRasterizePoints
+/// @ingroup recast
+/// @param[in,out]	context			The build context to use during the operation.
+/// @param[in]		boxMinBounds	The minimum extents of the box. [(x, y, z)] [Units: wu]
+/// @param[in]		boxMaxBounds	The maximum extents of the box. [(x, y, z)] [Units: wu]
+/// @param[in,out]	heightfield		An initialized heightfield.
+void rcClearSpans(rcContext* context, const float* boxMinBounds, const float* boxMaxBounds, rcHeightfield& heightfield);
+
 /// Marks non-walkable spans as walkable if their maximum is within @p walkableClimb of a walkable neighbor.
 ///
 /// Allows the formation of walkable regions that will flow over low lying 
@@ -43,8 +43,7 @@ public class CrowdAgent: CustomDebugStringConvertible {
         get {
             // This can never fail
             let r = dtCrowdGetAgent(crowd.crowd, idx)!
-            let p = r.params
-            return CrowdAgent.Params(radius: p.radius, height: p.height, maxAcceleration: p.maxAcceleration, maxSpeed: p.maxSpeed, collisionQueryRange: p.collisionQueryRange, pathOptimizationRange: p.pathOptimizationRange, separationWeight: p.separationWeight, updateFlags: UpdateFlags (rawValue: p.updateFlags), obstacleAvoidanceType: p.obstacleAvoidanceType, queryFilterType: p.queryFilterType, userData: p.userData)
+            return CrowdAgent.Params(r.params)
         }
         set {
             var p = newValue.todtCrowdAgentParams()
@@ -290,6 +289,10 @@ public class CrowdAgent: CustomDebugStringConvertible {
             self.userData = userData
         }
         
+        init (_ p: dtCrowdAgentParams) {
+            self.init(radius: p.radius, height: p.height, maxAcceleration: p.maxAcceleration, maxSpeed: p.maxSpeed, collisionQueryRange: p.collisionQueryRange, pathOptimizationRange: p.pathOptimizationRange, separationWeight: p.separationWeight, updateFlags: UpdateFlags (rawValue: p.updateFlags), obstacleAvoidanceType: p.obstacleAvoidanceType, queryFilterType: p.queryFilterType, userData: p.userData)
+        }
+        
         func todtCrowdAgentParams () -> dtCrowdAgentParams {
             dtCrowdAgentParams(radius: radius, height: height, maxAcceleration: maxAcceleration, maxSpeed: maxSpeed, collisionQueryRange: collisionQueryRange, pathOptimizationRange: pathOptimizationRange, separationWeight: separationWeight, updateFlags: UInt8 (updateFlags.rawValue), obstacleAvoidanceType: obstacleAvoidanceType, queryFilterType: queryFilterType, userData: userData)
         }
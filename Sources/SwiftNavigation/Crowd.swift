@@ -165,12 +165,106 @@ public class Crowd {
         return CrowdAgent (crowd: self, idx: idx)
     }
     
+    /// Adds many agents to the crowd in one call, all sharing the same configuration.
+    ///
+    /// This is considerably cheaper than calling ``addAgent(_:params:)`` in a loop, as the
+    /// positions are snapped to the navigation mesh in batches.
+    /// - Parameters:
+    ///   - positions: Requested positions for the agents.
+    ///   - params: The configuration for the agents.
+    /// - Returns: An array with one element per position, containing the agent, or nil if it was not possible to add that agent.
+    public func addAgents (_ positions: [SIMD3<Float>], params: CrowdAgent.Params) -> [CrowdAgent?] {
+        addAgents (positions, params: Array (repeating: params, count: positions.count))
+    }
+    
+    /// Adds many agents to the crowd in one call, each with its own configuration.
+    ///
+    /// This is considerably cheaper than calling ``addAgent(_:params:)`` in a loop, as the
+    /// positions are snapped to the navigation mesh in batches.
+    /// - Parameters:
+    ///   - positions: Requested positions for the agents.
+    ///   - params: The configuration for each agent, must have the same number of elements as `positions`.
+    /// - Returns: An array with one element per position, containing the agent, or nil if it was not possible to add that agent.
+    public func addAgents (_ positions: [SIMD3<Float>], params: [CrowdAgent.Params]) -> [CrowdAgent?] {
+        precondition (params.count == positions.count, "The number of parameters must match the number of positions")
+        let pos = NavMeshBuilder.flatten (positions)
+        let p = params.map { $0.todtCrowdAgentParams () }
+        var idxs = [Int32] (repeating: -1, count: positions.count)
+        
+        crowd.addAgents(pos, p, Int32 (positions.count), &idxs)
+        return idxs.map { idx in
+            idx == -1 ? nil : CrowdAgent (crowd: self, idx: idx)
+        }
+    }
+    
     /// Removes an agent from the crowd
     public func remove (agent: CrowdAgent) {
         crowd.removeAgent(agent.idx)
         agent.idx = -1
     }
     
+    /// Submits a move request to the same target for many agents in one call.
+    ///
+    /// This is cheaper than calling ``CrowdAgent/requestMove(target:)`` on each agent.
+    /// - Parameters:
+    ///   - agents: the agents that should move to the target
+    ///   - target: location for the agents to target
+    /// - Returns: the number of agents for which the request was accepted
+    @discardableResult
+    public func requestMove (agents: [CrowdAgent], target: PointInPoly) -> Int {
+        let idxs = agents.map { $0.idx }
+        return Int (crowd.requestMoveTargets(idxs, Int32 (idxs.count), target.polyRef, target.point))
+    }
+    
+    /// Submits a move request towards a position for many agents in one call.
+    ///
+    /// The position is snapped to the navigation mesh once for the whole group (once per
+    /// query filter type in use by the agents), rather than requiring a call to
+    /// ``NavMeshQuery/findNearestPoint(point:extents:filter:)`` per agent.
+    /// - Parameters:
+    ///   - agents: the agents that should move to the target
+    ///   - position: the position to move to, it does not need to be on the navigation mesh.
+    /// - Returns: the number of agents for which the request was accepted
+    @discardableResult
+    public func requestMove (agents: [CrowdAgent], position: SIMD3<Float>) -> Int {
+        let idxs = agents.map { $0.idx }
+        let pos: [Float] = [position.x, position.y, position.z]
+        return Int (crowd.requestMoveTargets(idxs, Int32 (idxs.count), pos, nil, nil))
+    }
+    
+    /// Retrieves the parameters for many agents in one call
+    /// - Parameter agents: the agents to retrieve the parameters from
+    /// - Returns: the parameters, in the same order as `agents`, with `nil` for the agents
+    /// that are no longer part of the crowd
+    public func params (for agents: [CrowdAgent]) -> [CrowdAgent.Params?] {
+        let idxs = agents.map { $0.idx }
+        var result = [dtCrowdAgentParams] (repeating: dtCrowdAgentParams (), count: idxs.count)
+        var valid = [UInt8] (repeating: 0, count: idxs.count)
+        crowd.getAgentParameters(idxs, Int32 (idxs.count), &result, &valid)
+        return result.indices.map { valid [$0] != 0 ? CrowdAgent.Params (result [$0]) : nil }
+    }
+    
+    /// Updates the parameters of many agents in one call
+    /// - Parameters:
+    ///   - params: the new parameters, one for each agent
+    ///   - agents: the agents to update, must have the same number of elements as `params`
+    public func update (params: [CrowdAgent.Params], for agents: [CrowdAgent]) {
+        precondition (params.count == agents.count, "The number of parameters must match the number of agents")
+        let idxs = agents.map { $0.idx }
+        let p = params.map { $0.todtCrowdAgentParams () }
+        crowd.updateAgentParameters(idxs, Int32 (idxs.count), p)
+    }
+    
+    /// Sets the same parameters on many agents in one call
+    /// - Parameters:
+    ///   - params: the new parameters
+    ///   - agents: the agents to update
+    public func update (params: CrowdAgent.Params, for agents: [CrowdAgent]) {
+        let idxs = agents.map { $0.idx }
+        let p = Array (repeating: params.todtCrowdAgentParams (), count: idxs.count)
+        crowd.updateAgentParameters(idxs, Int32 (idxs.count), p)
+    }
+    
     /// Update the simulation.
     /// - Parameter dt: the time in seconds, to update the simulation
     public func update (time: Float) {
@@ -118,4 +118,13 @@ public class NavMesh {
     public func makeCrowd (maxAgents: Int, agentRadius: Float) throws -> Crowd {
         try Crowd (maxAgents: Int32 (maxAgents), agentRadius: agentRadius, nav: self)
     }
+
+    /// Creates an extractor of the geometry of the tiles, to draw the navigation mesh
+    ///
+    /// - Parameters:
+    ///   - heightOffset: How much to lift the geometry above the navigation mesh.
+    /// - Returns: A debug mesh that re-extracts only the tiles that changed
+    public func makeDebugMesh (heightOffset: Float = 0.1) throws -> NavMeshDebugMesh {
+        try NavMeshDebugMesh (nav: self, heightOffset: heightOffset)
+    }
 }
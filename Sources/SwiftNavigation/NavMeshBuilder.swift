@@ -314,6 +314,16 @@ public class NavMeshBuilder {
         ///
         /// Defaults to false
         public var filterLedgeSpans: Bool
+        
+        /// The maximum number of threads used while partitioning the heightfield.
+        ///
+        /// The monotone and layer partitioners sweep the rows of the heightfield in
+        /// parallel, and produce the same regions regardless of the thread count.
+        /// A value of zero uses one thread per active processor, and one runs the
+        /// whole build on the calling thread.
+        ///
+        /// Defaults to 1
+        public var maxThreads: Int32
         /// Constructs the configuration object, sets the various properties, additional information on meaning of these parameters
         /// is available in the property documentation for each one.
         ///
@@ -351,6 +361,8 @@ public class NavMeshBuilder {
         ///     (For height detail only.) [Limits: 0 or >= 0.9] [Units: wu].   Defaults to 6.0
         ///   - detailSampleMaxError: The maximum distance the detail mesh surface should deviate from heightfield
         ///     data. (For height detail only.) [Limit: >=0] [Units: wu].  Defaults to 1.0
+        ///   - maxThreads: The maximum number of threads used while partitioning the heightfield,
+        ///     zero uses one thread per active processor.  Defaults to 1
         public init(width: Int32? = nil,
                     height: Int32? = nil,
                     tileSize: Int32 = 32,
@@ -373,7 +385,8 @@ public class NavMeshBuilder {
                     detailSampleMaxError: Float = 1,
                     filterLowHangingObstables: Bool = false,
                     filterLedgeSpans: Bool = false,
-                    filterWalkableLowHeightSpans: Bool = false) {
+                    filterWalkableLowHeightSpans: Bool = false,
+                    maxThreads: Int32 = 1) {
             self.width = width
             self.height = height
             self.tileSize = tileSize
@@ -397,6 +410,7 @@ public class NavMeshBuilder {
             self.filterLowHangingObstables = filterLowHangingObstables
             self.filterLedgeSpans = filterLedgeSpans
             self.filterWalkableLowHeightSpans = filterWalkableLowHeightSpans
+            self.maxThreads = maxThreads
         }
     }
     
@@ -529,7 +543,7 @@ public class NavMeshBuilder {
         let ret = vertices.withUnsafeBufferPointer { ptr in
             ptr.withMemoryRebound(to: Float.self) { vertPtr in
                 triangles.withUnsafeBufferPointer { trianglePtr in
-                    bindingRunBulk (&cfg, flags, vertPtr.baseAddress, Int32 (vertices.count/3), trianglePtr.baseAddress, Int32(triangles.count/3))
+                    bindingRunBulk (&cfg, flags, config.maxThreads, vertPtr.baseAddress, Int32 (vertices.count/3), trianglePtr.baseAddress, Int32(triangles.count/3))
                 }
             }
         }
@@ -0,0 +1,89 @@
+//
+// Debug geometry of a NavMesh
+//
+import Foundation
+import CRecast
+#if canImport(RealityKit)
+import RealityKit
+#endif
+
+/// Extracts the geometry of the tiles of a ``NavMesh`` for drawing it over the world, and
+/// keeps it up to date as tiles are added, replaced or removed.
+///
+/// Create it with ``NavMesh/makeDebugMesh(heightOffset:)``.   Call ``update(maxTiles:)`` where
+/// the navigation mesh is not being changed, and then only redraw the tiles returned by
+/// ``changedTiles(since:)``, so large worlds can show the navigation mesh without rebuilding
+/// all of it every time a tile changes.
+public class NavMeshDebugMesh {
+    public enum DebugMeshError: Error {
+        /// Failed to allocate memory
+        case alloc
+    }
+    // Keeps the navigation mesh alive while the extractor reads it
+    let nav: NavMesh
+    let mesh: OpaquePointer
+
+    init (nav: NavMesh, heightOffset: Float) throws {
+        guard let mesh = bindingCreateDebugMesh(nav.navMesh, heightOffset) else {
+            throw DebugMeshError.alloc
+        }
+        self.nav = nav
+        self.mesh = mesh
+    }
+
+    deinit {
+        bindingFreeDebugMesh(mesh)
+    }
+
+    /// A counter that is incremented by every ``update(maxTiles:)`` that extracted a tile
+    public var version: UInt32 {
+        bindingDebugMeshVersion(mesh)
+    }
+
+    /// The number of tile slots, tiles are identified by their slot index
+    public var tileCount: Int {
+        Int (bindingDebugMeshTileCount(mesh))
+    }
+
+    /// Extracts the geometry of the tiles that changed since the last update
+    /// - Parameter maxTiles: the maximum number of tiles to extract, zero extracts all of them,
+    /// the rest are extracted by the next updates.
+    /// - Returns: the number of tiles extracted
+    @discardableResult
+    public func update (maxTiles: Int = 0) -> Int {
+        Int (bindingDebugMeshUpdate(mesh, Int32 (maxTiles)))
+    }
+
+    /// Returns the slots of the tiles whose geometry changed after the given ``version``
+    public func changedTiles (since version: UInt32) -> [Int] {
+        var tiles = [Int32] (repeating: 0, count: tileCount)
+        let n = bindingDebugMeshChangedTiles(mesh, version, &tiles, Int32 (tiles.count))
+        return tiles [0..<Int (n)].map { Int ($0) }
+    }
+
+    /// Returns the geometry of a tile, which is empty if the slot has no tile
+    public func geometry (tile: Int) -> (positions: [SIMD3<Float>], triangles: [UInt32]) {
+        guard let t = bindingDebugMeshTile(mesh, Int32 (tile))?.pointee, t.nverts > 0 else {
+            return ([], [])
+        }
+        let positions = t.verts.withMemoryRebound(to: SIMD3<Float>.self, capacity: Int (t.nverts)) { ptr in
+            Array (UnsafeBufferPointer (start: ptr, count: Int (t.nverts)))
+        }
+        let triangles = Array (UnsafeBufferPointer (start: t.triangles, count: Int (t.ntris)*3))
+        return (positions, triangles)
+    }
+
+    #if canImport(RealityKit)
+    /// Returns the geometry of a tile as a MeshResource, or nil if the slot has no tile
+    public func meshResource (tile: Int) throws -> MeshResource? {
+        let (positions, triangles) = geometry (tile: tile)
+        if triangles.isEmpty {
+            return nil
+        }
+        var descriptor = MeshDescriptor()
+        descriptor.positions = MeshBuffer(positions)
+        descriptor.primitives = .triangles(triangles)
+        return try MeshResource.generate(from: [descriptor])
+    }
+    #endif
+}
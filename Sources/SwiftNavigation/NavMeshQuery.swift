@@ -72,6 +72,27 @@ public class NavMeshQuery {
         return .failure (NavMesh.statusToError(res))
     }
     
+    /// Gets a random point in the mesh, storing the location in the provided value instead of
+    /// allocating a new ``PointInPoly``.
+    /// - Parameters:
+    ///  - filter: an optional filter to determine the elegibility of a polygon
+    ///  - randomFunction: optional, if specified, it is a function that returns a value in the range `0..<1`
+    ///  - point: on success, this is updated with the location of the random point
+    /// - Returns: the polygon reference that contains the point, or a NavMeshError on failure
+    public func findRandomPoint (filter custom: NavQueryFilter? = nil, randomFunction: (@convention(c) () -> Float)? = nil, into point: inout SIMD3<Float>) -> Result<dtPolyRef,NavMesh.NavMeshError> {
+        var polyRef: dtPolyRef = 0
+        
+        let res = withUnsafeMutablePointer(to: &point) { pointPtr in
+            pointPtr.withMemoryRebound(to: Float.self, capacity: 3) { pointPtrCast in
+                query.findRandomPoint((custom ?? self.filter).query, randomFunction ?? floatRand, &polyRef, pointPtrCast)
+            }
+        }
+        if dtStatusSucceed(res) {
+            return .success(polyRef)
+        }
+        return .failure (NavMesh.statusToError(res))
+    }
+    
     /// Finds a path corridor in term of polygon references from the start polygon to the end polygon.
     ///
     /// If the end polygon cannot be reached through the navigation graph,
@@ -106,6 +127,48 @@ public class NavMeshQuery {
         return .failure(NavMesh.statusToError(res))
     }
     
+    /// Finds a path corridor in term of polygon references from the start polygon to the end polygon,
+    /// storing the result in a caller-owned buffer.
+    ///
+    /// This version does not allocate, so the buffer can be reused across many queries.  If the buffer
+    /// is too small to hold the full result, it will be filled as far as possible from the start polygon
+    /// toward the end polygon.
+    ///
+    /// - Parameters:
+    ///  - filter: an optional filter to determine the elegibility of a polygon
+    ///  - start: initial starting point
+    ///  - end: end point
+    ///  - corridor: the buffer that receives the polygon references, its size is the maximum number of polygons returned.
+    /// - Returns: on success, the number of polygon references stored in `corridor`, on failure, a detail for the reason why the path could not be found
+    public func findPathCorridor (filter custom: NavQueryFilter? = nil, start: PointInPoly, end: PointInPoly, into corridor: UnsafeMutableBufferPointer<dtPolyRef>) -> Result<Int,NavMesh.NavMeshError> {
+        var count: Int32 = 0
+        
+        let res = query.findPath(start.polyRef, end.polyRef, start.point, end.point, (custom ?? self.filter).query, corridor.baseAddress, &count, Int32(corridor.count))
+        if dtStatusSucceed(res) {
+            return .success(Int (count))
+        }
+        return .failure(NavMesh.statusToError(res))
+    }
+    
+    /// Finds a path corridor in term of polygon references from the start polygon to the end polygon,
+    /// storing the result in a caller-owned array.
+    ///
+    /// The array is not resized, its current `count` is the maximum number of polygons that will be
+    /// returned, and the elements past the returned count are left untouched.  Keep the array around
+    /// and pass it again on the next query to avoid allocating.
+    ///
+    /// - Parameters:
+    ///  - filter: an optional filter to determine the elegibility of a polygon
+    ///  - start: initial starting point
+    ///  - end: end point
+    ///  - corridor: the array that receives the polygon references.
+    /// - Returns: on success, the number of polygon references stored in `corridor`, on failure, a detail for the reason why the path could not be found
+    public func findPathCorridor (filter custom: NavQueryFilter? = nil, start: PointInPoly, end: PointInPoly, into corridor: inout [dtPolyRef]) -> Result<Int,NavMesh.NavMeshError> {
+        corridor.withUnsafeMutableBufferPointer { corridorPtr in
+            findPathCorridor(filter: custom, start: start, end: end, into: corridorPtr)
+        }
+    }
+    
     public struct StraightPathOptions: OptionSet {
         public init (rawValue: Int32) {
             self.rawValue = rawValue
@@ -233,6 +296,213 @@ public class NavMeshQuery {
         }
     }
     
+    /// Finds the straight path from the start to the end position within the polygon corridor, storing
+    /// the result in a reusable ``PathBuffer``.
+    ///
+    /// This is the allocation-free version of ``findStraightPath(filter:startPos:endPos:pathCorridor:maxPaths:options:)``,
+    /// the maximum number of points returned is the ``PathBuffer/maxPoints`` value of the buffer.
+    ///
+    /// - Parameters:
+    ///  - filter: an optional filter to determine the elegibility of a polygon
+    ///  - startPos: the starting position
+    ///  - endPos: the ending position
+    ///  - pathCorridor: the polygons to traverse, as returned by ``findPathCorridor(filter:start:end:into:)``
+    ///  - options: options controlling which vertices to add.
+    ///  - buffer: the buffer that receives the points, flags and polygon references of the straight path.
+    /// - Returns: on success, the number of points stored in the buffer.
+    public func findStraightPath (filter custom: NavQueryFilter? = nil, startPos: SIMD3<Float>, endPos: SIMD3<Float>, pathCorridor: UnsafeBufferPointer<dtPolyRef>, options: StraightPathOptions = [], into buffer: PathBuffer) -> Result<Int, NavMesh.NavMeshError> {
+        var _startPos = startPos
+        var _endPos = endPos
+        var resultCount: Int32 = 0
+        
+        buffer.count = 0
+        buffer.setEnds (start: PointInPoly (polyRef: pathCorridor.first ?? 0, point: [startPos.x, startPos.y, startPos.z]),
+                        end: PointInPoly (polyRef: pathCorridor.last ?? 0, point: [endPos.x, endPos.y, endPos.z]))
+        let res = withUnsafeMutablePointer(to: &_startPos) { startPtr in
+            startPtr.withMemoryRebound(to: Float.self, capacity: 3) { startPtrCast in
+                withUnsafeMutablePointer(to: &_endPos) { endPtr in
+                    endPtr.withMemoryRebound(to: Float.self, capacity: 3) { endPtrCast in
+                        query.findStraightPath(startPtrCast, endPtrCast, pathCorridor.baseAddress, Int32(pathCorridor.count), buffer.points, buffer.flagStorage, buffer.refs, &resultCount, Int32(buffer.maxPoints), options.rawValue)
+                    }
+                }
+            }
+        }
+        if dtStatusSucceed(res) {
+            buffer.count = Int (resultCount)
+            return .success(buffer.count)
+        }
+        return .failure(NavMesh.statusToError(res))
+    }
+    
+    /// Finds the path corridor and the straight path from the start to the end position in a single call,
+    /// storing both in a reusable ``PathBuffer``.
+    ///
+    /// This performs the same work as ``findStraightPath(filter:startPos:endPos:maxPaths:options:)``, but
+    /// both Detour steps run in one trip into the native library and no arrays are allocated, which
+    /// makes it suitable to be called thousands of times per second.   The corridor is available in
+    /// ``PathBuffer/corridor`` after the call.
+    ///
+    /// - Parameters:
+    ///  - filter: an optional filter to determine the elegibility of a polygon
+    ///  - startPos: the starting position as a PointInPoly location.
+    ///  - endPos: the ending position as a PointInPoly location.
+    ///  - options: options controlling which vertices to add.
+    ///  - buffer: the buffer that receives the corridor and the straight path.
+    /// - Returns: on success, the number of points stored in the buffer.
+    public func findStraightPath (filter custom: NavQueryFilter? = nil, startPos: PointInPoly, endPos: PointInPoly, options: StraightPathOptions = [], into buffer: PathBuffer) -> Result<Int, NavMesh.NavMeshError> {
+        var corridorCount: Int32 = 0
+        var resultCount: Int32 = 0
+        
+        buffer.setEnds (start: startPos, end: endPos)
+        let res = bindingFindStraightPathCorridor(query, (custom ?? self.filter).query, startPos.polyRef, endPos.polyRef, startPos.point, endPos.point, buffer.corridorStorage, &corridorCount, Int32(buffer.maxCorridor), buffer.points, buffer.flagStorage, buffer.refs, &resultCount, Int32(buffer.maxPoints), options.rawValue)
+        buffer.corridorCount = Int (corridorCount)
+        buffer.count = Int (resultCount)
+        if dtStatusSucceed(res) {
+            return .success(buffer.count)
+        }
+        return .failure(NavMesh.statusToError(res))
+    }
+    
+    /// Finds the straight path between two world positions in a single call.
+    ///
+    /// The positions are snapped to the nearest polygons using `extents`, the polygon corridor is
+    /// computed, and then string-pulled, all in one trip into the native library.  This replaces
+    /// calling ``findNearestPoint(point:extents:filter:)`` twice, followed by
+    /// ``findPathCorridor(filter:start:end:maxPaths:)`` and ``findStraightPath(filter:startPos:endPos:pathCorridor:maxPaths:options:)``.
+    ///
+    /// The corridor, the snapped positions and the straight path are stored in the provided buffer,
+    /// which can be reused across calls, so no memory is allocated.
+    ///
+    /// - Parameters:
+    ///  - filter: an optional filter to determine the elegibility of a polygon
+    ///  - from: the starting position in world coordinates
+    ///  - to: the ending position in world coordinates
+    ///  - extents: The search distance along each axis used to locate the polygons.  Defaults to `(1, 1, 1)`
+    ///  - options: options controlling which vertices to add.
+    ///  - buffer: the buffer that receives the results.
+    /// - Returns: on success, the number of points stored in the buffer.
+    public func findStraightPath (filter custom: NavQueryFilter? = nil, from: SIMD3<Float>, to: SIMD3<Float>, extents: SIMD3<Float> = [1, 1, 1], options: StraightPathOptions = [], into buffer: PathBuffer) -> Result<Int, NavMesh.NavMeshError> {
+        var _from = from
+        var _to = to
+        var _extents = extents
+        
+        let res = withUnsafeMutablePointer(to: &_from) { fromPtr in
+            fromPtr.withMemoryRebound(to: Float.self, capacity: 3) { fromPtrCast in
+                withUnsafeMutablePointer(to: &_to) { toPtr in
+                    toPtr.withMemoryRebound(to: Float.self, capacity: 3) { toPtrCast in
+                        withUnsafeMutablePointer(to: &_extents) { extentsPtr in
+                            extentsPtr.withMemoryRebound(to: Float.self, capacity: 3) { extentsPtrCast in
+                                bindingFindPath(query, (custom ?? self.filter).query, fromPtrCast, toPtrCast, extentsPtrCast, options.rawValue, buffer.result)
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        if dtStatusSucceed(res) {
+            return .success(buffer.count)
+        }
+        return .failure(NavMesh.statusToError(res))
+    }
+    
+    /// Reusable storage for the results of path queries.
+    ///
+    /// Create one of these once, and pass it to the `into:` versions of the path finding methods, like
+    /// ``NavMeshQuery/findStraightPath(filter:startPos:endPos:options:into:)``, to run queries
+    /// without allocating memory on every call.  The contents are overwritten by every query, and the
+    /// buffer must not be shared by queries running concurrently.
+    public final class PathBuffer {
+        // The native storage, shared with the bridge so that bindingFindPath can fill it in place.
+        let result: UnsafeMutablePointer<BindingPathResult>
+        
+        /// The maximum number of polygons that the corridor can hold
+        public let maxCorridor: Int
+        /// The maximum number of points that the straight path can hold
+        public let maxPoints: Int
+        
+        /// Number of polygon references stored in ``corridor``
+        public internal(set) var corridorCount: Int {
+            get { Int (result.pointee.corridorCount) }
+            set { result.pointee.corridorCount = Int32 (newValue) }
+        }
+        
+        /// Number of points in the straight path
+        public internal(set) var count: Int {
+            get { Int (result.pointee.count) }
+            set { result.pointee.count = Int32 (newValue) }
+        }
+        
+        var corridorStorage: UnsafeMutablePointer<dtPolyRef> { result.pointee.corridor }
+        var points: UnsafeMutablePointer<Float> { result.pointee.points }
+        var flagStorage: UnsafeMutablePointer<UInt8> { result.pointee.flags }
+        var refs: UnsafeMutablePointer<dtPolyRef> { result.pointee.refs }
+        
+        // Records the end points of a query that did not snap them itself
+        func setEnds (start: PointInPoly, end: PointInPoly) {
+            result.pointee.startRef = start.polyRef
+            result.pointee.startPos = (start.point [0], start.point [1], start.point [2])
+            result.pointee.endRef = end.polyRef
+            result.pointee.endPos = (end.point [0], end.point [1], end.point [2])
+        }
+        
+        /// Creates a buffer for path queries
+        /// - Parameters:
+        ///   - maxCorridor: the maximum number of polygons in the path corridor
+        ///   - maxPoints: the maximum number of points in the straight path
+        public init (maxCorridor: Int = 512, maxPoints: Int = 512) {
+            precondition (maxCorridor > 0 && maxCorridor <= Int32.max, "maxCorridor out of range")
+            precondition (maxPoints > 0 && maxPoints <= Int32.max / 3, "maxPoints out of range")
+            guard let result = bindingAllocPathResult(Int32 (maxCorridor), Int32 (maxPoints)) else {
+                fatalError("Could not allocate a PathBuffer")
+            }
+            self.result = result
+            self.maxCorridor = maxCorridor
+            self.maxPoints = maxPoints
+        }
+        
+        deinit {
+            bindingFreePathResult(result)
+        }
+        
+        /// The start location of the last query that filled this buffer, for the
+        /// ``NavMeshQuery/findStraightPath(filter:from:to:extents:options:into:)`` query this is the position snapped to the navigation mesh.
+        public var start: PointInPoly {
+            let p = result.pointee.startPos
+            return PointInPoly(polyRef: result.pointee.startRef, point: [p.0, p.1, p.2])
+        }
+        
+        /// The end location of the last query that filled this buffer, for the
+        /// ``NavMeshQuery/findStraightPath(filter:from:to:extents:options:into:)`` query this is the position snapped to the navigation mesh.
+        public var end: PointInPoly {
+            let p = result.pointee.endPos
+            return PointInPoly(polyRef: result.pointee.endRef, point: [p.0, p.1, p.2])
+        }
+        
+        /// The polygon corridor computed by the last query, only valid until the next query that uses this buffer.
+        public var corridor: UnsafeBufferPointer<dtPolyRef> {
+            UnsafeBufferPointer (start: corridorStorage, count: corridorCount)
+        }
+        
+        /// The point at the specified index in the straight path
+        public subscript (idx: Int) -> SIMD3<Float> {
+            if idx >= count {
+                fatalError("Out of range \(idx) maxValue is \(count)")
+            }
+            let base = idx * 3
+            return SIMD3<Float> (points [base], points [base+1], points [base+2])
+        }
+        
+        /// The flags for the point at the specified index in the straight path
+        public func flags (at idx: Int) -> StraightPathFlags {
+            StraightPathFlags (rawValue: flagStorage [idx])
+        }
+        
+        /// The reference of the polygon that is entered at the specified point of the straight path.
+        public func polyRef (at idx: Int) -> dtPolyRef {
+            refs [idx]
+        }
+    }
+    
     /// Contains the resulting value for calling ``findStraightPath(filter:startPos:endPos:pathCorridor:maxPaths:options:)``
     /// The arrays are guaranteed to contains the same elements (path is 3 times larger, due to having 3 floating point values)
     public struct FoundPath {
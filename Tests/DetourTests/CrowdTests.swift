@@ -0,0 +1,173 @@
+import XCTest
+import CRecast
+@testable import SwiftNavigation
+
+final class CrowdTests: XCTestCase {
+    func makeCrowd (_ nav: dtNavMesh) throws -> dtCrowd {
+        guard let crowd = dtAllocCrowd () else {
+            throw Crowd.CrowdError.alloc
+        }
+        guard crowd.`init` (64, 0.6, nav) else {
+            dtFreeCrowd (crowd)
+            throw Crowd.CrowdError.initialization
+        }
+        return crowd
+    }
+
+    /// The positions and velocities of the active agents
+    func snapshot (_ crowd: dtCrowd) -> [Float] {
+        var values: [Float] = []
+        for i in 0..<crowd.getAgentCount () {
+            guard let agent = crowd.getAgent (i), agent.active else {
+                continue
+            }
+            values += [agent.npos.0, agent.npos.1, agent.npos.2, agent.vel.0, agent.vel.1, agent.vel.2]
+        }
+        return values
+    }
+
+    func testQueryAgentsInRadiusInCrowdedBox () throws {
+        let scene = try TiledScene ()
+        let nav = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (nav) }
+        let crowd = try makeCrowd (nav)
+        defer { dtFreeCrowd (crowd) }
+
+        // A block of agents filling the bounds of the sphere, where only the four in
+        // the middle are inside it, and the ones in the corners are added first.
+        var params = CrowdAgent.Params (radius: 0.5, height: 2).todtCrowdAgentParams ()
+        let center: [Float] = [30, 0, 30]
+        let radius: Float = 1.5
+        for x: Float in [-1.8, -0.6, 0.6, 1.8] {
+            for z: Float in [-1.8, -0.6, 0.6, 1.8] {
+                XCTAssertGreaterThanOrEqual (crowd.addAgent ([center [0] + x, 0, center [2] + z], &params), 0)
+            }
+        }
+        crowd.update (0, nil)
+
+        var inside: [Int32] = []
+        for i in 0..<crowd.getAgentCount () {
+            guard let agent = crowd.getAgent (i), agent.active else {
+                continue
+            }
+            let dx = agent.npos.0 - center [0], dy = agent.npos.1 - center [1], dz = agent.npos.2 - center [2]
+            if dx*dx + dy*dy + dz*dz <= radius*radius {
+                inside.append (i)
+            }
+        }
+        XCTAssertEqual (inside.count, 4)
+
+        var found = [Int32] (repeating: -1, count: 16)
+        let n = crowd.queryAgentsInRadius (center, radius, &found, Int32 (inside.count))
+        XCTAssertEqual (found [0..<Int (n)].sorted (), inside)
+
+        XCTAssertEqual (crowd.queryAgentsInRadius (center, radius, &found, 2), 2)
+        XCTAssert (found [0..<2].allSatisfy { inside.contains ($0) })
+    }
+
+    func testRestoreStateReplaysTheSameSteps () throws {
+        let scene = try TiledScene ()
+        let nav = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (nav) }
+        let crowd = try makeCrowd (nav)
+        defer { dtFreeCrowd (crowd) }
+
+        var params = CrowdAgent.Params (radius: 0.5, height: 2,
+                                        updateFlags: [.anticipateTurns, .optimizeVisibility, .optimizeTopology, .separation, .obstacleAvoidance]).todtCrowdAgentParams ()
+        let query: dtNavMeshQuery = crowd.getNavMeshQuery ()
+        let halfExtents: [Float] = [2, 4, 2]
+        for i in 0..<32 {
+            let x = Float (i % 8) * 7, z = Float (i / 8) * 14
+            let idx = crowd.addAgent ([4 + x, 0, 4 + z], &params)
+            XCTAssertGreaterThanOrEqual (idx, 0)
+            var target: dtPolyRef = 0
+            var point: [Float] = [0, 0, 0]
+            XCTAssert (dtStatusSucceed (query.findNearestPoly ([60 - x, 0, 60 - z], halfExtents, crowd.getFilter (0), &target, &point)))
+            XCTAssert (crowd.requestMoveTarget (idx, target, point))
+        }
+        for _ in 0..<10 {
+            crowd.update (0.1, nil)
+        }
+
+        var state = [UInt8] (repeating: 0, count: Int (crowd.getStateSize ()))
+        var size: Int32 = 0
+        XCTAssert (crowd.storeState (&state, Int32 (state.count), &size))
+        let stored = snapshot (crowd)
+        for _ in 0..<30 {
+            crowd.update (0.1, nil)
+        }
+        let expected = snapshot (crowd)
+        XCTAssertNotEqual (expected, stored)
+
+        XCTAssert (crowd.restoreState (state, size))
+        XCTAssertEqual (snapshot (crowd), stored)
+        for _ in 0..<30 {
+            crowd.update (0.1, nil)
+        }
+        XCTAssertEqual (snapshot (crowd), expected)
+
+        // A new crowd continues the same way
+        let other = try makeCrowd (nav)
+        defer { dtFreeCrowd (other) }
+        XCTAssert (other.restoreState (state, size))
+        for _ in 0..<30 {
+            other.update (0.1, nil)
+        }
+        XCTAssertEqual (snapshot (other), expected)
+
+        // A truncated state is refused and leaves the crowd as it was
+        XCTAssertFalse (crowd.restoreState (state, size - 1))
+        XCTAssertEqual (snapshot (crowd), expected)
+        var small: Int32 = 0
+        XCTAssertFalse (crowd.storeState (&state, 10, &small))
+    }
+
+    func testRestoreStateKeepsObstacles () throws {
+        let scene = try TiledScene ()
+        let nav = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (nav) }
+        let crowd = try makeCrowd (nav)
+        defer { dtFreeCrowd (crowd) }
+        XCTAssert (crowd.initObstacles (8))
+
+        // Obstacles without a size are refused
+        XCTAssertEqual (crowd.addObstacle ([10, 0, 10], nil, 0, 2), -1)
+        XCTAssertEqual (crowd.addObstacle ([10, 0, 10], nil, 1, -1), -1)
+        XCTAssertEqual (crowd.addObstacle ([10, 0, 10], nil, .nan, 2), -1)
+
+        let removed = crowd.addObstacle ([10, 0, 10], nil, 1, 2)
+        let capsule = crowd.addObstacle ([20, 0, 20], [24, 0, 20], 0.5, 2)
+        let circle = crowd.addObstacle ([30, 0, 30], nil, 1, 2)
+        XCTAssertEqual ([removed, capsule, circle], [0, 1, 2])
+        crowd.removeObstacle (removed)
+        XCTAssert (crowd.updateObstacle (capsule, [30, 0, 20], nil, [1, 0, 0]))
+
+        var state = [UInt8] (repeating: 0, count: Int (crowd.getStateSize ()))
+        var size: Int32 = 0
+        XCTAssert (crowd.storeState (&state, Int32 (state.count), &size))
+        let stored = crowd.getObstacle (capsule).pointee
+
+        crowd.removeObstacle (capsule)
+        XCTAssertEqual (crowd.addObstacle ([10, 0, 10], nil, 2, 2), capsule)
+        XCTAssert (crowd.restoreState (state, size))
+
+        XCTAssertFalse (crowd.getObstacle (removed).pointee.active)
+        XCTAssert (crowd.getObstacle (circle).pointee.active)
+        let restored = crowd.getObstacle (capsule).pointee
+        XCTAssert (restored.active)
+        XCTAssertEqual (restored.type, stored.type)
+        XCTAssertEqual ([restored.pos.0, restored.pos.2, restored.end.0, restored.end.2], [30, 20, 34, 20])
+        XCTAssertEqual (restored.radius, stored.radius)
+        XCTAssertEqual (restored.vel.0, 1)
+        // The free slots are restored too
+        XCTAssertEqual (crowd.addObstacle ([10, 0, 10], nil, 1, 2), removed)
+
+        // A crowd without room for the obstacles refuses the state
+        let other = try makeCrowd (nav)
+        defer { dtFreeCrowd (other) }
+        XCTAssertFalse (other.restoreState (state, size))
+        XCTAssert (other.initObstacles (8))
+        XCTAssert (other.restoreState (state, size))
+        XCTAssert (other.getObstacle (capsule).pointee.active)
+    }
+}
@@ -0,0 +1,173 @@
+import XCTest
+import CRecast
+@testable import SwiftNavigation
+
+final class NavMeshQueryTests: XCTestCase {
+    func testFindNearestPolysMatchesFindNearestPolyAtTileBorders () throws {
+        let scene = try TiledScene ()
+        let nav = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (nav) }
+        let query = try XCTUnwrap (dtAllocNavMeshQuery ())
+        defer { dtFreeNavMeshQuery (query) }
+        XCTAssert (dtStatusSucceed (query.`init` (nav, 2048)))
+        let filter = try XCTUnwrap (dtAllocQueryFilter ())
+        defer { dtFreeQueryFilter (filter) }
+
+        // Points on the inner tile borders, and on either side of them
+        var centers: [Float] = []
+        let origin = scene.params.orig
+        for k in 1..<6 {
+            let border = Float (k) * scene.params.tileWidth
+            for s in 0...60 {
+                let offset = Float (s % 5 - 2) * 0.05
+                centers += [origin.0 + border + offset, 0.1, origin.2 + Float (s)]
+                centers += [origin.0 + Float (s), 0.1, origin.2 + border + offset]
+            }
+        }
+        let count = centers.count / 3
+        let halfExtents: [Float] = [0.5, 1, 0.5]
+        var refs = [dtPolyRef] (repeating: 0, count: count)
+        var points = [Float] (repeating: 0, count: count * 3)
+        XCTAssert (dtStatusSucceed (query.findNearestPolys (centers, Int32 (count), halfExtents, filter, &refs, &points)))
+
+        for i in 0..<count {
+            let center = Array (centers [i*3..<i*3+3])
+            var ref: dtPolyRef = 0
+            var point: [Float] = [0, 0, 0]
+            XCTAssert (dtStatusSucceed (query.findNearestPoly (center, halfExtents, filter, &ref, &point)))
+            XCTAssertNotEqual (ref, 0, "at \(center)")
+            XCTAssertEqual (refs [i], ref, "at \(center)")
+            XCTAssertEqual (Array (points [i*3..<i*3+3]), point, "at \(center)")
+        }
+    }
+
+    func testReplicaAnswersQueriesFromItsOwnCopy () throws {
+        let scene = try TiledScene ()
+        let nav = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (nav) }
+
+        // Counts the live allocations of the replica
+        let live = UnsafeMutablePointer<Int>.allocate (capacity: 1)
+        live.pointee = 0
+        defer { live.deallocate () }
+        var allocator = dtReplicaAllocator (alloc: { context, size in
+            context!.assumingMemoryBound (to: Int.self).pointee += 1
+            return malloc (size)
+        }, free: { context, ptr in
+            context!.assumingMemoryBound (to: Int.self).pointee -= 1
+            free (ptr)
+        }, context: UnsafeMutableRawPointer (live))
+        let replica = try XCTUnwrap (dtAllocNavMesh ())
+        XCTAssert (dtStatusSucceed (replica.initReplica (nav, &allocator)))
+        XCTAssertEqual (live.pointee, scene.tiles.count)
+        for i in 0..<nav.getMaxTiles () {
+            guard let tile = nav.getTile (i), tile.pointee.header != nil else {
+                continue
+            }
+            XCTAssertNotEqual (replica.getTile (i).pointee.polys, tile.pointee.polys)
+        }
+
+        let query = try XCTUnwrap (dtAllocNavMeshQuery ())
+        defer { dtFreeNavMeshQuery (query) }
+        XCTAssert (dtStatusSucceed (query.`init` (nav, 2048)))
+        let filter = try XCTUnwrap (dtAllocQueryFilter ())
+        defer { dtFreeQueryFilter (filter) }
+        let halfExtents: [Float] = [2, 4, 2]
+        var startRef: dtPolyRef = 0, endRef: dtPolyRef = 0
+        var start: [Float] = [0, 0, 0], end: [Float] = [0, 0, 0]
+        XCTAssert (dtStatusSucceed (query.findNearestPoly ([2, 0, 2], halfExtents, filter, &startRef, &start)))
+        XCTAssert (dtStatusSucceed (query.findNearestPoly ([62, 0, 62], halfExtents, filter, &endRef, &end)))
+        func path () -> [dtPolyRef] {
+            var path = [dtPolyRef] (repeating: 0, count: 256)
+            var count: Int32 = 0
+            XCTAssert (dtStatusSucceed (query.findPath (startRef, endRef, start, end, filter, &path, &count, 256)))
+            return Array (path [0..<Int (count)])
+        }
+        let expected = path ()
+        XCTAssertGreaterThan (expected.count, 2)
+        XCTAssert (dtStatusSucceed (query.setNavMesh (replica)))
+        XCTAssertEqual (path (), expected)
+
+        // The replica keeps its own flags, and takes the changes of the base through a delta
+        var state = [UInt8] (repeating: 0, count: Int (nav.getStateSize ()))
+        XCTAssert (dtStatusSucceed (nav.storeState (&state, Int32 (state.count))))
+        let blocked = expected [expected.count / 2]
+        XCTAssert (dtStatusSucceed (nav.setPolyFlags (blocked, 0)))
+        XCTAssertEqual (path (), expected)
+        var delta = [UInt8] (repeating: 0, count: Int (nav.getStateDeltaMaxSize ()))
+        var size: Int32 = 0
+        XCTAssert (dtStatusSucceed (nav.storeStateDelta (state, Int32 (state.count), &delta, Int32 (delta.count), &size)))
+        XCTAssert (dtStatusSucceed (replica.restoreStateDelta (delta, size)))
+        XCTAssertFalse (path ().contains (blocked))
+
+        dtFreeNavMesh (replica)
+        XCTAssertEqual (live.pointee, 0)
+    }
+
+    func testCostOverlayChangesPathCostAndChoice () throws {
+        let scene = try TiledScene ()
+        let nav = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (nav) }
+        let query = try XCTUnwrap (dtAllocNavMeshQuery ())
+        defer { dtFreeNavMeshQuery (query) }
+        XCTAssert (dtStatusSucceed (query.`init` (nav, 2048)))
+        let filter = try XCTUnwrap (dtAllocQueryFilter ())
+        defer { dtFreeQueryFilter (filter) }
+        let overlay = try XCTUnwrap (dtAllocPolyCostOverlay ())
+        defer { dtFreePolyCostOverlay (overlay) }
+        XCTAssert (dtStatusSucceed (overlay.`init` (nav)))
+
+        let halfExtents: [Float] = [2, 4, 2]
+        var startRef: dtPolyRef = 0, endRef: dtPolyRef = 0
+        var start: [Float] = [0, 0, 0], end: [Float] = [0, 0, 0]
+        XCTAssert (dtStatusSucceed (query.findNearestPoly ([2, 0, 2], halfExtents, filter, &startRef, &start)))
+        XCTAssert (dtStatusSucceed (query.findNearestPoly ([62, 0, 62], halfExtents, filter, &endRef, &end)))
+        func path () -> [dtPolyRef] {
+            var path = [dtPolyRef] (repeating: 0, count: 256)
+            var count: Int32 = 0
+            XCTAssert (dtStatusSucceed (query.findPath (startRef, endRef, start, end, filter, &path, &count, 256)))
+            return Array (path [0..<Int (count)])
+        }
+        // The cost of the cheapest path to the end, as found by the Dijkstra search
+        func cost () -> Float {
+            let max = 8192
+            var refs = [dtPolyRef] (repeating: 0, count: max)
+            var parents = [dtPolyRef] (repeating: 0, count: max)
+            var costs = [Float] (repeating: 0, count: max)
+            var count: Int32 = 0
+            XCTAssert (dtStatusSucceed (query.findPolysAroundCircle (startRef, start, 200, filter, &refs, &parents, &costs, &count, Int32 (max))))
+            let i = refs [0..<Int (count)].firstIndex (of: endRef)
+            XCTAssertNotNil (i)
+            return i.map { costs [$0] } ?? 0
+        }
+        let expected = path ()
+        let expectedCost = cost ()
+        filter.setCostOverlay (overlay)
+        XCTAssertEqual (path (), expected)
+        XCTAssertEqual (cost (), expectedCost)
+
+        // The middle of the diagonal becomes expensive
+        let bmin: [Float] = [26, -1, 26], bmax: [Float] = [38, 1, 38]
+        var changed: Int32 = 0
+        XCTAssert (dtStatusFailed (overlay.setCostInBounds (bmin, bmax, 0.5, &changed)))
+        XCTAssertEqual (changed, 0)
+        XCTAssert (dtStatusSucceed (overlay.setCostInBounds (bmin, bmax, 10, &changed)))
+        var inBox = [dtPolyRef] (repeating: 0, count: 512)
+        var count: Int32 = 0
+        XCTAssert (dtStatusSucceed (query.queryPolygons ([32, 0, 32], [6, 1, 6], filter, &inBox, &count, 512)))
+        XCTAssertEqual (changed, count)
+        for ref in inBox [0..<Int (count)] {
+            XCTAssertEqual (overlay.getCost (ref), 10)
+        }
+        XCTAssert (expected.contains { overlay.getCost ($0) == 10 })
+
+        let detour = path ()
+        XCTAssertNotEqual (detour, expected)
+        XCTAssertFalse (detour.contains { overlay.getCost ($0) == 10 })
+        XCTAssertGreaterThan (cost (), expectedCost)
+
+        overlay.clear ()
+        XCTAssertEqual (path (), expected)
+        XCTAssertEqual (cost (), expectedCost)
+    }
+}
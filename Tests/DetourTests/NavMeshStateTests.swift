@@ -0,0 +1,109 @@
+import XCTest
+import CRecast
+@testable import SwiftNavigation
+
+final class NavMeshStateTests: XCTestCase {
+    /// The state starts with the magic, the version, the tile count and the polygon count
+    static let tileCountOffset = 8
+    static let polyCountOffset = 12
+    /// The delta starts with the magic, the version and the change count
+    static let changeCountOffset = 8
+
+    func store (_ nav: dtNavMesh, filling fill: UInt8 = 0) -> [UInt8] {
+        var state = [UInt8] (repeating: fill, count: Int (nav.getStateSize ()))
+        XCTAssert (dtStatusSucceed (nav.storeState (&state, Int32 (state.count))))
+        return state
+    }
+
+    func storeDelta (_ nav: dtNavMesh, from base: [UInt8], filling fill: UInt8 = 0) -> [UInt8] {
+        var delta = [UInt8] (repeating: fill, count: Int (nav.getStateDeltaMaxSize ()))
+        var size: Int32 = 0
+        XCTAssert (dtStatusSucceed (nav.storeStateDelta (base, Int32 (base.count), &delta, Int32 (delta.count), &size)))
+        return Array (delta [0..<Int (size)])
+    }
+
+    func setting (_ data: [UInt8], _ value: Int32, at offset: Int) -> [UInt8] {
+        var data = data
+        data.withUnsafeMutableBytes { $0.storeBytes (of: value, toByteOffset: offset, as: Int32.self) }
+        return data
+    }
+
+    func testNavMeshRestoreState () throws {
+        let scene = try TiledScene ()
+        let nav = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (nav) }
+        let state = store (nav)
+
+        let poly = nav.getPolyRefBase (nav.getTileAt (3, 3, 0))
+        var stored: UInt16 = 0
+        XCTAssert (dtStatusSucceed (nav.getPolyFlags (poly, &stored)))
+        XCTAssert (dtStatusSucceed (nav.setPolyFlags (poly, stored ^ 0x8)))
+        XCTAssert (dtStatusSucceed (nav.restoreState (state, Int32 (state.count))))
+        var flags: UInt16 = 0
+        XCTAssert (dtStatusSucceed (nav.getPolyFlags (poly, &flags)))
+        XCTAssertEqual (flags, stored)
+    }
+
+    func testRestoreStateRejectsBadBuffers () throws {
+        let scene = try TiledScene ()
+        let nav = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (nav) }
+        let state = store (nav)
+        // The padding is cleared, so the buffer does not depend on what the memory held before
+        XCTAssertEqual (store (nav, filling: 0xaa), state)
+
+        let poly = nav.getPolyRefBase (nav.getTileAt (3, 3, 0))
+        var stored: UInt16 = 0
+        XCTAssert (dtStatusSucceed (nav.getPolyFlags (poly, &stored)))
+        XCTAssert (dtStatusSucceed (nav.setPolyFlags (poly, stored ^ 0x8)))
+
+        // Truncated buffers, down to a bare header
+        for size in [state.count - 1, state.count / 2, 16, 4] {
+            XCTAssert (dtStatusFailed (nav.restoreState (state, Int32 (size))), "size \(size)")
+        }
+        // Counts larger than the buffer, including ones whose sizes wrap around in 32 bits
+        for count in [Int32 (1) << 30, Int32 (1) << 29, Int32.max, -1] {
+            let tiles = setting (state, count, at: NavMeshStateTests.tileCountOffset)
+            XCTAssert (dtStatusFailed (nav.restoreState (tiles, Int32 (tiles.count))), "tiles \(count)")
+            let polys = setting (state, count, at: NavMeshStateTests.polyCountOffset)
+            XCTAssert (dtStatusFailed (nav.restoreState (polys, Int32 (polys.count))), "polygons \(count)")
+        }
+        var flags: UInt16 = 0
+        XCTAssert (dtStatusSucceed (nav.getPolyFlags (poly, &flags)))
+        XCTAssertEqual (flags, stored ^ 0x8)
+    }
+
+    func testRestoreStateDeltaRejectsBadBuffers () throws {
+        let scene = try TiledScene ()
+        let nav = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (nav) }
+        let base = store (nav)
+
+        let poly = nav.getPolyRefBase (nav.getTileAt (3, 3, 0))
+        var stored: UInt16 = 0
+        XCTAssert (dtStatusSucceed (nav.getPolyFlags (poly, &stored)))
+        XCTAssert (dtStatusSucceed (nav.setPolyFlags (poly, stored ^ 0x8)))
+        let delta = storeDelta (nav, from: base)
+        XCTAssertEqual (storeDelta (nav, from: base, filling: 0xaa), delta)
+        XCTAssert (dtStatusSucceed (nav.restoreState (base, Int32 (base.count))))
+
+        // A base with an inflated count is refused as well
+        var scratch = [UInt8] (repeating: 0, count: Int (nav.getStateDeltaMaxSize ()))
+        var size: Int32 = 0
+        let inflatedBase = setting (base, Int32 (1) << 30, at: NavMeshStateTests.tileCountOffset)
+        XCTAssert (dtStatusFailed (nav.storeStateDelta (inflatedBase, Int32 (inflatedBase.count), &scratch, Int32 (scratch.count), &size)))
+
+        XCTAssert (dtStatusFailed (nav.restoreStateDelta (delta, Int32 (delta.count - 1))))
+        for count in [Int32 (1) << 29, Int32 (1) << 30, Int32.max, -1] {
+            let inflated = setting (delta, count, at: NavMeshStateTests.changeCountOffset)
+            XCTAssert (dtStatusFailed (nav.restoreStateDelta (inflated, Int32 (inflated.count))), "changes \(count)")
+        }
+        var flags: UInt16 = 0
+        XCTAssert (dtStatusSucceed (nav.getPolyFlags (poly, &flags)))
+        XCTAssertEqual (flags, stored)
+
+        XCTAssert (dtStatusSucceed (nav.restoreStateDelta (delta, Int32 (delta.count))))
+        XCTAssert (dtStatusSucceed (nav.getPolyFlags (poly, &flags)))
+        XCTAssertEqual (flags, stored ^ 0x8)
+    }
+}
@@ -0,0 +1,115 @@
+import XCTest
+import CRecast
+@testable import SwiftNavigation
+
+final class PointFieldTests: XCTestCase {
+    /// A 10x10x10 field of 20x20 columns of 0.5 by cells of 0.1, walkable up to 45 degrees
+    func makeField () throws -> OpaquePointer {
+        var config = rcConfig ()
+        config.cs = 0.5
+        config.ch = 0.1
+        config.walkableSlopeAngle = 45
+        config.walkableClimb = 4
+        config.bmin = (0, 0, 0)
+        config.bmax = (10, 10, 10)
+        config.width = 20
+        config.height = 20
+        return try XCTUnwrap (bindingCreatePointField (&config))
+    }
+
+    func spans (_ field: OpaquePointer, _ x: Int32, _ z: Int32) -> [BindingSpan] {
+        var spans = [BindingSpan] (repeating: BindingSpan (), count: 4)
+        let count = Int (bindingPointFieldGetSpans (field, x, z, &spans, Int32 (spans.count)))
+        return Array (spans [0..<max (0, min (count, spans.count))])
+    }
+
+    func testSphereSlopesAreNotWalkable () throws {
+        let field = try makeField ()
+        defer { bindingFreePointField (field) }
+        XCTAssert (bindingPointFieldAddSphere (field, [5, 2, 5], 2))
+
+        // The top of the sphere, from 0 to 4
+        let top = spans (field, 10, 10)
+        XCTAssertEqual (top.count, 1)
+        XCTAssertEqual (top [0].smin, 0)
+        XCTAssertEqual (top [0].smax, 40)
+        XCTAssertEqual (top [0].area, Int32 (RC_WALKABLE_AREA))
+        // 1.25 from the center the surface is at 39 degrees, 1.75 from it at 61 degrees
+        XCTAssertEqual (spans (field, 12, 10).first?.area, Int32 (RC_WALKABLE_AREA))
+        XCTAssertEqual (spans (field, 13, 10).first?.area, Int32 (RC_NULL_AREA))
+        XCTAssert (spans (field, 14, 10).isEmpty)
+        XCTAssertEqual (bindingPointFieldGetSpans (field, 20, 0, nil, 0), -1)
+    }
+
+    func testBoxAndCapsuleSlopesAreNotWalkable () throws {
+        let field = try makeField ()
+        defer { bindingFreePointField (field) }
+        // A box turned 60 degrees around x, with a face at 30 degrees towards -z and one at 60 towards +z
+        let angle: Float = .pi / 3
+        let axes: [Float] = [1, 0, 0, 0, cos (angle), sin (angle), 0, -sin (angle), cos (angle)]
+        XCTAssert (bindingPointFieldAddBox (field, [7.5, 3, 7.5], [1, 1, 1], axes))
+        XCTAssertEqual (spans (field, 15, 14).first?.area, Int32 (RC_WALKABLE_AREA))
+        XCTAssertEqual (spans (field, 15, 16).first?.area, Int32 (RC_NULL_AREA))
+
+        // An axis aligned box is flat on top
+        XCTAssert (bindingPointFieldAddBox (field, [2.5, 1, 2.5], [1, 1, 1], nil))
+        let box = spans (field, 5, 5)
+        XCTAssertEqual (box.count, 1)
+        XCTAssertEqual (box [0].smax, 20)
+        XCTAssertEqual (box [0].area, Int32 (RC_WALKABLE_AREA))
+
+        // A capsule along x at z = 2, walkable while the top is less than 0.7 from the axis
+        XCTAssert (bindingPointFieldAddCapsule (field, [2, 2, 2], [8, 2, 2], 1))
+        XCTAssertEqual (spans (field, 10, 4).first?.smax, 30)
+        XCTAssertEqual (spans (field, 10, 4).first?.area, Int32 (RC_WALKABLE_AREA))
+        XCTAssertEqual (spans (field, 10, 3).first?.area, Int32 (RC_WALKABLE_AREA))
+        XCTAssertEqual (spans (field, 10, 2).first?.area, Int32 (RC_NULL_AREA))
+        XCTAssertEqual (spans (field, 10, 5).first?.area, Int32 (RC_NULL_AREA))
+    }
+
+    func testPointSplats () throws {
+        let field = try makeField ()
+        defer { bindingFreePointField (field) }
+        // A splat of radius 1 around the center of column 10, 10 covers the 13 columns within 1 of it
+        XCTAssert (bindingPointFieldAdd (field, [5.25, 2, 5.25], nil, 1, 1))
+        var columns = 0
+        for z in Int32 (0)..<20 {
+            for x in Int32 (0)..<20 {
+                let column = spans (field, x, z)
+                guard !column.isEmpty else { continue }
+                columns += 1
+                XCTAssertEqual (column.count, 1)
+                XCTAssertEqual (column [0].smin, 20)
+                XCTAssertEqual (column [0].smax, 21)
+                XCTAssertEqual (column [0].area, Int32 (RC_WALKABLE_AREA))
+            }
+        }
+        XCTAssertEqual (columns, 13)
+        bindingPointFieldClear (field, nil, nil)
+
+        // The gap of one cell between the first two points is closed, the larger one to the third is not
+        XCTAssert (bindingPointFieldAdd (field, [1.25, 2, 1.25, 1.25, 2.15, 1.25, 1.25, 2.55, 1.25], nil, 3, 0))
+        let stacked = spans (field, 2, 2)
+        XCTAssertEqual (stacked.count, 2)
+        XCTAssertEqual (stacked.map { $0.smin }, [20, 25])
+        XCTAssertEqual (stacked.map { $0.smax }, [22, 26])
+
+        // A steep point is not walkable, and stays flat
+        XCTAssert (bindingPointFieldAdd (field, [8.25, 2, 8.25], [0.8, 0.6, 0], 1, 1))
+        XCTAssertEqual (spans (field, 16, 16).first?.area, Int32 (RC_NULL_AREA))
+        XCTAssertEqual (spans (field, 18, 16).first?.smin, 20)
+        // A walkable point follows its slope
+        let slope: Float = 0.3
+        XCTAssert (bindingPointFieldAdd (field, [5.25, 2, 8.25], [slope, (1 - slope * slope).squareRoot (), 0], 1, 1))
+        XCTAssertEqual (spans (field, 10, 16).first?.smin, 20)
+        XCTAssertEqual (spans (field, 12, 16).first?.smin, 16)
+        XCTAssertEqual (spans (field, 8, 16).first?.smin, 23)
+        XCTAssertEqual (spans (field, 12, 16).first?.area, Int32 (RC_WALKABLE_AREA))
+
+        // Points outside are skipped, and a huge splat only covers the field
+        XCTAssert (bindingPointFieldAdd (field, [-50, 2, -50], nil, 1, 0))
+        XCTAssert (bindingPointFieldAdd (field, [5.25, 2, 5.25], nil, 1, 1e30))
+        XCTAssertEqual (spans (field, 0, 0).count, 1)
+        XCTAssertEqual (spans (field, 19, 19).count, 1)
+    }
+}
@@ -0,0 +1,395 @@
+import XCTest
+import CRecast
+@testable import SwiftNavigation
+
+final class TileTests: XCTestCase {
+    /// Lists the links of every polygon by tile location and polygon index, which
+    /// do not depend on the order the tiles were added in.
+    func links (_ nav: dtNavMesh) -> [String] {
+        var result: [String] = []
+        for i in 0..<nav.getMaxTiles () {
+            guard let tile = nav.getTile (i), let header = tile.pointee.header else {
+                continue
+            }
+            for p in 0..<Int (header.pointee.polyCount) {
+                var l = tile.pointee.polys [p].firstLink
+                while l != DT_NULL_LINK {
+                    let link = tile.pointee.links [Int (l)]
+                    let target = nav.getTile (Int32 (nav.decodePolyIdTile (link.ref))).pointee.header.pointee
+                    result.append ("\(header.pointee.x),\(header.pointee.y):\(p) -> \(target.x),\(target.y):\(nav.decodePolyIdPoly (link.ref)) edge \(link.edge) side \(link.side) \(link.bmin)-\(link.bmax)")
+                    l = link.next
+                }
+            }
+        }
+        return result.sorted ()
+    }
+
+    func testAddTilesMatchesAddTile () throws {
+        let scene = try TiledScene ()
+        let sequential = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (sequential) }
+
+        let batch = try scene.makeNavMesh ()
+        defer { dtFreeNavMesh (batch) }
+        var data: [UnsafeMutablePointer<UInt8>?] = (0..<scene.tiles.count).map { scene.copyTile ($0) }
+        let sizes = scene.tiles.map { Int32 ($0.count) }
+        var refs = [dtTileRef] (repeating: 0, count: scene.tiles.count)
+        // Links the tiles in four ranges on the dispatch threads
+        let status = batch.addTiles (&data, sizes, Int32 (data.count), TiledScene.freeData, nil, &refs, { _, count, range, userData in
+            guard let range else { return }
+            let n = Int (count)
+            DispatchQueue.concurrentPerform (iterations: 4) { i in
+                range (userData, Int32 (n * i / 4), Int32 (n * (i + 1) / 4))
+            }
+        }, nil)
+        XCTAssert (dtStatusSucceed (status))
+        XCTAssertFalse (refs.contains (0))
+        XCTAssertEqual (tileCount (batch), scene.tiles.count)
+
+        let expected = links (sequential)
+        let crossing = expected.filter { link in
+            let parts = link.split (separator: " ")
+            return parts [0].split (separator: ":") [0] != parts [2].split (separator: ":") [0]
+        }
+        XCTAssertFalse (crossing.isEmpty)
+        XCTAssertEqual (links (batch), expected)
+    }
+
+    struct Connection {
+        var start: SIMD2<Float>
+        var end: SIMD2<Float>
+        var bidirectional: Bool
+    }
+
+    /// Creates the data of a 10x10 wu tile at the origin, split in `quads` polygons,
+    /// with the given off-mesh connections.
+    func makeTile (_ connections: [Connection], quads: Int = 1) -> (data: UnsafeMutablePointer<UInt8>, size: Int32)? {
+        var verts: [UInt16] = []
+        var polys: [UInt16] = []
+        for q in 0..<quads {
+            let x0 = UInt16 (q * 100 / quads), x1 = UInt16 ((q + 1) * 100 / quads)
+            let base = UInt16 (verts.count / 3)
+            verts += [x0, 0, 0, x0, 0, 100, x1, 0, 100, x1, 0, 0]
+            var poly = [UInt16] (repeating: 0xffff, count: 12)
+            for v in 0..<4 {
+                poly [v] = base + UInt16 (v)
+            }
+            polys += poly
+        }
+        var conVerts: [Float] = []
+        for c in connections {
+            conVerts += [c.start.x, -1, c.start.y, c.end.x, -1, c.end.y]
+        }
+
+        var owned: [UnsafeMutableRawPointer] = []
+        defer { owned.forEach { $0.deallocate () } }
+        func pin<T> (_ values: [T]) -> UnsafePointer<T> {
+            let ptr = UnsafeMutablePointer<T>.allocate (capacity: max (values.count, 1))
+            ptr.initialize (from: values, count: values.count)
+            owned.append (UnsafeMutableRawPointer (ptr))
+            return UnsafePointer (ptr)
+        }
+
+        var params = dtNavMeshCreateParams ()
+        params.verts = pin (verts)
+        params.vertCount = Int32 (verts.count / 3)
+        params.polys = pin (polys)
+        params.polyAreas = pin ([UInt8] (repeating: 63, count: quads))
+        params.polyFlags = pin ([UInt16] (repeating: 1, count: quads))
+        params.polyCount = Int32 (quads)
+        params.nvp = 6
+        params.offMeshConVerts = pin (conVerts)
+        params.offMeshConRad = pin ([Float] (repeating: 0.5, count: connections.count))
+        params.offMeshConDir = pin (connections.map { $0.bidirectional ? UInt8 (DT_OFFMESH_CON_BIDIR) : 0 })
+        params.offMeshConAreas = pin ([UInt8] (repeating: 63, count: connections.count))
+        params.offMeshConFlags = pin ([UInt16] (repeating: 1, count: connections.count))
+        params.offMeshConUserID = pin ((0..<connections.count).map { UInt32 ($0) })
+        params.offMeshConCount = Int32 (connections.count)
+        params.walkableHeight = 2
+        params.walkableRadius = 0.5
+        params.walkableClimb = 0.9
+        params.bmin = (0, -1, 0)
+        params.bmax = (10, 1, 10)
+        params.cs = 0.1
+        params.ch = 0.1
+        params.buildBvTree = true
+
+        var data: UnsafeMutablePointer<UInt8>? = nil
+        var size: Int32 = 0
+        guard dtCreateNavMeshData (&params, &data, &size), let data else {
+            return nil
+        }
+        return (data, size)
+    }
+
+    /// Replaces a tile, returning the status, the new tile and the new reference of each old polygon
+    func replace (_ nav: dtNavMesh, _ ref: dtTileRef, with tile: (data: UnsafeMutablePointer<UInt8>, size: Int32)) -> (dtStatus, dtTileRef, [dtPolyRef]) {
+        var newRefs = [dtPolyRef] (repeating: 0, count: 4)
+        var newTile: dtTileRef = 0
+        let status = newRefs.withUnsafeMutableBufferPointer { buffer -> dtStatus in
+            var remap = dtPolyRefRemap ()
+            remap.newRefs = buffer.baseAddress
+            remap.maxPolys = Int32 (buffer.count)
+            return nav.replaceTile (ref, tile.data, tile.size, TiledScene.freeData, &newTile, &remap)
+        }
+        return (status, newTile, newRefs)
+    }
+
+    func testReplaceTileRemapsOffMeshConnections () throws {
+        var params = dtNavMeshParams ()
+        params.tileWidth = 10
+        params.tileHeight = 10
+        params.maxTiles = 4
+        params.maxPolys = 16
+        let nav = try XCTUnwrap (dtAllocNavMesh ())
+        defer { dtFreeNavMesh (nav) }
+        XCTAssert (dtStatusSucceed (nav.`init` (&params)))
+
+        let tile = try XCTUnwrap (makeTile ([
+            Connection (start: [2, 2], end: [8, 8], bidirectional: false),
+            Connection (start: [8, 8], end: [2, 2], bidirectional: false),
+            Connection (start: [2, 8], end: [8, 2], bidirectional: true)]))
+        XCTAssertEqual (tile.data.withMemoryRebound (to: dtMeshHeader.self, capacity: 1) { $0.pointee.offMeshConCount }, 3)
+        var ref: dtTileRef = 0
+        XCTAssert (dtStatusSucceed (nav.addTile (tile.data, tile.size, TiledScene.freeData, 0, &ref)))
+
+        // The new build lists the connections in another order, and the two way one from its other end
+        let reordered = try XCTUnwrap (makeTile ([
+            Connection (start: [8, 2], end: [2, 8], bidirectional: true),
+            Connection (start: [8, 8], end: [2, 2], bidirectional: false),
+            Connection (start: [2, 2], end: [8, 8], bidirectional: false)]))
+        var (status, newTile, newRefs) = replace (nav, ref, with: reordered)
+        XCTAssert (dtStatusSucceed (status))
+        let base = nav.getPolyRefBase (nav.getTileByRef (newTile))
+        XCTAssertEqual (newRefs, [base, base | 3, base | 2, base | 1])
+
+        // A connection that changed direction is a different connection
+        let redirected = try XCTUnwrap (makeTile ([Connection (start: [2, 2], end: [8, 8], bidirectional: true)]))
+        (status, newTile, newRefs) = replace (nav, newTile, with: redirected)
+        XCTAssert (dtStatusSucceed (status))
+        XCTAssertNotEqual (newRefs [0], 0)
+        XCTAssertEqual (Array (newRefs [1...]), [0, 0, 0])
+
+        // A tile with more polygons than the mesh can address is refused, and the old one is kept
+        let large = try XCTUnwrap (makeTile ([], quads: 20))
+        let current = newTile
+        (status, newTile, newRefs) = replace (nav, current, with: large)
+        XCTAssert (dtStatusFailed (status))
+        XCTAssertEqual (nav.getTileRefAt (0, 0, 0), current)
+        dtFree (large.data)
+    }
+
+    func testRemapPolyRefChainsReplacements () throws {
+        let scene = try TiledScene ()
+        let nav = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (nav) }
+        let i = try XCTUnwrap (scene.tiles.firstIndex { tile in
+            let header = tile.withUnsafeBytes { $0.loadUnaligned (as: dtMeshHeader.self) }
+            return header.x == 1 && header.y == 1
+        })
+        let first = nav.getTileRefAt (1, 1, 0)
+        let base = nav.getPolyRefBase (nav.getTileByRef (first))
+        let polyCount = Int (nav.getTileByRef (first).pointee.header.pointee.polyCount)
+        XCTAssertGreaterThan (polyCount, 1)
+
+        // The same tile is rebuilt twice, keeping both mappings
+        let newRefs = UnsafeMutablePointer<dtPolyRef>.allocate (capacity: polyCount * 2)
+        defer { newRefs.deallocate () }
+        var remaps = [dtPolyRefRemap] (repeating: dtPolyRefRemap (), count: 2)
+        var current = first
+        var bases: [dtPolyRef] = []
+        for k in 0..<2 {
+            remaps [k].newRefs = newRefs + k * polyCount
+            remaps [k].maxPolys = Int32 (polyCount)
+            var replaced: dtTileRef = 0
+            XCTAssert (dtStatusSucceed (nav.replaceTile (current, scene.copyTile (i), Int32 (scene.tiles [i].count), TiledScene.freeData, &replaced, &remaps [k])))
+            current = replaced
+            bases.append (nav.getPolyRefBase (nav.getTileByRef (current)))
+        }
+
+        for p in 0..<polyCount {
+            let ref = base | dtPolyRef (p)
+            // Each mapping goes one replacement ahead, the first one alone now gives stale references
+            XCTAssertEqual (remaps [0].newRefs [p], bases [0] | dtPolyRef (p))
+            XCTAssertFalse (nav.isValidPolyRef (dtRemapPolyRef (remaps, 1, ref)))
+            // Both mappings in order lead to the current polygons
+            XCTAssertEqual (dtRemapPolyRef (remaps, 2, ref), bases [1] | dtPolyRef (p))
+            XCTAssert (nav.isValidPolyRef (dtRemapPolyRef (remaps, 2, ref)))
+        }
+        let other = nav.getPolyRefBase (nav.getTileAt (0, 0, 0))
+        XCTAssertEqual (dtRemapPolyRef (remaps, 2, other), other)
+    }
+
+    func testDebugMeshUpdateResumesAfterTheLastSlot () throws {
+        let scene = try TiledScene ()
+        let nav = try scene.makeLoadedNavMesh ()
+        defer { dtFreeNavMesh (nav) }
+        let mesh = try XCTUnwrap (bindingCreateDebugMesh (nav, 0.1))
+        defer { bindingFreeDebugMesh (mesh) }
+
+        // The tile in the first slot is rebuilt before every update, which must not
+        // keep a limited update from getting to the other slots
+        let header = nav.getTile (0).pointee.header.pointee
+        let i = try XCTUnwrap (scene.tiles.firstIndex { tile in
+            let h = tile.withUnsafeBytes { $0.loadUnaligned (as: dtMeshHeader.self) }
+            return h.x == header.x && h.y == header.y
+        })
+        func extracted () -> Int {
+            (0..<bindingDebugMeshTileCount (mesh)).filter { bindingDebugMeshTile (mesh, $0).pointee.ref != 0 }.count
+        }
+        var updates = 0
+        while extracted () < scene.tiles.count && updates < 2 * scene.tiles.count {
+            XCTAssert (dtStatusSucceed (nav.removeTile (nav.getTileRefAt (header.x, header.y, 0), nil, nil)))
+            XCTAssert (dtStatusSucceed (nav.addTile (scene.copyTile (i), Int32 (scene.tiles [i].count), TiledScene.freeData, 0, nil)))
+            XCTAssertEqual (bindingDebugMeshUpdate (mesh, 1), 1)
+            updates += 1
+        }
+        XCTAssertEqual (extracted (), scene.tiles.count)
+        XCTAssertEqual (updates, scene.tiles.count)
+    }
+
+    func testTileStreamRejectsCorruptIndex () throws {
+        let scene = try TiledScene ()
+        let good = try Data (contentsOf: URL (fileURLWithPath: scene.path))
+        let path = scene.path + ".corrupt"
+        defer { try? FileManager.default.removeItem (atPath: path) }
+        var params = BindingTileStreamParams ()
+        params.loadRadius = 100
+        params.evictRadius = 200
+        params.maxReadAttempts = 3
+
+        func opens (_ data: Data) throws -> Bool {
+            try data.write (to: URL (fileURLWithPath: path))
+            guard let stream = bindingOpenTileStream (path, &params) else {
+                return false
+            }
+            bindingCloseTileStream (stream)
+            return true
+        }
+        func entry (_ i: Int) -> Int {
+            TiledScene.headerSize + i * TiledScene.entrySize
+        }
+        func offset (_ i: Int) -> Int64 {
+            good.withUnsafeBytes { $0.loadUnaligned (fromByteOffset: entry (i) + TiledScene.entryDataOffset, as: Int64.self) }
+        }
+        func corrupt<T> (_ at: Int, _ value: T) -> Data {
+            var data = good
+            data.withUnsafeMutableBytes { $0.storeBytes (of: value, toByteOffset: at, as: T.self) }
+            return data
+        }
+
+        XCTAssertTrue (try opens (good))
+        // Tiles past the end of the file
+        XCTAssertFalse (try opens (corrupt (entry (3) + TiledScene.entryDataOffset, Int64 (good.count) - 10)))
+        XCTAssertFalse (try opens (corrupt (entry (3) + TiledScene.entryDataOffset, Int64 (1) << 40)))
+        // Empty and negative tiles
+        XCTAssertFalse (try opens (corrupt (entry (3) + TiledScene.entrySizeOffset, Int32 (0))))
+        XCTAssertFalse (try opens (corrupt (entry (3) + TiledScene.entrySizeOffset, Int32 (-5))))
+        // A tile overlapping the one before it, and one inside the index
+        XCTAssertFalse (try opens (corrupt (entry (3) + TiledScene.entryDataOffset, offset (2) + 4)))
+        XCTAssertFalse (try opens (corrupt (entry (0) + TiledScene.entryDataOffset, Int64 (8))))
+        // More tiles than the file can hold, and a truncated file
+        XCTAssertFalse (try opens (corrupt (TiledScene.headerSize - 4, Int32 (1 << 28))))
+        XCTAssertFalse (try opens (good.dropLast ()))
+
+        // A tile with damaged data is not added, and the others are.   The damaged one is read
+        // again after a backoff, and given up on after the last attempt
+        var damaged = good
+        damaged [Int (offset (5))] ^= 0xff
+        try damaged.write (to: URL (fileURLWithPath: path))
+        let stream = try XCTUnwrap (bindingOpenTileStream (path, &params))
+        defer { bindingCloseTileStream (stream) }
+        let nav: dtNavMesh = bindingTileStreamNavMesh (stream)
+        let center: [Float] = [32, 0, 32]
+        bindingTileStreamSetInterestPoints (stream, center, nil, 1)
+        var stats = BindingTileStreamStats ()
+        let deadline = Date ().addingTimeInterval (10)
+        while Date () < deadline {
+            _ = bindingTileStreamUpdate (stream, 1000, 1)
+            bindingTileStreamGetStats (stream, &stats)
+            if stats.failed > 0 && bindingTileStreamPendingCount (stream) == 0 && tileCount (nav) == scene.tiles.count - 1 {
+                break
+            }
+            Thread.sleep (forTimeInterval: 0.002)
+        }
+        XCTAssertEqual (stats.failed, 1)
+        XCTAssertEqual (stats.tilesFailed, 3)
+        XCTAssertEqual (tileCount (nav), scene.tiles.count - 1)
+
+        for _ in 0..<20 {
+            _ = bindingTileStreamUpdate (stream, 1000, 1)
+            Thread.sleep (forTimeInterval: 0.001)
+        }
+        bindingTileStreamGetStats (stream, &stats)
+        XCTAssertEqual (stats.tilesFailed, 3)
+        XCTAssertEqual (bindingTileStreamPendingCount (stream), 0)
+    }
+
+    func testTileGeneratorGivesUpOnTilesThatKeepFailing () throws {
+        var params = BindingTileGeneratorParams ()
+        params.config.cs = 0.3
+        params.config.ch = 0.2
+        params.config.walkableSlopeAngle = 45
+        params.config.walkableHeight = 10
+        params.config.walkableClimb = 4
+        params.config.walkableRadius = 2
+        params.config.maxEdgeLen = 12
+        params.config.maxSimplificationError = 1.3
+        params.config.minRegionArea = 8
+        params.config.mergeRegionArea = 20
+        params.config.maxVertsPerPoly = 6
+        params.config.detailSampleDist = 6
+        params.config.detailSampleMaxError = 1
+        params.config.tileSize = 32
+        params.config.borderSize = params.config.walkableRadius + 3
+        params.config.bmin = (0, -5, 0)
+        params.config.bmax = (0, 5, 0)
+        params.flags = Int32 (PARTITION_WATERSHED)
+        params.agentHeight = 2
+        params.agentRadius = 0.6
+        params.agentMaxClimb = 0.9
+        // The point below wants four tiles, and only two fit, so the navigation mesh refuses the others every time
+        params.maxTiles = 2
+        params.maxPolysPerTile = 1024
+        params.generateRadius = 5
+        params.evictRadius = 20
+        params.numThreads = 2
+        params.maxBuildAttempts = 3
+
+        let provider: BindingTileGeometryProvider = { _, _, _, bmin, bmax, geometry in
+            guard let bmin, let bmax else { return }
+            let verts: [Float] = [bmin [0], 0, bmin [2], bmax [0], 0, bmin [2], bmax [0], 0, bmax [2], bmin [0], 0, bmax [2]]
+            let tris: [Int32] = [0, 2, 1, 0, 3, 2]
+            _ = bindingTileGeometryAdd (geometry, verts, 4, tris, 2)
+        }
+        let gen = try XCTUnwrap (bindingCreateTileGenerator (&params, provider, nil))
+        defer { bindingFreeTileGenerator (gen) }
+        let point: [Float] = [9.6, 0, 9.6]
+        bindingTileGeneratorSetInterestPoints (gen, point, 1)
+
+        var stats = BindingTileGeneratorStats ()
+        var updates = 0
+        let deadline = Date ().addingTimeInterval (10)
+        repeat {
+            _ = bindingTileGeneratorUpdate (gen, 16)
+            updates += 1
+            bindingTileGeneratorGetStats (gen, &stats)
+            Thread.sleep (forTimeInterval: 0.001)
+        } while stats.pending > 0 && Date () < deadline
+        XCTAssertEqual (stats.loaded, 2)
+        XCTAssertEqual (stats.failed, 2)
+        XCTAssertEqual (stats.buildsFailed, 6)
+        // The failures waited 2 and 4 updates before they were built again
+        XCTAssertGreaterThanOrEqual (updates, 7)
+
+        // Failed tiles are not built again while they are wanted
+        for _ in 0..<20 {
+            _ = bindingTileGeneratorUpdate (gen, 16)
+            Thread.sleep (forTimeInterval: 0.001)
+        }
+        bindingTileGeneratorGetStats (gen, &stats)
+        XCTAssertEqual (stats.failed, 2)
+        XCTAssertEqual (stats.buildsFailed, 6)
+        XCTAssertEqual (bindingTileGeneratorPendingCount (gen), 0)
+    }
+}
@@ -0,0 +1,164 @@
+import Foundation
+import CRecast
+@testable import SwiftNavigation
+
+/// A 64x64 plane with four boxes on it, baked into a tile file of 7x7 tiles.
+///
+/// The tiles are also kept in memory, so the tests can add them to navigation
+/// meshes of their own.
+final class TiledScene {
+    enum SceneError: Error {
+        case tileMesh
+        case bake
+    }
+
+    /// The tile file has a header with the magic, the version, the navigation mesh
+    /// parameters and the tile count, followed by an entry per tile.
+    static let headerSize = 8 + MemoryLayout<dtNavMeshParams>.size + 4
+    /// The x, y, layer and size of the tile as Int32, and its offset as Int64
+    static let entrySize = 24
+    static let entrySizeOffset = 12
+    static let entryDataOffset = 16
+
+    static let freeData = Int32 (DT_TILE_FREE_DATA.rawValue)
+
+    let path: String
+    let params: dtNavMeshParams
+    let tiles: [[UInt8]]
+
+    static func geometry () -> (vertices: [Float], triangles: [Int32]) {
+        let n = 64
+        var vertices: [Float] = []
+        var triangles: [Int32] = []
+        for z in 0...n {
+            for x in 0...n {
+                vertices += [Float (x), 0, Float (z)]
+            }
+        }
+        for z in 0..<n {
+            for x in 0..<n {
+                let a = Int32 (z * (n + 1) + x), c = a + Int32 (n + 1)
+                triangles += [a, c, a + 1, a + 1, c, c + 1]
+            }
+        }
+        let faces: [Int32] = [4, 6, 5, 4, 7, 6, 0, 1, 5, 0, 5, 4, 1, 2, 6, 1, 6, 5, 2, 3, 7, 2, 7, 6, 3, 0, 4, 3, 4, 7]
+        for corner: SIMD2<Float> in [[12, 12], [40, 18], [20, 44], [48, 48]] {
+            let base = Int32 (vertices.count / 3)
+            for y: Float in [0, 3] {
+                vertices += [corner.x, y, corner.y, corner.x + 6, y, corner.y]
+                vertices += [corner.x + 6, y, corner.y + 6, corner.x, y, corner.y + 6]
+            }
+            triangles += faces.map { base + $0 }
+        }
+        return (vertices, triangles)
+    }
+
+    init () throws {
+        path = FileManager.default.temporaryDirectory.appendingPathComponent ("scene-\(UUID ().uuidString).tiles").path
+
+        let (vertices, triangles) = TiledScene.geometry ()
+        var config = rcConfig ()
+        config.cs = 0.3
+        config.ch = 0.2
+        config.walkableSlopeAngle = 45
+        config.walkableHeight = 10
+        config.walkableClimb = 4
+        config.walkableRadius = 2
+        config.maxEdgeLen = 12
+        config.maxSimplificationError = 1.3
+        config.minRegionArea = 8
+        config.mergeRegionArea = 20
+        config.maxVertsPerPoly = 6
+        config.detailSampleDist = 6
+        config.detailSampleMaxError = 1
+        config.tileSize = 32
+        config.borderSize = config.walkableRadius + 3
+        guard let mesh = bindingCreateTileMesh (&config, 2, vertices, Int32 (vertices.count/3), triangles, Int32 (triangles.count/3)) else {
+            throw SceneError.tileMesh
+        }
+        defer { bindingFreeTileMesh (mesh) }
+        config.bmin.1 -= 1
+        config.bmax.1 += 1
+
+        var bake = BindingTileBakeParams ()
+        bake.config = config
+        bake.flags = Int32 (PARTITION_WATERSHED)
+        bake.agentHeight = 2
+        bake.agentRadius = 0.6
+        bake.agentMaxClimb = 0.9
+        bake.maxTiles = 128
+        bake.maxPolysPerTile = 1024
+        bake.numThreads = 2
+        let provider: BindingTileGeometryProvider = { userData, tx, ty, bmin, bmax, geometry in
+            bindingTileMeshGeometry (userData, tx, ty, bmin, bmax, geometry)
+        }
+        var stats = BindingTileBakeStats ()
+        guard bindingBakeTiles (&bake, provider, UnsafeMutableRawPointer (mesh), path, &stats), stats.tilesFailed == 0 else {
+            throw SceneError.bake
+        }
+
+        let file = try Data (contentsOf: URL (fileURLWithPath: path))
+        var params = dtNavMeshParams ()
+        var tiles: [[UInt8]] = []
+        file.withUnsafeBytes { raw in
+            params = raw.loadUnaligned (fromByteOffset: 8, as: dtNavMeshParams.self)
+            let count = Int (raw.loadUnaligned (fromByteOffset: TiledScene.headerSize - 4, as: Int32.self))
+            for i in 0..<count {
+                let entry = TiledScene.headerSize + i * TiledScene.entrySize
+                let size = Int (raw.loadUnaligned (fromByteOffset: entry + TiledScene.entrySizeOffset, as: Int32.self))
+                let offset = Int (raw.loadUnaligned (fromByteOffset: entry + TiledScene.entryDataOffset, as: Int64.self))
+                tiles.append (Array (raw [offset..<offset+size]))
+            }
+        }
+        self.params = params
+        self.tiles = tiles
+    }
+
+    deinit {
+        try? FileManager.default.removeItem (atPath: path)
+    }
+
+    /// Copies a tile into memory allocated by Detour, to add it with DT_TILE_FREE_DATA
+    func copyTile (_ i: Int) -> UnsafeMutablePointer<UInt8> {
+        let data = dtAlloc (tiles [i].count, DT_ALLOC_PERM)!.bindMemory (to: UInt8.self, capacity: tiles [i].count)
+        data.initialize (from: tiles [i], count: tiles [i].count)
+        return data
+    }
+
+    /// Creates a navigation mesh with the parameters of the scene, without any tile
+    func makeNavMesh () throws -> dtNavMesh {
+        guard let nav = dtAllocNavMesh () else {
+            throw NavMesh.NavMeshError.alloc
+        }
+        var params = self.params
+        let status = nav.`init` (&params)
+        if dtStatusFailed (status) {
+            dtFreeNavMesh (nav)
+            throw NavMesh.statusToError (status)
+        }
+        return nav
+    }
+
+    /// Creates a navigation mesh with every tile of the scene, added one at a time
+    func makeLoadedNavMesh () throws -> dtNavMesh {
+        let nav = try makeNavMesh ()
+        for i in 0..<tiles.count {
+            let status = nav.addTile (copyTile (i), Int32 (tiles [i].count), TiledScene.freeData, 0, nil)
+            if dtStatusFailed (status) {
+                dtFreeNavMesh (nav)
+                throw NavMesh.statusToError (status)
+            }
+        }
+        return nav
+    }
+}
+
+func tileCount (_ nav: dtNavMesh) -> Int {
+    var count = 0
+    for i in 0..<nav.getMaxTiles () {
+        if let tile = nav.getTile (i), tile.pointee.header != nil {
+            count += 1
+        }
+    }
+    return count
+}